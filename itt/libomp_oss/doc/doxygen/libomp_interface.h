@@ -297,6 +297,8 @@ so they are only described once.
 
 Static loop scheduling is handled by  @ref __kmpc_for_static_init_4 and friends. Only a single call is needed,
 since the iterations to be executed by any give thread can be determined as soon as the loop parameters are known.
+The common unchunked <tt>schedule(static)</tt> loop with unit stride can use the shorter
+@ref __kmpc_for_static_init_simple_4 and friends instead.
 
 Dynamic scheduling is handled by the @ref __kmpc_dispatch_init_4 and @ref __kmpc_dispatch_next_4 functions. 
 The init function is called once in each thread outside the loop, while the next function is called each
@@ -0,0 +1,650 @@
+// bench-overhead.c //
+
+/* <copyright>
+    Copyright (c) 2013 Intel Corporation.  All Rights Reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+      * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the name of Intel Corporation nor the names of its
+        contributors may be used to endorse or promote products derived
+        from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+------------------------------------------------------------------------
+
+    Portions of this software are protected under the following patents:
+        U.S. Patent 5,812,852
+        U.S. Patent 6,792,599
+        U.S. Patent 7,069,556
+        U.S. Patent 7,328,433
+        U.S. Patent 7,500,242
+
+  </copyright> */
+
+/*
+ * Overhead micro-benchmarks in the style of the EPCC OpenMP suite.
+ *
+ * Each construct is driven through the __kmpc_* entry points the compiler would call, so the
+ * program is built with a plain C compiler and measures the library, not a compiler's OpenMP
+ * lowering.  For every test the construct wraps delay() and is repeated until one sample takes
+ * at least the target time; the overhead is the sample time minus the same amount of delay()
+ * executed serially, divided by the number of constructs.
+ *
+ * Barrier patterns, lock kinds, reduction methods, affinity and the runtime schedule are chosen
+ * with the usual KMP_* / OMP_* environment variables; their values are printed with every
+ * record.  tools/run-bench.pl sweeps them along with thread counts.
+ *
+ * Usage: bench-overhead [-t threads] [-r samples] [-d delay] [-i iters] [-T target_us] [-H] [-P]
+ *                       [test...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef int       kmp_int32;
+typedef long long kmp_int64;
+
+typedef struct ident {
+    kmp_int32    reserved_1;
+    kmp_int32    flags;
+    kmp_int32    reserved_2;
+    kmp_int32    reserved_3;
+    char const * psource;
+} ident_t;
+
+#define KMP_IDENT_KMPC            0x02
+#define KMP_IDENT_ATOMIC_REDUCE   0x10
+
+typedef kmp_int32 kmp_critical_name[ 8 ];
+typedef void   (* kmpc_micro )( kmp_int32 * gtid, kmp_int32 * btid, ... );
+typedef kmp_int32 (* kmp_routine_entry_t )( kmp_int32, void * );
+
+typedef struct kmp_task {
+    void *              shareds;
+    kmp_routine_entry_t routine;
+    kmp_int32           part_id;
+} kmp_task_t;
+
+#define TASK_TIED   1
+
+extern void      __kmpc_fork_call( ident_t *, kmp_int32, kmpc_micro, ... );
+extern kmp_int32 __kmpc_global_thread_num( ident_t * );
+extern void      __kmpc_barrier( ident_t *, kmp_int32 );
+extern kmp_int32 __kmpc_single( ident_t *, kmp_int32 );
+extern void      __kmpc_end_single( ident_t *, kmp_int32 );
+extern void      __kmpc_critical( ident_t *, kmp_int32, kmp_critical_name * );
+extern void      __kmpc_end_critical( ident_t *, kmp_int32, kmp_critical_name * );
+extern void      __kmpc_init_lock( ident_t *, kmp_int32, void ** );
+extern void      __kmpc_destroy_lock( ident_t *, kmp_int32, void ** );
+extern void      __kmpc_set_lock( ident_t *, kmp_int32, void ** );
+extern void      __kmpc_unset_lock( ident_t *, kmp_int32, void ** );
+extern void      __kmpc_for_static_init_4( ident_t *, kmp_int32, kmp_int32, kmp_int32 *,
+                                           kmp_int32 *, kmp_int32 *, kmp_int32 *, kmp_int32,
+                                           kmp_int32 );
+extern void      __kmpc_for_static_fini( ident_t *, kmp_int32 );
+extern void      __kmpc_dispatch_init_4( ident_t *, kmp_int32, kmp_int32, kmp_int32, kmp_int32,
+                                         kmp_int32, kmp_int32 );
+extern int       __kmpc_dispatch_next_4( ident_t *, kmp_int32, kmp_int32 *, kmp_int32 *,
+                                         kmp_int32 *, kmp_int32 * );
+extern kmp_int32 __kmpc_reduce( ident_t *, kmp_int32, kmp_int32, size_t, void *,
+                                void (*)( void *, void * ), kmp_critical_name * );
+extern void      __kmpc_end_reduce( ident_t *, kmp_int32, kmp_critical_name * );
+extern kmp_task_t * __kmpc_omp_task_alloc( ident_t *, kmp_int32, kmp_int32, size_t, size_t,
+                                           kmp_routine_entry_t );
+extern kmp_int32 __kmpc_omp_task( ident_t *, kmp_int32, kmp_task_t * );
+extern void      __kmpc_omp_task_begin_if0( ident_t *, kmp_int32, kmp_task_t * );
+extern void      __kmpc_omp_task_complete_if0( ident_t *, kmp_int32, kmp_task_t * );
+
+extern void __kmpc_atomic_fixed4_add(  ident_t *, int, kmp_int32 *,          kmp_int32 );
+extern void __kmpc_atomic_fixed8_add(  ident_t *, int, kmp_int64 *,          kmp_int64 );
+extern void __kmpc_atomic_float4_add(  ident_t *, int, float *,              float );
+extern void __kmpc_atomic_float8_add(  ident_t *, int, double *,             double );
+extern void __kmpc_atomic_float10_add( ident_t *, int, long double *,        long double );
+extern void __kmpc_atomic_cmplx4_add(  ident_t *, int, float _Complex *,     float _Complex );
+extern void __kmpc_atomic_cmplx8_add(  ident_t *, int, double _Complex *,    double _Complex );
+extern void __kmpc_atomic_cmplx10_add( ident_t *, int, long double _Complex *, long double _Complex );
+
+extern double omp_get_wtime( void );
+extern void   omp_set_num_threads( int );
+extern int    omp_get_num_procs( void );
+
+static ident_t loc     = { 0, KMP_IDENT_KMPC, 0, 0, ";bench-overhead.c;bench;0;0;;" };
+static ident_t loc_red = { 0, KMP_IDENT_KMPC | KMP_IDENT_ATOMIC_REDUCE, 0, 0,
+                           ";bench-overhead.c;reduction;0;0;;" };
+
+static int    nthreads      = 1;
+static int    outer_reps    = 20;
+static int    delay_length  = 100;
+static int    iters         = 128;     // Loop iterations per thread in the "for" tests.
+static double target_us     = 1000.0;  // Minimal duration of one sample.
+
+static volatile int bench_sink;
+
+static void
+delay( int length )
+{
+    int i;
+    float a = 0.0f;
+    for ( i = 0; i < length; ++ i ) {
+        a += i;
+    }
+    if ( a < 0 ) {
+        bench_sink = (int) a;   // Never true, keeps the loop alive.
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Tests. Each one executes reps constructs; reps is always a multiple of nthreads.
+// -------------------------------------------------------------------------------------------------
+
+typedef struct bench_test {
+    char const * name;
+    char const * variant;
+    kmpc_micro   micro;    // Runs the constructs inside one parallel region, NULL for "parallel".
+    int          ref;      // delay() calls per construct in the serial reference, REF_ITERS for "for".
+    int          param;
+} bench_test_t;
+
+#define REF_ITERS  -1
+
+static bench_test_t const * cur_test;
+static int                  cur_reps;
+
+// --- parallel ---
+
+static void
+micro_delay( kmp_int32 * gtid, kmp_int32 * btid )
+{
+    delay( delay_length );
+}
+
+
+// --- for ---
+
+static struct {
+    char const * name;
+    kmp_int32    kind;     // kmp_sch_* value.
+    kmp_int32    chunk;
+    int          dispatch; // Goes through __kmpc_dispatch_* rather than __kmpc_for_static_*.
+} const schedules[] = {
+    { "static",                    34, 0, 0 },
+    { "static_chunked",            33, 1, 0 },
+    { "dynamic_chunked",           35, 1, 1 },
+    { "guided_chunked",            36, 1, 1 },
+    { "runtime",                   37, 0, 1 },
+    { "auto",                      38, 0, 1 },
+    { "trapezoidal",               39, 1, 1 },
+    { "static_greedy",             40, 0, 1 },
+    { "static_balanced",           41, 0, 1 },
+    { "guided_iterative_chunked",  42, 1, 1 },
+    { "guided_analytical_chunked", 43, 1, 1 },
+    { "static_steal",              44, 1, 1 },
+};
+
+static void
+micro_for( kmp_int32 * gtid, kmp_int32 * btid )
+{
+    int       s    = cur_test->param;
+    kmp_int32 last = nthreads * iters - 1;
+    int       r;
+    kmp_int32 i, lb, ub, st, liter;
+
+    for ( r = 0; r < cur_reps; ++ r ) {
+        if ( schedules[ s ].dispatch ) {
+            __kmpc_dispatch_init_4( & loc, * gtid, schedules[ s ].kind, 0, last, 1,
+                                    schedules[ s ].chunk );
+            while ( __kmpc_dispatch_next_4( & loc, * gtid, & liter, & lb, & ub, & st ) ) {
+                for ( i = lb; i <= ub; ++ i ) {
+                    delay( delay_length );
+                }
+            }
+        } else {
+            liter = 0; lb = 0; ub = last; st = 1;
+            __kmpc_for_static_init_4( & loc, * gtid, schedules[ s ].kind, & liter, & lb, & ub,
+                                      & st, 1, schedules[ s ].chunk );
+            for ( ; lb <= last; lb += st, ub += st ) {
+                for ( i = lb; i <= ( ub < last ? ub : last ); ++ i ) {
+                    delay( delay_length );
+                }
+                if ( schedules[ s ].chunk == 0 ) {
+                    break;
+                }
+            }
+            __kmpc_for_static_fini( & loc, * gtid );
+        }
+        __kmpc_barrier( & loc, * gtid );
+    }
+}
+
+// --- barrier ---
+
+static void
+micro_barrier( kmp_int32 * gtid, kmp_int32 * btid )
+{
+    int r;
+    for ( r = 0; r < cur_reps; ++ r ) {
+        delay( delay_length );
+        __kmpc_barrier( & loc, * gtid );
+    }
+}
+
+// --- single ---
+
+static void
+micro_single( kmp_int32 * gtid, kmp_int32 * btid )
+{
+    int r;
+    for ( r = 0; r < cur_reps; ++ r ) {
+        if ( __kmpc_single( & loc, * gtid ) ) {
+            delay( delay_length );
+            __kmpc_end_single( & loc, * gtid );
+        }
+        __kmpc_barrier( & loc, * gtid );
+    }
+}
+
+// --- critical, lock ---
+
+static kmp_critical_name crit;
+static void *            lock;
+
+static void
+micro_critical( kmp_int32 * gtid, kmp_int32 * btid )
+{
+    int r;
+    for ( r = 0; r < cur_reps / nthreads; ++ r ) {
+        __kmpc_critical( & loc, * gtid, & crit );
+        delay( delay_length );
+        __kmpc_end_critical( & loc, * gtid, & crit );
+    }
+}
+
+static void
+micro_lock( kmp_int32 * gtid, kmp_int32 * btid )
+{
+    int r;
+    for ( r = 0; r < cur_reps / nthreads; ++ r ) {
+        __kmpc_set_lock( & loc, * gtid, & lock );
+        delay( delay_length );
+        __kmpc_unset_lock( & loc, * gtid, & lock );
+    }
+}
+
+// --- atomic ---
+
+static kmp_int32            a_fixed4;
+static kmp_int64            a_fixed8;
+static float                a_float4;
+static double               a_float8;
+static long double          a_float10;
+static float _Complex       a_cmplx4;
+static double _Complex      a_cmplx8;
+static long double _Complex a_cmplx10;
+
+static char const * const atomic_types[] = {
+    "fixed4", "fixed8", "float4", "float8", "float10", "cmplx4", "cmplx8", "cmplx10"
+};
+
+static void
+micro_atomic( kmp_int32 * gtid, kmp_int32 * btid )
+{
+    int n = cur_reps / nthreads;
+    int r;
+    switch ( cur_test->param ) {
+        case 0: for ( r = 0; r < n; ++ r ) __kmpc_atomic_fixed4_add(  & loc, * gtid, & a_fixed4,  1 );    break;
+        case 1: for ( r = 0; r < n; ++ r ) __kmpc_atomic_fixed8_add(  & loc, * gtid, & a_fixed8,  1 );    break;
+        case 2: for ( r = 0; r < n; ++ r ) __kmpc_atomic_float4_add(  & loc, * gtid, & a_float4,  1.0f ); break;
+        case 3: for ( r = 0; r < n; ++ r ) __kmpc_atomic_float8_add(  & loc, * gtid, & a_float8,  1.0 );  break;
+        case 4: for ( r = 0; r < n; ++ r ) __kmpc_atomic_float10_add( & loc, * gtid, & a_float10, 1.0L ); break;
+        case 5: for ( r = 0; r < n; ++ r ) __kmpc_atomic_cmplx4_add(  & loc, * gtid, & a_cmplx4,  1.0f ); break;
+        case 6: for ( r = 0; r < n; ++ r ) __kmpc_atomic_cmplx8_add(  & loc, * gtid, & a_cmplx8,  1.0 );  break;
+        case 7: for ( r = 0; r < n; ++ r ) __kmpc_atomic_cmplx10_add( & loc, * gtid, & a_cmplx10, 1.0L ); break;
+    }
+}
+
+// --- reduction ---
+
+static kmp_critical_name red_crit;
+static kmp_int32         red_sum;
+
+static void
+reduce_func( void * lhs, void * rhs )
+{
+    * (kmp_int32 *) lhs += * (kmp_int32 *) rhs;
+}
+
+static void
+micro_reduction( kmp_int32 * gtid, kmp_int32 * btid )
+{
+    int       r;
+    kmp_int32 priv;
+    for ( r = 0; r < cur_reps; ++ r ) {
+        priv = 1;
+        delay( delay_length );
+        switch ( __kmpc_reduce( & loc_red, * gtid, 1, sizeof( priv ), & priv, reduce_func,
+                                & red_crit ) ) {
+            case 1:
+                red_sum += priv;
+                __kmpc_end_reduce( & loc_red, * gtid, & red_crit );
+                break;
+            case 2:
+                __kmpc_atomic_fixed4_add( & loc_red, * gtid, & red_sum, priv );
+                __kmpc_end_reduce( & loc_red, * gtid, & red_crit );
+                break;
+        }
+    }
+}
+
+// --- task ---
+
+static kmp_int32
+task_entry( kmp_int32 gtid, void * task )
+{
+    delay( delay_length );
+    return 0;
+}
+
+static void
+spawn_tasks( kmp_int32 gtid, int n )
+{
+    int i;
+    for ( i = 0; i < n; ++ i ) {
+        __kmpc_omp_task( & loc, gtid,
+            __kmpc_omp_task_alloc( & loc, gtid, TASK_TIED, sizeof( kmp_task_t ), 0, task_entry ) );
+    }
+}
+
+static void
+micro_task( kmp_int32 * gtid, kmp_int32 * btid )
+{
+    int r;
+    kmp_task_t * task;
+    switch ( cur_test->param ) {
+        case 0:     // Every thread creates and mostly executes its own tasks.
+            spawn_tasks( * gtid, cur_reps );
+            break;
+        case 1:     // One thread creates all the tasks, the others have to steal them.
+            if ( __kmpc_single( & loc, * gtid ) ) {
+                spawn_tasks( * gtid, cur_reps * nthreads );
+                __kmpc_end_single( & loc, * gtid );
+            }
+            break;
+        case 2:     // Undeferred (if(0)) tasks: create and execute immediately.
+            for ( r = 0; r < cur_reps; ++ r ) {
+                task = __kmpc_omp_task_alloc( & loc, * gtid, TASK_TIED, sizeof( kmp_task_t ), 0,
+                                              task_entry );
+                __kmpc_omp_task_begin_if0( & loc, * gtid, task );
+                task_entry( * gtid, task );
+                __kmpc_omp_task_complete_if0( & loc, * gtid, task );
+            }
+            break;
+    }
+    __kmpc_barrier( & loc, * gtid );
+}
+
+static void
+run( bench_test_t const * test, int reps )
+{
+    int r;
+    if ( test->micro == NULL ) {
+        for ( r = 0; r < reps; ++ r ) {
+            __kmpc_fork_call( & loc, 0, (kmpc_micro) micro_delay );
+        }
+    } else {
+        cur_test = test;
+        cur_reps = reps;
+        __kmpc_fork_call( & loc, 0, test->micro );
+    }
+}
+
+static bench_test_t tests[ 64 ];
+static int          n_tests;
+
+static void
+add_test( char const * name, char const * variant, void * micro, int ref, int param )
+{
+    bench_test_t * t = & tests[ n_tests ++ ];
+    t->name    = name;
+    t->variant = variant;
+    t->micro   = (kmpc_micro) micro;
+    t->ref     = ref;
+    t->param   = param;
+}
+
+static void
+init_tests( void )
+{
+    int i;
+    add_test( "parallel", "-", NULL, 1, 0 );
+    for ( i = 0; i < (int)( sizeof( schedules ) / sizeof( schedules[ 0 ] ) ); ++ i ) {
+        add_test( "for", schedules[ i ].name, micro_for, REF_ITERS, i );
+    }
+    add_test( "barrier",  "-", micro_barrier,  1, 0 );
+    add_test( "single",   "-", micro_single,   1, 0 );
+    add_test( "critical", "-", micro_critical, 1, 0 );
+    add_test( "lock",     "-", micro_lock,     1, 0 );
+    for ( i = 0; i < (int)( sizeof( atomic_types ) / sizeof( atomic_types[ 0 ] ) ); ++ i ) {
+        add_test( "atomic", atomic_types[ i ], micro_atomic, 0, i );
+    }
+    add_test( "reduction", "-",        micro_reduction, 1, 0 );
+    add_test( "task",      "parallel", micro_task,      1, 0 );
+    add_test( "task",      "master",   micro_task,      1, 1 );
+    add_test( "task",      "if0",      micro_task,      1, 2 );
+}
+
+// -------------------------------------------------------------------------------------------------
+// Measurement.
+// -------------------------------------------------------------------------------------------------
+
+static double delay_us;    // Time of one delay( delay_length ) call.
+
+static void
+calibrate_delay( void )
+{
+    int    n = 1;
+    int    i;
+    double t;
+    for ( ; ; ) {
+        t = omp_get_wtime();
+        for ( i = 0; i < n; ++ i ) {
+            delay( delay_length );
+        }
+        t = ( omp_get_wtime() - t ) * 1.0e6;
+        if ( t >= target_us || n >= ( 1 << 30 ) ) {
+            break;
+        }
+        n *= 2;
+    }
+    delay_us = t / n;
+}
+
+// Delay work per construct that the serial reference executes, in microseconds.
+static double
+reference_us( bench_test_t const * test )
+{
+    return ( test->ref == REF_ITERS ? iters : test->ref ) * delay_us;
+}
+
+static void
+measure( bench_test_t const * test )
+{
+    int    reps = nthreads;
+    int    k;
+    double t, sum = 0.0, sum2 = 0.0, min = 0.0, ovh, mean, sd;
+
+    // Grow the number of constructs per sample until a sample is long enough.
+    for ( ; ; ) {
+        t = omp_get_wtime();
+        run( test, reps );
+        t = ( omp_get_wtime() - t ) * 1.0e6;
+        if ( t >= target_us || reps >= ( 1 << 24 ) ) {
+            break;
+        }
+        reps *= 2;
+    }
+
+    for ( k = 0; k < outer_reps; ++ k ) {
+        t = omp_get_wtime();
+        run( test, reps );
+        t = ( omp_get_wtime() - t ) * 1.0e6;
+        ovh = t / reps - reference_us( test );
+        sum  += ovh;
+        sum2 += ovh * ovh;
+        if ( k == 0 || ovh < min ) {
+            min = ovh;
+        }
+    }
+    mean = sum / outer_reps;
+    sd   = outer_reps > 1 ? sqrt( fabs( sum2 - sum * mean ) / ( outer_reps - 1 ) ) : 0.0;
+
+    printf( "%s,%s,%d,%d,%.4f,%.4f,%.4f", test->name, test->variant, nthreads, reps, mean, sd, min );
+}
+
+static char const * const env_columns[] = {
+    "KMP_FORKJOIN_BARRIER_PATTERN",
+    "KMP_PLAIN_BARRIER_PATTERN",
+    "KMP_REDUCTION_BARRIER_PATTERN",
+    "KMP_LOCK_KIND",
+    "KMP_FORCE_REDUCTION",
+    "KMP_AFFINITY",
+    "OMP_SCHEDULE",
+    "KMP_BLOCKTIME"
+};
+#define N_ENV_COLUMNS  ( sizeof( env_columns ) / sizeof( env_columns[ 0 ] ) )
+
+static void
+print_header( void )
+{
+    unsigned i;
+    printf( "test,variant,threads,reps,overhead_us,sd_us,min_us" );
+    for ( i = 0; i < N_ENV_COLUMNS; ++ i ) {
+        printf( ",%s", env_columns[ i ] );
+    }
+    printf( "\n" );
+}
+
+static void
+print_env( void )
+{
+    unsigned     i;
+    char const * value;
+    for ( i = 0; i < N_ENV_COLUMNS; ++ i ) {
+        value = getenv( env_columns[ i ] );
+        printf( ",\"%s\"", value != NULL ? value : "" );
+    }
+    printf( "\n" );
+}
+
+static void
+usage( void )
+{
+    int i;
+    fprintf( stderr,
+        "usage: bench-overhead [-t threads] [-r samples] [-d delay] [-i iters] [-T target_us]\n"
+        "                      [-H] [-P] [test...]\n"
+        "  -H  print the CSV header first\n"
+        "  -P  print the number of processors and exit\n"
+        "tests:" );
+    for ( i = 0; i < n_tests; ++ i ) {
+        if ( i == 0 || strcmp( tests[ i ].name, tests[ i - 1 ].name ) != 0 ) {
+            fprintf( stderr, " %s", tests[ i ].name );
+        }
+    }
+    fprintf( stderr, "\n" );
+    exit( 2 );
+}
+
+int
+main( int argc, char ** argv )
+{
+    int    header = 0;
+    int    a, i;
+    int    gtid;
+    int    selected = 0;
+    char * sel[ 64 ];
+
+    init_tests();
+    nthreads = omp_get_num_procs();
+    for ( a = 1; a < argc; ++ a ) {
+        if ( argv[ a ][ 0 ] == '-' ) {
+            char opt = argv[ a ][ 1 ];
+            if ( opt == 'H' ) {
+                header = 1;
+            } else if ( opt == 'P' ) {
+                printf( "%d\n", omp_get_num_procs() );
+                return 0;
+            } else if ( opt != 0 && strchr( "trdiT", opt ) != NULL && a + 1 < argc ) {
+                char const * v = argv[ ++ a ];
+                switch ( opt ) {
+                    case 't': nthreads     = atoi( v ); break;
+                    case 'r': outer_reps   = atoi( v ); break;
+                    case 'd': delay_length = atoi( v ); break;
+                    case 'i': iters        = atoi( v ); break;
+                    case 'T': target_us    = atof( v ); break;
+                }
+            } else {
+                usage();
+            }
+        } else if ( selected < 64 ) {
+            sel[ selected ++ ] = argv[ a ];
+        }
+    }
+    if ( nthreads < 1 || outer_reps < 1 || delay_length < 0 || iters < 1 || target_us <= 0 ) {
+        usage();
+    }
+    for ( a = 0; a < selected; ++ a ) {
+        for ( i = 0; i < n_tests && strcmp( tests[ i ].name, sel[ a ] ) != 0; ++ i ) {
+        }
+        if ( i == n_tests ) {
+            fprintf( stderr, "bench-overhead: unknown test \"%s\"\n", sel[ a ] );
+            usage();
+        }
+    }
+
+    omp_set_num_threads( nthreads );
+    __kmpc_fork_call( & loc, 0, (kmpc_micro) micro_delay );  // Start the threads up.
+    gtid = __kmpc_global_thread_num( & loc );
+    __kmpc_init_lock( & loc, gtid, & lock );
+    calibrate_delay();
+
+    if ( header ) {
+        print_header();
+    }
+    for ( i = 0; i < n_tests; ++ i ) {
+        if ( selected ) {
+            for ( a = 0; a < selected && strcmp( tests[ i ].name, sel[ a ] ) != 0; ++ a ) {
+            }
+            if ( a == selected ) {
+                continue;
+            }
+        }
+        measure( & tests[ i ] );
+        print_env();
+        fflush( stdout );
+    }
+    __kmpc_destroy_lock( & loc, gtid, & lock );
+    return 0;
+}
+
+// end of file //
@@ -70,9 +70,8 @@ typedef __float128 _Quad;
 #define TASK_CURRENT_NOT_QUEUED  0
 #define TASK_CURRENT_QUEUED      1
 
-#define TASK_DEQUE_BITS          8  // Used solely to define TASK_DEQUE_SIZE and TASK_DEQUE_MASK.
-#define TASK_DEQUE_SIZE          ( 1 << TASK_DEQUE_BITS )
-#define TASK_DEQUE_MASK          ( TASK_DEQUE_SIZE - 1 )
+#define TASK_DEQUE_BITS          8  // Used solely to define TASK_DEQUE_SIZE.
+#define TASK_DEQUE_SIZE          ( 1 << TASK_DEQUE_BITS )  // Initial size; deques double when full
 
 #ifdef BUILD_TIED_TASK_STACK
 #define TASK_STACK_EMPTY         0  // entries when the stack is empty
@@ -84,6 +83,10 @@ typedef __float128 _Quad;
 
 #define TASK_NOT_PUSHED          1
 #define TASK_SUCCESSFULLY_PUSHED 0
+
+#define TASKLOOP_TASKS_PER_THREAD  10  // Tasks a taskloop without grainsize/num_tasks creates per thread
+#define TASKLOOP_LEAF_TASKS        8   // A taskloop range of at most this many tasks is no longer split
+#define TASK_DEP_FREE_LIST_MAX     256 // Freed dependence chunks a thread keeps; the rest go back to the allocator
 #define TASK_TIED                1
 #define TASK_UNTIED              0
 #define TASK_EXPLICIT            1
@@ -157,6 +160,19 @@ typedef __float128 _Quad;
 #define USE_FAST_MEMORY 3
 #endif
 
+// Runtime statistics (kmp_stats.h), off unless requested at build time.
+#ifndef KMP_STATS_ENABLED
+#define KMP_STATS_ENABLED 0
+#endif
+
+// Tool interface (ompt.h, kmp_ompt.h); costs one branch per event when no tool is attached.
+#ifndef OMPT_SUPPORT
+#define OMPT_SUPPORT 1
+#endif
+#if OMPT_SUPPORT
+#include "ompt.h"
+#endif
+
 // Assume using BGET compare_exchange instruction instead of lock by default.
 #ifndef USE_CMP_XCHG_FOR_BGET
 #define USE_CMP_XCHG_FOR_BGET 1
@@ -291,8 +307,8 @@ typedef enum kmp_sched {
     kmp_sched_upper_std         = 5,     // upper bound for standard schedules
     kmp_sched_lower_ext         = 100,   // lower bound of Intel extension schedules
     kmp_sched_trapezoidal       = 101,   // mapped to kmp_sch_trapezoidal              (39)
-//  kmp_sched_static_steal      = 102,   // mapped to kmp_sch_static_steal             (44)
-    kmp_sched_upper             = 102,
+    kmp_sched_static_steal      = 102,   // mapped to kmp_sch_static_steal             (44)
+    kmp_sched_upper             = 103,
     kmp_sched_default = kmp_sched_static // default scheduling
 } kmp_sched_t;
 #endif
@@ -318,7 +334,7 @@ enum sched_type {
     kmp_sch_guided_iterative_chunked  = 42,
     kmp_sch_guided_analytical_chunked = 43,
 
-    kmp_sch_static_steal              = 44,   /**< accessible only through KMP_SCHEDULE environment variable */
+    kmp_sch_static_steal              = 44,   /**< accessible through OMP_SCHEDULE and kmp_sched_static_steal */
 
     /* accessible only through KMP_SCHEDULE environment variable */
     kmp_sch_upper                     = 45,   /**< upper bound for unordered values */
@@ -725,6 +741,8 @@ extern int __kmp_affinity_respect_mask; /* Respect process' initial affinity mas
 extern char * __kmp_affinity_proclist; /* proc ID list */
 extern kmp_affin_mask_t *__kmp_affinity_masks;
 extern unsigned __kmp_affinity_num_masks;
+extern int *__kmp_affinity_place_node; /* node (package) of each of __kmp_affinity_masks */
+extern int __kmp_affinity_num_nodes;
 extern int __kmp_get_system_affinity(kmp_affin_mask_t *mask, int abort_on_error);
 extern int __kmp_set_system_affinity(kmp_affin_mask_t const *mask, int abort_on_error);
 extern void __kmp_affinity_bind_thread(int which);
@@ -764,6 +782,18 @@ typedef struct kmp_nested_proc_bind_t {
 
 extern kmp_nested_proc_bind_t __kmp_nested_proc_bind;
 
+//
+// Lock hints, see omp_init_lock_with_hint().
+// This needs to be kept in sync with the values in omp.h !!!
+//
+typedef enum kmp_lock_hint_t {
+    kmp_lock_hint_none           = 0,
+    kmp_lock_hint_uncontended    = 1,
+    kmp_lock_hint_contended      = 1 << 1,
+    kmp_lock_hint_nonspeculative = 1 << 2,
+    kmp_lock_hint_speculative    = 1 << 3
+} kmp_lock_hint_t;
+
 # if (KMP_OS_WINDOWS || KMP_OS_LINUX)
 #  define KMP_PLACE_ALL       (-1)
 #  define KMP_PLACE_UNDEFINED (-2)
@@ -884,6 +914,25 @@ extern unsigned int __kmp_place_core_offset;
                                  ( ( (blocktime) + (KMP_BLOCKTIME_MULTIPLIER / (monitor_wakeups)) - 1 ) /  \
                                    (KMP_BLOCKTIME_MULTIPLIER / (monitor_wakeups)) )
 
+/*
+ * Adaptive waiting (KMP_ADAPTIVE_WAIT): each thread keeps a decayed average of
+ * its recent wait times, in timestamp ticks, for a few wait sites (barrier flags
+ * and locks), hashed by address.  A wait spins for at most twice the predicted
+ * time plus KMP_ADAPTIVE_SPIN_MIN; if the prediction exceeds KMP_ADAPTIVE_SPIN_MAX
+ * the thread parks at once.
+ */
+#define KMP_WAIT_HIST_SIZE           16        /* must be a power of 2 */
+#define KMP_WAIT_HIST_HASH(site)     ( ( ( (kmp_uintptr_t)(site) >> 3 ) ^ ( (kmp_uintptr_t)(site) >> 9 ) ) \
+                                       & ( KMP_WAIT_HIST_SIZE - 1 ) )
+#define KMP_ADAPTIVE_SPIN_MIN        (1 << 10) /* ticks spun even when the site is predicted short */
+#define KMP_ADAPTIVE_SPIN_MAX        (1 << 18) /* longest predicted wait worth spinning for */
+
+/*
+ * Lock contention profile (KMP_LOCK_PROFILE): each thread remembers when it
+ * acquired the locks it holds, up to this many at a time, to time the holds.
+ */
+#define KMP_LOCK_PROFILE_HELD        8
+
 #define KMP_MIN_STATSCOLS       40
 #define KMP_MAX_STATSCOLS       4096
 #define KMP_DEFAULT_STATSCOLS   80
@@ -895,6 +944,7 @@ extern unsigned int __kmp_place_core_offset;
 #define KMP_MIN_CHUNK           1
 #define KMP_MAX_CHUNK           (INT_MAX-1)
 #define KMP_DEFAULT_CHUNK       1
+#define KMP_MAX_DISPATCH_BATCH  (1<<16)
 
 #define KMP_MIN_INIT_WAIT       1
 #define KMP_MAX_INIT_WAIT       (INT_MAX/2)
@@ -904,8 +954,12 @@ extern unsigned int __kmp_place_core_offset;
 #define KMP_MAX_NEXT_WAIT       (INT_MAX/2)
 #define KMP_DEFAULT_NEXT_WAIT   1024U
 
-// max possible dynamic loops in concurrent execution per team
-#define KMP_MAX_DISP_BUF        7
+// dynamic loops in concurrent execution per team: initial and maximum
+// size of the team's ring of dispatch buffers (it grows on demand)
+#define KMP_DFLT_DISP_NUM_BUFF  7
+#define KMP_MAX_DISP_NUM_BUFF   256
+// deepest active nesting level whose teams can be kept hot (KMP_HOT_TEAMS_MAX_LEVEL)
+#define KMP_MAX_HOT_TEAMS_LEVEL 5
 #define KMP_MAX_ORDERED         8
 
 #define KMP_MAX_FIELDS          32
@@ -1069,6 +1123,8 @@ typedef struct kmp_cpuinfo {
     int        model;        // ( CPUID(1).EAX[19:16] << 4 ) + CPUID(1).EAX[7:4] ( ( Extended Model << 4 ) + Model)
     int        stepping;     // CPUID(1).EAX[3:0] ( Stepping )
     int        sse2;         // 0 if SSE2 instructions are not supported, 1 otherwise.
+    int        rtm;          // 0 if RTM instructions are not supported, 1 otherwise.
+    int        cx16;         // 0 if CMPXCHG16B instruction is not supported, 1 otherwise.
 
     int        cpu_stackoffset;
     int        apic_id;
@@ -1371,6 +1427,7 @@ typedef struct KMP_ALIGN_CACHE dispatch_private_info32 {
     kmp_int32 st;
     kmp_int32 tc;
     kmp_int32 static_steal_counter; /* for static_steal only; maybe better to put after ub */
+    kmp_tas_lock_t steal_lock; /* for static_steal only: the 8-byte path guards count and ub with it */
 
     // KMP_ALIGN( 16 ) ensures ( if the KMP_ALIGN macro is turned on )
     //    a) parm3 is properly aligned and
@@ -1403,6 +1460,7 @@ typedef struct KMP_ALIGN_CACHE dispatch_private_info64 {
     kmp_int64 st;      /* stride */
     kmp_int64 tc;      /* trip count (number of iterations) */
     kmp_int64 static_steal_counter; /* for static_steal only; maybe better to put after ub */
+    kmp_tas_lock_t steal_lock; /* for static_steal only: guards count and ub, which do not fit one CAS */
 
     /* parm[1-4] are used in different ways by different scheduling algorithms */
 
@@ -1568,9 +1626,19 @@ typedef enum kmp_bar_pat {      /* Barrier communication patterns */
     bp_linear_bar = 0,          /* Single level (degenerate) tree */
     bp_tree_bar = 1,            /* Balanced tree with branching factor 2^n */
     bp_hyper_bar = 2,           /* Hypercube-embedded tree with min branching factor 2^n */
-    bp_last_bar = 3             /* Placeholder to mark the end */
+    bp_hierarchical_bar = 3,    /* Tree following the machine topology (core, package, machine) */
+    bp_last_bar = 4             /* Placeholder to mark the end */
 } kmp_bar_pat_e;
 
+/*
+ * Machine hierarchy used by the hierarchical barrier, innermost level first.
+ * Threads tid .. tid+__kmp_bar_hier_skip[l+1]-1 form one subtree at level l,
+ * whose root tid is a multiple of __kmp_bar_hier_skip[l+1].  Everything above
+ * the last level hangs directly off the master.
+ */
+#define KMP_MAX_BAR_HIER_DEPTH  8       /* max number of levels in the barrier hierarchy */
+#define KMP_BAR_HIER_MAX_FANOUT 8       /* wider topology levels are split into sublevels */
+
 /* Thread barrier needs volatile barrier fields */
 typedef struct KMP_ALIGN_CACHE kmp_bstate {
     volatile kmp_uint   b_arrived;              /* STATE => task reached synch point. */
@@ -1578,6 +1646,15 @@ typedef struct KMP_ALIGN_CACHE kmp_bstate {
         KMP_ALIGN_CACHE
     #endif
     volatile kmp_uint   b_go;                   /* STATE => task should proceed.      */
+    /*
+     * On-core gather flags of the hierarchical barrier: the i-th leaf child
+     * sets byte i, so the parent sees all of its children with a single load.
+     * Byte 0 stands for the parent itself and is never set.
+     */
+    union {
+        volatile kmp_uint64 b_leaf_arrived;
+        volatile kmp_uint8  b_leaf_byte[ KMP_BAR_HIER_MAX_FANOUT ];
+    };
 } kmp_bstate_t;
 
 union KMP_ALIGN_CACHE kmp_barrier_union {
@@ -1924,6 +2001,49 @@ typedef struct kmp_taskgroup {
     kmp_uint32            count;   // number of allocated and not yet complete tasks
     struct kmp_taskgroup *parent;  // parent taskgroup
 } kmp_taskgroup_t;
+
+/* Dependence information passed by the compiler to __kmpc_omp_task_with_deps() */
+typedef struct kmp_depend_info {
+    kmp_intptr_t               base_addr;
+    size_t                     len;
+    struct {
+        kmp_uint8              in:1;
+        kmp_uint8              out:1;
+    } flags;
+} kmp_depend_info_t;
+
+typedef struct kmp_depnode kmp_depnode_t;
+
+typedef struct kmp_depnode_list {
+    kmp_depnode_t *            dl_node;
+    struct kmp_depnode_list *  dl_next;
+} kmp_depnode_list_t;
+
+/* Node of the dependence graph, one per task with dependences (or per wait) */
+struct kmp_depnode {
+    kmp_task_t *                  dn_task;           // task to schedule when no predecessors remain, NULL for a wait
+    kmp_depnode_list_t * volatile dn_successors;     // nodes waiting for this one, KMP_DEPNODE_FINISHED once released
+    volatile kmp_int32            dn_npredecessors;  // unfinished predecessors (+1 while dependences are processed)
+    volatile kmp_int32            dn_nrefs;          // references from the task, dependence hash and successor lists
+};
+
+#define KMP_DEPNODE_FINISHED    ((kmp_depnode_list_t *) 1)
+
+/* Last writer and readers of one address among the children of a task */
+typedef struct kmp_dephash_entry {
+    kmp_intptr_t                 de_addr;
+    kmp_depnode_t *              de_last_out;
+    kmp_depnode_list_t *         de_last_ins;
+    struct kmp_dephash_entry *   de_next;            // next entry in the bucket
+} kmp_dephash_entry_t;
+
+#define KMP_DEPHASH_MASTER_SIZE  997    // buckets for implicit tasks, which usually create the most tasks
+#define KMP_DEPHASH_OTHER_SIZE   97     // buckets for explicit tasks
+
+typedef struct kmp_dephash {
+    kmp_uint32                   dh_size;
+    kmp_dephash_entry_t *        dh_buckets[ 1 ];    // dh_size buckets allocated
+} kmp_dephash_t;
 #endif
 
 #ifdef BUILD_TIED_TASK_STACK
@@ -1948,7 +2068,8 @@ typedef struct kmp_tasking_flags {          /* Total struct must be exactly 32 b
     unsigned tiedness    : 1;               /* task is either tied (1) or untied (0) */
     unsigned final       : 1;               /* task is final(1) so execute immediately */
     unsigned merged_if0  : 1;               /* no __kmpc_task_{begin/complete}_if0 calls in if0 code path */
-    unsigned reserved13  : 13;              /* reserved for compiler use */
+    unsigned unsigned_bounds : 1;           /* taskloop pattern: lb and ub are unsigned (1) or signed (0) */
+    unsigned reserved12  : 12;              /* reserved for compiler use */
 
     /* Library flags */                     /* Total library flags must be 16 bits */
     unsigned tasktype    : 1;               /* task is either explicit(1) or implicit (0) */
@@ -1985,6 +2106,13 @@ struct kmp_taskdata {                                 /* aligned during dynamic
     volatile kmp_uint32     td_incomplete_child_tasks; /* Child tasks not yet complete */
 #if OMP_40_ENABLED
     kmp_taskgroup_t *       td_taskgroup;         // Each task keeps pointer to its current taskgroup
+    kmp_dephash_t *         td_dephash;           // Dependences of the children of this task
+    kmp_depnode_t *         td_depnode;           // Dependence node of this task, if it has dependences
+    size_t                  td_size_alloc;        // Size of the taskdata, task and shareds block (for duplication)
+#endif
+#if OMPT_SUPPORT
+    kmp_uint64              td_ompt_task_id;      // Task id reported to the tool, 0 if no tool is attached
+    ompt_frame_t            td_ompt_frame;        // Runtime frames around the task's code, for sampling tools
 #endif
     _Quad                   td_dummy;             // Align structure 16-byte size since allocated just before kmp_task_t
 }; // struct kmp_taskdata
@@ -1992,16 +2120,27 @@ struct kmp_taskdata {                                 /* aligned during dynamic
 // Make sure padding above worked
 KMP_BUILD_ASSERT( sizeof(kmp_taskdata_t) % sizeof(void *) == 0 );
 
+// Circular array holding a task deque.  When the deque fills up, the owner
+// copies it into an array twice as large; the old array is kept on the ta_prev
+// list until the deque is freed, because thieves may still be reading from it.
+typedef struct kmp_task_array {
+    struct kmp_task_array * ta_prev;               // Array this one replaced, or NULL
+    kmp_uint32              ta_mask;               // Number of entries - 1 (a power of 2 - 1)
+    kmp_taskdata_t * volatile ta_tasks[ 1 ];       // Actually ta_mask + 1 entries
+} kmp_task_array_t;
+
 // Data for task team but per thread
+//
+// The deque is a Chase-Lev work-stealing deque: the owner pushes and pops at
+// the tail without atomics (except a fence when popping), thieves take tasks
+// from the head with a compare-and-swap.  Head and tail are free-running
+// counters; the index into the array is counter & ta_mask.
 typedef struct kmp_base_thread_data {
     kmp_info_p *            td_thr;                // Pointer back to thread info
                                                    // Used only in __kmp_execute_tasks, maybe not avail until task is queued?
-    kmp_bootstrap_lock_t    td_deque_lock;         // Lock for accessing deque
-    kmp_taskdata_t **       td_deque;              // Deque of tasks encountered by td_thr, dynamically allocated
-    kmp_uint32              td_deque_head;         // Head of deque (will wrap)
-    kmp_uint32              td_deque_tail;         // Tail of deque (will wrap)
-    kmp_int32               td_deque_ntasks;       // Number of tasks in deque
-                                                   // GEH: shouldn't this be volatile since used in while-spin?
+    kmp_task_array_t * volatile td_deque;          // Deque of tasks encountered by td_thr, dynamically allocated
+    volatile kmp_uint32     td_deque_head;         // Head of deque, advanced by thieves and the owner's last pop
+    volatile kmp_uint32     td_deque_tail;         // Tail of deque, written only by the owner
     kmp_int32               td_deque_last_stolen;  // Thread number of last successful steal
 #ifdef BUILD_TIED_TASK_STACK
     kmp_task_stack_t        td_susp_tied_tasks;    // Stack of suspended tied tasks for task scheduling constraint
@@ -2014,6 +2153,10 @@ typedef union KMP_ALIGN_CACHE kmp_thread_data {
     char                    td_pad[ KMP_PAD(kmp_base_thread_data_t, CACHE_LINE) ];
 } kmp_thread_data_t;
 
+// Number of tasks in a deque; only a hint unless read by the owner with no thieves around
+#define KMP_TASK_DEQUE_NTASKS( thread_data ) \
+    ( (kmp_int32)( TCR_4( (thread_data) -> td.td_deque_tail ) - TCR_4( (thread_data) -> td.td_deque_head ) ) )
+
 
 // Data for task teams which are used when tasking is enabled for the team
 typedef struct kmp_base_task_team {
@@ -2055,7 +2198,45 @@ typedef struct kmp_free_list {
     void             *th_free_list_sync;   // Self-allocated tasks stolen/returned by other threads
     void             *th_free_list_other;  // Non-self free list (to be returned to owner's sync list)
 } kmp_free_list_t;
-#endif
+
+// Task slab: tasks are carved from per-thread chunks into exact size classes,
+// with a free list per class (same self/sync/other scheme as above)
+#define KMP_TASK_SLAB_QUANTUM   16              // size classes are multiples of this many bytes
+#define KMP_TASK_SLAB_CLASSES   64              // largest class is KMP_TASK_SLAB_CLASSES * KMP_TASK_SLAB_QUANTUM bytes
+#define KMP_TASK_SLAB_CHUNK     ( 32 * 1024 )   // bytes taken from the system at a time
+#define KMP_TASK_SLAB_BATCH     32              // blocks freed by other threads are returned in batches of this many
+
+typedef struct kmp_task_slab {
+    kmp_free_list_t   ts_lists[ KMP_TASK_SLAB_CLASSES ];
+    char             *ts_chunk_ptr;        // unused part of the current chunk
+    size_t            ts_chunk_left;
+    void             *ts_chunks;           // all chunks of this slab, freed by __kmp_cleanup_fast_memory()
+    struct kmp_task_slab *ts_next;         // next slab of a reaped thread, waiting to be reused
+} kmp_task_slab_t;
+#endif
+
+// One wait site in the thread's adaptive wait history (see KMP_WAIT_HIST_SIZE)
+typedef struct kmp_wait_hist {
+    volatile void    *wh_site;             // address waited on, NULL if the entry is unused
+    kmp_uint64        wh_avg;              // decayed average wait at this site, in timestamp ticks
+} kmp_wait_hist_t;
+
+// A lock held by the thread, timed for KMP_LOCK_PROFILE (see KMP_LOCK_PROFILE_HELD)
+typedef struct kmp_lock_held {
+    void             *lh_lock;             // lock address, NULL if the entry is unused
+    kmp_lock_profile_t *lh_prof;           // record of the site the lock was acquired at
+    kmp_uint64        lh_start;            // timestamp of the acquisition
+} kmp_lock_held_t;
+
+/*
+ * A nested team kept with its workers by the master thread that forked it,
+ * so the next fork at the same level skips allocating the team and threads.
+ * The outermost level uses root->r.r_hot_team instead.
+ */
+typedef struct kmp_hot_team {
+    kmp_team_p       *ht_team;        /* idle team, or NULL */
+    kmp_uint8         ht_task_state;  /* master's th_task_state for ht_team */
+} kmp_hot_team_t;
 
 /* ------------------------------------------------------------------------ */
 // OpenMP thread data structures
@@ -2116,6 +2297,7 @@ typedef struct KMP_ALIGN_CACHE kmp_base_info {
     /* TODO the first serial team should actually be stored in the info_t
      * structure.  this will help reduce initial allocation overhead */
     KMP_ALIGN_CACHE kmp_team_p *th_serial_team; /*serialized team held in reserve*/
+    kmp_hot_team_t          th_hot_teams[ KMP_MAX_HOT_TEAMS_LEVEL - 1 ]; /* hot teams for active levels 2.. */
 /* The following are also read by the master during reinit */
     struct common_table    *th_pri_common;
 
@@ -2139,7 +2321,16 @@ typedef struct KMP_ALIGN_CACHE kmp_base_info {
     kmp_task_team_t    * th_task_team;           // Task team struct
     kmp_taskdata_t     * th_current_task;        // Innermost Task being executed
     kmp_uint8            th_task_state;          // alternating 0/1 for task team identification
+#if OMP_40_ENABLED
+    void               * th_dep_free_list;       // free dependence nodes, lists and hash entries
+    kmp_int32            th_dep_free_count;      // length of th_dep_free_list
+#endif
 #endif  // OMP_30_ENABLED
+#if KMP_STATS_ENABLED
+    struct kmp_stats   * th_stats;               // statistics record, NULL unless KMP_STATS is set
+#endif
+    kmp_wait_hist_t      th_wait_hist[ KMP_WAIT_HIST_SIZE ]; // recent wait times, used by KMP_ADAPTIVE_WAIT
+    kmp_lock_held_t      th_lock_held[ KMP_LOCK_PROFILE_HELD ]; // locks held, used by KMP_LOCK_PROFILE
 
     /*
      * More stuff for keeping track of active/sleeping threads
@@ -2149,6 +2340,10 @@ typedef struct KMP_ALIGN_CACHE kmp_base_info {
                                                  // #active threads in pool
     int                  th_active;              // ! sleeping
                                                  // 32 bits for TCR/TCW
+#if OMPT_SUPPORT
+    volatile ompt_state_t th_ompt_state;         // what the thread is doing, read by sampling tools
+    volatile kmp_uint64  th_ompt_wait_id;        // lock or critical waited for in a wait_* state
+#endif
 
 
     struct cons_header * th_cons;
@@ -2164,6 +2359,7 @@ typedef struct KMP_ALIGN_CACHE kmp_base_info {
 #if ( USE_FAST_MEMORY == 3 ) || ( USE_FAST_MEMORY == 5 )
     #define NUM_LISTS 4
     kmp_free_list_t   th_free_lists[NUM_LISTS];   // Free lists for fast memory allocation routines
+    kmp_task_slab_t  *th_task_slab;               // Exact size free lists for task descriptors, outlives the thread
 #endif
 
 #if KMP_OS_WINDOWS
@@ -2215,6 +2411,18 @@ typedef int     (*launch_t)( int gtid );
 # define KMP_BARRIER_ICV_PULL   0
 #endif
 
+//
+// Unless the workers pull them from the team struct, the ICV's are set in
+// the master thread only and each parent in the fork barrier release tree
+// copies its own ICV's to its children before waking them, so the master
+// does O(log nthreads) work instead of O(nthreads) in __kmp_reinitialize_team.
+//
+#if OMP_30_ENABLED && ! KMP_BARRIER_ICV_PULL
+# define KMP_BARRIER_ICV_PUSH   1
+#else
+# define KMP_BARRIER_ICV_PUSH   0
+#endif
+
 #if (KMP_PERF_V106 == KMP_ON)
 //
 // Set up how many argv pointers will fit in cache lines containing
@@ -2278,6 +2486,10 @@ typedef struct KMP_ALIGN_CACHE kmp_base_team {
 #endif
     microtask_t              t_pkfn;
     launch_t                 t_invoke;       /* procedure to launch the microtask */
+#if OMPT_SUPPORT
+    kmp_uint64               t_ompt_parallel_id; /* parallel region id reported to the tool */
+    ompt_state_t             t_ompt_master_state; /* master's state before the fork */
+#endif
 
 #if KMP_ARCH_X86 || KMP_ARCH_X86_64
     kmp_int8                 t_fp_control_saved;
@@ -2312,6 +2524,9 @@ typedef struct KMP_ALIGN_CACHE kmp_base_team {
     int                      t_max_nproc;    /* maximum threads this team can handle (this is dynamicly expandable) */
     int                      t_serialized;   /* levels deep of serialized teams */
     dispatch_shared_info_t  *t_disp_buffer;  /* buffers for dispatch system */
+    int                      t_disp_num_buffers;   /* number of buffers in t_disp_buffer */
+    volatile int             t_disp_buffer_waited; /* a thread waited for a free dispatch buffer */
+    int                     *t_static_rank;  /* rank of each thread in the static schedule */
     int                      t_id;           // team's id, assigned by debugger.
 #if OMP_30_ENABLED
     int                      t_level;        /* nested parallel level */
@@ -2490,6 +2705,9 @@ extern volatile int __kmp_init_user_locks;
 extern int __kmp_init_counter;
 extern int __kmp_root_counter;
 extern int __kmp_version;
+#if KMP_STATS_ENABLED
+extern int __kmp_stats_enabled;    /* KMP_STATS: collect runtime statistics */
+#endif
 
 /* list of address of allocated caches for commons */
 extern kmp_cached_addr_t *__kmp_threadpriv_cache_list;
@@ -2507,6 +2725,9 @@ extern char const   *__kmp_barrier_branch_bit_env_name [ bs_last_barrier ];
 extern char const   *__kmp_barrier_pattern_env_name    [ bs_last_barrier ];
 extern char const   *__kmp_barrier_type_name           [ bs_last_barrier ];
 extern char const   *__kmp_barrier_pattern_name        [ bp_last_bar ];
+extern kmp_uint32    __kmp_bar_hier_depth;
+extern kmp_uint32    __kmp_bar_hier_fanout             [ KMP_MAX_BAR_HIER_DEPTH ];
+extern kmp_uint32    __kmp_bar_hier_skip               [ KMP_MAX_BAR_HIER_DEPTH + 1 ];
 
 /* Global Locks */
 extern kmp_bootstrap_lock_t __kmp_initz_lock;     /* control initialization */
@@ -2532,6 +2753,10 @@ extern enum sched_type  __kmp_guided;   /* default guided scheduling method */
 extern enum sched_type  __kmp_auto;     /* default auto scheduling method */
 #endif // OMP_30_ENABLED
 extern int              __kmp_chunk;    /* default runtime chunk size */
+extern int              __kmp_dispatch_batch; /* max chunks taken per atomic under dynamic scheduling */
+extern int              __kmp_dispatch_num_buffers; /* initial number of dispatch buffers per team */
+extern int              __kmp_hot_teams_max_level; /* deepest active level that keeps hot teams */
+extern int              __kmp_static_numa;     /* hand out static loop blocks node by node */
 
 extern size_t     __kmp_stksize;        /* stack size per thread         */
 extern size_t     __kmp_monitor_stksize;/* stack size for monitor thread */
@@ -2580,6 +2805,9 @@ extern int        __kmp_dflt_nested;    /* nested parallelism enabled by default
 extern int        __kmp_dflt_blocktime; /* number of milliseconds to wait before blocking (env setting) */
 extern int        __kmp_monitor_wakeups;/* number of times monitor wakes up per second */
 extern int        __kmp_bt_intervals;   /* number of monitor timestamp intervals before blocking */
+extern int        __kmp_adaptive_wait;  /* spin or park according to the recent waits at each site */
+extern int        __kmp_use_monitor;    /* blocktime is counted by the monitor thread, not by timestamps */
+extern kmp_uint64 __kmp_ticks_per_msec; /* __kmp_hardware_timestamp() ticks per millisecond, if !__kmp_use_monitor */
 #ifdef KMP_ADJUST_BLOCKTIME
 extern int        __kmp_zero_bt;        /* whether blocktime has been forced to zero */
 #endif /* KMP_ADJUST_BLOCKTIME */
@@ -2759,8 +2987,14 @@ extern void * ___kmp_fast_allocate( kmp_info_t *this_thr, size_t size KMP_SRC_LO
 extern void   ___kmp_fast_free( kmp_info_t *this_thr, void *ptr KMP_SRC_LOC_DECL );
 extern void   __kmp_free_fast_memory( kmp_info_t *this_thr );
 extern void   __kmp_initialize_fast_memory( kmp_info_t *this_thr );
+extern void   __kmp_cleanup_fast_memory( void );
 #define __kmp_fast_allocate( this_thr, size ) ___kmp_fast_allocate( (this_thr), (size) KMP_SRC_LOC_CURR )
 #define __kmp_fast_free( this_thr, ptr )      ___kmp_fast_free( (this_thr), (ptr) KMP_SRC_LOC_CURR )
+
+extern void * ___kmp_task_slab_allocate( kmp_info_t *this_thr, size_t size KMP_SRC_LOC_DECL );
+extern void   ___kmp_task_slab_free( kmp_info_t *this_thr, void *ptr KMP_SRC_LOC_DECL );
+#define __kmp_task_slab_allocate( this_thr, size ) ___kmp_task_slab_allocate( (this_thr), (size) KMP_SRC_LOC_CURR )
+#define __kmp_task_slab_free( this_thr, ptr )      ___kmp_task_slab_free( (this_thr), (ptr) KMP_SRC_LOC_CURR )
 #endif
 
 extern void * ___kmp_thread_malloc( kmp_info_t *th, size_t size KMP_SRC_LOC_DECL );
@@ -2887,6 +3121,7 @@ extern void __kmp_affinity_set_init_mask(int gtid, int isa_root); /* set affinit
 #if OMP_40_ENABLED
 extern void __kmp_affinity_set_place(int gtid);
 #endif
+extern int __kmp_affinity_thread_node(kmp_info_t *th);
 extern void __kmp_change_thread_affinity_mask( int gtid, kmp_affin_mask_t *new_mask,
                                                kmp_affin_mask_t *old_mask );
 extern void __kmp_affinity_determine_capable( const char *env_var );
@@ -2902,6 +3137,7 @@ extern void __kmp_balanced_affinity( int tid, int team_size );
 #if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
 
 extern int __kmp_futex_determine_capable( void );
+extern int __kmp_futex_parking;         /* park sleeping threads on the spin word with futex_wait */
 
 #endif // KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
 
@@ -2955,16 +3191,16 @@ extern kmp_info_t * __kmp_allocate_thread( kmp_root_t *root,
 extern kmp_team_t * __kmp_allocate_team( kmp_root_t *root, int new_nproc, int max_nproc,
                                          kmp_proc_bind_t proc_bind,
                                          kmp_internal_control_t *new_icvs,
-                                         int argc );
+                                         int argc, kmp_info_t *master );
 #elif OMP_30_ENABLED
 extern kmp_team_t * __kmp_allocate_team( kmp_root_t *root, int new_nproc, int max_nproc,
                                          kmp_internal_control_t *new_icvs,
-                                         int argc );
+                                         int argc, kmp_info_t *master );
 #else
 extern kmp_team_t * __kmp_allocate_team( kmp_root_t *root, int new_nproc, int max_nproc,
                                          int new_set_nproc, int new_set_dynamic, int new_set_nested,
                                          int new_set_blocktime, int new_bt_intervals, int new_bt_set,
-                                         int argc );
+                                         int argc, kmp_info_t *master );
 #endif // OMP_30_ENABLED
 extern void __kmp_free_thread( kmp_info_t * );
 extern void __kmp_free_team( kmp_root_t *, kmp_team_t * );
@@ -3042,6 +3278,10 @@ extern void __kmp_task_team_sync  ( kmp_info_t *this_thr, kmp_team_t *team );
 extern void __kmp_task_team_wait  ( kmp_info_t *this_thr, kmp_team_t *team
 );
 extern void __kmp_tasking_barrier( kmp_team_t *team, kmp_info_t *thread, int gtid );
+#if OMP_40_ENABLED
+extern void __kmp_dephash_free( kmp_info_t *thread, kmp_taskdata_t *task );
+extern void __kmp_free_dep_pool( kmp_info_t *thread );
+#endif
 
 #endif // OMP_30_ENABLED
 
@@ -3157,6 +3397,9 @@ extern int __kmp_invoke_microtask( microtask_t pkfn, int gtid, int npr, int argc
 extern int  __kmp_is_address_mapped( void *addr );
 extern kmp_uint64 __kmp_hardware_timestamp(void);
 
+extern kmp_uint64 __kmp_adaptive_spin_ticks( kmp_info_t *th, volatile void *site );
+extern void       __kmp_adaptive_wait_update( kmp_info_t *th, volatile void *site, kmp_uint64 ticks );
+
 /* ------------------------------------------------------------------------ */
 
 KMP_EXPORT void   __kmpc_begin                ( ident_t *, kmp_int32 flags );
@@ -3198,6 +3441,15 @@ KMP_EXPORT void   __kmpc_end_single         ( ident_t *, kmp_int32 global_tid );
 KMP_EXPORT void KMPC_FOR_STATIC_INIT    ( ident_t *loc, kmp_int32 global_tid, kmp_int32 schedtype, kmp_int32 *plastiter,
                                           kmp_int *plower, kmp_int *pupper, kmp_int *pstride, kmp_int incr, kmp_int chunk );
 
+KMP_EXPORT void __kmpc_for_static_init_simple_4 ( ident_t *loc, kmp_int32 global_tid, kmp_int32 *plastiter,
+                                                  kmp_int32 *plower, kmp_int32 *pupper );
+KMP_EXPORT void __kmpc_for_static_init_simple_4u( ident_t *loc, kmp_int32 global_tid, kmp_int32 *plastiter,
+                                                  kmp_uint32 *plower, kmp_uint32 *pupper );
+KMP_EXPORT void __kmpc_for_static_init_simple_8 ( ident_t *loc, kmp_int32 global_tid, kmp_int32 *plastiter,
+                                                  kmp_int64 *plower, kmp_int64 *pupper );
+KMP_EXPORT void __kmpc_for_static_init_simple_8u( ident_t *loc, kmp_int32 global_tid, kmp_int32 *plastiter,
+                                                  kmp_uint64 *plower, kmp_uint64 *pupper );
+
 KMP_EXPORT void __kmpc_for_static_fini  ( ident_t *loc, kmp_int32 global_tid );
 
 KMP_EXPORT void __kmpc_copyprivate( ident_t *loc, kmp_int32 global_tid, size_t cpy_size, void *cpy_data, void(*cpy_func)(void*,void*), kmp_int32 didit );
@@ -3256,6 +3508,17 @@ void __kmpc_omp_task_complete( ident_t *loc_ref, kmp_int32 gtid, kmp_task_t *tas
 #if OMP_40_ENABLED
 KMP_EXPORT void __kmpc_taskgroup( ident* loc, int gtid );
 KMP_EXPORT void __kmpc_end_taskgroup( ident* loc, int gtid );
+
+KMP_EXPORT kmp_int32 __kmpc_omp_task_with_deps ( ident_t *loc_ref, kmp_int32 gtid, kmp_task_t * new_task,
+                                                 kmp_int32 ndeps, kmp_depend_info_t *dep_list,
+                                                 kmp_int32 ndeps_noalias, kmp_depend_info_t *noalias_dep_list );
+KMP_EXPORT void __kmpc_omp_wait_deps ( ident_t *loc_ref, kmp_int32 gtid, kmp_int32 ndeps, kmp_depend_info_t *dep_list,
+                                       kmp_int32 ndeps_noalias, kmp_depend_info_t *noalias_dep_list );
+
+typedef void (* kmp_task_dup_t)( kmp_task_t *dst, kmp_task_t *src, kmp_int32 lastpriv );
+KMP_EXPORT void __kmpc_taskloop( ident_t *loc, kmp_int32 gtid, kmp_task_t *task, kmp_int32 if_val,
+                                 kmp_uint64 *lb, kmp_uint64 *ub, kmp_int64 st,
+                                 kmp_int32 nogroup, kmp_int32 sched, kmp_uint64 grainsize, void *task_dup );
 #endif
 
 /*
@@ -3272,6 +3535,12 @@ KMP_EXPORT void __kmpc_unset_nest_lock( ident_t *loc, kmp_int32 gtid, void **use
 KMP_EXPORT int __kmpc_test_lock( ident_t *loc, kmp_int32 gtid, void **user_lock );
 KMP_EXPORT int __kmpc_test_nest_lock( ident_t *loc, kmp_int32 gtid, void **user_lock );
 
+#if OMP_40_ENABLED
+KMP_EXPORT void __kmpc_init_lock_with_hint( ident_t *loc, kmp_int32 gtid, void **user_lock, kmp_uintptr_t hint );
+KMP_EXPORT void __kmpc_init_nest_lock_with_hint( ident_t *loc, kmp_int32 gtid, void **user_lock, kmp_uintptr_t hint );
+KMP_EXPORT void __kmpc_critical_with_hint( ident_t *loc, kmp_int32 global_tid, kmp_critical_name *crit, kmp_uintptr_t hint );
+#endif
+
 /* ------------------------------------------------------------------------ */
 
 /*
@@ -3874,6 +3874,146 @@ __kmp_aux_affinity_initialize(void)
 }
 
 
+//
+// Build the tree used by the hierarchical barrier from the topology found
+// above: hardware threads within a core, cores within a package, packages
+// within the machine.  Levels wider than KMP_BAR_HIER_MAX_FANOUT are split
+// by their largest divisor that fits, so that a subtree does not straddle a
+// core or package boundary.  A level with no such divisor (e.g. 11 or 13
+// cores) is cut into groups of KMP_BAR_HIER_MAX_FANOUT instead: the on-core
+// gather has one byte flag per child, so no fanout may exceed that.  Every
+// level has a single fanout and the groups are runs of consecutive tids, so
+// such a level cannot be cut at the boundary; its last group takes threads
+// from the next core or package.  That only moves some gather traffic off
+// the core or package, the barrier itself does not depend on the grouping.
+// The topology globals are set by the map routines even when
+// __kmp_affinity_type == affinity_none.
+//
+static void
+__kmp_affinity_create_bar_hier(void)
+{
+    int radix[3];
+    int depth = 0;
+    int i;
+
+    radix[0] = __kmp_nThreadsPerCore;
+    radix[1] = nCoresPerPkg;
+    radix[2] = nPackages;
+
+    for (i = 0; i < 3; i++) {
+        int rest = radix[i];
+        while ((rest > 1) && (depth < KMP_MAX_BAR_HIER_DEPTH)) {
+            int fanout = rest;
+            if (fanout > KMP_BAR_HIER_MAX_FANOUT) {
+                for (fanout = KMP_BAR_HIER_MAX_FANOUT; fanout > 1; fanout--) {
+                    if (rest % fanout == 0) {
+                        break;
+                    }
+                }
+                if (fanout == 1) {
+                    // No divisor fits: full groups, see above
+                    fanout = KMP_BAR_HIER_MAX_FANOUT;
+                }
+            }
+            __kmp_bar_hier_fanout[depth++] = fanout;
+            rest = (rest + fanout - 1) / fanout;
+        }
+    }
+
+    __kmp_bar_hier_skip[0] = 1;
+    for (i = 0; i < depth; i++) {
+        __kmp_bar_hier_skip[i + 1] = __kmp_bar_hier_skip[i]
+          * __kmp_bar_hier_fanout[i];
+    }
+    __kmp_bar_hier_depth = depth;
+
+    KA_TRACE(10, ("__kmp_affinity_create_bar_hier: %d levels, %d threads/core, "
+      "%d cores/pkg, %d pkgs\n", depth, __kmp_nThreadsPerCore, nCoresPerPkg,
+      nPackages));
+}
+
+
+//
+// Record the node of each place in __kmp_affinity_masks, for KMP_STATIC_NUMA.
+// The topology maps do not detect memory nodes, so the package stands in for
+// the node: the first OS proc of each mask is looked up in address2os, and
+// the ordinal number of its package (childNums[0]) becomes the node id.  A
+// flat topology is a single node.
+//
+static void
+__kmp_affinity_create_place_nodes(void)
+{
+    unsigned i;
+    unsigned j;
+
+    if ((address2os == NULL) || (__kmp_affinity_masks == NULL)
+      || (__kmp_affinity_num_masks == 0)) {
+        return;
+    }
+    int depth = address2os[0].first.depth;
+    __kmp_affinity_place_node = (int *)__kmp_allocate(
+      __kmp_affinity_num_masks * sizeof(int));
+    __kmp_affinity_num_nodes = 1;
+    for (i = 0; i < __kmp_affinity_num_masks; i++) {
+        kmp_affin_mask_t *mask = KMP_CPU_INDEX(__kmp_affinity_masks, i);
+        int node = 0;
+        if (depth > 1) {
+            for (j = 0; j < (unsigned)__kmp_avail_proc; j++) {
+                if (KMP_CPU_ISSET(address2os[j].second, mask)) {
+                    node = address2os[j].first.childNums[0];
+                    break;
+                }
+            }
+        }
+        __kmp_affinity_place_node[i] = node;
+        if (node >= __kmp_affinity_num_nodes) {
+            __kmp_affinity_num_nodes = node + 1;
+        }
+    }
+    KA_TRACE(10, ("__kmp_affinity_create_place_nodes: %d places on %d nodes\n",
+      __kmp_affinity_num_masks, __kmp_affinity_num_nodes));
+}
+
+
+//
+// Return the node of the place thread th is bound to for the current parallel
+// region, or -1 if it is not bound to a single place.  Under OpenMP 4.0
+// binding the master sets th_new_place in __kmp_partition_places() before it
+// releases the team; under KMP_AFFINITY binding the place follows from the
+// gtid, as in __kmp_affinity_set_init_mask().
+//
+int
+__kmp_affinity_thread_node(kmp_info_t *th)
+{
+    int place;
+
+    if (__kmp_affinity_place_node == NULL) {
+        return -1;
+    }
+# if OMP_40_ENABLED
+    if (__kmp_nested_proc_bind.bind_types[0] != proc_bind_intel) {
+        place = th->th.th_new_place;
+    }
+    else
+# endif
+    {
+        if (__kmp_affinity_type != affinity_explicit
+          && __kmp_affinity_type != affinity_logical
+          && __kmp_affinity_type != affinity_physical
+          && __kmp_affinity_type != affinity_scatter
+          && __kmp_affinity_type != affinity_compact) {
+            return -1;
+        }
+        place = (th->th.th_info.ds.ds_gtid + __kmp_affinity_offset)
+          % __kmp_affinity_num_masks;
+    }
+    if ((place < 0) || (place >= (int)__kmp_affinity_num_masks)) {
+        return -1;
+    }
+    return __kmp_affinity_place_node[place];
+}
+
+
 void
 __kmp_affinity_initialize(void)
 {
@@ -3899,6 +4039,8 @@ __kmp_affinity_initialize(void)
     if (disabled) {
         __kmp_affinity_type = affinity_disabled;
     }
+    __kmp_affinity_create_bar_hier();
+    __kmp_affinity_create_place_nodes();
 }
 
 
@@ -3914,6 +4056,11 @@ __kmp_affinity_uninitialize(void)
         fullMask = NULL;
     }
     __kmp_affinity_num_masks = 0;
+    if (__kmp_affinity_place_node != NULL) {
+        __kmp_free(__kmp_affinity_place_node);
+        __kmp_affinity_place_node = NULL;
+    }
+    __kmp_affinity_num_nodes = 0;
 # if OMP_40_ENABLED
     __kmp_affinity_num_places = 0;
 # endif
@@ -3929,6 +4076,7 @@ __kmp_affinity_uninitialize(void)
         __kmp_free( procarr );
         procarr = NULL;
     }
+    __kmp_bar_hier_depth = 0;
 }
 
 
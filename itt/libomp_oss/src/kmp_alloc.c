@@ -2014,6 +2014,177 @@ ___kmp_fast_free( kmp_info_t *this_thr, void * ptr KMP_SRC_LOC_DECL )
 
 } // func __kmp_fast_free
 
+/* ------------------------------------------------------------------------ */
+// Task slab allocator.
+// Task descriptors (taskdata, task, privates and shareds) come in a handful of
+// sizes per program.  Rather than rounding them up to the fast memory classes
+// above (256 bytes at least, plus a descriptor and bget overhead), they are
+// carved from per-thread chunks in KMP_TASK_SLAB_QUANTUM steps, each block
+// preceded by a 16-byte descriptor naming the owning thread and the class.
+// Freeing follows the fast memory scheme: the owner pushes a block on its
+// private list; another thread collects blocks of one owner and hands them
+// back to the owner's sync list KMP_TASK_SLAB_BATCH at a time.
+//
+// Such a batch may still be on its way back when the owner is reaped, so the
+// slab is allocated apart from the thread and outlives it: a reaped thread's
+// slab waits on __kmp_task_slab_orphans for the next new thread to adopt it,
+// and is only freed by __kmp_cleanup_fast_memory() once all threads are gone.
+
+typedef union kmp_slab_descr {
+    struct {
+        kmp_task_slab_t * owner;     // slab whose chunk the block was carved from
+        kmp_uint32    cls;           // size class, KMP_TASK_SLAB_CLASSES for a large block
+        kmp_uint32    count;         // number of blocks in a batch, kept by the batch head
+    } sd;
+    kmp_uint64        sd_align[ 2 ]; // keep blocks 16-byte aligned
+} kmp_slab_descr_t;
+
+#define KMP_SLAB_DESCR( ptr )  ( (kmp_slab_descr_t *)( (char *)(ptr) - sizeof( kmp_slab_descr_t ) ) )
+
+// Slabs of reaped threads; protected by __kmp_forkjoin_lock like the thread pool
+static kmp_task_slab_t * __kmp_task_slab_orphans = NULL;
+
+// Return a batch of blocks to the sync free list of their owner
+static void
+__kmp_task_slab_return( void * head, kmp_uint32 cls )
+{
+    kmp_task_slab_t * owner = KMP_SLAB_DESCR( head )->sd.owner;
+    void           ** sync  = & owner->ts_lists[ cls ].th_free_list_sync;
+    void            * tail  = head;
+    void            * old_ptr;
+
+    while ( *((void **)tail) != NULL ) {
+        tail = *((void **)tail);
+    }
+    old_ptr = TCR_PTR( *sync );
+    *((void **)tail) = old_ptr;
+    while ( ! KMP_COMPARE_AND_STORE_PTR( sync, old_ptr, head ) )
+    {
+        KMP_CPU_PAUSE();
+        old_ptr = TCR_PTR( *sync );
+        *((void **)tail) = old_ptr;
+    }
+}
+
+void *
+___kmp_task_slab_allocate( kmp_info_t *this_thr, size_t size KMP_SRC_LOC_DECL )
+{
+    kmp_task_slab_t  * slab = this_thr->th.th_task_slab;
+    kmp_free_list_t  * list;
+    kmp_slab_descr_t * descr;
+    size_t             cls;
+    size_t             block;
+    void             * ptr;
+
+    KE_TRACE( 25, ( "-> __kmp_task_slab_allocate( T#%d, %d ) called from %s:%d\n",
+      __kmp_gtid_from_thread(this_thr), (int) size KMP_SRC_LOC_PARM ) );
+
+    cls = ( size + KMP_TASK_SLAB_QUANTUM - 1 ) / KMP_TASK_SLAB_QUANTUM;
+    if ( cls > KMP_TASK_SLAB_CLASSES ) {
+        // too big to deserve a class, take it from the system
+        descr = (kmp_slab_descr_t *) __kmp_allocate( sizeof( kmp_slab_descr_t ) + size );
+        descr->sd.owner = slab;
+        descr->sd.cls   = KMP_TASK_SLAB_CLASSES;
+        ptr = descr + 1;
+        goto end;
+    }
+    if ( cls > 0 ) {
+        --cls;
+    }
+    list = & slab->ts_lists[ cls ];
+
+    ptr = list->th_free_list_self;
+    if ( ptr != NULL ) {
+        list->th_free_list_self = *((void **)ptr);
+        goto end;
+    }
+    ptr = TCR_SYNC_PTR( list->th_free_list_sync );
+    if ( ptr != NULL ) {
+        // take over everything other threads have returned
+        while ( ! KMP_COMPARE_AND_STORE_PTR( &list->th_free_list_sync, ptr, NULL ) )
+        {
+            KMP_CPU_PAUSE();
+            ptr = TCR_SYNC_PTR( list->th_free_list_sync );
+        }
+        list->th_free_list_self = *((void **)ptr);
+        goto end;
+    }
+
+    // carve a new block, starting a new chunk if the current one is used up
+    block = sizeof( kmp_slab_descr_t ) + ( cls + 1 ) * KMP_TASK_SLAB_QUANTUM;
+    if ( slab->ts_chunk_left < block ) {
+        char * chunk = (char *) __kmp_allocate( KMP_TASK_SLAB_CHUNK );
+        KE_TRACE( 25, ( "__kmp_task_slab_allocate: T#%d new chunk %p\n",
+                        __kmp_gtid_from_thread( this_thr ), chunk ) );
+        *((void **)chunk) = slab->ts_chunks;   // the first descriptor slot links the chunks
+        slab->ts_chunks     = chunk;
+        slab->ts_chunk_ptr  = chunk + sizeof( kmp_slab_descr_t );
+        slab->ts_chunk_left = KMP_TASK_SLAB_CHUNK - sizeof( kmp_slab_descr_t );
+    }
+    descr = (kmp_slab_descr_t *) slab->ts_chunk_ptr;
+    slab->ts_chunk_ptr  += block;
+    slab->ts_chunk_left -= block;
+    descr->sd.owner = slab;
+    descr->sd.cls   = (kmp_uint32) cls;
+    ptr = descr + 1;
+
+    end:
+    KE_TRACE( 25, ( "<- __kmp_task_slab_allocate( T#%d ) returns %p\n",
+                    __kmp_gtid_from_thread( this_thr ), ptr ) );
+    return ptr;
+} // func __kmp_task_slab_allocate
+
+void
+___kmp_task_slab_free( kmp_info_t *this_thr, void * ptr KMP_SRC_LOC_DECL )
+{
+    kmp_slab_descr_t * descr = KMP_SLAB_DESCR( ptr );
+    kmp_task_slab_t  * slab  = this_thr->th.th_task_slab;
+    kmp_task_slab_t  * owner = descr->sd.owner;
+    kmp_uint32         cls   = descr->sd.cls;
+    kmp_free_list_t  * list;
+    void             * head;
+
+    KE_TRACE( 25, ( "-> __kmp_task_slab_free( T#%d, %p ) called from %s:%d\n",
+      __kmp_gtid_from_thread(this_thr), ptr KMP_SRC_LOC_PARM ) );
+
+    if ( cls == KMP_TASK_SLAB_CLASSES ) {
+        __kmp_free( descr );
+        goto end;
+    }
+
+    list = & slab->ts_lists[ cls ];
+    if ( owner == slab ) {
+        *((void **)ptr) = list->th_free_list_self;
+        list->th_free_list_self = ptr;
+        goto end;
+    }
+
+    head = list->th_free_list_other;
+    if ( head != NULL && KMP_SLAB_DESCR( head )->sd.owner == owner ) {
+        // extend the batch for this owner, and hand it back once it is full
+        *((void **)ptr) = head;
+        descr->sd.count = KMP_SLAB_DESCR( head )->sd.count + 1;
+        if ( descr->sd.count < KMP_TASK_SLAB_BATCH ) {
+            list->th_free_list_other = ptr;
+        } else {
+            list->th_free_list_other = NULL;
+            __kmp_task_slab_return( ptr, cls );
+        }
+    } else {
+        // the owner changed, return the old batch and start a new one
+        if ( head != NULL ) {
+            __kmp_task_slab_return( head, cls );
+        }
+        *((void **)ptr) = NULL;
+        descr->sd.count = 1;
+        list->th_free_list_other = ptr;
+    }
+
+    end:
+    KE_TRACE( 25, ( "<- __kmp_task_slab_free() returns\n" ) );
+} // func __kmp_task_slab_free
+
+
 
 // Initialize the thread free lists related to fast memory
 // Only do this when a thread is initially created.
@@ -2023,6 +2194,16 @@ __kmp_initialize_fast_memory( kmp_info_t *this_thr )
     KE_TRACE(10, ( "__kmp_initialize_fast_memory: Called from th %p\n", this_thr ) );
 
     memset ( this_thr->th.th_free_lists, 0, NUM_LISTS * sizeof( kmp_free_list_t ) );
+
+    // Adopt the slab of a reaped thread if there is one, with whatever blocks
+    // it has got back since.  Called under __kmp_forkjoin_lock.
+    if ( __kmp_task_slab_orphans != NULL ) {
+        this_thr->th.th_task_slab = __kmp_task_slab_orphans;
+        __kmp_task_slab_orphans = __kmp_task_slab_orphans->ts_next;
+        this_thr->th.th_task_slab->ts_next = NULL;
+    } else {
+        this_thr->th.th_task_slab = (kmp_task_slab_t *) __kmp_allocate( sizeof( kmp_task_slab_t ) );
+    }
 }
 
 // Free the memory in the thread free lists related to fast memory
@@ -2038,6 +2219,25 @@ __kmp_free_fast_memory( kmp_info_t *th )
     KE_TRACE(5, ( "__kmp_free_fast_memory: Called T#%d\n",
                    __kmp_gtid_from_thread( th ) ) );
 
+    // Task slab: hand the batches we collected back to their owners, then
+    // leave the slab for the next new thread, since other threads may still
+    // return blocks to it.  __kmp_reap_thread() holds __kmp_forkjoin_lock.
+    if ( th->th.th_task_slab != NULL ) {
+        kmp_task_slab_t * slab = th->th.th_task_slab;
+        kmp_uint32        cls;
+
+        for ( cls = 0; cls < KMP_TASK_SLAB_CLASSES; ++cls ) {
+            void * head = slab->ts_lists[ cls ].th_free_list_other;
+            if ( head != NULL ) {
+                slab->ts_lists[ cls ].th_free_list_other = NULL;
+                __kmp_task_slab_return( head, cls );
+            }
+        }
+        slab->ts_next = __kmp_task_slab_orphans;
+        __kmp_task_slab_orphans = slab;
+        th->th.th_task_slab = NULL;
+    }
+
     __kmp_bget_dequeue( th );         // Release any queued buffers
 
     // Dig through free lists and extract all allocated blocks
@@ -2068,4 +2268,21 @@ __kmp_free_fast_memory( kmp_info_t *th )
                   __kmp_gtid_from_thread( th ) ) );
 }
 
+// Free the task slabs of all reaped threads, with their chunks.
+// Only do this when the library shuts down, after all threads are reaped.
+void
+__kmp_cleanup_fast_memory( void )
+{
+    while ( __kmp_task_slab_orphans != NULL ) {
+        kmp_task_slab_t * slab = __kmp_task_slab_orphans;
+        __kmp_task_slab_orphans = slab->ts_next;
+        while ( slab->ts_chunks != NULL ) {
+            void * chunk = slab->ts_chunks;
+            slab->ts_chunks = *((void **)chunk);
+            __kmp_free( chunk );
+        }
+        __kmp_free( slab );
+    }
+}
+
 #endif // USE_FAST_MEMORY
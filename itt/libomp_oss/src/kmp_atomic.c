@@ -587,11 +587,8 @@ kmp_atomic_lock_t __kmp_atomic_lock_4r;  /* Control access to all user coded ato
 kmp_atomic_lock_t __kmp_atomic_lock_8i;  /* Control access to all user coded atomics for 8-byte fixed data types */
 kmp_atomic_lock_t __kmp_atomic_lock_8r;  /* Control access to all user coded atomics for kmp_real64 data type    */
 kmp_atomic_lock_t __kmp_atomic_lock_8c;  /* Control access to all user coded atomics for complex byte data type  */
-kmp_atomic_lock_t __kmp_atomic_lock_10r; /* Control access to all user coded atomics for long double data type   */
-kmp_atomic_lock_t __kmp_atomic_lock_16r; /* Control access to all user coded atomics for _Quad data type         */
-kmp_atomic_lock_t __kmp_atomic_lock_16c; /* Control access to all user coded atomics for double complex data type*/
-kmp_atomic_lock_t __kmp_atomic_lock_20c; /* Control access to all user coded atomics for long double complex type*/
-kmp_atomic_lock_t __kmp_atomic_lock_32c; /* Control access to all user coded atomics for _Quad complex data type */
+
+kmp_atomic_lock_slot_t __kmp_atomic_lock_table[ KMP_ATOMIC_LOCK_TABLE_SIZE ]; /* Wide data types, hashed by address */
 
 
 /*
@@ -657,19 +654,20 @@ RET_TYPE __kmpc_atomic_##TYPE_ID##_##OP_ID( ident_t *id_ref, int gtid, TYPE * lh
 
 // ------------------------------------------------------------------------
 // Lock variables used for critical sections for various size operands
-#define ATOMIC_LOCK0   __kmp_atomic_lock       // all types, for Gnu compat
-#define ATOMIC_LOCK1i  __kmp_atomic_lock_1i    // char
-#define ATOMIC_LOCK2i  __kmp_atomic_lock_2i    // short
-#define ATOMIC_LOCK4i  __kmp_atomic_lock_4i    // long int
-#define ATOMIC_LOCK4r  __kmp_atomic_lock_4r    // float
-#define ATOMIC_LOCK8i  __kmp_atomic_lock_8i    // long long int
-#define ATOMIC_LOCK8r  __kmp_atomic_lock_8r    // double
-#define ATOMIC_LOCK8c  __kmp_atomic_lock_8c    // float complex
-#define ATOMIC_LOCK10r __kmp_atomic_lock_10r   // long double
-#define ATOMIC_LOCK16r __kmp_atomic_lock_16r   // _Quad
-#define ATOMIC_LOCK16c __kmp_atomic_lock_16c   // double complex
-#define ATOMIC_LOCK20c __kmp_atomic_lock_20c   // long double complex
-#define ATOMIC_LOCK32c __kmp_atomic_lock_32c   // _Quad complex
+//     ADDR - address of the operand, selects the lock for the wide types
+#define ATOMIC_LOCK0(ADDR)   ( & __kmp_atomic_lock )       // all types, for Gnu compat
+#define ATOMIC_LOCK1i(ADDR)  ( & __kmp_atomic_lock_1i )    // char
+#define ATOMIC_LOCK2i(ADDR)  ( & __kmp_atomic_lock_2i )    // short
+#define ATOMIC_LOCK4i(ADDR)  ( & __kmp_atomic_lock_4i )    // long int
+#define ATOMIC_LOCK4r(ADDR)  ( & __kmp_atomic_lock_4r )    // float
+#define ATOMIC_LOCK8i(ADDR)  ( & __kmp_atomic_lock_8i )    // long long int
+#define ATOMIC_LOCK8r(ADDR)  ( & __kmp_atomic_lock_8r )    // double
+#define ATOMIC_LOCK8c(ADDR)  ( & __kmp_atomic_lock_8c )    // float complex
+#define ATOMIC_LOCK10r(ADDR) __kmp_get_atomic_lock( ADDR ) // long double
+#define ATOMIC_LOCK16r(ADDR) __kmp_get_atomic_lock( ADDR ) // _Quad
+#define ATOMIC_LOCK16c(ADDR) __kmp_get_atomic_lock( ADDR ) // double complex
+#define ATOMIC_LOCK20c(ADDR) __kmp_get_atomic_lock( ADDR ) // long double complex
+#define ATOMIC_LOCK32c(ADDR) __kmp_get_atomic_lock( ADDR ) // _Quad complex
 
 // ------------------------------------------------------------------------
 // Operation on *lhs, rhs bound by critical section
@@ -678,11 +676,11 @@ RET_TYPE __kmpc_atomic_##TYPE_ID##_##OP_ID( ident_t *id_ref, int gtid, TYPE * lh
 // Note: don't check gtid as it should always be valid
 // 1, 2-byte - expect valid parameter, other - check before this macro
 #define OP_CRITICAL(OP,LCK_ID) \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );                    \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );                    \
                                                                           \
     (*lhs) OP (rhs);                                                      \
                                                                           \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );
 
 // ------------------------------------------------------------------------
 // For GNU compatibility, we may need to use a critical section,
@@ -744,6 +742,99 @@ RET_TYPE __kmpc_atomic_##TYPE_ID##_##OP_ID( ident_t *id_ref, int gtid, TYPE * lh
 #define KMP_EX_COMPARE_AND_STORE_ACQ8 KMP_COMPARE_AND_STORE_ACQ8
 #define KMP_EX_COMPARE_AND_STORE_ACQ16 KMP_COMPARE_AND_STORE_ACQ16
 
+// ------------------------------------------------------------------------
+// 16-byte operands (long double, _Quad, double complex) on Intel(R) 64 are
+// updated with CMPXCHG16B when the operand is 16-byte aligned; otherwise, and
+// for the 32-byte complex types, the address-hashed locks are used.  Every
+// routine touching a wide type makes the same choice for a given address, so
+// lock-free and locked updates of one object never mix.
+#if KMP_ARCH_X86_64 && KMP_OS_UNIX
+ #define KMP_ATOMIC_CMPXCHG16 1
+#else
+ #define KMP_ATOMIC_CMPXCHG16 0
+#endif
+
+#if KMP_ATOMIC_CMPXCHG16
+
+ typedef struct kmp_atomic_bits16 {
+     kmp_uint64 lo;
+     kmp_uint64 hi;
+ } kmp_atomic_bits16_t;
+
+ static inline kmp_int32
+ __kmp_compare_and_store128( volatile kmp_atomic_bits16_t *p, kmp_atomic_bits16_t cv, kmp_atomic_bits16_t sv )
+ {
+     unsigned char ret;
+     __asm__ volatile ( "lock; cmpxchg16b %1\n\t"
+                        "sete %0"
+                        : "=q" (ret), "+m" (*p), "+a" (cv.lo), "+d" (cv.hi)
+                        : "b" (sv.lo), "c" (sv.hi)
+                        : "memory", "cc" );
+     return ret;
+ }
+
+ // The operand is read in two halves; a torn read just fails the compare-and-store.
+ #define KMP_ATOMIC_LOAD16(BITS,ADDR)                                      \
+        (BITS).lo = ( (volatile kmp_uint64 *)(ADDR) )[ 0 ];               \
+        (BITS).hi = ( (volatile kmp_uint64 *)(ADDR) )[ 1 ];
+
+ #define KMP_ATOMIC_USE_CMPXCHG16(SIZE,ADDR)                               \
+        ( (SIZE) == 16 && ! ( (kmp_uintptr_t)(ADDR) & 0xF ) && __kmp_cpuinfo.cx16 )
+
+ // Generic routines: f computes the new value from the old one.  The new value
+ // starts as a copy of the old one, so bytes f does not write are preserved.
+ static inline void
+ __kmp_atomic_cmpxchg16( void *lhs, void *rhs, void (*f)( void *, void *, void * ) )
+ {
+     kmp_atomic_bits16_t old_bits, new_bits;
+
+     KMP_ATOMIC_LOAD16( old_bits, lhs );
+     new_bits = old_bits;
+     (*f)( &new_bits, &old_bits, rhs );
+     while ( ! __kmp_compare_and_store128( (kmp_atomic_bits16_t *) lhs, old_bits, new_bits ) )
+     {
+         KMP_DO_PAUSE;
+
+         KMP_ATOMIC_LOAD16( old_bits, lhs );
+         new_bits = old_bits;
+         (*f)( &new_bits, &old_bits, rhs );
+     }
+ }
+
+// ------------------------------------------------------------------------
+// Operation on 16-byte *ADDR using CMPXCHG16B
+//     TYPE    - operands' type
+//     ADDR    - operand address (lhs or loc)
+//     NEW_VAL - expression computing new_value from old_value (and rhs)
+//     RET     - statement completing the routine, may use old_value and new_value
+// The union keeps the copies in bounds for the types this is never taken for.
+#define OP_CMPXCHG16(TYPE,ADDR,NEW_VAL,RET)                               \
+    if ( KMP_ATOMIC_USE_CMPXCHG16( sizeof( TYPE ), ADDR ) ) {             \
+        union { kmp_atomic_bits16_t b; char v[ sizeof( TYPE ) ]; } old_bits, new_bits; \
+        TYPE old_value, new_value;                                        \
+        KMP_ATOMIC_LOAD16( old_bits.b, ADDR );                            \
+        memcpy( &old_value, old_bits.v, sizeof( TYPE ) );                 \
+        new_value = NEW_VAL;                                              \
+        memcpy( new_bits.v, &new_value, sizeof( TYPE ) );                 \
+        while ( ! __kmp_compare_and_store128( (kmp_atomic_bits16_t *)(ADDR), \
+                      old_bits.b, new_bits.b ) )                          \
+        {                                                                 \
+            KMP_DO_PAUSE;                                                 \
+                                                                          \
+            KMP_ATOMIC_LOAD16( old_bits.b, ADDR );                        \
+            memcpy( &old_value, old_bits.v, sizeof( TYPE ) );             \
+            new_value = NEW_VAL;                                          \
+            memcpy( new_bits.v, &new_value, sizeof( TYPE ) );             \
+        }                                                                 \
+        RET;                                                              \
+    }
+
+#else
+
+ #define OP_CMPXCHG16(TYPE,ADDR,NEW_VAL,RET)
+
+#endif /* KMP_ATOMIC_CMPXCHG16 */
+
 // ------------------------------------------------------------------------
 // Operation on *lhs, rhs using "compare_and_store" routine
 //     TYPE    - operands' type
@@ -1029,12 +1120,12 @@ ATOMIC_CMPX_L( fixed8,  orl, kmp_int64, 64, ||, 8i, 7, KMP_ARCH_X86 )  // __kmpc
 // MIN and MAX need separate macros
 // OP - operator to check if we need any actions?
 #define MIN_MAX_CRITSECT(OP,LCK_ID)                                        \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );                     \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );                     \
                                                                            \
     if ( *lhs OP rhs ) {                 /* still need actions? */         \
         *lhs = rhs;                                                        \
     }                                                                      \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );
 
 // -------------------------------------------------------------------------
 #ifdef KMP_GOMP_COMPAT
@@ -1072,6 +1163,7 @@ ATOMIC_CMPX_L( fixed8,  orl, kmp_int64, 64, ||, 8i, 7, KMP_ARCH_X86 )  // __kmpc
 ATOMIC_BEGIN(TYPE_ID,OP_ID,TYPE,void)                                      \
     if ( *lhs OP rhs ) {     /* need actions? */                           \
         GOMP_MIN_MAX_CRITSECT(OP,GOMP_FLAG)                                \
+        OP_CMPXCHG16(TYPE,lhs,( old_value OP rhs ) ? rhs : old_value,return) \
         MIN_MAX_CRITSECT(OP,LCK_ID)                                        \
     }                                                                      \
 }
@@ -1175,6 +1267,7 @@ ATOMIC_CMPX_EQV( fixed8, eqv,  kmp_int64, 64,  ^~, 8i, 7, KMP_ARCH_X86 ) // __km
 #define ATOMIC_CRITICAL(TYPE_ID,OP_ID,TYPE,OP,LCK_ID,GOMP_FLAG)           \
 ATOMIC_BEGIN(TYPE_ID,OP_ID,TYPE,void)                                     \
     OP_GOMP_CRITICAL(OP##=,GOMP_FLAG)  /* send assignment */              \
+    OP_CMPXCHG16(TYPE,lhs,old_value OP rhs,return)                        \
     OP_CRITICAL(OP##=,LCK_ID)          /* send assignment */              \
 }
 
@@ -1236,11 +1329,11 @@ ATOMIC_CRITICAL( cmplx16, div, CPLX128_LEG,     /, 32c,   1 )            // __km
 // Note: don't check gtid as it should always be valid
 // 1, 2-byte - expect valid parameter, other - check before this macro
 #define OP_CRITICAL_REV(OP,LCK_ID) \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
                                                                           \
     (*lhs) = (rhs) OP (*lhs);                                             \
                                                                           \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );
 
 #ifdef KMP_GOMP_COMPAT
 #define OP_GOMP_CRITICAL_REV(OP,FLAG)                                     \
@@ -1354,6 +1447,7 @@ ATOMIC_CMPXCHG_REV( float8,  sub, kmp_real64, 64, -,  8r, KMP_ARCH_X86 )  // __k
 #define ATOMIC_CRITICAL_REV(TYPE_ID,OP_ID,TYPE,OP,LCK_ID,GOMP_FLAG)           \
 ATOMIC_BEGIN_REV(TYPE_ID,OP_ID,TYPE,void)                                     \
     OP_GOMP_CRITICAL_REV(OP,GOMP_FLAG)                                        \
+    OP_CMPXCHG16(TYPE,lhs,rhs OP old_value,return)                            \
     OP_CRITICAL_REV(OP,LCK_ID)                                                \
 }
 
@@ -1411,6 +1505,7 @@ void __kmpc_atomic_##TYPE_ID##_##OP_ID##_##RTYPE_ID( ident_t *id_ref, int gtid,
 #define ATOMIC_CRITICAL_FP(TYPE_ID,TYPE,OP_ID,OP,RTYPE_ID,RTYPE,LCK_ID,GOMP_FLAG)         \
 ATOMIC_BEGIN_MIX(TYPE_ID,TYPE,OP_ID,RTYPE_ID,RTYPE)                                       \
     OP_GOMP_CRITICAL(OP##=,GOMP_FLAG)  /* send assignment */                              \
+    OP_CMPXCHG16(TYPE,lhs,old_value OP rhs,return)                                        \
     OP_CRITICAL(OP##=,LCK_ID)  /* send assignment */                                      \
 }
 
@@ -1577,11 +1672,11 @@ RET_TYPE __kmpc_atomic_##TYPE_ID##_##OP_ID( ident_t *id_ref, int gtid, TYPE * lo
 // Note: don't check gtid as it should always be valid
 // 1, 2-byte - expect valid parameter, other - check before this macro
 #define OP_CRITICAL_READ(OP,LCK_ID)                                       \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );                    \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( loc ), gtid );                    \
                                                                           \
     new_value = (*loc);                                                   \
                                                                           \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( loc ), gtid );
 
 // -------------------------------------------------------------------------
 #ifdef KMP_GOMP_COMPAT
@@ -1619,6 +1714,7 @@ ATOMIC_BEGIN_READ(TYPE_ID,OP_ID,TYPE,TYPE)                                \
 ATOMIC_BEGIN_READ(TYPE_ID,OP_ID,TYPE,TYPE)                                \
     TYPE new_value;                                                       \
     OP_GOMP_CRITICAL_READ(OP##=,GOMP_FLAG)  /* send assignment */         \
+    OP_CMPXCHG16(TYPE,loc,old_value,return new_value)                     \
     OP_CRITICAL_READ(OP,LCK_ID)          /* send assignment */            \
     return new_value;                                                     \
 }
@@ -1630,11 +1726,11 @@ ATOMIC_BEGIN_READ(TYPE_ID,OP_ID,TYPE,TYPE)                                \
 #if ( KMP_OS_WINDOWS )
 
 #define OP_CRITICAL_READ_WRK(OP,LCK_ID)                                   \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );                    \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( loc ), gtid );                    \
                                                                           \
     (*out) = (*loc);                                                      \
                                                                           \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( loc ), gtid );
 // ------------------------------------------------------------------------
 #ifdef KMP_GOMP_COMPAT
 #define OP_GOMP_CRITICAL_READ_WRK(OP,FLAG)                                \
@@ -1748,6 +1844,7 @@ ATOMIC_BEGIN(TYPE_ID,OP_ID,TYPE,void)                                     \
 #define ATOMIC_CRITICAL_WR(TYPE_ID,OP_ID,TYPE,OP,LCK_ID,GOMP_FLAG)        \
 ATOMIC_BEGIN(TYPE_ID,OP_ID,TYPE,void)                                     \
     OP_GOMP_CRITICAL(OP,GOMP_FLAG)       /* send assignment */            \
+    OP_CMPXCHG16(TYPE,lhs,rhs,return)                                     \
     OP_CRITICAL(OP,LCK_ID)               /* send assignment */            \
 }
 // -------------------------------------------------------------------------
@@ -1801,7 +1898,7 @@ RET_TYPE __kmpc_atomic_##TYPE_ID##_##OP_ID( ident_t *id_ref, int gtid, TYPE * lh
 // Note: don't check gtid as it should always be valid
 // 1, 2-byte - expect valid parameter, other - check before this macro
 #define OP_CRITICAL_CPT(OP,LCK_ID)                                        \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
                                                                           \
     if( flag ) {                                                          \
         (*lhs) OP rhs;                                                    \
@@ -1811,7 +1908,7 @@ RET_TYPE __kmpc_atomic_##TYPE_ID##_##OP_ID( ident_t *id_ref, int gtid, TYPE * lh
         (*lhs) OP rhs;                                                    \
     }                                                                     \
                                                                           \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
     return new_value;
 
 // ------------------------------------------------------------------------
@@ -1975,14 +2072,14 @@ ATOMIC_CMPXCHG_CPT( float8,  mul_cpt, kmp_real64, 64, *,  KMP_ARCH_X86 )  // __k
 // Note: don't check gtid as it should always be valid
 // 1, 2-byte - expect valid parameter, other - check before this macro
 #define OP_CRITICAL_L_CPT(OP,LCK_ID)                                      \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );                    \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );                    \
                                                                           \
     if( flag ) {                                                          \
         new_value OP rhs;                                                 \
     } else                                                                \
         new_value = (*lhs);                                               \
                                                                           \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );
 
 // ------------------------------------------------------------------------
 #ifdef KMP_GOMP_COMPAT
@@ -2026,7 +2123,7 @@ ATOMIC_CMPX_L_CPT( fixed8,  orl_cpt, kmp_int64, 64, ||, KMP_ARCH_X86 )  // __kmp
 // MIN and MAX need separate macros
 // OP - operator to check if we need any actions?
 #define MIN_MAX_CRITSECT_CPT(OP,LCK_ID)                                    \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );                     \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );                     \
                                                                            \
     if ( *lhs OP rhs ) {                 /* still need actions? */         \
         old_value = *lhs;                                                  \
@@ -2036,7 +2133,7 @@ ATOMIC_CMPX_L_CPT( fixed8,  orl_cpt, kmp_int64, 64, ||, KMP_ARCH_X86 )  // __kmp
         else                                                               \
             new_value = old_value;                                         \
     }                                                                      \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );                     \
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );                     \
     return new_value;                                                      \
 
 // -------------------------------------------------------------------------
@@ -2079,6 +2176,8 @@ ATOMIC_BEGIN_CPT(TYPE_ID,OP_ID,TYPE,TYPE)                                  \
     TYPE new_value, old_value;                                             \
     if ( *lhs OP rhs ) {     /* need actions? */                           \
         GOMP_MIN_MAX_CRITSECT_CPT(OP,GOMP_FLAG)                            \
+        OP_CMPXCHG16(TYPE,lhs,( old_value OP rhs ) ? rhs : old_value,      \
+                     return flag ? new_value : old_value)                  \
         MIN_MAX_CRITSECT_CPT(OP,LCK_ID)                                    \
     }                                                                      \
     return *lhs;                                                           \
@@ -2152,6 +2251,7 @@ ATOMIC_CMPX_EQV_CPT( fixed8, eqv_cpt,  kmp_int64, 64,  ^~, KMP_ARCH_X86 ) // __k
 ATOMIC_BEGIN_CPT(TYPE_ID,OP_ID,TYPE,TYPE)                           \
     TYPE new_value;                                                 \
     OP_GOMP_CRITICAL_CPT(OP,GOMP_FLAG)  /* send assignment */       \
+    OP_CMPXCHG16(TYPE,lhs,old_value OP rhs,return flag ? new_value : old_value) \
     OP_CRITICAL_CPT(OP##=,LCK_ID)          /* send assignment */    \
 }
 
@@ -2160,7 +2260,7 @@ ATOMIC_BEGIN_CPT(TYPE_ID,OP_ID,TYPE,TYPE)                           \
 // Workaround for cmplx4. Regular routines with return value don't work
 // on Win_32e. Let's return captured values through the additional parameter.
 #define OP_CRITICAL_CPT_WRK(OP,LCK_ID)                                    \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
                                                                           \
     if( flag ) {                                                          \
         (*lhs) OP rhs;                                                    \
@@ -2170,7 +2270,7 @@ ATOMIC_BEGIN_CPT(TYPE_ID,OP_ID,TYPE,TYPE)                           \
         (*lhs) OP rhs;                                                    \
     }                                                                     \
                                                                           \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
     return;
 // ------------------------------------------------------------------------
 
@@ -2256,7 +2356,7 @@ ATOMIC_CRITICAL_CPT( cmplx16, div_cpt, CPLX128_LEG, /, 32c,   1 )            //
 // Note: don't check gtid as it should always be valid
 // 1, 2-byte - expect valid parameter, other - check before this macro
 #define OP_CRITICAL_CPT_REV(OP,LCK_ID)                                    \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
                                                                           \
     if( flag ) {                                                          \
         /*temp_val = (*lhs);*/\
@@ -2266,7 +2366,7 @@ ATOMIC_CRITICAL_CPT( cmplx16, div_cpt, CPLX128_LEG, /, 32c,   1 )            //
         new_value = (*lhs);\
         (*lhs) = (rhs) OP (*lhs);                                         \
     }                                                                     \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
     return new_value;
 
 // ------------------------------------------------------------------------
@@ -2362,6 +2462,7 @@ ATOMIC_BEGIN_CPT(TYPE_ID,OP_ID,TYPE,TYPE)                               \
         TYPE KMP_ATOMIC_VOLATILE temp_val;                                \
     /*printf("__kmp_atomic_mode = %d\n", __kmp_atomic_mode);*/\
     OP_GOMP_CRITICAL_CPT_REV(OP,GOMP_FLAG)                              \
+    OP_CMPXCHG16(TYPE,lhs,rhs OP old_value,return flag ? new_value : old_value) \
     OP_CRITICAL_CPT_REV(OP,LCK_ID)                                      \
 }
 
@@ -2385,7 +2486,7 @@ ATOMIC_CRITICAL_CPT_REV( float16, div_cpt_rev, QUAD_LEGACY,     /, 16r,   1 )
 // Workaround for cmplx4. Regular routines with return value don't work
 // on Win_32e. Let's return captured values through the additional parameter.
 #define OP_CRITICAL_CPT_REV_WRK(OP,LCK_ID)                                \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
                                                                           \
     if( flag ) {                                                          \
         (*lhs) = (rhs) OP (*lhs);                                         \
@@ -2395,7 +2496,7 @@ ATOMIC_CRITICAL_CPT_REV( float16, div_cpt_rev, QUAD_LEGACY,     /, 16r,   1 )
         (*lhs) = (rhs) OP (*lhs);                                         \
     }                                                                     \
                                                                           \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
     return;
 // ------------------------------------------------------------------------
 
@@ -2443,12 +2544,12 @@ TYPE __kmpc_atomic_##TYPE_ID##_swp( ident_t *id_ref, int gtid, TYPE * lhs, TYPE
     KA_TRACE(100,("__kmpc_atomic_" #TYPE_ID "_swp: T#%d\n", gtid ));
 
 #define CRITICAL_SWP(LCK_ID)                                              \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
                                                                           \
     old_value = (*lhs);                                                   \
     (*lhs) = rhs;                                                         \
                                                                           \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
     return old_value;
 
 // ------------------------------------------------------------------------
@@ -2528,6 +2629,7 @@ ATOMIC_XCHG_FLOAT_SWP( float4, kmp_real32, 32, KMP_ARCH_X86 )      // __kmpc_ato
 ATOMIC_BEGIN_SWP(TYPE_ID,TYPE)                                          \
     TYPE old_value;                                                     \
     GOMP_CRITICAL_SWP(GOMP_FLAG)                                        \
+    OP_CMPXCHG16(TYPE,lhs,rhs,return old_value)                         \
     CRITICAL_SWP(LCK_ID)                                                \
 }
 
@@ -2545,12 +2647,12 @@ void __kmpc_atomic_##TYPE_ID##_swp( ident_t *id_ref, int gtid, TYPE * lhs, TYPE
 
 
 #define CRITICAL_SWP_WRK(LCK_ID)                                          \
-    __kmp_acquire_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_acquire_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
                                                                           \
     tmp = (*lhs);                                                         \
     (*lhs) = (rhs);                                                       \
     (*out) = tmp;                                                         \
-    __kmp_release_atomic_lock( & ATOMIC_LOCK##LCK_ID, gtid );             \
+    __kmp_release_atomic_lock( ATOMIC_LOCK##LCK_ID( lhs ), gtid );             \
     return;
 
 // ------------------------------------------------------------------------
@@ -2837,13 +2939,26 @@ __kmpc_atomic_10( ident_t *id_ref, int gtid, void* lhs, void* rhs, void (*f)( vo
 {
     KMP_DEBUG_ASSERT( __kmp_init_serial );
 
+#if KMP_ATOMIC_CMPXCHG16
+    // A 10-byte long double occupies 16 bytes on Intel(R) 64.
+    if ( KMP_ATOMIC_USE_CMPXCHG16( 16, lhs )
+#ifdef KMP_GOMP_COMPAT
+         && ( __kmp_atomic_mode != 2 )
+#endif /* KMP_GOMP_COMPAT */
+       )
+    {
+        __kmp_atomic_cmpxchg16( lhs, rhs, f );
+        return;
+    }
+#endif /* KMP_ATOMIC_CMPXCHG16 */
+
 #ifdef KMP_GOMP_COMPAT
     if ( __kmp_atomic_mode == 2 ) {
         __kmp_acquire_atomic_lock( & __kmp_atomic_lock, gtid );
     }
     else
 #endif /* KMP_GOMP_COMPAT */
-    __kmp_acquire_atomic_lock( & __kmp_atomic_lock_10r, gtid );
+    __kmp_acquire_atomic_lock( __kmp_get_atomic_lock( lhs ), gtid );
 
     (*f)( lhs, lhs, rhs );
 
@@ -2853,7 +2968,7 @@ __kmpc_atomic_10( ident_t *id_ref, int gtid, void* lhs, void* rhs, void (*f)( vo
     }
     else
 #endif /* KMP_GOMP_COMPAT */
-    __kmp_release_atomic_lock( & __kmp_atomic_lock_10r, gtid );
+    __kmp_release_atomic_lock( __kmp_get_atomic_lock( lhs ), gtid );
 }
 
 void
@@ -2861,13 +2976,25 @@ __kmpc_atomic_16( ident_t *id_ref, int gtid, void* lhs, void* rhs, void (*f)( vo
 {
     KMP_DEBUG_ASSERT( __kmp_init_serial );
 
+#if KMP_ATOMIC_CMPXCHG16
+    if ( KMP_ATOMIC_USE_CMPXCHG16( 16, lhs )
+#ifdef KMP_GOMP_COMPAT
+         && ( __kmp_atomic_mode != 2 )
+#endif /* KMP_GOMP_COMPAT */
+       )
+    {
+        __kmp_atomic_cmpxchg16( lhs, rhs, f );
+        return;
+    }
+#endif /* KMP_ATOMIC_CMPXCHG16 */
+
 #ifdef KMP_GOMP_COMPAT
     if ( __kmp_atomic_mode == 2 ) {
         __kmp_acquire_atomic_lock( & __kmp_atomic_lock, gtid );
     }
     else
 #endif /* KMP_GOMP_COMPAT */
-    __kmp_acquire_atomic_lock( & __kmp_atomic_lock_16c, gtid );
+    __kmp_acquire_atomic_lock( __kmp_get_atomic_lock( lhs ), gtid );
 
     (*f)( lhs, lhs, rhs );
 
@@ -2877,7 +3004,7 @@ __kmpc_atomic_16( ident_t *id_ref, int gtid, void* lhs, void* rhs, void (*f)( vo
     }
     else
 #endif /* KMP_GOMP_COMPAT */
-    __kmp_release_atomic_lock( & __kmp_atomic_lock_16c, gtid );
+    __kmp_release_atomic_lock( __kmp_get_atomic_lock( lhs ), gtid );
 }
 
 void
@@ -2891,7 +3018,7 @@ __kmpc_atomic_20( ident_t *id_ref, int gtid, void* lhs, void* rhs, void (*f)( vo
     }
     else
 #endif /* KMP_GOMP_COMPAT */
-    __kmp_acquire_atomic_lock( & __kmp_atomic_lock_20c, gtid );
+    __kmp_acquire_atomic_lock( __kmp_get_atomic_lock( lhs ), gtid );
 
     (*f)( lhs, lhs, rhs );
 
@@ -2901,7 +3028,7 @@ __kmpc_atomic_20( ident_t *id_ref, int gtid, void* lhs, void* rhs, void (*f)( vo
     }
     else
 #endif /* KMP_GOMP_COMPAT */
-    __kmp_release_atomic_lock( & __kmp_atomic_lock_20c, gtid );
+    __kmp_release_atomic_lock( __kmp_get_atomic_lock( lhs ), gtid );
 }
 
 void
@@ -2915,7 +3042,7 @@ __kmpc_atomic_32( ident_t *id_ref, int gtid, void* lhs, void* rhs, void (*f)( vo
     }
     else
 #endif /* KMP_GOMP_COMPAT */
-    __kmp_acquire_atomic_lock( & __kmp_atomic_lock_32c, gtid );
+    __kmp_acquire_atomic_lock( __kmp_get_atomic_lock( lhs ), gtid );
 
     (*f)( lhs, lhs, rhs );
 
@@ -2925,7 +3052,7 @@ __kmpc_atomic_32( ident_t *id_ref, int gtid, void* lhs, void* rhs, void (*f)( vo
     }
     else
 #endif /* KMP_GOMP_COMPAT */
-    __kmp_release_atomic_lock( & __kmp_atomic_lock_32c, gtid );
+    __kmp_release_atomic_lock( __kmp_get_atomic_lock( lhs ), gtid );
 }
 
 // AC: same two routines as GOMP_atomic_start/end, but will be called by our compiler
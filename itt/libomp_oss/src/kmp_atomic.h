@@ -433,11 +433,29 @@ extern kmp_atomic_lock_t __kmp_atomic_lock_4r;  /* Control access to all user co
 extern kmp_atomic_lock_t __kmp_atomic_lock_8i;  /* Control access to all user coded atomics for 8-byte fixed data types */
 extern kmp_atomic_lock_t __kmp_atomic_lock_8r;  /* Control access to all user coded atomics for kmp_real64 data type    */
 extern kmp_atomic_lock_t __kmp_atomic_lock_8c;  /* Control access to all user coded atomics for complex byte data type  */
-extern kmp_atomic_lock_t __kmp_atomic_lock_10r; /* Control access to all user coded atomics for long double data type   */
-extern kmp_atomic_lock_t __kmp_atomic_lock_16r; /* Control access to all user coded atomics for _Quad data type         */
-extern kmp_atomic_lock_t __kmp_atomic_lock_16c; /* Control access to all user coded atomics for double complex data type*/
-extern kmp_atomic_lock_t __kmp_atomic_lock_20c; /* Control access to all user coded atomics for long double complex type*/
-extern kmp_atomic_lock_t __kmp_atomic_lock_32c; /* Control access to all user coded atomics for _Quad complex data type */
+
+//
+// Atomics on the wide types (long double, _Quad and the complex flavours) that
+// cannot be done with a compare-and-store are serialized by one of these locks,
+// picked by the address of the operand, so unrelated atomics only meet on a
+// hash collision instead of all of them sharing one lock per type.
+//
+
+#define KMP_ATOMIC_LOCK_TABLE_SIZE 128  /* must be a power of 2 */
+
+typedef struct KMP_ALIGN_CACHE kmp_atomic_lock_slot {
+    kmp_atomic_lock_t als_lock;
+} kmp_atomic_lock_slot_t;
+
+extern kmp_atomic_lock_slot_t __kmp_atomic_lock_table[ KMP_ATOMIC_LOCK_TABLE_SIZE ];
+
+inline kmp_atomic_lock_t *
+__kmp_get_atomic_lock( void *addr )
+{
+    // The wide types are at least 16 bytes long, so the low 4 bits carry no information.
+    kmp_uintptr_t key = (kmp_uintptr_t) addr >> 4;
+    return & __kmp_atomic_lock_table[ ( key ^ ( key >> 7 ) ) & ( KMP_ATOMIC_LOCK_TABLE_SIZE - 1 ) ].als_lock;
+}
 
 //
 //  Below routines for atomic UPDATE are listed
@@ -48,6 +48,7 @@
 #include "kmp.h"
 #include "kmp_i18n.h"
 #include "kmp_error.h"
+#include "kmp_ompt.h"
 
 #define MAX_MESSAGE 512
 
@@ -425,7 +426,7 @@ __kmpc_serialized_parallel(ident_t *loc, kmp_int32 global_tid)
                                                this_thr->th.th_team->t.t_set_bt_intervals[tid],
                                                this_thr->th.th_team->t.t_set_bt_set[tid],
 #endif // OMP_30_ENABLED
-                                               0);
+                                               0, NULL);
                 __kmp_release_bootstrap_lock( &__kmp_forkjoin_lock );
                 KMP_ASSERT( new_team );
 
@@ -882,10 +883,14 @@ __kmpc_ordered( ident_t * loc, kmp_int32 gtid )
 
     th = __kmp_threads[ gtid ];
 
-    if ( th -> th.th_dispatch -> th_deo_fcn != 0 )
-        (*th->th.th_dispatch->th_deo_fcn)( & gtid, & cid, loc );
-    else
-        __kmp_parallel_deo( & gtid, & cid, loc );
+    {
+        KMP_OMPT_STATE_ENTER( th, ompt_prev_state, ompt_state_wait_ordered, loc );
+        if ( th -> th.th_dispatch -> th_deo_fcn != 0 )
+            (*th->th.th_dispatch->th_deo_fcn)( & gtid, & cid, loc );
+        else
+            __kmp_parallel_deo( & gtid, & cid, loc );
+        KMP_OMPT_STATE_EXIT( th, ompt_prev_state );
+    }
 
 }
 
@@ -918,6 +923,261 @@ __kmp_static_yield( int arg ) { // AC: needed in macro __kmp_acquire_user_lock_w
     __kmp_yield( arg );
 }
 
+//
+// KMP_LOCK_PROFILE: try the lock first to tell whether the acquisition has
+// to wait, time it, and start timing the hold.  The release side only has
+// to end the hold.  try_lock must not report errors under
+// KMP_CONSISTENCY_CHECK; the checked acquire runs if it fails.
+//
+// Adaptive locks are not profiled: they may be held inside an RTM
+// transaction, which the profile updates would abort.  They are never
+// nested, so only the simple lock sites check for them.
+//
+#if KMP_USE_ADAPTIVE_LOCKS
+# if KMP_USE_DYNAMIC_LOCK
+#  define KMP_I_LOCK_SPECULATIVE(ilk)   ( (ilk)->type == locktag_adaptive )
+#  define KMP_USER_LOCK_SPECULATIVE(l)  ( KMP_EXTRACT_D_TAG( l ) == 0 && KMP_I_LOCK_SPECULATIVE( KMP_LOOKUP_I_LOCK( l ) ) )
+# else
+#  define KMP_USER_LOCK_SPECULATIVE(l)  ( __kmp_user_lock_kind == lk_adaptive )
+# endif
+#else
+# define KMP_I_LOCK_SPECULATIVE(ilk)    0
+# define KMP_USER_LOCK_SPECULATIVE(l)   0
+#endif
+
+#define KMP_PROFILED_ACQUIRE(gtid, loc, lock, func, speculative, try_lock, acquire)            \
+    do {                                                                                        \
+        if ( __kmp_lock_profile && ! ( speculative ) ) {                                        \
+            kmp_uint64 __prof_start = __kmp_hardware_timestamp();                               \
+            int __prof_contended = ! ( try_lock );                                              \
+            if ( __prof_contended ) {                                                           \
+                acquire;                                                                        \
+            }                                                                                   \
+            __kmp_lock_profile_acquired( gtid, loc, lock, func, __prof_start, __prof_contended ); \
+        }                                                                                       \
+        else {                                                                                  \
+            acquire;                                                                            \
+        }                                                                                       \
+    } while ( 0 )
+
+#define KMP_PROFILED_RELEASE(gtid, lock)                                                        \
+    do {                                                                                        \
+        if ( __kmp_lock_profile ) {                                                             \
+            __kmp_lock_profile_released( gtid, lock );                                          \
+        }                                                                                       \
+    } while ( 0 )
+
+#if KMP_USE_DYNAMIC_LOCK
+
+//
+// Lock kind for a lock hint.  Contradictory hints are ignored; speculation
+// is only used when the processor supports it.
+//
+static __forceinline kmp_dyna_lockseq_t
+__kmp_map_hint_to_lock( kmp_uintptr_t hint )
+{
+#if OMP_40_ENABLED
+    if ( ( hint & kmp_lock_hint_contended ) && ( hint & kmp_lock_hint_uncontended ) ) {
+        return __kmp_user_lock_seq;
+    }
+    if ( ( hint & kmp_lock_hint_speculative ) && ( hint & kmp_lock_hint_nonspeculative ) ) {
+        return __kmp_user_lock_seq;
+    }
+#if KMP_USE_ADAPTIVE_LOCKS
+    if ( hint & kmp_lock_hint_speculative ) {
+        if ( ! __kmp_cpuinfo.initialized ) {
+            __kmp_query_cpuid( & __kmp_cpuinfo );
+        }
+        return __kmp_cpuinfo.rtm ? lockseq_adaptive : __kmp_user_lock_seq;
+    }
+#endif
+    if ( hint & kmp_lock_hint_contended ) {
+        return lockseq_queuing;
+    }
+    if ( hint & kmp_lock_hint_uncontended ) {
+        return lockseq_tas;
+    }
+#if KMP_USE_ADAPTIVE_LOCKS
+    if ( ( hint & kmp_lock_hint_nonspeculative ) && ( __kmp_user_lock_seq == lockseq_adaptive ) ) {
+        return lockseq_queuing;
+    }
+#endif
+#endif // OMP_40_ENABLED
+    return __kmp_user_lock_seq;
+}
+
+//
+// Nested locks are always indirect; they use the nested version of the
+// kind a simple lock would get.
+//
+static __forceinline kmp_dyna_lockseq_t
+__kmp_map_hint_to_nested_lock( kmp_uintptr_t hint )
+{
+    switch ( __kmp_map_hint_to_lock( hint ) ) {
+        case lockseq_tas:
+            return lockseq_nested_tas;
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+        case lockseq_futex:
+            return lockseq_nested_futex;
+#endif
+        case lockseq_ticket:
+            return lockseq_nested_ticket;
+        case lockseq_drdpa:
+            return lockseq_nested_drdpa;
+        default: // queuing, adaptive
+            return lockseq_nested_queuing;
+    }
+}
+
+//
+// Set up the lock of a critical section on first use.  Direct locks live in
+// the critical section itself, indirect ones are pointed to by it.  The
+// first thread to get here decides the lock kind.
+//
+static void
+__kmp_init_dyna_critical( kmp_critical_name * crit, ident_t const * loc, kmp_int32 gtid, kmp_dyna_lockseq_t seq )
+{
+    void **lck_pp = (void **)crit;
+
+    if ( KMP_IS_D_LOCK( seq ) ) {
+        // Pointer-sized exchange, so we cannot lose against an indirect lock pointer.
+        KMP_COMPARE_AND_STORE_PTR( lck_pp, 0, (void *)(kmp_uintptr_t)KMP_GET_D_TAG( seq ) );
+    }
+    else {
+        kmp_lock_index_t idx;
+        kmp_indirect_lock_t *ilk = __kmp_allocate_indirect_lock( (void **)&idx, gtid, KMP_GET_I_TAG( seq ) );
+        KMP_I_LOCK_FUNC( ilk, init )( ilk->lock );
+        KMP_SET_I_LOCK_LOCATION( ilk, loc );
+        KMP_SET_I_LOCK_FLAGS( ilk, kmp_lf_critical_section );
+        //
+        // As with the lock table locks: if another thread beat us to it,
+        // free the lock and use the one the other thread allocated.
+        //
+        if ( KMP_COMPARE_AND_STORE_PTR( lck_pp, 0, ilk ) == 0 ) {
+            KMP_I_LOCK_FUNC( ilk, destroy )( ilk->lock );
+            __kmp_free_indirect_lock( ilk, idx >> 1, gtid );
+        }
+    }
+    KMP_DEBUG_ASSERT( TCR_PTR( *lck_pp ) != NULL );
+}
+
+//
+// Consistency check: nested locks are indirect locks of a nested kind, all
+// other locks are simple ones.
+//
+static void
+__kmp_check_dyna_lock_nesting( void ** user_lock, int nested, char const * func )
+{
+    int is_nested = FALSE;
+
+    if ( user_lock == NULL ) {
+        KMP_FATAL( LockIsUninitialized, func );
+    }
+    if ( KMP_EXTRACT_D_TAG( user_lock ) == 0 ) {
+        kmp_indirect_lock_t *ilk = __kmp_lookup_indirect_lock( user_lock, func );
+        is_nested = ( ilk->type >= locktag_nested_tas );
+    }
+    if ( nested && ! is_nested ) {
+        KMP_FATAL( LockSimpleUsedAsNestable, func );
+    }
+    if ( ! nested && is_nested ) {
+        KMP_FATAL( LockNestableUsedAsSimple, func );
+    }
+}
+
+//
+// Operations on a lock word with inlined fast paths for the direct locks.
+// An uncontended acquire of a test and set or futex lock is a single
+// compare-and-swap on the lock word, an uncontended release a plain store
+// (tas) or a compare-and-swap (futex).  Contended locks, indirect locks and
+// all locks under KMP_CONSISTENCY_CHECK go through the lock operation
+// tables.  The lock statistics are only counted by the lock functions, so
+// nothing is inlined when they are collected.
+//
+#if KMP_USE_INLINED_DIRECT_LOCKS && ! KMP_STATS_ENABLED
+# define KMP_INLINE_DIRECT_LOCKS 1
+#else
+# define KMP_INLINE_DIRECT_LOCKS 0
+#endif
+
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+// Use the compiler intrinsic, as the tas fast path in kmp_lock.h does; the
+// assembly routine behind KMP_COMPARE_AND_STORE_ACQ32 would cost a call.
+# define KMP_DIRECT_LOCK_CAS(p, cv, sv) \
+    __sync_bool_compare_and_swap( (volatile kmp_uint32 *)( p ), (kmp_uint32)( cv ), (kmp_uint32)( sv ) )
+#else
+# define KMP_DIRECT_LOCK_CAS(p, cv, sv) KMP_COMPARE_AND_STORE_ACQ32( p, cv, sv )
+#endif
+
+static __forceinline void
+__kmp_set_dyna_lock( kmp_dyna_lock_t * lk, kmp_int32 gtid )
+{
+#if KMP_INLINE_DIRECT_LOCKS
+    if ( ! __kmp_env_consistency_check ) {
+        if ( KMP_EXTRACT_D_TAG( lk ) == lockseq_tas ) {
+            if ( KMP_DIRECT_LOCK_CAS( lk, KMP_LOCK_FREE( tas ), KMP_LOCK_BUSY( gtid + 1, tas ) ) ) {
+                return;
+            }
+        }
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+        else if ( KMP_EXTRACT_D_TAG( lk ) == lockseq_futex ) {
+            if ( KMP_DIRECT_LOCK_CAS( lk, KMP_LOCK_FREE( futex ),
+              KMP_LOCK_BUSY( ( gtid + 1 ) << 1, futex ) ) ) {
+                return;
+            }
+        }
+#endif
+    }
+#endif // KMP_INLINE_DIRECT_LOCKS
+    KMP_D_LOCK_FUNC( lk, set )( lk, gtid );
+}
+
+static __forceinline void
+__kmp_unset_dyna_lock( kmp_dyna_lock_t * lk, kmp_int32 gtid )
+{
+#if KMP_INLINE_DIRECT_LOCKS
+    if ( ! __kmp_env_consistency_check ) {
+        if ( KMP_EXTRACT_D_TAG( lk ) == lockseq_tas ) {
+            TCW_4( *(volatile kmp_dyna_lock_t *)lk, KMP_LOCK_FREE( tas ) );
+            KMP_MB();
+            return;
+        }
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+        else if ( KMP_EXTRACT_D_TAG( lk ) == lockseq_futex ) {
+            // Fails if a waiter has set the wake-up bit; the lock function wakes it.
+            if ( KMP_DIRECT_LOCK_CAS( lk, KMP_LOCK_BUSY( ( gtid + 1 ) << 1, futex ),
+              KMP_LOCK_FREE( futex ) ) ) {
+                return;
+            }
+        }
+#endif
+    }
+#endif // KMP_INLINE_DIRECT_LOCKS
+    KMP_D_LOCK_FUNC( lk, unset )( lk, gtid );
+}
+
+static __forceinline int
+__kmp_test_dyna_lock( kmp_dyna_lock_t * lk, kmp_int32 gtid )
+{
+#if KMP_INLINE_DIRECT_LOCKS
+    if ( ! __kmp_env_consistency_check ) {
+        if ( KMP_EXTRACT_D_TAG( lk ) == lockseq_tas ) {
+            return ( TCR_4( *(volatile kmp_dyna_lock_t *)lk ) == KMP_LOCK_FREE( tas ) )
+              && KMP_DIRECT_LOCK_CAS( lk, KMP_LOCK_FREE( tas ), KMP_LOCK_BUSY( gtid + 1, tas ) );
+        }
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+        else if ( KMP_EXTRACT_D_TAG( lk ) == lockseq_futex ) {
+            return KMP_DIRECT_LOCK_CAS( lk, KMP_LOCK_FREE( futex ),
+              KMP_LOCK_BUSY( ( gtid + 1 ) << 1, futex ) );
+        }
+#endif
+    }
+#endif // KMP_INLINE_DIRECT_LOCKS
+    return KMP_D_LOCK_FUNC( lk, test )( lk, gtid );
+}
+
+#else // KMP_USE_DYNAMIC_LOCK
+
 static kmp_user_lock_p
 __kmp_get_critical_section_ptr( kmp_critical_name * crit, ident_t const * loc, kmp_int32 gtid )
 {
@@ -957,6 +1217,8 @@ __kmp_get_critical_section_ptr( kmp_critical_name * crit, ident_t const * loc, k
     return lck;
 }
 
+#endif // KMP_USE_DYNAMIC_LOCK
+
 /*!
 @ingroup WORK_SHARING
 @param loc  source location information.
@@ -967,13 +1229,59 @@ some other suitably unique value.
 Enter code protected by a `critical` construct.
 This function blocks until the executing thread can enter the critical section.
 */
+#if KMP_USE_DYNAMIC_LOCK
+static __forceinline void
+__kmp_critical_with_seq( ident_t * loc, kmp_int32 global_tid, kmp_critical_name * crit, kmp_dyna_lockseq_t seq )
+{
+    kmp_dyna_lock_t *lk = (kmp_dyna_lock_t *)crit;
+    kmp_indirect_lock_t *ilk = NULL;
+
+    KMP_CHECK_USER_LOCK_INIT();
+
+    if ( TCR_PTR( *(void **)crit ) == NULL ) {
+        __kmp_init_dyna_critical( crit, loc, global_tid, seq );
+    }
+
+    if ( KMP_EXTRACT_D_TAG( lk ) != 0 ) {
+        if ( __kmp_env_consistency_check )
+            __kmp_push_sync( global_tid, ct_critical, loc, (kmp_user_lock_p)lk,
+              (kmp_dyna_lockseq_t)KMP_EXTRACT_D_TAG( lk ) );
+    }
+    else {
+        ilk = (kmp_indirect_lock_t *)TCR_PTR( *(kmp_indirect_lock_t **)crit );
+        if ( __kmp_env_consistency_check )
+            __kmp_push_sync( global_tid, ct_critical, loc, ilk->lock,
+              (kmp_dyna_lockseq_t)( ilk->type + KMP_FIRST_I_LOCK ) );
+    }
+
+    KMP_OMPT_CALLBACK( ompt_event_wait_critical, ( (ompt_wait_id_t)(kmp_uintptr_t) crit ) );
+    {
+        KMP_OMPT_STATE_ENTER( __kmp_threads[ global_tid ], ompt_prev_state, ompt_state_wait_critical, crit );
+        if ( ilk == NULL ) {
+            KMP_PROFILED_ACQUIRE( global_tid, loc, crit, "critical", 0, KMP_D_LOCK_FUNC( lk, try )( lk, global_tid ),
+              __kmp_set_dyna_lock( lk, global_tid ) );
+        }
+        else {
+            KMP_PROFILED_ACQUIRE( global_tid, loc, crit, "critical", KMP_I_LOCK_SPECULATIVE( ilk ),
+              KMP_I_LOCK_FUNC( ilk, try )( ilk->lock, global_tid ),
+              KMP_I_LOCK_FUNC( ilk, set )( ilk->lock, global_tid ) );
+        }
+        KMP_OMPT_STATE_EXIT( __kmp_threads[ global_tid ], ompt_prev_state );
+    }
+    KMP_OMPT_CALLBACK( ompt_event_acquired_critical, ( (ompt_wait_id_t)(kmp_uintptr_t) crit ) );
+}
+#endif // KMP_USE_DYNAMIC_LOCK
+
 void
 __kmpc_critical( ident_t * loc, kmp_int32 global_tid, kmp_critical_name * crit ) {
 
-    kmp_user_lock_p lck;
-
     KC_TRACE( 10, ("__kmpc_critical: called T#%d\n", global_tid ) );
 
+#if KMP_USE_DYNAMIC_LOCK
+    __kmp_critical_with_seq( loc, global_tid, crit, __kmp_user_lock_seq );
+#else
+    kmp_user_lock_p lck;
+
     //TODO: add THR_OVHD_STATE
 
     KMP_CHECK_USER_LOCK_INIT();
@@ -1003,12 +1311,47 @@ __kmpc_critical( ident_t * loc, kmp_int32 global_tid, kmp_critical_name * crit )
 
     // Value of 'crit' should be good for using as a critical_id of the critical section directive.
 
-    __kmp_acquire_user_lock_with_checks( lck, global_tid );
-
+    KMP_OMPT_CALLBACK( ompt_event_wait_critical, ( (ompt_wait_id_t)(kmp_uintptr_t) crit ) );
+    {
+        KMP_OMPT_STATE_ENTER( __kmp_threads[ global_tid ], ompt_prev_state, ompt_state_wait_critical, crit );
+        KMP_PROFILED_ACQUIRE( global_tid, loc, crit, "critical", KMP_USER_LOCK_SPECULATIVE( lck ),
+          __kmp_try_user_lock( lck, global_tid ),
+          __kmp_acquire_user_lock_with_checks( lck, global_tid ) );
+        KMP_OMPT_STATE_EXIT( __kmp_threads[ global_tid ], ompt_prev_state );
+    }
+    KMP_OMPT_CALLBACK( ompt_event_acquired_critical, ( (ompt_wait_id_t)(kmp_uintptr_t) crit ) );
+#endif // KMP_USE_DYNAMIC_LOCK
 
     KA_TRACE( 15, ("__kmpc_critical: done T#%d\n", global_tid ));
 } // __kmpc_critical
 
+#if OMP_40_ENABLED
+/*!
+@ingroup WORK_SHARING
+@param loc  source location information.
+@param global_tid  global thread number .
+@param crit identity of the critical section.
+@param hint lock hint (omp_lock_hint_t) of the critical section.
+
+Enter code protected by a `critical` construct with a `hint` clause.
+The hint selects the lock kind when the critical section is entered for the
+first time; it is ignored later, and if dynamic locks are not used.
+*/
+void
+__kmpc_critical_with_hint( ident_t * loc, kmp_int32 global_tid, kmp_critical_name * crit, kmp_uintptr_t hint )
+{
+    KC_TRACE( 10, ("__kmpc_critical_with_hint: called T#%d, hint %#lx\n", global_tid, (unsigned long)hint ) );
+
+#if KMP_USE_DYNAMIC_LOCK
+    __kmp_critical_with_seq( loc, global_tid, crit, __kmp_map_hint_to_lock( hint ) );
+#else
+    __kmpc_critical( loc, global_tid, crit );
+#endif
+
+    KA_TRACE( 15, ("__kmpc_critical_with_hint: done T#%d\n", global_tid ));
+} // __kmpc_critical_with_hint
+#endif // OMP_40_ENABLED
+
 /*!
 @ingroup WORK_SHARING
 @param loc  source location information.
@@ -1021,10 +1364,28 @@ Leave a critical section, releasing any lock that was held during its execution.
 void
 __kmpc_end_critical(ident_t *loc, kmp_int32 global_tid, kmp_critical_name *crit)
 {
-    kmp_user_lock_p lck;
-
     KC_TRACE( 10, ("__kmpc_end_critical: called T#%d\n", global_tid ));
 
+    KMP_PROFILED_RELEASE( global_tid, crit );
+
+#if KMP_USE_DYNAMIC_LOCK
+    kmp_dyna_lock_t *lk = (kmp_dyna_lock_t *)crit;
+
+    KMP_ASSERT( TCR_PTR( *(void **)crit ) != NULL );
+
+    if ( __kmp_env_consistency_check )
+        __kmp_pop_sync( global_tid, ct_critical, loc );
+
+    if ( KMP_EXTRACT_D_TAG( lk ) != 0 ) {
+        __kmp_unset_dyna_lock( lk, global_tid );
+    }
+    else {
+        kmp_indirect_lock_t *ilk = (kmp_indirect_lock_t *)TCR_PTR( *(kmp_indirect_lock_t **)crit );
+        KMP_I_LOCK_FUNC( ilk, unset )( ilk->lock, global_tid );
+    }
+#else
+    kmp_user_lock_p lck;
+
     if ( ( __kmp_user_lock_kind == lk_tas )
       && ( sizeof( lck->tas.lk.poll ) <= OMP_CRITICAL_SIZE ) ) {
         lck = (kmp_user_lock_p)crit;
@@ -1047,6 +1408,8 @@ __kmpc_end_critical(ident_t *loc, kmp_int32 global_tid, kmp_critical_name *crit)
     // Value of 'crit' should be good for using as a critical_id of the critical section directive.
 
     __kmp_release_user_lock_with_checks( lck, global_tid );
+#endif // KMP_USE_DYNAMIC_LOCK
+    KMP_OMPT_CALLBACK( ompt_event_release_critical, ( (ompt_wait_id_t)(kmp_uintptr_t) crit ) );
 
     KA_TRACE( 15, ("__kmpc_end_critical: done T#%d\n", global_tid ));
 }
@@ -1442,11 +1805,40 @@ __kmpc_copyprivate( ident_t *loc, kmp_int32 gtid, size_t cpy_size, void *cpy_dat
  * into with_checks routines
  */
 
+#if KMP_USE_DYNAMIC_LOCK
+
+static __forceinline void
+__kmp_init_lock_with_seq( ident_t * loc, void ** user_lock, kmp_dyna_lockseq_t seq )
+{
+    KMP_CHECK_USER_LOCK_INIT();
+
+    if ( KMP_IS_D_LOCK( seq ) ) {
+        KMP_INIT_D_LOCK( user_lock, seq );
+    }
+    else {
+        KMP_INIT_I_LOCK( user_lock, seq );
+        kmp_indirect_lock_t *ilk = KMP_LOOKUP_I_LOCK( user_lock );
+        KMP_SET_I_LOCK_LOCATION( ilk, loc );
+    }
+}
+
+static __forceinline void
+__kmp_init_nest_lock_with_seq( ident_t * loc, void ** user_lock, kmp_dyna_lockseq_t seq )
+{
+    KMP_CHECK_USER_LOCK_INIT();
+
+    KMP_DEBUG_ASSERT( KMP_IS_I_LOCK( seq ) );
+    KMP_INIT_I_LOCK( user_lock, seq );
+    kmp_indirect_lock_t *ilk = KMP_LOOKUP_I_LOCK( user_lock );
+    KMP_SET_I_LOCK_LOCATION( ilk, loc );
+}
+
+#endif // KMP_USE_DYNAMIC_LOCK
+
 /* initialize the lock */
 void
 __kmpc_init_lock( ident_t * loc, kmp_int32 gtid,  void ** user_lock ) {
     static char const * const func = "omp_init_lock";
-    kmp_user_lock_p lck;
     KMP_DEBUG_ASSERT( __kmp_init_serial );
 
     if ( __kmp_env_consistency_check ) {
@@ -1455,6 +1847,11 @@ __kmpc_init_lock( ident_t * loc, kmp_int32 gtid,  void ** user_lock ) {
         }
     }
 
+#if KMP_USE_DYNAMIC_LOCK
+    __kmp_init_lock_with_seq( loc, user_lock, __kmp_user_lock_seq );
+#else
+    kmp_user_lock_p lck;
+
     KMP_CHECK_USER_LOCK_INIT();
 
     if ( ( __kmp_user_lock_kind == lk_tas )
@@ -1472,6 +1869,7 @@ __kmpc_init_lock( ident_t * loc, kmp_int32 gtid,  void ** user_lock ) {
     }
     INIT_LOCK( lck );
     __kmp_set_user_lock_location( lck, loc );
+#endif // KMP_USE_DYNAMIC_LOCK
 
 } // __kmpc_init_lock
 
@@ -1479,7 +1877,6 @@ __kmpc_init_lock( ident_t * loc, kmp_int32 gtid,  void ** user_lock ) {
 void
 __kmpc_init_nest_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
     static char const * const func = "omp_init_nest_lock";
-    kmp_user_lock_p lck;
     KMP_DEBUG_ASSERT( __kmp_init_serial );
 
     if ( __kmp_env_consistency_check ) {
@@ -1488,6 +1885,11 @@ __kmpc_init_nest_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
         }
     }
 
+#if KMP_USE_DYNAMIC_LOCK
+    __kmp_init_nest_lock_with_seq( loc, user_lock, __kmp_map_hint_to_nested_lock( 0 ) );
+#else
+    kmp_user_lock_p lck;
+
     KMP_CHECK_USER_LOCK_INIT();
 
     if ( ( __kmp_user_lock_kind == lk_tas ) && ( sizeof( lck->tas.lk.poll )
@@ -1507,12 +1909,56 @@ __kmpc_init_nest_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
 
     INIT_NESTED_LOCK( lck );
     __kmp_set_user_lock_location( lck, loc );
+#endif // KMP_USE_DYNAMIC_LOCK
 
 } // __kmpc_init_nest_lock
 
+#if OMP_40_ENABLED
+/* initialize the lock, with the lock kind chosen by the hint */
+void
+__kmpc_init_lock_with_hint( ident_t * loc, kmp_int32 gtid, void ** user_lock, kmp_uintptr_t hint ) {
+#if KMP_USE_DYNAMIC_LOCK
+    KMP_DEBUG_ASSERT( __kmp_init_serial );
+
+    if ( __kmp_env_consistency_check ) {
+        if ( user_lock == NULL ) {
+            KMP_FATAL( LockIsUninitialized, "omp_init_lock_with_hint" );
+        }
+    }
+
+    __kmp_init_lock_with_seq( loc, user_lock, __kmp_map_hint_to_lock( hint ) );
+#else
+    __kmpc_init_lock( loc, gtid, user_lock );
+#endif
+} // __kmpc_init_lock_with_hint
+
+void
+__kmpc_init_nest_lock_with_hint( ident_t * loc, kmp_int32 gtid, void ** user_lock, kmp_uintptr_t hint ) {
+#if KMP_USE_DYNAMIC_LOCK
+    KMP_DEBUG_ASSERT( __kmp_init_serial );
+
+    if ( __kmp_env_consistency_check ) {
+        if ( user_lock == NULL ) {
+            KMP_FATAL( LockIsUninitialized, "omp_init_nest_lock_with_hint" );
+        }
+    }
+
+    __kmp_init_nest_lock_with_seq( loc, user_lock, __kmp_map_hint_to_nested_lock( hint ) );
+#else
+    __kmpc_init_nest_lock( loc, gtid, user_lock );
+#endif
+} // __kmpc_init_nest_lock_with_hint
+#endif // OMP_40_ENABLED
+
 void
 __kmpc_destroy_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
 
+#if KMP_USE_DYNAMIC_LOCK
+    if ( __kmp_env_consistency_check ) {
+        __kmp_check_dyna_lock_nesting( user_lock, FALSE, "omp_destroy_lock" );
+    }
+    KMP_D_LOCK_FUNC( user_lock, destroy )( (kmp_dyna_lock_t *)user_lock );
+#else
     kmp_user_lock_p lck;
 
     if ( ( __kmp_user_lock_kind == lk_tas )
@@ -1544,12 +1990,19 @@ __kmpc_destroy_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
     else {
         __kmp_user_lock_free( user_lock, gtid, lck );
     }
+#endif // KMP_USE_DYNAMIC_LOCK
 } // __kmpc_destroy_lock
 
 /* destroy the lock */
 void
 __kmpc_destroy_nest_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
 
+#if KMP_USE_DYNAMIC_LOCK
+    if ( __kmp_env_consistency_check ) {
+        __kmp_check_dyna_lock_nesting( user_lock, TRUE, "omp_destroy_nest_lock" );
+    }
+    KMP_D_LOCK_FUNC( user_lock, destroy )( (kmp_dyna_lock_t *)user_lock );
+#else
     kmp_user_lock_p lck;
 
     if ( ( __kmp_user_lock_kind == lk_tas ) && ( sizeof( lck->tas.lk.poll )
@@ -1584,10 +2037,16 @@ __kmpc_destroy_nest_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
     else {
         __kmp_user_lock_free( user_lock, gtid, lck );
     }
+#endif // KMP_USE_DYNAMIC_LOCK
 } // __kmpc_destroy_nest_lock
 
 void
 __kmpc_set_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
+#if KMP_USE_DYNAMIC_LOCK
+    if ( __kmp_env_consistency_check ) {
+        __kmp_check_dyna_lock_nesting( user_lock, FALSE, "omp_set_lock" );
+    }
+#else
     kmp_user_lock_p lck;
 
     if ( ( __kmp_user_lock_kind == lk_tas )
@@ -1603,15 +2062,34 @@ __kmpc_set_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
     else {
         lck = __kmp_lookup_user_lock( user_lock, "omp_set_lock" );
     }
+#endif // KMP_USE_DYNAMIC_LOCK
 
-
-    ACQUIRE_LOCK( lck, gtid );
+    KMP_OMPT_CALLBACK( ompt_event_wait_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
+    {
+        KMP_OMPT_STATE_ENTER( __kmp_threads[ gtid ], ompt_prev_state, ompt_state_wait_lock, user_lock );
+#if KMP_USE_DYNAMIC_LOCK
+        KMP_PROFILED_ACQUIRE( gtid, loc, user_lock, "omp_set_lock", KMP_USER_LOCK_SPECULATIVE( user_lock ),
+          KMP_D_LOCK_FUNC( user_lock, try )( (kmp_dyna_lock_t *)user_lock, gtid ),
+          __kmp_set_dyna_lock( (kmp_dyna_lock_t *)user_lock, gtid ) );
+#else
+        KMP_PROFILED_ACQUIRE( gtid, loc, user_lock, "omp_set_lock", KMP_USER_LOCK_SPECULATIVE( lck ),
+          __kmp_try_user_lock( lck, gtid ),
+          ACQUIRE_LOCK( lck, gtid ) );
+#endif
+        KMP_OMPT_STATE_EXIT( __kmp_threads[ gtid ], ompt_prev_state );
+    }
+    KMP_OMPT_CALLBACK( ompt_event_acquired_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
 
 }
 
 
 void
 __kmpc_set_nest_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
+#if KMP_USE_DYNAMIC_LOCK
+    if ( __kmp_env_consistency_check ) {
+        __kmp_check_dyna_lock_nesting( user_lock, TRUE, "omp_set_nest_lock" );
+    }
+#else
     kmp_user_lock_p lck;
 
     if ( ( __kmp_user_lock_kind == lk_tas ) && ( sizeof( lck->tas.lk.poll )
@@ -1628,26 +2106,49 @@ __kmpc_set_nest_lock( ident_t * loc, kmp_int32 gtid, void ** user_lock ) {
     else {
         lck = __kmp_lookup_user_lock( user_lock, "omp_set_nest_lock" );
     }
+#endif // KMP_USE_DYNAMIC_LOCK
 
-
-    ACQUIRE_NESTED_LOCK( lck, gtid );
+    KMP_OMPT_CALLBACK( ompt_event_wait_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
+    {
+        KMP_OMPT_STATE_ENTER( __kmp_threads[ gtid ], ompt_prev_state, ompt_state_wait_lock, user_lock );
+#if KMP_USE_DYNAMIC_LOCK
+        KMP_PROFILED_ACQUIRE( gtid, loc, user_lock, "omp_set_nest_lock", 0,
+          KMP_D_LOCK_FUNC( user_lock, try )( (kmp_dyna_lock_t *)user_lock, gtid ),
+          KMP_D_LOCK_FUNC( user_lock, set )( (kmp_dyna_lock_t *)user_lock, gtid ) );
+#else
+        KMP_PROFILED_ACQUIRE( gtid, loc, user_lock, "omp_set_nest_lock", 0, __kmp_try_nested_user_lock( lck, gtid ),
+          ACQUIRE_NESTED_LOCK( lck, gtid ) );
+#endif
+        KMP_OMPT_STATE_EXIT( __kmp_threads[ gtid ], ompt_prev_state );
+    }
+    KMP_OMPT_CALLBACK( ompt_event_acquired_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
 
 }
 
 void
 __kmpc_unset_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
 {
-    kmp_user_lock_p lck;
-
     /* Can't use serial interval since not block structured */
     /* release the lock */
 
+    KMP_PROFILED_RELEASE( gtid, user_lock );
+
+#if KMP_USE_DYNAMIC_LOCK
+    if ( __kmp_env_consistency_check ) {
+        __kmp_check_dyna_lock_nesting( user_lock, FALSE, "omp_unset_lock" );
+    }
+    __kmp_unset_dyna_lock( (kmp_dyna_lock_t *)user_lock, gtid );
+    KMP_OMPT_CALLBACK( ompt_event_release_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
+#else
+    kmp_user_lock_p lck;
+
     if ( ( __kmp_user_lock_kind == lk_tas )
       && ( sizeof( lck->tas.lk.poll ) <= OMP_LOCK_T_SIZE ) ) {
 #if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
         // "fast" path implemented to fix customer performance issue
         TCW_4(((kmp_user_lock_p)user_lock)->tas.lk.poll, 0);
         KMP_MB();
+        KMP_OMPT_CALLBACK( ompt_event_release_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
         return;
 #else
         lck = (kmp_user_lock_p)user_lock;
@@ -1665,16 +2166,27 @@ __kmpc_unset_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
 
 
     RELEASE_LOCK( lck, gtid );
+    KMP_OMPT_CALLBACK( ompt_event_release_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
+#endif // KMP_USE_DYNAMIC_LOCK
 }
 
 /* release the lock */
 void
 __kmpc_unset_nest_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
 {
-    kmp_user_lock_p lck;
-
     /* Can't use serial interval since not block structured */
 
+    KMP_PROFILED_RELEASE( gtid, user_lock );
+
+#if KMP_USE_DYNAMIC_LOCK
+    if ( __kmp_env_consistency_check ) {
+        __kmp_check_dyna_lock_nesting( user_lock, TRUE, "omp_unset_nest_lock" );
+    }
+    KMP_D_LOCK_FUNC( user_lock, unset )( (kmp_dyna_lock_t *)user_lock, gtid );
+    KMP_OMPT_CALLBACK( ompt_event_release_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
+#else
+    kmp_user_lock_p lck;
+
     if ( ( __kmp_user_lock_kind == lk_tas ) && ( sizeof( lck->tas.lk.poll )
       + sizeof( lck->tas.lk.depth_locked ) <= OMP_NEST_LOCK_T_SIZE ) ) {
 #if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
@@ -1684,6 +2196,7 @@ __kmpc_unset_nest_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
             TCW_4(tl->lk.poll, 0);
         }
         KMP_MB();
+        KMP_OMPT_CALLBACK( ompt_event_release_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
         return;
 #else
         lck = (kmp_user_lock_p)user_lock;
@@ -1702,14 +2215,25 @@ __kmpc_unset_nest_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
 
 
     RELEASE_NESTED_LOCK( lck, gtid );
+    KMP_OMPT_CALLBACK( ompt_event_release_lock, ( (ompt_wait_id_t)(kmp_uintptr_t) user_lock ) );
+#endif // KMP_USE_DYNAMIC_LOCK
 }
 
 /* try to acquire the lock */
 int
 __kmpc_test_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
 {
-    kmp_user_lock_p lck;
     int          rc;
+    int          profiled;   // Checked before the test, which may start a transaction.
+
+#if KMP_USE_DYNAMIC_LOCK
+    if ( __kmp_env_consistency_check ) {
+        __kmp_check_dyna_lock_nesting( user_lock, FALSE, "omp_test_lock" );
+    }
+    profiled = __kmp_lock_profile && ! KMP_USER_LOCK_SPECULATIVE( user_lock );
+    rc = __kmp_test_dyna_lock( (kmp_dyna_lock_t *)user_lock, gtid );
+#else
+    kmp_user_lock_p lck;
 
     if ( ( __kmp_user_lock_kind == lk_tas )
       && ( sizeof( lck->tas.lk.poll ) <= OMP_LOCK_T_SIZE ) ) {
@@ -1726,7 +2250,12 @@ __kmpc_test_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
     }
 
 
+    profiled = __kmp_lock_profile && ! KMP_USER_LOCK_SPECULATIVE( lck );
     rc = TEST_LOCK( lck, gtid );
+#endif // KMP_USE_DYNAMIC_LOCK
+    if ( rc && profiled ) {
+        __kmp_lock_profile_acquired( gtid, loc, user_lock, "omp_test_lock", 0, FALSE );
+    }
     return ( rc ? FTN_TRUE : FTN_FALSE );
 
     /* Can't use serial interval since not block structured */
@@ -1736,9 +2265,16 @@ __kmpc_test_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
 int
 __kmpc_test_nest_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
 {
-    kmp_user_lock_p lck;
     int          rc;
 
+#if KMP_USE_DYNAMIC_LOCK
+    if ( __kmp_env_consistency_check ) {
+        __kmp_check_dyna_lock_nesting( user_lock, TRUE, "omp_test_nest_lock" );
+    }
+    rc = KMP_D_LOCK_FUNC( user_lock, test )( (kmp_dyna_lock_t *)user_lock, gtid );
+#else
+    kmp_user_lock_p lck;
+
     if ( ( __kmp_user_lock_kind == lk_tas ) && ( sizeof( lck->tas.lk.poll )
       + sizeof( lck->tas.lk.depth_locked ) <= OMP_NEST_LOCK_T_SIZE ) ) {
         lck = (kmp_user_lock_p)user_lock;
@@ -1756,6 +2292,10 @@ __kmpc_test_nest_lock( ident_t *loc, kmp_int32 gtid, void **user_lock )
 
 
     rc = TEST_NESTED_LOCK( lck, gtid );
+#endif // KMP_USE_DYNAMIC_LOCK
+    if ( rc && __kmp_lock_profile ) {
+        __kmp_lock_profile_acquired( gtid, loc, user_lock, "omp_test_nest_lock", 0, FALSE );
+    }
     return rc;
 
     /* Can't use serial interval since not block structured */
@@ -1788,6 +2328,30 @@ __kmp_enter_critical_section_reduce_block( ident_t * loc, kmp_int32 global_tid,
     //            (although it's used for an internal purpose only)
     //            why was it visible in previous implementation?
     //            should we keep it visible in new reduce block?
+#if KMP_USE_DYNAMIC_LOCK
+    kmp_dyna_lock_t *lk = (kmp_dyna_lock_t *)crit;
+
+    if ( TCR_PTR( *(void **)crit ) == NULL ) {
+        __kmp_init_dyna_critical( crit, loc, global_tid, __kmp_user_lock_seq );
+    }
+
+    if ( KMP_EXTRACT_D_TAG( lk ) != 0 ) {
+        if ( __kmp_env_consistency_check )
+            __kmp_push_sync( global_tid, ct_critical, loc, (kmp_user_lock_p)lk,
+              (kmp_dyna_lockseq_t)KMP_EXTRACT_D_TAG( lk ) );
+        KMP_PROFILED_ACQUIRE( global_tid, loc, crit, "reduction", 0, KMP_D_LOCK_FUNC( lk, try )( lk, global_tid ),
+          __kmp_set_dyna_lock( lk, global_tid ) );
+    }
+    else {
+        kmp_indirect_lock_t *ilk = (kmp_indirect_lock_t *)TCR_PTR( *(kmp_indirect_lock_t **)crit );
+        if ( __kmp_env_consistency_check )
+            __kmp_push_sync( global_tid, ct_critical, loc, ilk->lock,
+              (kmp_dyna_lockseq_t)( ilk->type + KMP_FIRST_I_LOCK ) );
+        KMP_PROFILED_ACQUIRE( global_tid, loc, crit, "reduction", KMP_I_LOCK_SPECULATIVE( ilk ),
+          KMP_I_LOCK_FUNC( ilk, try )( ilk->lock, global_tid ),
+          KMP_I_LOCK_FUNC( ilk, set )( ilk->lock, global_tid ) );
+    }
+#else
     kmp_user_lock_p lck;
 
     // We know that the fast reduction code is only emitted by Intel compilers
@@ -1804,13 +2368,33 @@ __kmp_enter_critical_section_reduce_block( ident_t * loc, kmp_int32 global_tid,
     if ( __kmp_env_consistency_check )
         __kmp_push_sync( global_tid, ct_critical, loc, lck );
 
-    __kmp_acquire_user_lock_with_checks( lck, global_tid );
+    KMP_PROFILED_ACQUIRE( global_tid, loc, crit, "reduction", KMP_USER_LOCK_SPECULATIVE( lck ),
+      __kmp_try_user_lock( lck, global_tid ),
+      __kmp_acquire_user_lock_with_checks( lck, global_tid ) );
+#endif // KMP_USE_DYNAMIC_LOCK
 }
 
 // used in a critical section reduce block
 static __forceinline void
 __kmp_end_critical_section_reduce_block( ident_t * loc, kmp_int32 global_tid, kmp_critical_name * crit ) {
 
+    KMP_PROFILED_RELEASE( global_tid, crit );
+
+#if KMP_USE_DYNAMIC_LOCK
+    kmp_dyna_lock_t *lk = (kmp_dyna_lock_t *)crit;
+
+    if ( __kmp_env_consistency_check )
+        __kmp_pop_sync( global_tid, ct_critical, loc );
+
+    if ( KMP_EXTRACT_D_TAG( lk ) != 0 ) {
+        __kmp_unset_dyna_lock( lk, global_tid );
+    }
+    else {
+        kmp_indirect_lock_t *ilk = (kmp_indirect_lock_t *)TCR_PTR( *(kmp_indirect_lock_t **)crit );
+        KMP_ASSERT( ilk != NULL );
+        KMP_I_LOCK_FUNC( ilk, unset )( ilk->lock, global_tid );
+    }
+#else
     kmp_user_lock_p lck;
 
     // We know that the fast reduction code is only emitted by Intel compilers with 32 byte critical
@@ -1826,6 +2410,7 @@ __kmp_end_critical_section_reduce_block( ident_t * loc, kmp_int32 global_tid, km
         __kmp_pop_sync( global_tid, ct_critical, loc );
 
     __kmp_release_user_lock_with_checks( lck, global_tid );
+#endif // KMP_USE_DYNAMIC_LOCK
 
 } // __kmp_end_critical_section_reduce_block
 
@@ -60,6 +60,7 @@
 #include "kmp_i18n.h"
 #include "kmp_str.h"
 #include "kmp_error.h"
+#include "kmp_stats.h"
 #if KMP_OS_WINDOWS && KMP_ARCH_X86
     #include <float.h>
 #endif
@@ -81,6 +82,7 @@
         ST st;                   // signed
         UT tc;                   // unsigned
         T  static_steal_counter; // for static_steal only; maybe better to put after ub
+        kmp_tas_lock_t steal_lock; // for static_steal only; used with 8-byte indexes
 
         /* parm[1-4] are used in different ways by different scheduling algorithms */
 
@@ -282,6 +284,23 @@ compare_and_swap< kmp_int64 >( volatile kmp_int64 *p, kmp_int64 c, kmp_int64 s )
     return KMP_COMPARE_AND_STORE_REL64( p, c, s );
 }
 
+#if ( KMP_STATIC_STEAL_ENABLED && KMP_ARCH_X86_64 )
+/*
+    Victim of the given probe (1 .. nproc-1) for a static_steal thief: tids
+    id-1, id+1, id-2, id+2, ... modulo nproc.  Threads with nearby tids are
+    bound nearby under compact/close affinity, so the chunks stolen first
+    are the ones whose data is most likely in a shared cache.
+*/
+static inline int
+__kmp_steal_victim( int id, int probe, int nproc )
+{
+    int dist   = ( probe + 1 ) >> 1;
+    int victim = ( ( probe & 1 ) ? id - dist : id + dist ) % nproc;
+
+    return victim < 0 ? victim + nproc : victim;
+}
+#endif
+
 /*
     Spin wait loop that first does pause, then yield.
     Waits until function returns non-zero when called with *spinner and check.
@@ -592,9 +611,9 @@ __kmp_dispatch_init(
     T                                              tc;
     kmp_info_t *                                   th;
     kmp_team_t *                                   team;
-    kmp_uint32                                     my_buffer_index;
+    kmp_uint32                                     my_buffer_index = 0;
     dispatch_private_info_template< T >          * pr;
-    dispatch_shared_info_template< UT > volatile * sh;
+    dispatch_shared_info_template< UT > volatile * sh = NULL;
 
     KMP_BUILD_ASSERT( sizeof( dispatch_private_info_template< T > ) == sizeof( dispatch_private_info ) );
     KMP_BUILD_ASSERT( sizeof( dispatch_shared_info_template< UT > ) == sizeof( dispatch_shared_info ) );
@@ -630,9 +649,9 @@ __kmp_dispatch_init(
 
         /* What happens when number of threads changes, need to resize buffer? */
         pr = reinterpret_cast< dispatch_private_info_template< T >  * >
-            ( &th -> th.th_dispatch -> th_disp_buffer[ my_buffer_index % KMP_MAX_DISP_BUF ] );
+            ( &th -> th.th_dispatch -> th_disp_buffer[ my_buffer_index % team->t.t_disp_num_buffers ] );
         sh = reinterpret_cast< dispatch_shared_info_template< UT > volatile * >
-            ( &team -> t.t_disp_buffer[ my_buffer_index % KMP_MAX_DISP_BUF ] );
+            ( &team -> t.t_disp_buffer[ my_buffer_index % team->t.t_disp_num_buffers ] );
     }
 
     /* Pick up the nomerge/ordered bits from the scheduling type */
@@ -811,6 +830,10 @@ __kmp_dispatch_init(
                 //pr->pfields.parm3 = 0; // it's not used in static_steal
                 pr->u.p.parm4 = id;
                 pr->u.p.st = st;
+                if ( sizeof( T ) > 4 ) {
+                    // a zeroed buffer is not a free lock when dynamic locks are on
+                    __kmp_init_tas_lock( &pr->u.p.steal_lock );
+                }
                 break;
             } else {
                 KD_TRACE(100, ("__kmp_dispatch_init: T#%d falling-through to kmp_sch_static_balanced\n",
@@ -831,6 +854,9 @@ __kmp_dispatch_init(
 
             if ( nproc > 1 ) {
                 T id = __kmp_tid_from_gtid(gtid);
+                if ( __kmp_static_numa ) {
+                    id = team->t.t_static_rank[ id ];
+                }
 
                 if ( tc < nproc ) {
                     if ( id < tc ) {
@@ -1029,6 +1055,14 @@ __kmp_dispatch_init(
     case kmp_sch_static_chunked :
     case kmp_sch_dynamic_chunked :
         KD_TRACE(100,("__kmp_dispatch_init: T#%d kmp_sch_static_chunked/kmp_sch_dynamic_chunked cases\n", gtid));
+        if ( schedule == kmp_sch_dynamic_chunked ) {
+            /* Chunk batching (KMP_DISPATCH_BATCH): parm4 = number of chunks, or 0 if not batching;
+               [parm2, parm3) = chunk numbers taken by this thread but not yet handed out */
+            pr->u.p.parm2 = 0;
+            pr->u.p.parm3 = 0;
+            pr->u.p.parm4 = ( __kmp_dispatch_batch > 1 && ! pr->ordered && team->t.t_nproc > 1 ) ?
+                ( tc / chunk + ( tc % chunk ? 1 : 0 ) ) : 0;
+        }
         break;
     case kmp_sch_trapezoidal :
         {
@@ -1096,6 +1130,11 @@ __kmp_dispatch_init(
 
         KD_TRACE(100, ("__kmp_dispatch_init: T#%d before wait: my_buffer_index:%d sh->buffer_index:%d\n",
                         gtid, my_buffer_index, sh->buffer_index) );
+        if ( sh->buffer_index != my_buffer_index ) {
+            // All buffers are taken by loops other threads have not finished yet;
+            // have the master grow the ring at the next fork.
+            TCW_4( team->t.t_disp_buffer_waited, TRUE );
+        }
         __kmp_wait_yield< kmp_uint32 >( & sh->buffer_index, my_buffer_index, __kmp_eq< kmp_uint32 >
                                         );
             // Note: KMP_WAIT_YIELD() cannot be used there: buffer index and my_buffer_index are
@@ -1128,20 +1167,18 @@ __kmp_dispatch_init(
     }
     #endif
     #if ( KMP_STATIC_STEAL_ENABLED )
-    if ( ___kmp_size_type < 8 ) {
-      // It cannot be guaranteed that after execution of a loop with some other schedule kind
-      // all the parm3 variables will contain the same value.
-      // Even if all parm3 will be the same, it still exists a bad case like using 0 and 1
-      // rather than program life-time increment.
-      // So the dedicated variable is required. The 'static_steal_counter' is used.
-      if( schedule == kmp_sch_static_steal ) {
+    // It cannot be guaranteed that after execution of a loop with some other schedule kind
+    // all the parm3 variables will contain the same value.
+    // Even if all parm3 will be the same, it still exists a bad case like using 0 and 1
+    // rather than program life-time increment.
+    // So the dedicated variable is required. The 'static_steal_counter' is used.
+    if( schedule == kmp_sch_static_steal ) {
         // Other threads will inspect this variable when searching for a victim.
         // This is a flag showing that other threads may steal from this thread since then.
         volatile T * p = &pr->u.p.static_steal_counter;
         *p = *p + 1;
-      }
     }
-    #endif // ( KMP_STATIC_STEAL_ENABLED && USE_STEALING )
+    #endif // ( KMP_STATIC_STEAL_ENABLED )
 }
 
 /*
@@ -1452,81 +1489,95 @@ __kmp_dispatch_next(
             case kmp_sch_static_steal:
                 {
                     T chunk = pr->u.p.parm1;
+                    typedef union {
+                        struct {
+                            UT count;
+                            T  ub;
+                        } p;
+                        kmp_int64 b;
+                    } union_i4;
 
                     KD_TRACE(100, ("__kmp_dispatch_next: T#%d kmp_sch_static_steal case\n", gtid) );
 
                     trip = pr->u.p.tc - 1;
 
                     if ( ___kmp_size_type > 4 ) {
-                        // Other threads do not look into the data of this thread,
-                        //  so it's not necessary to make volatile casting.
+                        // 'count' and 'ub' do not fit in one 8-byte CAS, so the owner and
+                        // the thieves update them under the owner's steal_lock.
+                        __kmp_acquire_tas_lock( &pr->u.p.steal_lock, gtid );
                         init   = ( pr->u.p.count )++;
-                        status = ( init < pr->u.p.ub );
+                        status = ( init < (UT)pr->u.p.ub );
+                        __kmp_release_tas_lock( &pr->u.p.steal_lock, gtid );
                     } else {
-                        typedef union {
-                            struct {
-                                UT count;
-                                T  ub;
-                            } p;
-                            kmp_int64 b;
-                        } union_i4;
                         // All operations on 'count' or 'ub' must be combined atomically together.
-                        // stealing implemented only for 4-byte indexes
-                        {
-                            union_i4 vold, vnew;
+                        union_i4 vold, vnew;
+                        vold.b = *( volatile kmp_int64 * )(&pr->u.p.count);
+                        vnew = vold;
+                        vnew.p.count++;
+                        while( ! KMP_COMPARE_AND_STORE_ACQ64(
+                                    ( volatile kmp_int64* )&pr->u.p.count,
+                                    *VOLATILE_CAST(kmp_int64 *)&vold.b,
+                                    *VOLATILE_CAST(kmp_int64 *)&vnew.b ) ) {
+                            KMP_CPU_PAUSE();
                             vold.b = *( volatile kmp_int64 * )(&pr->u.p.count);
                             vnew = vold;
                             vnew.p.count++;
-                            while( ! KMP_COMPARE_AND_STORE_ACQ64(
-                                        ( volatile kmp_int64* )&pr->u.p.count,
-                                        *VOLATILE_CAST(kmp_int64 *)&vold.b,
-                                        *VOLATILE_CAST(kmp_int64 *)&vnew.b ) ) {
-                                KMP_CPU_PAUSE();
-                                vold.b = *( volatile kmp_int64 * )(&pr->u.p.count);
-                                vnew = vold;
-                                vnew.p.count++;
-                            }
-                            vnew = vold;
-                            init   = vnew.p.count;
-                            status = ( init < vnew.p.ub ) ;
                         }
+                        vnew = vold;
+                        init   = vnew.p.count;
+                        status = ( init < vnew.p.ub ) ;
+                    } // if
 
-                        if( !status ) {
-                            kmp_info_t   **other_threads = team->t.t_threads;
-                            int          while_limit = 10;
-                            int          while_index = 0;
+                    if( !status ) {
+                        kmp_info_t   **other_threads = team->t.t_threads;
+                        int          nproc = team->t.t_nproc;
+                        int          id    = th->th.th_info.ds.ds_tid;
+                        int          probe;
+                        // A victim working on this loop uses the same slot of its dispatch buffer.
+                        ptrdiff_t    slot  = (dispatch_private_info_t *)pr - th->th.th_dispatch->th_disp_buffer;
+
+                        // Probe the last victim first, then the other threads nearest first.
+                        for ( probe = 0; ( !status ) && probe < nproc; ++probe ) {
+                            int victimIdx = probe ? __kmp_steal_victim( id, probe, nproc ) : (int)pr->u.p.parm4;
+                            dispatch_private_info_template< T > * victim;
+
+                            if ( victimIdx == id ) {
+                                continue;
+                            }
+                            victim = reinterpret_cast< dispatch_private_info_template< T >* >
+                                ( other_threads[victimIdx]->th.th_dispatch->th_dispatch_pr_current );
+                            if ( ( victim != reinterpret_cast< dispatch_private_info_template< T >* >
+                                       ( &other_threads[victimIdx]->th.th_dispatch->th_disp_buffer[ slot ] ) ) ||
+                                 ( (*( volatile T * )&victim->u.p.static_steal_counter) !=
+                                   (*( volatile T * )&pr->u.p.static_steal_counter) ) ) {
+                                // the victim is not ready yet to participate in stealing
+                                // because the victim is still in kmp_init_dispatch
+                                // (or in an earlier loop)
+                                continue;
+                            }
 
-                            // TODO: algorithm of searching for a victim
-                            // should be cleaned up and measured
-                            while ( ( !status ) && ( while_limit != ++while_index ) ) {
-                                union_i4  vold, vnew;
-                                kmp_int32 remaining; // kmp_int32 because KMP_I4 only
-                                T         victimIdx    = pr->u.p.parm4;
-                                T         oldVictimIdx = victimIdx;
-                                dispatch_private_info_template< T > * victim;
-
-                                do {
-                                    if( !victimIdx ) {
-                                        victimIdx = team->t.t_nproc - 1;
-                                    } else {
-                                        --victimIdx;
-                                    }
-                                    victim = reinterpret_cast< dispatch_private_info_template< T >* >
-                                        ( other_threads[victimIdx]->th.th_dispatch->th_dispatch_pr_current );
-                                } while ( (victim == NULL || victim == pr) && oldVictimIdx != victimIdx );
-                                // TODO: think about a proper place of this test
-                                if ( ( !victim ) ||
-                                   ( (*( volatile T * )&victim->u.p.static_steal_counter) !=
-                                     (*( volatile T * )&pr->u.p.static_steal_counter) ) ) {
-                                    // TODO: delay would be nice
-                                    continue;
-                                    // the victim is not ready yet to participate in stealing
-                                    // because the victim is still in kmp_init_dispatch
+                            if ( ___kmp_size_type > 4 ) {
+                                UT remaining;
+
+                                __kmp_acquire_tas_lock( &victim->u.p.steal_lock, gtid );
+                                limit = victim->u.p.ub;
+                                init  = victim->u.p.count;
+                                if ( init < limit && ( remaining = limit - init ) >= 4 ) {
+                                    init = limit - ( remaining >> 2 );
+                                    victim->u.p.ub = init;
+                                    status = 1;
                                 }
-                                if ( oldVictimIdx == victimIdx ) {
-                                    break;
+                                __kmp_release_tas_lock( &victim->u.p.steal_lock, gtid );
+                                if ( status ) {
+                                    // now update own count and ub
+                                    __kmp_acquire_tas_lock( &pr->u.p.steal_lock, gtid );
+                                    pr->u.p.count = init + 1;
+                                    pr->u.p.ub = limit;
+                                    __kmp_release_tas_lock( &pr->u.p.steal_lock, gtid );
                                 }
-                                pr->u.p.parm4 = victimIdx;
+                            } else {
+                                union_i4  vold, vnew;
+                                kmp_int32 remaining; // kmp_int32 because KMP_I4 only
 
                                 while( 1 ) {
                                     vold.b = *( volatile kmp_int64 * )( &victim->u.p.count );
@@ -1549,9 +1600,8 @@ __kmp_dispatch_next(
                                             *VOLATILE_CAST(kmp_int64 *)&vold.b,
                                             *VOLATILE_CAST(kmp_int64 *)&vnew.b ) ) {
                                         status = 1;
-                                        while_index = 0;
                                         // now update own count and ub
-                                        #if KMP_ARCH_X86 
+                                        #if KMP_ARCH_X86
                                         // stealing executed on non-KMP_ARCH_X86 only
                                             // Atomic 64-bit write on ia32 is
                                             // unavailable, so we do this in steps.
@@ -1570,8 +1620,11 @@ __kmp_dispatch_next(
                                     } // if
                                 KMP_CPU_PAUSE();
                                 } // while (1)
-                            } // while
-                        } // if
+                            } // if
+                            if ( status ) {
+                                pr->u.p.parm4 = victimIdx;
+                            }
+                        } // for
                     } // if
                     if ( !status ) {
                         *p_lb = 0;
@@ -1653,13 +1706,17 @@ __kmp_dispatch_next(
             case kmp_sch_static_chunked:
                 {
                     T parm1;
+                    T id = __kmp_tid_from_gtid(gtid);
 
                     KD_TRACE(100, ("__kmp_dispatch_next: T#%d kmp_sch_static_[affinity|chunked] case\n",
                                    gtid ) );
                     parm1 = pr->u.p.parm1;
+                    if ( __kmp_static_numa ) {
+                        id = team->t.t_static_rank[ id ];
+                    }
 
                     trip  = pr->u.p.tc - 1;
-                    init  = parm1 * (pr->u.p.count + __kmp_tid_from_gtid(gtid));
+                    init  = parm1 * (pr->u.p.count + id);
 
                     if ( (status = (init <= trip)) != 0 ) {
                         start = pr->u.p.lb;
@@ -1711,7 +1768,29 @@ __kmp_dispatch_next(
                     KD_TRACE(100, ("__kmp_dispatch_next: T#%d kmp_sch_dynamic_chunked case\n",
                                    gtid ) );
 
-                    init = chunk * test_then_inc_acq< ST >((volatile ST *) & sh->u.s.iteration );
+                    if ( pr->u.p.parm4 == 0 ) {
+                        init = chunk * test_then_inc_acq< ST >((volatile ST *) & sh->u.s.iteration );
+                    } else {
+                        // Take a batch of chunks with one atomic add and hand them out locally.
+                        // Like guided, the batch is remaining / (K*nproc) chunks, K=2 by default,
+                        // so it shrinks to a single chunk near the end of the loop.
+                        if ( (UT)pr->u.p.parm2 >= (UT)pr->u.p.parm3 ) {
+                            UT done  = sh->u.s.iteration;  // shared value, may be stale
+                            ST batch = 1;
+
+                            if ( done < (UT)pr->u.p.parm4 ) {
+                                batch = ( (UT)pr->u.p.parm4 - done ) / ( guided_int_param * team->t.t_nproc );
+                                if ( batch > __kmp_dispatch_batch ) {
+                                    batch = __kmp_dispatch_batch;
+                                } else if ( batch < 1 ) {
+                                    batch = 1;
+                                }
+                            }
+                            pr->u.p.parm2 = test_then_add< ST >( (volatile ST *) & sh->u.s.iteration, batch );
+                            pr->u.p.parm3 = pr->u.p.parm2 + batch;
+                        }
+                        init = chunk * (UT)( pr->u.p.parm2 )++;
+                    }
                     trip = pr->u.p.tc - 1;
 
                     if ( (status = (init <= trip)) == 0 ) {
@@ -1995,6 +2074,10 @@ __kmp_dispatch_next(
             } // switch
         } // if tc == 0;
 
+        if ( status ) {
+            KMP_STATS_COUNT( th, __kmp_stats_chunk_counter( pr->schedule ) );
+        }
+
         if ( status == 0 ) {
             UT   num_done;
 
@@ -2026,7 +2109,7 @@ __kmp_dispatch_next(
 
                 KMP_MB();       /* Flush all pending memory write invalidates.  */
 
-                sh -> buffer_index += KMP_MAX_DISP_BUF;
+                sh -> buffer_index += team->t.t_disp_num_buffers;
                 KD_TRACE(100, ("__kmp_dispatch_next: T#%d change buffer_index:%d\n",
                                 gtid, sh->buffer_index) );
 
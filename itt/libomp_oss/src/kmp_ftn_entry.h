@@ -730,6 +730,30 @@ FTN_INIT_NEST_LOCK( void **user_lock )
     #endif
 }
 
+#if OMP_40_ENABLED
+/* initialize the lock, with the lock kind chosen by the hint */
+void FTN_STDCALL
+FTN_INIT_LOCK_WITH_HINT( void **user_lock, int KMP_DEREF hint )
+{
+    #ifdef KMP_STUB
+        *((kmp_stub_lock_t *)user_lock) = UNLOCKED;
+    #else
+        __kmpc_init_lock_with_hint( NULL, __kmp_entry_gtid(), user_lock, KMP_DEREF hint );
+    #endif
+}
+
+/* initialize the lock, with the lock kind chosen by the hint */
+void FTN_STDCALL
+FTN_INIT_NEST_LOCK_WITH_HINT( void **user_lock, int KMP_DEREF hint )
+{
+    #ifdef KMP_STUB
+        *((kmp_stub_lock_t *)user_lock) = UNLOCKED;
+    #else
+        __kmpc_init_nest_lock_with_hint( NULL, __kmp_entry_gtid(), user_lock, KMP_DEREF hint );
+    #endif
+}
+#endif // OMP_40_ENABLED
+
 void FTN_STDCALL
 FTN_DESTROY_LOCK( void **user_lock )
 {
@@ -111,6 +111,8 @@
     #define FTN_UNSET_LOCK                       omp_unset_lock
     #define FTN_TEST_LOCK                        omp_test_lock
     #define FTN_INIT_NEST_LOCK                   omp_init_nest_lock
+    #define FTN_INIT_LOCK_WITH_HINT              omp_init_lock_with_hint
+    #define FTN_INIT_NEST_LOCK_WITH_HINT         omp_init_nest_lock_with_hint
     #define FTN_DESTROY_NEST_LOCK                omp_destroy_nest_lock
     #define FTN_SET_NEST_LOCK                    omp_set_nest_lock
     #define FTN_UNSET_NEST_LOCK                  omp_unset_nest_lock
@@ -185,6 +187,8 @@
     #define FTN_UNSET_LOCK                       omp_unset_lock_
     #define FTN_TEST_LOCK                        omp_test_lock_
     #define FTN_INIT_NEST_LOCK                   omp_init_nest_lock_
+    #define FTN_INIT_LOCK_WITH_HINT              omp_init_lock_with_hint_
+    #define FTN_INIT_NEST_LOCK_WITH_HINT         omp_init_nest_lock_with_hint_
     #define FTN_DESTROY_NEST_LOCK                omp_destroy_nest_lock_
     #define FTN_SET_NEST_LOCK                    omp_set_nest_lock_
     #define FTN_UNSET_NEST_LOCK                  omp_unset_nest_lock_
@@ -259,6 +263,8 @@
     #define FTN_UNSET_LOCK                       OMP_UNSET_LOCK
     #define FTN_TEST_LOCK                        OMP_TEST_LOCK
     #define FTN_INIT_NEST_LOCK                   OMP_INIT_NEST_LOCK
+    #define FTN_INIT_LOCK_WITH_HINT              OMP_INIT_LOCK_WITH_HINT
+    #define FTN_INIT_NEST_LOCK_WITH_HINT         OMP_INIT_NEST_LOCK_WITH_HINT
     #define FTN_DESTROY_NEST_LOCK                OMP_DESTROY_NEST_LOCK
     #define FTN_SET_NEST_LOCK                    OMP_SET_NEST_LOCK
     #define FTN_UNSET_NEST_LOCK                  OMP_UNSET_NEST_LOCK
@@ -333,6 +339,8 @@
     #define FTN_UNSET_LOCK                       OMP_UNSET_LOCK_
     #define FTN_TEST_LOCK                        OMP_TEST_LOCK_
     #define FTN_INIT_NEST_LOCK                   OMP_INIT_NEST_LOCK_
+    #define FTN_INIT_LOCK_WITH_HINT              OMP_INIT_LOCK_WITH_HINT_
+    #define FTN_INIT_NEST_LOCK_WITH_HINT         OMP_INIT_NEST_LOCK_WITH_HINT_
     #define FTN_DESTROY_NEST_LOCK                OMP_DESTROY_NEST_LOCK_
     #define FTN_SET_NEST_LOCK                    OMP_SET_NEST_LOCK_
     #define FTN_UNSET_NEST_LOCK                  OMP_UNSET_NEST_LOCK_
@@ -73,6 +73,9 @@ kmp_cached_addr_t  *__kmp_threadpriv_cache_list = NULL;
 int                 __kmp_init_counter  = 0;
 int                 __kmp_root_counter  = 0;
 int                 __kmp_version       = 0;
+#if KMP_STATS_ENABLED
+int                 __kmp_stats_enabled = FALSE;
+#endif
 
 volatile kmp_uint32 __kmp_team_counter  = 0;
 volatile kmp_uint32 __kmp_task_counter  = 0;
@@ -124,7 +127,10 @@ char const *__kmp_barrier_type_name           [ bs_last_barrier ] =
                                     , "reduction"
                                 #endif // KMP_FAST_REDUCTION_BARRIER
                             };
-char const *__kmp_barrier_pattern_name [ bp_last_bar ] = { "linear", "tree", "hyper" };
+char const *__kmp_barrier_pattern_name [ bp_last_bar ] = { "linear", "tree", "hyper", "hierarchical" };
+kmp_uint32 __kmp_bar_hier_depth = 0;    /* set from the machine topology by __kmp_affinity_initialize() */
+kmp_uint32 __kmp_bar_hier_fanout [ KMP_MAX_BAR_HIER_DEPTH ] = { 0 };
+kmp_uint32 __kmp_bar_hier_skip   [ KMP_MAX_BAR_HIER_DEPTH + 1 ] = { 1 };
 
 
 int       __kmp_allThreadsSpecified = 0;
@@ -157,6 +163,12 @@ enum sched_type      __kmp_auto = kmp_sch_guided_analytical_chunked; /* default
 int        __kmp_dflt_blocktime = KMP_DEFAULT_BLOCKTIME;
 int       __kmp_monitor_wakeups = KMP_MIN_MONITOR_WAKEUPS;
 int          __kmp_bt_intervals = KMP_INTERVALS_FROM_BLOCKTIME( KMP_DEFAULT_BLOCKTIME, KMP_MIN_MONITOR_WAKEUPS );
+int         __kmp_adaptive_wait = FALSE;
+int           __kmp_use_monitor = TRUE;
+kmp_uint64 __kmp_ticks_per_msec = 0;
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+int         __kmp_futex_parking = TRUE;
+#endif
 #ifdef KMP_ADJUST_BLOCKTIME
 int               __kmp_zero_bt = FALSE;
 #endif /* KMP_ADJUST_BLOCKTIME */
@@ -165,6 +177,10 @@ int            __kmp_ht_enabled = FALSE;
 int        __kmp_ht_log_per_phy = 1;
 int                __kmp_ncores = 0;
 int                 __kmp_chunk = 0;
+int        __kmp_dispatch_batch = 1;
+int  __kmp_dispatch_num_buffers = KMP_DFLT_DISP_NUM_BUFF;
+int           __kmp_static_numa = FALSE;
+int   __kmp_hot_teams_max_level = 1;
 int           __kmp_abort_delay = 0;
 #if KMP_OS_LINUX && defined(KMP_TDATA_GTID)
 int             __kmp_gtid_mode = 3; /* use __declspec(thread) TLS to store gtid */
@@ -203,9 +219,14 @@ enum sched_type __kmp_sch_map[ kmp_sched_upper - kmp_sched_lower_ext + kmp_sched
     kmp_sch_dynamic_chunked,    // ==> kmp_sched_dynamic           = 2
     kmp_sch_guided_chunked,     // ==> kmp_sched_guided            = 3
     kmp_sch_auto,               // ==> kmp_sched_auto              = 4
-    kmp_sch_trapezoidal         // ==> kmp_sched_trapezoidal       = 101
+    kmp_sch_trapezoidal,        // ==> kmp_sched_trapezoidal       = 101
                                 // will likely not used, introduced here just to debug the code
                                 // of public intel extension schedules
+#if KMP_STATIC_STEAL_ENABLED && KMP_ARCH_X86_64
+    kmp_sch_static_steal        // ==> kmp_sched_static_steal      = 102
+#else
+    kmp_sch_dynamic_chunked     // ==> kmp_sched_static_steal      = 102 (no stealing on this architecture)
+#endif
 };
 
 #if KMP_OS_LINUX
@@ -240,6 +261,8 @@ int      __kmp_affinity_respect_mask = affinity_respect_mask_default;
 char *   __kmp_affinity_proclist     = NULL;
 kmp_affin_mask_t *__kmp_affinity_masks = NULL;
 unsigned __kmp_affinity_num_masks    = 0;
+int *    __kmp_affinity_place_node   = NULL;
+int      __kmp_affinity_num_nodes    = 0;
 
 char const *  __kmp_cpuinfo_file     = NULL;
 
@@ -50,6 +50,8 @@
 #include "kmp_i18n.h"
 #include "kmp_lock.h"
 #include "kmp_io.h"
+#include "kmp_str.h"
+#include "kmp_stats.h"
 
 #if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
 # include <unistd.h>
@@ -124,11 +126,21 @@ __kmp_validate_locks( void )
 // gcc reserves >= 8 bytes for nested locks, so we can assume that the
 // entire 8 bytes were allocated for nested locks on all 64-bit platforms.
 //
+// Dynamic direct locks only own the lock word, even when a whole lock would
+// fit; their lock kind tells simple from nested locks (nested ones are
+// always indirect), so the simple lock checks must not look at depth_locked.
+//
+#if KMP_USE_DYNAMIC_LOCK
+# define KMP_SIMPLE_LOCK_HAS_DEPTH(type)    0
+#else
+# define KMP_SIMPLE_LOCK_HAS_DEPTH(type)    ( sizeof ( type ) <= OMP_LOCK_T_SIZE )
+#endif
+//
 
 static kmp_int32
 __kmp_get_tas_lock_owner( kmp_tas_lock_t *lck )
 {
-    return TCR_4( lck->lk.poll ) - 1;
+    return KMP_LOCK_STRIP( TCR_4( lck->lk.poll ) ) - 1;
 }
 
 static inline bool
@@ -143,15 +155,18 @@ __kmp_acquire_tas_lock_timed_template( kmp_tas_lock_t *lck, kmp_int32 gtid )
     KMP_MB();
 
 #ifdef USE_LOCK_PROFILE
-    kmp_uint32 curr = TCR_4( lck->lk.poll );
+    kmp_uint32 curr = KMP_LOCK_STRIP( TCR_4( lck->lk.poll ) );
     if ( ( curr != 0 ) && ( curr != gtid + 1 ) )
         __kmp_printf( "LOCK CONTENTION: %p\n", lck );
     /* else __kmp_printf( "." );*/
 #endif /* USE_LOCK_PROFILE */
 
-    if ( KMP_COMPARE_AND_STORE_ACQ32( & ( lck->lk.poll ), 0, gtid + 1 ) ) {
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_ACQUIRE );
+    if ( ( lck->lk.poll == KMP_LOCK_FREE( tas ) )
+      && KMP_COMPARE_AND_STORE_ACQ32( & ( lck->lk.poll ), KMP_LOCK_FREE( tas ), KMP_LOCK_BUSY( gtid + 1, tas ) ) ) {
         return;
     }
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_CONTENDED );
 
     kmp_uint32 spins;
     KMP_INIT_YIELD( spins );
@@ -163,8 +178,8 @@ __kmp_acquire_tas_lock_timed_template( kmp_tas_lock_t *lck, kmp_int32 gtid )
         KMP_YIELD_SPIN( spins );
     }
 
-    while ( KMP_COMPARE_AND_STORE_ACQ32( & ( lck->lk.poll ), 0, gtid + 1 )
-      == 0 ) {
+    while ( ( lck->lk.poll != KMP_LOCK_FREE( tas ) ) ||
+      ( ! KMP_COMPARE_AND_STORE_ACQ32( & ( lck->lk.poll ), KMP_LOCK_FREE( tas ), KMP_LOCK_BUSY( gtid + 1, tas ) ) ) ) {
         //
         // FIXME - use exponential backoff here
         //
@@ -189,7 +204,7 @@ __kmp_acquire_tas_lock_with_checks( kmp_tas_lock_t *lck, kmp_int32 gtid )
 {
     if ( __kmp_env_consistency_check ) {
         char const * const func = "omp_set_lock";
-        if ( ( sizeof ( kmp_tas_lock_t ) <= OMP_LOCK_T_SIZE )
+        if ( KMP_SIMPLE_LOCK_HAS_DEPTH( kmp_tas_lock_t )
           && __kmp_is_tas_lock_nestable( lck ) ) {
             KMP_FATAL( LockNestableUsedAsSimple, func );
         }
@@ -203,7 +218,8 @@ __kmp_acquire_tas_lock_with_checks( kmp_tas_lock_t *lck, kmp_int32 gtid )
 int
 __kmp_test_tas_lock( kmp_tas_lock_t *lck, kmp_int32 gtid )
 {
-    if ( KMP_COMPARE_AND_STORE_ACQ32( & ( lck->lk.poll ), 0, gtid + 1 ) ) {
+    if ( ( lck->lk.poll == KMP_LOCK_FREE( tas ) )
+      && KMP_COMPARE_AND_STORE_ACQ32( & ( lck->lk.poll ), KMP_LOCK_FREE( tas ), KMP_LOCK_BUSY( gtid + 1, tas ) ) ) {
         return TRUE;
     }
     return FALSE;
@@ -214,7 +230,7 @@ __kmp_test_tas_lock_with_checks( kmp_tas_lock_t *lck, kmp_int32 gtid )
 {
     if ( __kmp_env_consistency_check ) {
         char const * const func = "omp_test_lock";
-        if ( ( sizeof ( kmp_tas_lock_t ) <= OMP_LOCK_T_SIZE )
+        if ( KMP_SIMPLE_LOCK_HAS_DEPTH( kmp_tas_lock_t )
           && __kmp_is_tas_lock_nestable( lck ) ) {
             KMP_FATAL( LockNestableUsedAsSimple, func );
         }
@@ -227,7 +243,7 @@ __kmp_release_tas_lock( kmp_tas_lock_t *lck, kmp_int32 gtid )
 {
     KMP_MB();       /* Flush all pending memory write invalidates.  */
 
-    TCW_4( lck->lk.poll, 0 );
+    TCW_4( lck->lk.poll, KMP_LOCK_FREE( tas ) );
 
     KMP_MB();       /* Flush all pending memory write invalidates.  */
 
@@ -241,7 +257,7 @@ __kmp_release_tas_lock_with_checks( kmp_tas_lock_t *lck, kmp_int32 gtid )
     if ( __kmp_env_consistency_check ) {
         char const * const func = "omp_unset_lock";
         KMP_MB();  /* in case another processor initialized lock */
-        if ( ( sizeof ( kmp_tas_lock_t ) <= OMP_LOCK_T_SIZE )
+        if ( KMP_SIMPLE_LOCK_HAS_DEPTH( kmp_tas_lock_t )
           && __kmp_is_tas_lock_nestable( lck ) ) {
             KMP_FATAL( LockNestableUsedAsSimple, func );
         }
@@ -259,7 +275,7 @@ __kmp_release_tas_lock_with_checks( kmp_tas_lock_t *lck, kmp_int32 gtid )
 void
 __kmp_init_tas_lock( kmp_tas_lock_t * lck )
 {
-    TCW_4( lck->lk.poll, 0 );
+    TCW_4( lck->lk.poll, KMP_LOCK_FREE( tas ) );
 }
 
 static void
@@ -279,7 +295,7 @@ __kmp_destroy_tas_lock_with_checks( kmp_tas_lock_t *lck )
 {
     if ( __kmp_env_consistency_check ) {
         char const * const func = "omp_destroy_lock";
-        if ( ( sizeof ( kmp_tas_lock_t ) <= OMP_LOCK_T_SIZE )
+        if ( KMP_SIMPLE_LOCK_HAS_DEPTH( kmp_tas_lock_t )
           && __kmp_is_tas_lock_nestable( lck ) ) {
             KMP_FATAL( LockNestableUsedAsSimple, func );
         }
@@ -432,7 +448,7 @@ __kmp_destroy_nested_tas_lock_with_checks( kmp_tas_lock_t *lck )
 static kmp_int32
 __kmp_get_futex_lock_owner( kmp_futex_lock_t *lck )
 {
-    return ( TCR_4( lck->lk.poll ) >> 1 ) - 1;
+    return ( KMP_LOCK_STRIP( TCR_4( lck->lk.poll ) ) >> 1 ) - 1;
 }
 
 static inline bool
@@ -449,7 +465,7 @@ __kmp_acquire_futex_lock_timed_template( kmp_futex_lock_t *lck, kmp_int32 gtid )
     KMP_MB();
 
 #ifdef USE_LOCK_PROFILE
-    kmp_uint32 curr = TCR_4( lck->lk.poll );
+    kmp_uint32 curr = KMP_LOCK_STRIP( TCR_4( lck->lk.poll ) );
     if ( ( curr != 0 ) && ( curr != gtid_code ) )
         __kmp_printf( "LOCK CONTENTION: %p\n", lck );
     /* else __kmp_printf( "." );*/
@@ -458,10 +474,33 @@ __kmp_acquire_futex_lock_timed_template( kmp_futex_lock_t *lck, kmp_int32 gtid )
     KA_TRACE( 1000, ("__kmp_acquire_futex_lock: lck:%p(0x%x), T#%d entering\n",
       lck, lck->lk.poll, gtid ) );
 
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_ACQUIRE );
+#if KMP_STATS_ENABLED
+    if ( TCR_4( lck->lk.poll ) != KMP_LOCK_FREE( futex ) )
+        KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_CONTENDED );
+#endif
+
+    //
+    // With KMP_ADAPTIVE_WAIT, spin on a held lock for as long as the recent
+    // waits for it predict before going to futex_wait.
+    //
+    kmp_info_t *adaptive_thr = NULL;
+    kmp_uint64 adaptive_start = 0;
+    if ( __kmp_adaptive_wait && ( gtid >= 0 ) && ( TCR_4( lck->lk.poll ) != KMP_LOCK_FREE( futex ) ) ) {
+        adaptive_thr = __kmp_threads[ gtid ];
+        kmp_uint64 spin_ticks = __kmp_adaptive_spin_ticks( adaptive_thr, & ( lck->lk.poll ) );
+        adaptive_start = __kmp_hardware_timestamp();
+        KMP_STATS_COUNT( adaptive_thr, spin_ticks ? KMP_STAT_WAIT_SPIN : KMP_STAT_WAIT_PARK );
+        while ( ( TCR_4( lck->lk.poll ) != KMP_LOCK_FREE( futex ) )
+          && ( __kmp_hardware_timestamp() - adaptive_start < spin_ticks ) ) {
+            KMP_CPU_PAUSE();
+        }
+    }
+
     kmp_int32 poll_val;
-    while ( ( poll_val = __kmp_compare_and_store_ret32( & ( lck->lk.poll ), 0,
-      gtid_code ) ) != 0 ) {
-        kmp_int32 cond = poll_val & 1;
+    while ( ( poll_val = __kmp_compare_and_store_ret32( & ( lck->lk.poll ), KMP_LOCK_FREE( futex ),
+      KMP_LOCK_BUSY( gtid_code, futex ) ) ) != KMP_LOCK_FREE( futex ) ) {
+        kmp_int32 cond = KMP_LOCK_STRIP( poll_val ) & 1;
         KA_TRACE( 1000, ("__kmp_acquire_futex_lock: lck:%p, T#%d poll_val = 0x%x cond = 0x%x\n",
            lck, gtid, poll_val, cond ) );
 
@@ -479,12 +518,12 @@ __kmp_acquire_futex_lock_timed_template( kmp_futex_lock_t *lck, kmp_int32 gtid )
             // thread that they need to wake this thread up.
             //
             if ( ! __kmp_compare_and_store32( & ( lck->lk.poll ),
-              poll_val, poll_val | 1 ) ) {
+              poll_val, poll_val | KMP_LOCK_BUSY( 1, futex ) ) ) {
                 KA_TRACE( 1000, ("__kmp_acquire_futex_lock: lck:%p(0x%x), T#%d can't set bit 0\n",
                   lck, lck->lk.poll, gtid ) );
                 continue;
             }
-            poll_val |= 1;
+            poll_val |= KMP_LOCK_BUSY( 1, futex );
 
             KA_TRACE( 1000, ("__kmp_acquire_futex_lock: lck:%p(0x%x), T#%d bit 0 set\n",
               lck, lck->lk.poll, gtid ) );
@@ -512,6 +551,11 @@ __kmp_acquire_futex_lock_timed_template( kmp_futex_lock_t *lck, kmp_int32 gtid )
         gtid_code |= 1;
     }
 
+    if ( adaptive_thr != NULL ) {
+        __kmp_adaptive_wait_update( adaptive_thr, & ( lck->lk.poll ),
+          __kmp_hardware_timestamp() - adaptive_start );
+    }
+
     KA_TRACE( 1000, ("__kmp_acquire_futex_lock: lck:%p(0x%x), T#%d exiting\n",
       lck, lck->lk.poll, gtid ) );
 }
@@ -527,7 +571,7 @@ __kmp_acquire_futex_lock_with_checks( kmp_futex_lock_t *lck, kmp_int32 gtid )
 {
     if ( __kmp_env_consistency_check ) {
         char const * const func = "omp_set_lock";
-        if ( ( sizeof ( kmp_futex_lock_t ) <= OMP_LOCK_T_SIZE )
+        if ( KMP_SIMPLE_LOCK_HAS_DEPTH( kmp_futex_lock_t )
           && __kmp_is_futex_lock_nestable( lck ) ) {
             KMP_FATAL( LockNestableUsedAsSimple, func );
         }
@@ -541,7 +585,8 @@ __kmp_acquire_futex_lock_with_checks( kmp_futex_lock_t *lck, kmp_int32 gtid )
 int
 __kmp_test_futex_lock( kmp_futex_lock_t *lck, kmp_int32 gtid )
 {
-    if ( KMP_COMPARE_AND_STORE_ACQ32( & ( lck->lk.poll ), 0, ( gtid + 1 ) << 1 ) ) {
+    if ( KMP_COMPARE_AND_STORE_ACQ32( & ( lck->lk.poll ), KMP_LOCK_FREE( futex ),
+      KMP_LOCK_BUSY( ( gtid + 1 ) << 1, futex ) ) ) {
         return TRUE;
     }
     return FALSE;
@@ -552,7 +597,7 @@ __kmp_test_futex_lock_with_checks( kmp_futex_lock_t *lck, kmp_int32 gtid )
 {
     if ( __kmp_env_consistency_check ) {
         char const * const func = "omp_test_lock";
-        if ( ( sizeof ( kmp_futex_lock_t ) <= OMP_LOCK_T_SIZE )
+        if ( KMP_SIMPLE_LOCK_HAS_DEPTH( kmp_futex_lock_t )
           && __kmp_is_futex_lock_nestable( lck ) ) {
             KMP_FATAL( LockNestableUsedAsSimple, func );
         }
@@ -568,12 +613,12 @@ __kmp_release_futex_lock( kmp_futex_lock_t *lck, kmp_int32 gtid )
     KA_TRACE( 1000, ("__kmp_release_futex_lock: lck:%p(0x%x), T#%d entering\n",
       lck, lck->lk.poll, gtid ) );
 
-    kmp_int32 poll_val = __kmp_xchg_fixed32( & ( lck->lk.poll ), 0 );
+    kmp_int32 poll_val = __kmp_xchg_fixed32( & ( lck->lk.poll ), KMP_LOCK_FREE( futex ) );
 
     KA_TRACE( 1000, ("__kmp_release_futex_lock: lck:%p, T#%d released poll_val = 0x%x\n",
        lck, gtid, poll_val ) );
 
-    if ( poll_val & 1 ) {
+    if ( KMP_LOCK_STRIP( poll_val ) & 1 ) {
         KA_TRACE( 1000, ("__kmp_release_futex_lock: lck:%p, T#%d futex_wake 1 thread\n",
            lck, gtid ) );
         syscall( __NR_futex, & ( lck->lk.poll ), FUTEX_WAKE, 1, NULL, NULL, 0 );
@@ -594,7 +639,7 @@ __kmp_release_futex_lock_with_checks( kmp_futex_lock_t *lck, kmp_int32 gtid )
     if ( __kmp_env_consistency_check ) {
         char const * const func = "omp_unset_lock";
         KMP_MB();  /* in case another processor initialized lock */
-        if ( ( sizeof ( kmp_futex_lock_t ) <= OMP_LOCK_T_SIZE )
+        if ( KMP_SIMPLE_LOCK_HAS_DEPTH( kmp_futex_lock_t )
           && __kmp_is_futex_lock_nestable( lck ) ) {
             KMP_FATAL( LockNestableUsedAsSimple, func );
         }
@@ -612,7 +657,7 @@ __kmp_release_futex_lock_with_checks( kmp_futex_lock_t *lck, kmp_int32 gtid )
 void
 __kmp_init_futex_lock( kmp_futex_lock_t * lck )
 {
-    TCW_4( lck->lk.poll, 0 );
+    TCW_4( lck->lk.poll, KMP_LOCK_FREE( futex ) );
 }
 
 static void
@@ -632,7 +677,7 @@ __kmp_destroy_futex_lock_with_checks( kmp_futex_lock_t *lck )
 {
     if ( __kmp_env_consistency_check ) {
         char const * const func = "omp_destroy_lock";
-        if ( ( sizeof ( kmp_futex_lock_t ) <= OMP_LOCK_T_SIZE )
+        if ( KMP_SIMPLE_LOCK_HAS_DEPTH( kmp_futex_lock_t )
           && __kmp_is_futex_lock_nestable( lck ) ) {
             KMP_FATAL( LockNestableUsedAsSimple, func );
         }
@@ -817,9 +862,11 @@ __kmp_acquire_ticket_lock_timed_template( kmp_ticket_lock_t *lck, kmp_int32 gtid
     /* else __kmp_printf( "." );*/
 #endif /* USE_LOCK_PROFILE */
 
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_ACQUIRE );
     if ( TCR_4( lck->lk.now_serving ) == my_ticket ) {
         return;
     }
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_CONTENDED );
     KMP_WAIT_YIELD( &lck->lk.now_serving, my_ticket, __kmp_bakery_check, lck );
 }
 
@@ -866,6 +913,17 @@ __kmp_test_ticket_lock( kmp_ticket_lock_t *lck, kmp_int32 gtid )
     return FALSE;
 }
 
+static int
+__kmp_try_ticket_lock( kmp_ticket_lock_t *lck, kmp_int32 gtid )
+{
+    int retval = __kmp_test_ticket_lock( lck, gtid );
+
+    if ( __kmp_env_consistency_check && retval ) {
+        lck->lk.owner_id = gtid + 1;
+    }
+    return retval;
+}
+
 static int
 __kmp_test_ticket_lock_with_checks( kmp_ticket_lock_t *lck, kmp_int32 gtid )
 {
@@ -879,12 +937,7 @@ __kmp_test_ticket_lock_with_checks( kmp_ticket_lock_t *lck, kmp_int32 gtid )
         }
     }
 
-    int retval = __kmp_test_ticket_lock( lck, gtid );
-
-    if ( __kmp_env_consistency_check && retval ) {
-        lck->lk.owner_id = gtid + 1;
-    }
-    return retval;
+    return __kmp_try_ticket_lock( lck, gtid );
 }
 
 void
@@ -1287,6 +1340,7 @@ __kmp_acquire_queuing_lock_timed_template( kmp_queuing_lock_t *lck,
     kmp_int32 need_mf = 1;
 
     KA_TRACE( 1000, ("__kmp_acquire_queuing_lock: lck:%p, T#%d entering\n", lck, gtid ));
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_ACQUIRE );
 
     KMP_DEBUG_ASSERT( this_thr != NULL );
     spin_here_p = & this_thr->th.th_spin_here;
@@ -1403,6 +1457,7 @@ __kmp_acquire_queuing_lock_timed_template( kmp_queuing_lock_t *lck,
                 /* corresponding wait for this write in release code */
             }
             KA_TRACE( 1000, ("__kmp_acquire_queuing_lock: lck:%p, T#%d waiting for lock\n", lck, gtid ));
+            KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_CONTENDED );
 
 
             /* ToDo: May want to consider using __kmp_wait_sleep  or something that sleeps for
@@ -1506,6 +1561,17 @@ __kmp_test_queuing_lock( kmp_queuing_lock_t *lck, kmp_int32 gtid )
     return FALSE;
 }
 
+static int
+__kmp_try_queuing_lock( kmp_queuing_lock_t *lck, kmp_int32 gtid )
+{
+    int retval = __kmp_test_queuing_lock( lck, gtid );
+
+    if ( __kmp_env_consistency_check && retval ) {
+        lck->lk.owner_id = gtid + 1;
+    }
+    return retval;
+}
+
 static int
 __kmp_test_queuing_lock_with_checks( kmp_queuing_lock_t *lck, kmp_int32 gtid )
 {
@@ -1519,12 +1585,7 @@ __kmp_test_queuing_lock_with_checks( kmp_queuing_lock_t *lck, kmp_int32 gtid )
         }
     }
 
-    int retval = __kmp_test_queuing_lock( lck, gtid );
-
-    if ( __kmp_env_consistency_check && retval ) {
-        lck->lk.owner_id = gtid + 1;
-    }
-    return retval;
+    return __kmp_try_queuing_lock( lck, gtid );
 }
 
 void
@@ -1917,6 +1978,457 @@ __kmp_set_queuing_lock_flags( kmp_queuing_lock_t *lck, kmp_lock_flags_t flags )
     lck->lk.flags = flags;
 }
 
+#if KMP_USE_ADAPTIVE_LOCKS
+
+/* ------------------------------------------------------------------------ */
+/* Adaptive locks                                                           */
+
+//
+// The RTM instructions are emitted as raw bytes, so the runtime can be built
+// with assemblers that do not know them. They are only executed when CPUID
+// reports RTM support (see __kmp_stg_parse_lock_kind).
+//
+
+// Values returned by _xbegin(): either _XBEGIN_STARTED, or a combination of
+// the abort status bits below.
+#define _XBEGIN_STARTED          (~0u)
+#define _XABORT_EXPLICIT         (1 << 0)
+#define _XABORT_RETRY            (1 << 1)
+#define _XABORT_CONFLICT         (1 << 2)
+#define _XABORT_CAPACITY         (1 << 3)
+#define _XABORT_DEBUG            (1 << 4)
+#define _XABORT_NESTED           (1 << 5)
+#define _XABORT_CODE(x)          ((unsigned char)(((x) >> 24) & 0xFF))
+
+// Aborts for which retrying the transaction is worthwhile.
+#define SOFT_ABORT_MASK  (_XABORT_RETRY | _XABORT_CONFLICT | _XABORT_EXPLICIT)
+
+static __inline int _xbegin()
+{
+    int res = -1;
+
+    // Note that %eax must be noted as killed (clobbered), because the XSR is
+    // returned in %eax(%rax) on abort.  Other register values are restored,
+    // so don't need to be killed.
+    //
+    // We must also mark 'res' as an input and an output, since otherwise
+    // 'res=-1' may be dropped as being dead, whereas we do need the
+    // assignment on the successful (i.e., non-abort) path.
+    __asm__ volatile ("1: .byte  0xC7; .byte 0xF8;\n"
+                      "   .long  1f-1b-6\n"
+                      "    jmp   2f\n"
+                      "1:  movl  %%eax,%0\n"
+                      "2:"
+                      :"+r"(res)::"memory","%eax");
+
+    // Return the XSR on abort, or -1 (_XBEGIN_STARTED) when the transaction
+    // has started.
+    return res;
+}
+
+static __inline void _xend()
+{
+    // xend
+    __asm__ volatile (".byte 0x0f; .byte 0x01; .byte 0xd5" :::"memory");
+}
+
+// The argument must be a literal, it is pasted into the instruction bytes.
+#define _xabort(ARG) \
+    __asm__ volatile (".byte 0xC6; .byte 0xF8; .byte " #ARG :::"memory");
+
+//
+// Defaults for the adaptivity parameters of new locks; may be changed by
+// KMP_ADAPTIVE_LOCK_PROPS.
+//
+kmp_adaptive_backoff_params_t __kmp_adaptive_backoff_params = { 1, 1024 };
+
+#define GET_QLK_PTR(l) ( (kmp_queuing_lock_t *) & (l)->lk.qlk )
+
+#if KMP_DEBUG_ADAPTIVE_LOCKS
+
+//
+// Statistics of destroyed locks, accumulated for the report at shutdown.
+//
+static kmp_adaptive_lock_statistics_t __kmp_destroyed_lock_stats;
+
+# define KMP_INC_STAT(lck,stat) ( (lck)->lk.adaptive.stats.stat++ )
+
+static void
+__kmp_zero_speculative_stats( kmp_adaptive_lock_t *lck )
+{
+    memset( (void *)&lck->lk.adaptive.stats, 0, sizeof( lck->lk.adaptive.stats ) );
+}
+
+static void
+__kmp_print_adaptive_lock_stats( const char *title, kmp_adaptive_lock_statistics_t volatile *s )
+{
+    kmp_uint32 speculative = s->successful_speculations + s->hard_failed_speculations
+      + s->soft_failed_speculations;
+    kmp_uint32 total = s->successful_speculations + s->non_speculative_acquires;
+
+    __kmp_printf( "%s: acquires %u, speculative successes %u, hard aborts %u, "
+      "soft aborts %u, non-speculative acquires %u, lemming yields %u (%.1f%% speculative, "
+      "%.1f%% of speculations successful)\n",
+      title, total, s->successful_speculations, s->hard_failed_speculations,
+      s->soft_failed_speculations, s->non_speculative_acquires, s->lemming_yields,
+      total ? 100.0 * s->successful_speculations / total : 0.0,
+      speculative ? 100.0 * s->successful_speculations / speculative : 0.0 );
+}
+
+static void
+__kmp_accumulate_speculative_stats( kmp_adaptive_lock_t *lck )
+{
+    kmp_adaptive_lock_statistics_t volatile *s = &lck->lk.adaptive.stats;
+    kmp_adaptive_lock_statistics_t *t = &__kmp_destroyed_lock_stats;
+
+    if ( s->successful_speculations + s->non_speculative_acquires == 0 ) {
+        return;   // Never acquired, do not clutter the output.
+    }
+
+    char title[ 64 ];
+    snprintf( title, sizeof( title ), "Adaptive lock %p", lck );
+    __kmp_print_adaptive_lock_stats( title, s );
+
+    // Locks may be destroyed concurrently.
+#define ADD_STAT(stat) KMP_TEST_THEN_ADD32( (kmp_int32 *) &t->stat, s->stat )
+    ADD_STAT( successful_speculations );
+    ADD_STAT( hard_failed_speculations );
+    ADD_STAT( soft_failed_speculations );
+    ADD_STAT( non_speculative_acquires );
+    ADD_STAT( lemming_yields );
+#undef ADD_STAT
+}
+
+void
+__kmp_print_speculative_stats()
+{
+    if ( __kmp_user_lock_kind != lk_adaptive ) {
+        return;
+    }
+    __kmp_print_adaptive_lock_stats( "Adaptive locks total", &__kmp_destroyed_lock_stats );
+}
+
+#else
+
+# define KMP_INC_STAT(lck,stat)
+
+#endif // KMP_DEBUG_ADAPTIVE_LOCKS
+
+static inline bool
+__kmp_is_unlocked_queuing_lock( kmp_queuing_lock_t *lck )
+{
+    // It is enough to check that the head_id is zero.
+    // We don't also need to check the tail.
+    bool res = lck->lk.head_id == 0;
+
+    // We need a fence here, since we must ensure that no memory operations
+    // from later in this thread float above that read.
+#if KMP_COMPILER_ICC
+    _mm_mfence();
+#else
+    __sync_synchronize();
+#endif
+
+    return res;
+}
+
+// Functions for manipulating the badness
+static __inline void
+__kmp_update_badness_after_success( kmp_adaptive_lock_t *lck )
+{
+    // Reset the badness to zero so we eagerly try to speculate again.
+    // Do not write the shared line if nothing changes.
+    if ( lck->lk.adaptive.badness != 0 ) {
+        lck->lk.adaptive.badness = 0;
+    }
+    KMP_INC_STAT( lck, successful_speculations );
+}
+
+// Create a bit mask with one more set bit.
+static __inline void
+__kmp_step_badness( kmp_adaptive_lock_t *lck )
+{
+    kmp_uint32 newBadness = ( lck->lk.adaptive.badness << 1 ) | 1;
+    if ( newBadness > lck->lk.adaptive.max_badness ) {
+        return;
+    } else {
+        lck->lk.adaptive.badness = newBadness;
+    }
+}
+
+// Check whether speculation should be attempted.
+static __inline int
+__kmp_should_speculate( kmp_adaptive_lock_t *lck )
+{
+    kmp_uint32 badness = lck->lk.adaptive.badness;
+    kmp_uint32 attempts = lck->lk.adaptive.acquire_attempts;
+    int res = ( attempts & badness ) == 0;
+    return res;
+}
+
+// Attempt to acquire only the speculative lock.
+// Does not back off to the non-speculative lock.
+//
+static int
+__kmp_test_adaptive_lock_only( kmp_adaptive_lock_t *lck, kmp_int32 gtid )
+{
+    int retries = lck->lk.adaptive.max_soft_retries;
+
+    // We don't explicitly count the start of speculation, rather we record
+    // the results (success, hard fail, soft fail). The sum of all of those
+    // is the total number of times we started speculation since all
+    // speculations must end one of those ways.
+    do {
+        kmp_uint32 status = _xbegin();
+        // Switch this in to disable actual speculation but exercise
+        // at least some of the rest of the code. Useful for debugging...
+        // kmp_uint32 status = _XABORT_NESTED;
+
+        if ( status == _XBEGIN_STARTED ) {
+            // We have successfully started speculation.
+            // Check that no-one acquired the lock for real between when we last
+            // looked and now. This also gets the lock cache line into our read-set,
+            // which we need so that we'll abort if anyone later claims it for real.
+            if ( ! __kmp_is_unlocked_queuing_lock( GET_QLK_PTR( lck ) ) ) {
+                // Lock is now visibly acquired, so someone beat us to it.
+                // Abort the transaction so we'll restart from _xbegin with the
+                // failure status.
+                _xabort(0x01)
+                KMP_ASSERT2( 0, "should not get here" );
+            }
+            return 1;   // Lock has been acquired (speculatively)
+        } else {
+            // We have aborted, update the statistics
+            if ( status & SOFT_ABORT_MASK ) {
+                KMP_INC_STAT( lck, soft_failed_speculations );
+                // and loop round to retry.
+            } else {
+                KMP_INC_STAT( lck, hard_failed_speculations );
+                // and give up if we had a hard failure.
+                break;
+            }
+        }
+    } while( retries-- ); // Loop while we have retries, and didn't fail hard.
+
+    // Either we had a hard failure or we didn't succeed softly after
+    // the full set of attempts, so back off the badness.
+    __kmp_step_badness( lck );
+    return 0;
+}
+
+// Attempt to acquire the speculative lock, or back off to the non-speculative one
+// if the speculative lock cannot be acquired.
+// We can succeed speculatively, non-speculatively, or fail.
+int
+__kmp_test_adaptive_lock( kmp_adaptive_lock_t *lck, kmp_int32 gtid )
+{
+    // First try to acquire the lock speculatively
+    if ( __kmp_should_speculate( lck ) && __kmp_test_adaptive_lock_only( lck, gtid ) ) {
+        return 1;
+    }
+
+    // Speculative acquisition failed, so try to acquire it non-speculatively.
+    // Count the non-speculative acquire attempt
+    lck->lk.adaptive.acquire_attempts++;
+
+    // Use base, non-speculative lock.
+    if ( __kmp_test_queuing_lock( GET_QLK_PTR( lck ), gtid ) ) {
+        KMP_INC_STAT( lck, non_speculative_acquires );
+        return 1;       // Lock is acquired (non-speculatively)
+    } else {
+        return 0;       // Failed to acquire the lock, it's already visibly locked.
+    }
+}
+
+static int
+__kmp_try_adaptive_lock( kmp_adaptive_lock_t *lck, kmp_int32 gtid )
+{
+    int retval = __kmp_test_adaptive_lock( lck, gtid );
+
+    if ( __kmp_env_consistency_check && retval ) {
+        lck->lk.qlk.owner_id = gtid + 1;
+    }
+    return retval;
+}
+
+static int
+__kmp_test_adaptive_lock_with_checks( kmp_adaptive_lock_t *lck, kmp_int32 gtid )
+{
+    if ( __kmp_env_consistency_check ) {
+        char const * const func = "omp_test_lock";
+        if ( lck->lk.qlk.initialized != GET_QLK_PTR( lck ) ) {
+            KMP_FATAL( LockIsUninitialized, func );
+        }
+        if ( __kmp_is_queuing_lock_nestable( GET_QLK_PTR( lck ) ) ) {
+            KMP_FATAL( LockNestableUsedAsSimple, func );
+        }
+    }
+
+    return __kmp_try_adaptive_lock( lck, gtid );
+}
+
+// Block until we can acquire a speculative, adaptive lock.
+// We check whether we should be trying to speculate.
+// If we should be, we check the real lock to see if it is free,
+// and, if not, pause without attempting to acquire it until it is.
+// Then we try the speculative acquire.
+// This means that although we suffer from lemmings a little
+// (because we can't acquire the lock speculatively until
+// the queue of threads waiting has cleared), we don't get into a
+// state where we can never acquire the lock speculatively (because we
+// force the queue to clear by preventing new arrivals from entering the
+// queue).
+// This does mean that when we're trying to break lemmings, the lock
+// is no longer fair. However OpenMP makes no guarantee that its
+// locks are fair, so this isn't a real problem.
+void
+__kmp_acquire_adaptive_lock( kmp_adaptive_lock_t *lck, kmp_int32 gtid )
+{
+    if ( __kmp_should_speculate( lck ) ) {
+        if ( __kmp_is_unlocked_queuing_lock( GET_QLK_PTR( lck ) ) ) {
+            if ( __kmp_test_adaptive_lock_only( lck, gtid ) ) {
+                return;
+            }
+            // We tried speculation and failed, so give up.
+        } else {
+            // We can't try speculation until the lock is free, so we
+            // pause here (without suspending on the queueing lock,
+            // to allow it to drain, then try again.
+            // All other threads will also see the same result for
+            // shouldSpeculate, so will be doing the same if they
+            // try to claim the lock from now on.
+            while ( ! __kmp_is_unlocked_queuing_lock( GET_QLK_PTR( lck ) ) ) {
+                KMP_INC_STAT( lck, lemming_yields );
+                __kmp_yield( TRUE );
+            }
+
+            if ( __kmp_test_adaptive_lock_only( lck, gtid ) ) {
+                return;
+            }
+        }
+    }
+
+    // Speculative acquisition failed, so acquire it non-speculatively.
+    // Count the non-speculative acquire attempt
+    lck->lk.adaptive.acquire_attempts++;
+
+    __kmp_acquire_queuing_lock_timed_template<false>( GET_QLK_PTR( lck ), gtid );
+    // We have acquired the base lock, so count that.
+    KMP_INC_STAT( lck, non_speculative_acquires );
+}
+
+static void
+__kmp_acquire_adaptive_lock_with_checks( kmp_adaptive_lock_t *lck, kmp_int32 gtid )
+{
+    if ( __kmp_env_consistency_check ) {
+        char const * const func = "omp_set_lock";
+        if ( lck->lk.qlk.initialized != GET_QLK_PTR( lck ) ) {
+            KMP_FATAL( LockIsUninitialized, func );
+        }
+        if ( __kmp_is_queuing_lock_nestable( GET_QLK_PTR( lck ) ) ) {
+            KMP_FATAL( LockNestableUsedAsSimple, func );
+        }
+        if ( __kmp_get_queuing_lock_owner( GET_QLK_PTR( lck ) ) == gtid ) {
+            KMP_FATAL( LockIsAlreadyOwned, func );
+        }
+    }
+
+    __kmp_acquire_adaptive_lock( lck, gtid );
+
+    if ( __kmp_env_consistency_check ) {
+        lck->lk.qlk.owner_id = gtid + 1;
+    }
+}
+
+void
+__kmp_release_adaptive_lock( kmp_adaptive_lock_t *lck, kmp_int32 gtid )
+{
+    if ( __kmp_is_unlocked_queuing_lock( GET_QLK_PTR( lck ) ) ) {
+        // If the lock doesn't look claimed we must be speculating.
+        // (Or the user's code is buggy and they're releasing without locking;
+        // if we had XTEST we'd be able to check that case...)
+        _xend();        // Exit speculation
+        __kmp_update_badness_after_success( lck );
+    } else {
+        // Since the lock *is* visibly locked we're not speculating,
+        // so should use the underlying lock's release scheme.
+        __kmp_release_queuing_lock( GET_QLK_PTR( lck ), gtid );
+    }
+}
+
+static void
+__kmp_release_adaptive_lock_with_checks( kmp_adaptive_lock_t *lck, kmp_int32 gtid )
+{
+    if ( __kmp_env_consistency_check ) {
+        char const * const func = "omp_unset_lock";
+        KMP_MB();  /* in case another processor initialized lock */
+        if ( lck->lk.qlk.initialized != GET_QLK_PTR( lck ) ) {
+            KMP_FATAL( LockIsUninitialized, func );
+        }
+        if ( __kmp_is_queuing_lock_nestable( GET_QLK_PTR( lck ) ) ) {
+            KMP_FATAL( LockNestableUsedAsSimple, func );
+        }
+        if ( __kmp_get_queuing_lock_owner( GET_QLK_PTR( lck ) ) == -1 ) {
+            KMP_FATAL( LockUnsettingFree, func );
+        }
+        if ( __kmp_get_queuing_lock_owner( GET_QLK_PTR( lck ) ) != gtid ) {
+            KMP_FATAL( LockUnsettingSetByAnother, func );
+        }
+        lck->lk.qlk.owner_id = 0;
+    }
+    __kmp_release_adaptive_lock( lck, gtid );
+}
+
+void
+__kmp_init_adaptive_lock( kmp_adaptive_lock_t *lck )
+{
+    __kmp_init_queuing_lock( GET_QLK_PTR( lck ) );
+    lck->lk.adaptive.badness = 0;
+    lck->lk.adaptive.acquire_attempts = 0;
+    lck->lk.adaptive.max_soft_retries = __kmp_adaptive_backoff_params.max_soft_retries;
+    lck->lk.adaptive.max_badness = __kmp_adaptive_backoff_params.max_badness;
+#if KMP_DEBUG_ADAPTIVE_LOCKS
+    __kmp_zero_speculative_stats( lck );
+#endif
+    KA_TRACE(1000, ("__kmp_init_adaptive_lock: lock %p initialized\n", lck));
+}
+
+static void
+__kmp_init_adaptive_lock_with_checks( kmp_adaptive_lock_t * lck )
+{
+    __kmp_init_adaptive_lock( lck );
+}
+
+void
+__kmp_destroy_adaptive_lock( kmp_adaptive_lock_t *lck )
+{
+#if KMP_DEBUG_ADAPTIVE_LOCKS
+    __kmp_accumulate_speculative_stats( lck );
+#endif
+    __kmp_destroy_queuing_lock( GET_QLK_PTR( lck ) );
+    // Nothing needed for the speculative part.
+}
+
+static void
+__kmp_destroy_adaptive_lock_with_checks( kmp_adaptive_lock_t *lck )
+{
+    if ( __kmp_env_consistency_check ) {
+        char const * const func = "omp_destroy_lock";
+        if ( lck->lk.qlk.initialized != GET_QLK_PTR( lck ) ) {
+            KMP_FATAL( LockIsUninitialized, func );
+        }
+        if ( __kmp_is_queuing_lock_nestable( GET_QLK_PTR( lck ) ) ) {
+            KMP_FATAL( LockNestableUsedAsSimple, func );
+        }
+        if ( __kmp_get_queuing_lock_owner( GET_QLK_PTR( lck ) ) != -1 ) {
+            KMP_FATAL( LockStillOwned, func );
+        }
+    }
+    __kmp_destroy_adaptive_lock( lck );
+}
+
+#endif // KMP_USE_ADAPTIVE_LOCKS
+
 /* ------------------------------------------------------------------------ */
 /* DRDPA ticket locks                                                */
 /* "DRDPA" means Dynamically Reconfigurable Distributed Polling Area */
@@ -1948,6 +2460,12 @@ __kmp_acquire_drdpa_lock_timed_template( kmp_drdpa_lock_t *lck, kmp_int32 gtid )
     /* else __kmp_printf( "." );*/
 #endif /* USE_LOCK_PROFILE */
 
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_ACQUIRE );
+#if KMP_STATS_ENABLED
+    if (TCR_8(polls[ticket & mask].poll) != ticket)
+        KMP_STATS_GTID_COUNT( gtid, KMP_STAT_LOCK_CONTENDED );
+#endif
+
     //
     // Now spin-wait, but reload the polls pointer and mask, in case the
     // polling area has been reconfigured.  Unless it is reconfigured, the
@@ -2162,6 +2680,17 @@ __kmp_test_drdpa_lock( kmp_drdpa_lock_t *lck, kmp_int32 gtid )
     return FALSE;
 }
 
+static int
+__kmp_try_drdpa_lock( kmp_drdpa_lock_t *lck, kmp_int32 gtid )
+{
+    int retval = __kmp_test_drdpa_lock( lck, gtid );
+
+    if ( __kmp_env_consistency_check && retval ) {
+        lck->lk.owner_id = gtid + 1;
+    }
+    return retval;
+}
+
 static int
 __kmp_test_drdpa_lock_with_checks( kmp_drdpa_lock_t *lck, kmp_int32 gtid )
 {
@@ -2175,12 +2704,7 @@ __kmp_test_drdpa_lock_with_checks( kmp_drdpa_lock_t *lck, kmp_int32 gtid )
         }
     }
 
-    int retval = __kmp_test_drdpa_lock( lck, gtid );
-
-    if ( __kmp_env_consistency_check && retval ) {
-        lck->lk.owner_id = gtid + 1;
-    }
-    return retval;
+    return __kmp_try_drdpa_lock( lck, gtid );
 }
 
 void
@@ -2488,6 +3012,7 @@ kmp_int32 ( *__kmp_get_user_lock_owner_ )( kmp_user_lock_p lck ) = NULL;
 void ( *__kmp_acquire_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_int32 gtid ) = NULL;
 
 int ( *__kmp_test_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_int32 gtid ) = NULL;
+int ( *__kmp_try_user_lock_ )( kmp_user_lock_p lck, kmp_int32 gtid ) = NULL;
 void ( *__kmp_release_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_int32 gtid ) = NULL;
 void ( *__kmp_init_user_lock_with_checks_ )( kmp_user_lock_p lck ) = NULL;
 void ( *__kmp_destroy_user_lock_ )( kmp_user_lock_p lck ) = NULL;
@@ -2495,6 +3020,7 @@ void ( *__kmp_destroy_user_lock_with_checks_ )( kmp_user_lock_p lck ) = NULL;
 void ( *__kmp_acquire_nested_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_int32 gtid ) = NULL;
 
 int ( *__kmp_test_nested_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_int32 gtid ) = NULL;
+int ( *__kmp_try_nested_user_lock_ )( kmp_user_lock_p lck, kmp_int32 gtid ) = NULL;
 void ( *__kmp_release_nested_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_int32 gtid ) = NULL;
 void ( *__kmp_init_nested_user_lock_with_checks_ )( kmp_user_lock_p lck ) = NULL;
 void ( *__kmp_destroy_nested_user_lock_with_checks_ )( kmp_user_lock_p lck ) = NULL;
@@ -2528,6 +3054,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_tas_lock_with_checks );
 
+            __kmp_try_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_tas_lock );
+
             __kmp_release_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_tas_lock_with_checks );
@@ -2552,6 +3082,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_nested_tas_lock_with_checks );
 
+            __kmp_try_nested_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_nested_tas_lock );
+
             __kmp_release_nested_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_nested_tas_lock_with_checks );
@@ -2599,6 +3133,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_futex_lock_with_checks );
 
+            __kmp_try_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_futex_lock );
+
             __kmp_release_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_futex_lock_with_checks );
@@ -2623,6 +3161,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_nested_futex_lock_with_checks );
 
+            __kmp_try_nested_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_nested_futex_lock );
+
             __kmp_release_nested_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_nested_futex_lock_with_checks );
@@ -2670,6 +3212,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_ticket_lock_with_checks );
 
+            __kmp_try_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_try_ticket_lock );
+
             __kmp_release_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_ticket_lock_with_checks );
@@ -2694,6 +3240,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_nested_ticket_lock_with_checks );
 
+            __kmp_try_nested_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_nested_ticket_lock );
+
             __kmp_release_nested_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_nested_ticket_lock_with_checks );
@@ -2744,6 +3294,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_queuing_lock_with_checks );
 
+            __kmp_try_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_try_queuing_lock );
+
             __kmp_release_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_queuing_lock_with_checks );
@@ -2768,6 +3322,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_nested_queuing_lock_with_checks );
 
+            __kmp_try_nested_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_nested_queuing_lock );
+
             __kmp_release_nested_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_nested_queuing_lock_with_checks );
@@ -2802,6 +3360,96 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
         }
         break;
 
+#if KMP_USE_ADAPTIVE_LOCKS
+        case lk_adaptive: {
+            __kmp_base_user_lock_size = sizeof( kmp_base_adaptive_lock_t );
+            __kmp_user_lock_size = sizeof( kmp_adaptive_lock_t );
+
+            __kmp_get_user_lock_owner_ =
+              ( kmp_int32 ( * )( kmp_user_lock_p ) )
+              ( &__kmp_get_queuing_lock_owner );
+
+            __kmp_acquire_user_lock_with_checks_ =
+              ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_acquire_adaptive_lock_with_checks );
+
+            __kmp_test_user_lock_with_checks_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_adaptive_lock_with_checks );
+
+            __kmp_try_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_try_adaptive_lock );
+
+            __kmp_release_user_lock_with_checks_ =
+              ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_release_adaptive_lock_with_checks );
+
+            __kmp_init_user_lock_with_checks_ =
+              ( void ( * )( kmp_user_lock_p ) )
+              ( &__kmp_init_adaptive_lock_with_checks );
+
+            __kmp_destroy_user_lock_with_checks_ =
+              ( void ( * )( kmp_user_lock_p ) )
+              ( &__kmp_destroy_adaptive_lock_with_checks );
+
+            __kmp_destroy_user_lock_ =
+              ( void ( * )( kmp_user_lock_p ) )
+              ( &__kmp_destroy_adaptive_lock );
+
+            //
+            // Nested locks do not speculate: the nesting depth and the owner
+            // have to be visible to other threads. The queuing lock is the
+            // first field of the adaptive lock, so the queuing lock routines
+            // work on it as is.
+            //
+            __kmp_acquire_nested_user_lock_with_checks_ =
+              ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_acquire_nested_queuing_lock_with_checks );
+
+            __kmp_test_nested_user_lock_with_checks_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_nested_queuing_lock_with_checks );
+
+            __kmp_try_nested_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_nested_queuing_lock );
+
+            __kmp_release_nested_user_lock_with_checks_ =
+              ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_release_nested_queuing_lock_with_checks );
+
+            __kmp_init_nested_user_lock_with_checks_ =
+              ( void ( * )( kmp_user_lock_p ) )
+              ( &__kmp_init_nested_queuing_lock_with_checks );
+
+            __kmp_destroy_nested_user_lock_with_checks_ =
+              ( void ( * )( kmp_user_lock_p ) )
+              ( &__kmp_destroy_nested_queuing_lock_with_checks );
+
+             __kmp_is_user_lock_initialized_ =
+               ( int ( * )( kmp_user_lock_p ) )
+               ( &__kmp_is_queuing_lock_initialized );
+
+             __kmp_get_user_lock_location_ =
+               ( const ident_t * ( * )( kmp_user_lock_p ) )
+               ( &__kmp_get_queuing_lock_location );
+
+             __kmp_set_user_lock_location_ =
+               ( void ( * )( kmp_user_lock_p, const ident_t * ) )
+               ( &__kmp_set_queuing_lock_location );
+
+             __kmp_get_user_lock_flags_ =
+               ( kmp_lock_flags_t ( * )( kmp_user_lock_p ) )
+               ( &__kmp_get_queuing_lock_flags );
+
+             __kmp_set_user_lock_flags_ =
+               ( void ( * )( kmp_user_lock_p, kmp_lock_flags_t ) )
+               ( &__kmp_set_queuing_lock_flags );
+        }
+        break;
+#endif // KMP_USE_ADAPTIVE_LOCKS
+
         case lk_drdpa: {
             __kmp_base_user_lock_size = sizeof( kmp_base_drdpa_lock_t );
             __kmp_user_lock_size = sizeof( kmp_drdpa_lock_t );
@@ -2818,6 +3466,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_drdpa_lock_with_checks );
 
+            __kmp_try_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_try_drdpa_lock );
+
             __kmp_release_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_drdpa_lock_with_checks );
@@ -2842,6 +3494,10 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
               ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_test_nested_drdpa_lock_with_checks );
 
+            __kmp_try_nested_user_lock_ =
+              ( int  ( * )( kmp_user_lock_p, kmp_int32 ) )
+              ( &__kmp_test_nested_drdpa_lock );
+
             __kmp_release_nested_user_lock_with_checks_ =
               ( void ( * )( kmp_user_lock_p, kmp_int32 ) )
               ( &__kmp_release_nested_drdpa_lock_with_checks );
@@ -2879,6 +3535,725 @@ void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind )
 }
 
 
+#if KMP_USE_DYNAMIC_LOCK
+
+// ----------------------------------------------------------------------------
+// Dynamic locks
+
+//
+// Lists of the lock kinds, in the order of kmp_indirect_locktag_t, used to
+// build the operation tables.
+//
+#if KMP_USE_ADAPTIVE_LOCKS
+# define KMP_FOREACH_ADAPTIVE_LOCK(m, a)        m(adaptive, a)
+#else
+# define KMP_FOREACH_ADAPTIVE_LOCK(m, a)
+#endif
+
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+# define KMP_FOREACH_D_LOCK(m, a)               m(tas, a) m(futex, a)
+# define KMP_FOREACH_NESTED_FUTEX_LOCK(m, a)    m(nested_futex, a)
+#else
+# define KMP_FOREACH_D_LOCK(m, a)               m(tas, a)
+# define KMP_FOREACH_NESTED_FUTEX_LOCK(m, a)
+#endif
+
+#define KMP_FOREACH_SIMPLE_I_LOCK(m, a)                                     \
+    m(ticket, a) m(queuing, a) m(drdpa, a) KMP_FOREACH_ADAPTIVE_LOCK(m, a)
+#define KMP_FOREACH_NESTED_I_LOCK(m, a)                                     \
+    m(nested_tas, a) KMP_FOREACH_NESTED_FUTEX_LOCK(m, a)                    \
+    m(nested_ticket, a) m(nested_queuing, a) m(nested_drdpa, a)
+#define KMP_FOREACH_I_LOCK(m, a)                                            \
+    KMP_FOREACH_SIMPLE_I_LOCK(m, a) KMP_FOREACH_NESTED_I_LOCK(m, a)
+
+kmp_dyna_lockseq_t __kmp_user_lock_seq = lockseq_queuing;
+
+//
+// Direct locks keep their kind in the lock word, so initialization is the
+// same for all of them.
+//
+static void
+__kmp_init_direct_lock( kmp_dyna_lock_t *lck, kmp_dyna_lockseq_t seq )
+{
+    TCW_4( *lck, KMP_GET_D_TAG( seq ) );
+    KA_TRACE( 20, ("__kmp_init_direct_lock: initialized direct lock %p with tag %#x\n", lck, KMP_GET_D_TAG( seq ) ) );
+}
+
+//
+// Indirect locks: entry 0 of the direct operation tables.  They find the
+// lock in the indirect lock table and dispatch on its kind.
+//
+static void
+__kmp_init_indirect_lock( kmp_dyna_lock_t *lock, kmp_dyna_lockseq_t seq )
+{
+    kmp_indirect_locktag_t tag = KMP_GET_I_TAG( seq );
+    kmp_indirect_lock_t *l = __kmp_allocate_indirect_lock( (void **)lock, __kmp_entry_gtid(), tag );
+    KMP_I_LOCK_FUNC( l, init )( l->lock );
+    KA_TRACE( 20, ("__kmp_init_indirect_lock: initialized indirect lock %p (%p) with tag %d\n", lock, l->lock, tag ) );
+}
+
+static void
+__kmp_destroy_indirect_lock( kmp_dyna_lock_t *lock )
+{
+    kmp_int32 gtid = __kmp_entry_gtid();
+    kmp_lock_index_t index = KMP_EXTRACT_I_INDEX( lock );
+    kmp_indirect_lock_t *l = __kmp_lookup_indirect_lock( (void **)lock, "omp_destroy_lock" );
+    KMP_I_LOCK_FUNC( l, destroy )( l->lock );
+    __kmp_free_indirect_lock( l, index, gtid );
+    TCW_4( *lock, 0 );
+}
+
+static void
+__kmp_set_indirect_lock( kmp_dyna_lock_t *lock, kmp_int32 gtid )
+{
+    kmp_indirect_lock_t *l = KMP_LOOKUP_I_LOCK( lock );
+    KMP_I_LOCK_FUNC( l, set )( l->lock, gtid );
+}
+
+static void
+__kmp_unset_indirect_lock( kmp_dyna_lock_t *lock, kmp_int32 gtid )
+{
+    kmp_indirect_lock_t *l = KMP_LOOKUP_I_LOCK( lock );
+    KMP_I_LOCK_FUNC( l, unset )( l->lock, gtid );
+}
+
+static int
+__kmp_test_indirect_lock( kmp_dyna_lock_t *lock, kmp_int32 gtid )
+{
+    kmp_indirect_lock_t *l = KMP_LOOKUP_I_LOCK( lock );
+    return KMP_I_LOCK_FUNC( l, test )( l->lock, gtid );
+}
+
+static void
+__kmp_set_indirect_lock_with_checks( kmp_dyna_lock_t *lock, kmp_int32 gtid )
+{
+    kmp_indirect_lock_t *l = __kmp_lookup_indirect_lock( (void **)lock, "omp_set_lock" );
+    KMP_I_LOCK_FUNC( l, set )( l->lock, gtid );
+}
+
+static void
+__kmp_unset_indirect_lock_with_checks( kmp_dyna_lock_t *lock, kmp_int32 gtid )
+{
+    kmp_indirect_lock_t *l = __kmp_lookup_indirect_lock( (void **)lock, "omp_unset_lock" );
+    KMP_I_LOCK_FUNC( l, unset )( l->lock, gtid );
+}
+
+static int
+__kmp_test_indirect_lock_with_checks( kmp_dyna_lock_t *lock, kmp_int32 gtid )
+{
+    kmp_indirect_lock_t *l = __kmp_lookup_indirect_lock( (void **)lock, "omp_test_lock" );
+    return KMP_I_LOCK_FUNC( l, test )( l->lock, gtid );
+}
+
+static int
+__kmp_try_indirect_lock( kmp_dyna_lock_t *lock, kmp_int32 gtid )
+{
+    kmp_indirect_lock_t *l = KMP_LOOKUP_I_LOCK( lock );
+    return KMP_I_LOCK_FUNC( l, try )( l->lock, gtid );
+}
+
+//
+// Direct lock operation tables.  The direct locks use their own functions
+// on the lock word, which is the poll field of kmp_tas_lock_t and
+// kmp_futex_lock_t.
+//
+#define expand_init(l, a)   __kmp_init_direct_lock,
+void ( *__kmp_direct_init_ops[] )( kmp_dyna_lock_t *, kmp_dyna_lockseq_t )
+  = { __kmp_init_indirect_lock, KMP_FOREACH_D_LOCK( expand_init, 0 ) };
+#undef expand_init
+
+#define expand_func(l, op)  ( void ( * )( kmp_dyna_lock_t * ) )__kmp_##op##_##l##_lock,
+#define expand_check(l, op) ( void ( * )( kmp_dyna_lock_t * ) )__kmp_##op##_##l##_lock_with_checks,
+static void ( *direct_destroy[] )( kmp_dyna_lock_t * )
+  = { __kmp_destroy_indirect_lock, KMP_FOREACH_D_LOCK( expand_func, destroy ) };
+static void ( *direct_destroy_check[] )( kmp_dyna_lock_t * )
+  = { __kmp_destroy_indirect_lock, KMP_FOREACH_D_LOCK( expand_check, destroy ) };
+#undef expand_func
+#undef expand_check
+
+#define expand_func(l, op)  ( void ( * )( kmp_dyna_lock_t *, kmp_int32 ) )__kmp_##op##_##l##_lock,
+#define expand_check(l, op) ( void ( * )( kmp_dyna_lock_t *, kmp_int32 ) )__kmp_##op##_##l##_lock_with_checks,
+static void ( *direct_set[] )( kmp_dyna_lock_t *, kmp_int32 )
+  = { __kmp_set_indirect_lock, KMP_FOREACH_D_LOCK( expand_func, acquire ) };
+static void ( *direct_set_check[] )( kmp_dyna_lock_t *, kmp_int32 )
+  = { __kmp_set_indirect_lock_with_checks, KMP_FOREACH_D_LOCK( expand_check, acquire ) };
+static void ( *direct_unset[] )( kmp_dyna_lock_t *, kmp_int32 )
+  = { __kmp_unset_indirect_lock, KMP_FOREACH_D_LOCK( expand_func, release ) };
+static void ( *direct_unset_check[] )( kmp_dyna_lock_t *, kmp_int32 )
+  = { __kmp_unset_indirect_lock_with_checks, KMP_FOREACH_D_LOCK( expand_check, release ) };
+#undef expand_func
+#undef expand_check
+
+#define expand_func(l, op)  ( int ( * )( kmp_dyna_lock_t *, kmp_int32 ) )__kmp_##op##_##l##_lock,
+#define expand_check(l, op) ( int ( * )( kmp_dyna_lock_t *, kmp_int32 ) )__kmp_##op##_##l##_lock_with_checks,
+static int ( *direct_test[] )( kmp_dyna_lock_t *, kmp_int32 )
+  = { __kmp_test_indirect_lock, KMP_FOREACH_D_LOCK( expand_func, test ) };
+static int ( *direct_test_check[] )( kmp_dyna_lock_t *, kmp_int32 )
+  = { __kmp_test_indirect_lock_with_checks, KMP_FOREACH_D_LOCK( expand_check, test ) };
+static int ( *direct_try[] )( kmp_dyna_lock_t *, kmp_int32 )
+  = { __kmp_try_indirect_lock, KMP_FOREACH_D_LOCK( expand_func, test ) };
+#undef expand_func
+#undef expand_check
+
+void ( **__kmp_direct_destroy_ops )( kmp_dyna_lock_t * ) = direct_destroy;
+void ( **__kmp_direct_set_ops )( kmp_dyna_lock_t *, kmp_int32 ) = direct_set;
+void ( **__kmp_direct_unset_ops )( kmp_dyna_lock_t *, kmp_int32 ) = direct_unset;
+int ( **__kmp_direct_test_ops )( kmp_dyna_lock_t *, kmp_int32 ) = direct_test;
+int ( **__kmp_direct_try_ops )( kmp_dyna_lock_t *, kmp_int32 ) = direct_try;
+
+//
+// Indirect lock operation tables, indexed by kmp_indirect_locktag_t.
+//
+#define expand_func(l, op)  ( void ( * )( kmp_user_lock_p ) )__kmp_##op##_##l##_lock,
+#define expand_check(l, op) ( void ( * )( kmp_user_lock_p ) )__kmp_##op##_##l##_lock_with_checks,
+static void ( *indirect_init[] )( kmp_user_lock_p )
+  = { KMP_FOREACH_I_LOCK( expand_func, init ) };
+static void ( *indirect_init_check[] )( kmp_user_lock_p )
+  = { KMP_FOREACH_I_LOCK( expand_check, init ) };
+static void ( *indirect_destroy[] )( kmp_user_lock_p )
+  = { KMP_FOREACH_I_LOCK( expand_func, destroy ) };
+static void ( *indirect_destroy_check[] )( kmp_user_lock_p )
+  = { KMP_FOREACH_I_LOCK( expand_check, destroy ) };
+#undef expand_func
+#undef expand_check
+
+#define expand_func(l, op)  ( void ( * )( kmp_user_lock_p, kmp_int32 ) )__kmp_##op##_##l##_lock,
+#define expand_check(l, op) ( void ( * )( kmp_user_lock_p, kmp_int32 ) )__kmp_##op##_##l##_lock_with_checks,
+static void ( *indirect_set[] )( kmp_user_lock_p, kmp_int32 )
+  = { KMP_FOREACH_I_LOCK( expand_func, acquire ) };
+static void ( *indirect_set_check[] )( kmp_user_lock_p, kmp_int32 )
+  = { KMP_FOREACH_I_LOCK( expand_check, acquire ) };
+static void ( *indirect_unset[] )( kmp_user_lock_p, kmp_int32 )
+  = { KMP_FOREACH_I_LOCK( expand_func, release ) };
+static void ( *indirect_unset_check[] )( kmp_user_lock_p, kmp_int32 )
+  = { KMP_FOREACH_I_LOCK( expand_check, release ) };
+#undef expand_func
+#undef expand_check
+
+#define expand_func(l, op)  ( int ( * )( kmp_user_lock_p, kmp_int32 ) )__kmp_##op##_##l##_lock,
+#define expand_check(l, op) ( int ( * )( kmp_user_lock_p, kmp_int32 ) )__kmp_##op##_##l##_lock_with_checks,
+static int ( *indirect_test[] )( kmp_user_lock_p, kmp_int32 )
+  = { KMP_FOREACH_I_LOCK( expand_func, test ) };
+static int ( *indirect_test_check[] )( kmp_user_lock_p, kmp_int32 )
+  = { KMP_FOREACH_I_LOCK( expand_check, test ) };
+// The nested tests keep the owner themselves; the simple ones need a try.
+static int ( *indirect_try[] )( kmp_user_lock_p, kmp_int32 )
+  = { KMP_FOREACH_SIMPLE_I_LOCK( expand_func, try ) KMP_FOREACH_NESTED_I_LOCK( expand_func, test ) };
+#undef expand_func
+#undef expand_check
+
+void ( **__kmp_indirect_init_ops )( kmp_user_lock_p ) = indirect_init;
+void ( **__kmp_indirect_destroy_ops )( kmp_user_lock_p ) = indirect_destroy;
+void ( **__kmp_indirect_set_ops )( kmp_user_lock_p, kmp_int32 ) = indirect_set;
+void ( **__kmp_indirect_unset_ops )( kmp_user_lock_p, kmp_int32 ) = indirect_unset;
+int ( **__kmp_indirect_test_ops )( kmp_user_lock_p, kmp_int32 ) = indirect_test;
+int ( **__kmp_indirect_try_ops )( kmp_user_lock_p, kmp_int32 ) = indirect_try;
+
+//
+// Access functions to the fields which exist for some lock kinds only.
+// Adaptive locks use the ones of their underlying queuing lock, nested locks
+// the ones of the simple lock of the same kind.
+//
+#if KMP_USE_ADAPTIVE_LOCKS
+# define KMP_ADAPTIVE_LOCK_FIELD_FUNC(cast, pre, field)     ( cast )__kmp_##pre##_queuing_lock_##field,
+#else
+# define KMP_ADAPTIVE_LOCK_FIELD_FUNC(cast, pre, field)
+#endif
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+# define KMP_NESTED_FUTEX_LOCK_FIELD_FUNC                   NULL,
+#else
+# define KMP_NESTED_FUTEX_LOCK_FIELD_FUNC
+#endif
+
+#define KMP_I_LOCK_FIELD_FUNCS(cast, pre, field)                                \
+    {                                                                           \
+        ( cast )__kmp_##pre##_ticket_lock_##field,                              \
+        ( cast )__kmp_##pre##_queuing_lock_##field,                             \
+        ( cast )__kmp_##pre##_drdpa_lock_##field,                               \
+        KMP_ADAPTIVE_LOCK_FIELD_FUNC( cast, pre, field )                        \
+        NULL,                                                                   \
+        KMP_NESTED_FUTEX_LOCK_FIELD_FUNC                                        \
+        ( cast )__kmp_##pre##_ticket_lock_##field,                              \
+        ( cast )__kmp_##pre##_queuing_lock_##field,                             \
+        ( cast )__kmp_##pre##_drdpa_lock_##field                                \
+    }
+
+void ( *__kmp_indirect_set_location[] )( kmp_user_lock_p, const ident_t * )
+  = KMP_I_LOCK_FIELD_FUNCS( void ( * )( kmp_user_lock_p, const ident_t * ), set, location );
+void ( *__kmp_indirect_set_flags[] )( kmp_user_lock_p, kmp_lock_flags_t )
+  = KMP_I_LOCK_FIELD_FUNCS( void ( * )( kmp_user_lock_p, kmp_lock_flags_t ), set, flags );
+const ident_t * ( *__kmp_indirect_get_location[] )( kmp_user_lock_p )
+  = KMP_I_LOCK_FIELD_FUNCS( const ident_t * ( * )( kmp_user_lock_p ), get, location );
+kmp_lock_flags_t ( *__kmp_indirect_get_flags[] )( kmp_user_lock_p )
+  = KMP_I_LOCK_FIELD_FUNCS( kmp_lock_flags_t ( * )( kmp_user_lock_p ), get, flags );
+int ( *__kmp_indirect_is_initialized[] )( kmp_user_lock_p )
+  = KMP_I_LOCK_FIELD_FUNCS( int ( * )( kmp_user_lock_p ), is, initialized );
+
+#undef KMP_I_LOCK_FIELD_FUNCS
+#undef KMP_NESTED_FUTEX_LOCK_FIELD_FUNC
+#undef KMP_ADAPTIVE_LOCK_FIELD_FUNC
+
+//
+// Sizes of the indirect locks, and lists of free ones for reuse.  A free lock
+// keeps the index of the next one in its pool.index field; 0 ends the list.
+//
+static size_t __kmp_indirect_lock_size[ KMP_NUM_I_LOCKS ] = {
+    sizeof( kmp_ticket_lock_t ),
+    sizeof( kmp_queuing_lock_t ),
+    sizeof( kmp_drdpa_lock_t ),
+#if KMP_USE_ADAPTIVE_LOCKS
+    sizeof( kmp_adaptive_lock_t ),
+#endif
+    sizeof( kmp_tas_lock_t ),
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+    sizeof( kmp_futex_lock_t ),
+#endif
+    sizeof( kmp_ticket_lock_t ),
+    sizeof( kmp_queuing_lock_t ),
+    sizeof( kmp_drdpa_lock_t )
+};
+
+static kmp_lock_index_t __kmp_indirect_lock_pool[ KMP_NUM_I_LOCKS ] = { 0 };
+
+kmp_indirect_lock_table_t __kmp_i_lock_table = { NULL, 0, 1 };
+
+//
+// Get a table entry and the memory for an indirect lock of the given kind,
+// and store its index into the lock word.  The lock itself is not
+// initialized.
+//
+kmp_indirect_lock_t *
+__kmp_allocate_indirect_lock( void **user_lock, kmp_int32 gtid, kmp_indirect_locktag_t tag )
+{
+    kmp_indirect_lock_t *lck;
+    kmp_lock_index_t index;
+
+    KMP_DEBUG_ASSERT( user_lock != NULL );
+    KMP_DEBUG_ASSERT( 0 <= tag && tag < KMP_NUM_I_LOCKS );
+
+    __kmp_acquire_lock( &__kmp_global_lock, gtid );
+
+    if ( __kmp_indirect_lock_pool[ tag ] != 0 ) {
+        // Reuse a lock of the same kind, and its table entry.
+        index = __kmp_indirect_lock_pool[ tag ];
+        lck = KMP_GET_I_LOCK( index );
+        __kmp_indirect_lock_pool[ tag ] = lck->lock->pool.index;
+        lck->lock->pool.index = 0;
+        KA_TRACE( 20, ("__kmp_allocate_indirect_lock: reusing lock %d (%p) of kind %d\n", index, lck->lock, tag ) );
+    }
+    else {
+        index = __kmp_i_lock_table.next;
+        if ( index >= __kmp_i_lock_table.size * KMP_I_LOCK_CHUNK ) {
+            //
+            // Add rows to the table.  Existing rows are kept, so the table
+            // entries do not move; the old row array is linked from the new
+            // one since other threads may still be reading it.
+            //
+            kmp_lock_index_t size = ( __kmp_i_lock_table.size == 0 ) ? 1 : 2 * __kmp_i_lock_table.size;
+            kmp_indirect_lock_t **table = (kmp_indirect_lock_t **)
+              __kmp_allocate( ( 1 + size ) * sizeof( kmp_indirect_lock_t * ) );
+            kmp_lock_index_t row;
+            if ( __kmp_i_lock_table.size > 0 ) {
+                memcpy( table + 1, __kmp_i_lock_table.table + 1,
+                  __kmp_i_lock_table.size * sizeof( kmp_indirect_lock_t * ) );
+            }
+            for ( row = __kmp_i_lock_table.size; row < size; ++ row ) {
+                table[ 1 + row ] = (kmp_indirect_lock_t *)
+                  __kmp_allocate( KMP_I_LOCK_CHUNK * sizeof( kmp_indirect_lock_t ) );
+            }
+            table[ 0 ] = (kmp_indirect_lock_t *)__kmp_i_lock_table.table;
+            KMP_MB();
+            __kmp_i_lock_table.table = table;
+            __kmp_i_lock_table.size = size;
+        }
+        lck = KMP_GET_I_LOCK( index );
+        lck->lock = (kmp_user_lock_p)__kmp_allocate( __kmp_indirect_lock_size[ tag ] );
+        __kmp_i_lock_table.next = index + 1;
+        KA_TRACE( 20, ("__kmp_allocate_indirect_lock: allocated lock %d (%p) of kind %d\n", index, lck->lock, tag ) );
+    }
+    lck->type = tag;
+
+    __kmp_release_lock( &__kmp_global_lock, gtid );
+
+    // The index is shifted to keep the lock word even; see KMP_EXTRACT_D_TAG.
+    * ( (kmp_lock_index_t *)user_lock ) = index << 1;
+
+    return lck;
+}
+
+//
+// Put the lock into the pool of its kind.  The lock must be destroyed.
+//
+void
+__kmp_free_indirect_lock( kmp_indirect_lock_t *lck, kmp_lock_index_t index, kmp_int32 gtid )
+{
+    KMP_DEBUG_ASSERT( lck != NULL && lck == KMP_GET_I_LOCK( index ) );
+
+    __kmp_acquire_lock( &__kmp_global_lock, gtid );
+
+    lck->lock->pool.next = NULL;
+    lck->lock->pool.index = __kmp_indirect_lock_pool[ lck->type ];
+    __kmp_indirect_lock_pool[ lck->type ] = index;
+
+    __kmp_release_lock( &__kmp_global_lock, gtid );
+}
+
+kmp_indirect_lock_t *
+__kmp_lookup_indirect_lock( void **user_lock, const char *func )
+{
+    if ( __kmp_env_consistency_check ) {
+        kmp_indirect_lock_t *lck = NULL;
+        kmp_lock_index_t index;
+        if ( user_lock == NULL ) {
+            KMP_FATAL( LockIsUninitialized, func );
+        }
+        index = KMP_EXTRACT_I_INDEX( user_lock );
+        if ( ( *(kmp_dyna_lock_t *)user_lock & 1 ) || ! ( 0 < index && index < __kmp_i_lock_table.next ) ) {
+            KMP_FATAL( LockIsUninitialized, func );
+        }
+        lck = KMP_GET_I_LOCK( index );
+        if ( lck->lock == NULL ) {
+            KMP_FATAL( LockIsUninitialized, func );
+        }
+        return lck;
+    }
+    return KMP_LOOKUP_I_LOCK( user_lock );
+}
+
+//
+// Set up the operation tables and the lock kind of locks initialized without
+// a hint.  Called after the settings are read.
+//
+void
+__kmp_init_dynamic_user_locks( void )
+{
+    if ( __kmp_env_consistency_check ) {
+        __kmp_direct_destroy_ops = direct_destroy_check;
+        __kmp_direct_set_ops = direct_set_check;
+        __kmp_direct_unset_ops = direct_unset_check;
+        __kmp_direct_test_ops = direct_test_check;
+        __kmp_indirect_init_ops = indirect_init_check;
+        __kmp_indirect_destroy_ops = indirect_destroy_check;
+        __kmp_indirect_set_ops = indirect_set_check;
+        __kmp_indirect_unset_ops = indirect_unset_check;
+        __kmp_indirect_test_ops = indirect_test_check;
+    }
+    else {
+        __kmp_direct_destroy_ops = direct_destroy;
+        __kmp_direct_set_ops = direct_set;
+        __kmp_direct_unset_ops = direct_unset;
+        __kmp_direct_test_ops = direct_test;
+        __kmp_indirect_init_ops = indirect_init;
+        __kmp_indirect_destroy_ops = indirect_destroy;
+        __kmp_indirect_set_ops = indirect_set;
+        __kmp_indirect_unset_ops = indirect_unset;
+        __kmp_indirect_test_ops = indirect_test;
+    }
+
+    switch ( __kmp_user_lock_kind ) {
+        case lk_tas:
+            __kmp_user_lock_seq = lockseq_tas;
+            break;
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+        case lk_futex:
+            __kmp_user_lock_seq = lockseq_futex;
+            break;
+#endif
+        case lk_ticket:
+            __kmp_user_lock_seq = lockseq_ticket;
+            break;
+        case lk_drdpa:
+            __kmp_user_lock_seq = lockseq_drdpa;
+            break;
+#if KMP_USE_ADAPTIVE_LOCKS
+        case lk_adaptive:
+            __kmp_user_lock_seq = lockseq_adaptive;
+            break;
+#endif
+        default:
+            __kmp_user_lock_seq = lockseq_queuing;
+            break;
+    }
+    KA_TRACE( 10, ("__kmp_init_dynamic_user_locks: default lock sequence %d\n", __kmp_user_lock_seq ) );
+}
+
+kmp_int32
+__kmp_get_dyna_lock_owner( kmp_user_lock_p lck, kmp_dyna_lockseq_t seq )
+{
+    switch ( seq ) {
+        case lockseq_tas:
+        case lockseq_nested_tas:
+            return __kmp_get_tas_lock_owner( (kmp_tas_lock_t *)lck );
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+        case lockseq_futex:
+        case lockseq_nested_futex:
+            return __kmp_get_futex_lock_owner( (kmp_futex_lock_t *)lck );
+#endif
+        case lockseq_ticket:
+        case lockseq_nested_ticket:
+            return __kmp_get_ticket_lock_owner( (kmp_ticket_lock_t *)lck );
+        case lockseq_queuing:
+        case lockseq_nested_queuing:
+#if KMP_USE_ADAPTIVE_LOCKS
+        case lockseq_adaptive:
+#endif
+            return __kmp_get_queuing_lock_owner( (kmp_queuing_lock_t *)lck );
+        case lockseq_drdpa:
+        case lockseq_nested_drdpa:
+            return __kmp_get_drdpa_lock_owner( (kmp_drdpa_lock_t *)lck );
+        default:
+            return -1;
+    }
+}
+
+//
+// Destroy and free all indirect locks, and the table.  Locks in the pools
+// are not initialized any more, the is_initialized check skips them.
+//
+void
+__kmp_cleanup_indirect_user_locks( void )
+{
+    kmp_lock_index_t index;
+
+    for ( index = 1; index < __kmp_i_lock_table.next; ++ index ) {
+        kmp_indirect_lock_t *l = KMP_GET_I_LOCK( index );
+        kmp_user_lock_p lck = l->lock;
+        const ident_t *loc;
+
+        if ( lck == NULL ) {
+            continue;
+        }
+        if ( ( __kmp_indirect_is_initialized[ l->type ] != NULL ) &&
+          __kmp_indirect_is_initialized[ l->type ]( lck ) ) {
+            //
+            // Same warning as for the lock table locks: the user is not
+            // responsible for destroying critical sections.
+            //
+            if ( __kmp_env_consistency_check &&
+              ! ( __kmp_indirect_get_flags[ l->type ]( lck ) & kmp_lf_critical_section ) &&
+              ( ( loc = __kmp_indirect_get_location[ l->type ]( lck ) ) != NULL ) &&
+              ( loc->psource != NULL ) ) {
+                kmp_str_loc_t str_loc = __kmp_str_loc_init( loc->psource, 0 );
+                KMP_WARNING( CnsLockNotDestroyed, str_loc.file, str_loc.func,
+                  str_loc.line, str_loc.col );
+                __kmp_str_loc_free( &str_loc );
+            }
+            KA_TRACE( 20, ("__kmp_cleanup_indirect_user_locks: free lock %d (%p) of kind %d\n", index, lck, l->type ) );
+            __kmp_indirect_destroy_ops[ l->type ]( lck );
+        }
+        __kmp_free( lck );
+        l->lock = NULL;
+    }
+
+    //
+    // Free the rows, then the row arrays.  All row arrays share the rows of
+    // the latest one.
+    //
+    kmp_indirect_lock_t **table = __kmp_i_lock_table.table;
+    kmp_lock_index_t row;
+    for ( row = 0; row < __kmp_i_lock_table.size; ++ row ) {
+        __kmp_free( table[ 1 + row ] );
+    }
+    while ( table != NULL ) {
+        kmp_indirect_lock_t **prev = (kmp_indirect_lock_t **)table[ 0 ];
+        __kmp_free( table );
+        table = prev;
+    }
+    __kmp_i_lock_table.table = NULL;
+    __kmp_i_lock_table.size = 0;
+    __kmp_i_lock_table.next = 1;
+    for ( row = 0; row < KMP_NUM_I_LOCKS; ++ row ) {
+        __kmp_indirect_lock_pool[ row ] = 0;
+    }
+}
+
+#undef KMP_FOREACH_I_LOCK
+#undef KMP_FOREACH_NESTED_FUTEX_LOCK
+#undef KMP_FOREACH_D_LOCK
+#undef KMP_FOREACH_ADAPTIVE_LOCK
+
+#endif // KMP_USE_DYNAMIC_LOCK
+
+// ----------------------------------------------------------------------------
+// Lock contention profile (KMP_LOCK_PROFILE)
+
+int __kmp_lock_profile = FALSE;
+
+#define KMP_LOCK_PROFILE_BUCKETS    1024        // must be a power of 2
+#define KMP_LOCK_PROFILE_REPORT     20          // sites listed at shutdown
+
+//
+// Records are added with a compare-and-swap on the bucket head and stay
+// until the report, so lookups take no lock.
+//
+static kmp_lock_profile_t * volatile __kmp_lock_profile_table[ KMP_LOCK_PROFILE_BUCKETS ];
+
+static kmp_lock_profile_t *
+__kmp_lock_profile_find( const ident_t *loc, void *lock, char const *func )
+{
+    kmp_uintptr_t key = ( loc != NULL ) ? (kmp_uintptr_t)loc : (kmp_uintptr_t)lock;
+    kmp_lock_profile_t * volatile *bucket
+      = & __kmp_lock_profile_table[ ( ( key >> 3 ) ^ ( key >> 13 ) ) & ( KMP_LOCK_PROFILE_BUCKETS - 1 ) ];
+    kmp_lock_profile_t *prof = NULL;
+
+    for ( ;; ) {
+        kmp_lock_profile_t *head = (kmp_lock_profile_t *)TCR_PTR( *bucket );
+        kmp_lock_profile_t *p;
+        for ( p = head; p != NULL; p = p->next ) {
+            if ( ( p->loc == loc ) && ( loc != NULL || p->lock == lock ) ) {
+                if ( prof != NULL ) {
+                    __kmp_free( prof );     // another thread added the site first
+                }
+                return p;
+            }
+        }
+        if ( prof == NULL ) {
+            prof = (kmp_lock_profile_t *)__kmp_allocate( sizeof( kmp_lock_profile_t ) );
+            prof->loc = loc;
+            prof->lock = lock;
+            prof->func = func;
+        }
+        prof->next = head;
+        if ( KMP_COMPARE_AND_STORE_PTR( bucket, head, prof ) ) {
+            return prof;
+        }
+    }
+}
+
+//
+// Called after the lock was acquired; start is the timestamp taken before
+// the thread tried to get it.  Locks acquired at one site may be different
+// locks held by several threads at once, so the counters are updated
+// atomically.
+//
+void
+__kmp_lock_profile_acquired( kmp_int32 gtid, const ident_t *loc, void *lock, char const *func,
+  kmp_uint64 start, int contended )
+{
+    kmp_lock_profile_t *prof = __kmp_lock_profile_find( loc, lock, func );
+    kmp_uint64 now = __kmp_hardware_timestamp();
+    int i;
+
+    KMP_TEST_THEN_INC64( (volatile kmp_int64 *) & prof->acquires );
+    if ( contended ) {
+        kmp_uint64 wait = now - start;
+        kmp_uint64 max;
+        KMP_TEST_THEN_INC64( (volatile kmp_int64 *) & prof->contended );
+        KMP_TEST_THEN_ADD64( (volatile kmp_int64 *) & prof->wait_ticks, wait );
+        while ( ( max = TCR_8( prof->max_wait_ticks ) ) < wait ) {
+            if ( KMP_COMPARE_AND_STORE_ACQ64( (volatile kmp_int64 *) & prof->max_wait_ticks, max, wait ) ) {
+                break;
+            }
+        }
+    }
+
+    if ( gtid < 0 ) {
+        return;
+    }
+    kmp_lock_held_t *held = __kmp_threads[ gtid ]->th.th_lock_held;
+    for ( i = 0; i < KMP_LOCK_PROFILE_HELD; ++ i ) {
+        if ( held[ i ].lh_lock == NULL ) {
+            held[ i ].lh_lock = lock;
+            held[ i ].lh_prof = prof;
+            held[ i ].lh_start = now;
+            break;
+        }
+    }
+    // If the thread holds too many locks this hold is not timed.
+}
+
+//
+// Called before the lock is released.  A nested lock may have several
+// entries; which one is taken does not change the total hold time.
+//
+void
+__kmp_lock_profile_released( kmp_int32 gtid, void *lock )
+{
+    kmp_lock_held_t *held;
+    int i;
+
+    if ( gtid < 0 ) {
+        return;
+    }
+    held = __kmp_threads[ gtid ]->th.th_lock_held;
+    for ( i = 0; i < KMP_LOCK_PROFILE_HELD; ++ i ) {
+        if ( held[ i ].lh_lock == lock ) {
+            kmp_lock_profile_t *prof = held[ i ].lh_prof;
+            KMP_TEST_THEN_INC64( (volatile kmp_int64 *) & prof->holds );
+            KMP_TEST_THEN_ADD64( (volatile kmp_int64 *) & prof->hold_ticks, __kmp_hardware_timestamp() - held[ i ].lh_start );
+            held[ i ].lh_lock = NULL;
+            return;
+        }
+    }
+}
+
+static int
+__kmp_lock_profile_compare( const void *a, const void *b )
+{
+    kmp_uint64 wa = ( * (kmp_lock_profile_t * const *)a )->wait_ticks;
+    kmp_uint64 wb = ( * (kmp_lock_profile_t * const *)b )->wait_ticks;
+    return ( wa < wb ) ? 1 : ( wa > wb ) ? -1 : 0;
+}
+
+//
+// List the sites with the longest total wait, then free the records.
+// Times are in timestamp ticks (cycles on x86).
+//
+void
+__kmp_lock_profile_output( void )
+{
+    kmp_lock_profile_t **sites;
+    kmp_lock_profile_t *prof;
+    int count = 0;
+    int i;
+
+    for ( i = 0; i < KMP_LOCK_PROFILE_BUCKETS; ++ i ) {
+        for ( prof = __kmp_lock_profile_table[ i ]; prof != NULL; prof = prof->next ) {
+            ++ count;
+        }
+    }
+    if ( count == 0 ) {
+        return;
+    }
+
+    sites = (kmp_lock_profile_t **)__kmp_allocate( count * sizeof( kmp_lock_profile_t * ) );
+    count = 0;
+    for ( i = 0; i < KMP_LOCK_PROFILE_BUCKETS; ++ i ) {
+        for ( prof = __kmp_lock_profile_table[ i ]; prof != NULL; prof = prof->next ) {
+            sites[ count ++ ] = prof;
+        }
+        __kmp_lock_profile_table[ i ] = NULL;
+    }
+    qsort( sites, count, sizeof( kmp_lock_profile_t * ), __kmp_lock_profile_compare );
+
+    __kmp_printf( "\nOMP: Lock contention profile: %d sites, times in ticks\n", count );
+    __kmp_printf( "%12s %12s %16s %14s %14s  %-18s %s\n", "acquires", "contended", "wait",
+      "max_wait", "avg_hold", "call", "location" );
+    for ( i = 0; i < count; ++ i ) {
+        prof = sites[ i ];
+        if ( i < KMP_LOCK_PROFILE_REPORT ) {
+            __kmp_printf( "%12llu %12llu %16llu %14llu %14llu  %-18s ",
+              (unsigned long long) prof->acquires, (unsigned long long) prof->contended,
+              (unsigned long long) prof->wait_ticks, (unsigned long long) prof->max_wait_ticks,
+              (unsigned long long)( prof->holds ? prof->hold_ticks / prof->holds : 0 ), prof->func );
+            if ( prof->loc != NULL && prof->loc->psource != NULL ) {
+                kmp_str_loc_t loc = __kmp_str_loc_init( prof->loc->psource, 0 );
+                __kmp_printf( "%s:%d %s\n", loc.file ? loc.file : "?", loc.line, loc.func ? loc.func : "?" );
+                __kmp_str_loc_free( & loc );
+            }
+            else {
+                __kmp_printf( "lock %p\n", prof->lock );
+            }
+        }
+        __kmp_free( prof );
+    }
+    if ( count > KMP_LOCK_PROFILE_REPORT ) {
+        __kmp_printf( "(%d sites with less wait not listed)\n", count - KMP_LOCK_PROFILE_REPORT );
+    }
+    __kmp_printf( "\n" );
+    __kmp_free( sites );
+}
+
 // ----------------------------------------------------------------------------
 // User lock table & lock allocation
 
@@ -3062,6 +4437,10 @@ __kmp_lookup_user_lock( void **user_lock, char const *func )
 void
 __kmp_cleanup_user_locks( void )
 {
+#if KMP_USE_DYNAMIC_LOCK
+    __kmp_cleanup_indirect_user_locks();
+#endif
+
     //
     // Reset lock pool. Do not worry about lock in the pool -- we will free
     // them when iterating through lock table (it includes all the locks,
@@ -3186,6 +4565,10 @@ __kmp_cleanup_user_locks( void )
 	block_ptr = next;
     }
 
+#if KMP_USE_ADAPTIVE_LOCKS && KMP_DEBUG_ADAPTIVE_LOCKS
+    __kmp_print_speculative_stats();
+#endif
+
     TCW_4(__kmp_init_user_locks, FALSE);
 }
 
@@ -99,6 +99,122 @@ typedef struct ident ident_t;
 #define OMP_CRITICAL_SIZE       sizeof(void *)
 #define INTEL_CRITICAL_SIZE     32
 
+//
+// With dynamic locks every user lock and critical section carries its own
+// lock kind (see "Dynamic locks" below), so the kind can be chosen per lock,
+// e.g. by the hint given to omp_init_lock_with_hint().  Build with
+// -DKMP_USE_DYNAMIC_LOCK=0 to use the single lock kind selected by
+// KMP_LOCK_KIND for all user locks instead.
+//
+#ifndef KMP_USE_DYNAMIC_LOCK
+# define KMP_USE_DYNAMIC_LOCK   1
+#endif
+
+//
+// Adaptive (RTM speculative) locks, see "Adaptive locks" below.  The
+// instructions are emitted as raw bytes, so the lock kind is available on
+// any x86 Linux* OS / OS X* build; on processors without RTM support
+// KMP_LOCK_KIND=adaptive degrades to queuing locks.
+//
+#if ( KMP_ARCH_X86 || KMP_ARCH_X86_64 ) && ! KMP_OS_WINDOWS && ! KMP_MIC
+# define KMP_USE_ADAPTIVE_LOCKS 1
+#else
+# define KMP_USE_ADAPTIVE_LOCKS 0
+#endif
+
+//
+// Lock kinds and lock word encoding of dynamic locks.  They are needed by the
+// direct lock implementations below, the rest is in "Dynamic locks".
+//
+#if KMP_USE_DYNAMIC_LOCK
+
+typedef kmp_uint32 kmp_dyna_lock_t;
+
+//
+// Lock sequences: all lock kinds available to user locks.  The direct ones
+// must come first, the order of the indirect ones must match
+// kmp_indirect_locktag_t.
+//
+enum kmp_dyna_lockseq {
+    lockseq_indirect = 0,
+    lockseq_tas,
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+    lockseq_futex,
+#endif
+    lockseq_ticket,
+    lockseq_queuing,
+    lockseq_drdpa,
+#if KMP_USE_ADAPTIVE_LOCKS
+    lockseq_adaptive,
+#endif
+    lockseq_nested_tas,
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+    lockseq_nested_futex,
+#endif
+    lockseq_nested_ticket,
+    lockseq_nested_queuing,
+    lockseq_nested_drdpa
+};
+
+typedef enum kmp_dyna_lockseq kmp_dyna_lockseq_t;
+
+#define KMP_FIRST_I_LOCK        lockseq_ticket
+#define KMP_LAST_I_LOCK         lockseq_nested_drdpa
+#define KMP_NUM_D_LOCKS         KMP_FIRST_I_LOCK       // including lockseq_indirect
+#define KMP_NUM_I_LOCKS         ( KMP_LAST_I_LOCK - KMP_FIRST_I_LOCK + 1 )
+
+#define KMP_IS_D_LOCK(seq)      ( ( seq ) > lockseq_indirect && ( seq ) < KMP_FIRST_I_LOCK )
+#define KMP_IS_I_LOCK(seq)      ( ( seq ) >= KMP_FIRST_I_LOCK && ( seq ) <= KMP_LAST_I_LOCK )
+
+#define KMP_GET_D_TAG(seq)      ( ( ( seq ) << 1 ) | 1 )
+#define KMP_GET_I_TAG(seq)      ( (kmp_indirect_locktag_t)( ( seq ) - KMP_FIRST_I_LOCK ) )
+
+// Tags of direct locks, kept in the low byte of the lock word.
+enum kmp_direct_locktag {
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+    locktag_futex = KMP_GET_D_TAG( lockseq_futex ),
+#endif
+    locktag_tas   = KMP_GET_D_TAG( lockseq_tas )
+};
+
+typedef enum kmp_direct_locktag kmp_direct_locktag_t;
+
+// Tags of indirect locks, kept in the indirect lock table.
+enum kmp_indirect_locktag {
+    locktag_ticket = 0,
+    locktag_queuing,
+    locktag_drdpa,
+#if KMP_USE_ADAPTIVE_LOCKS
+    locktag_adaptive,
+#endif
+    locktag_nested_tas,
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+    locktag_nested_futex,
+#endif
+    locktag_nested_ticket,
+    locktag_nested_queuing,
+    locktag_nested_drdpa
+};
+
+typedef enum kmp_indirect_locktag kmp_indirect_locktag_t;
+
+//
+// Lock word values of direct locks.  The lock state is kept above the tag,
+// e.g. a held test and set lock is KMP_LOCK_BUSY( gtid + 1, tas ).
+//
+#define KMP_LOCK_SHIFT          8
+#define KMP_LOCK_FREE(type)     ( locktag_##type )
+#define KMP_LOCK_BUSY(v, type)  ( ( ( v ) << KMP_LOCK_SHIFT ) | locktag_##type )
+#define KMP_LOCK_STRIP(v)       ( ( v ) >> KMP_LOCK_SHIFT )
+
+#else // KMP_USE_DYNAMIC_LOCK
+
+#define KMP_LOCK_FREE(type)     0
+#define KMP_LOCK_BUSY(v, type)  ( v )
+#define KMP_LOCK_STRIP(v)       ( v )
+
+#endif // KMP_USE_DYNAMIC_LOCK
+
 //
 // lock flags
 //
@@ -128,13 +244,14 @@ extern void __kmp_validate_locks( void );
 
 // ----------------------------------------------------------------------------
 //
-//  There are 5 lock implementations:
+//  There are 6 lock implementations:
 //
 //       1. Test and set locks.
 //       2. futex locks (Linux* OS on x86 and Intel(R) Many Integrated Core architecture)
 //       3. Ticket (Lamport bakery) locks.
 //       4. Queuing locks (with separate spin fields).
 //       5. DRPA (Dynamically Reconfigurable Distributed Polling Area) locks
+//       6. Adaptive locks (speculative RTM transactions over a queuing lock, x86 only)
 //
 //   and 3 lock purposes:
 //
@@ -188,7 +305,7 @@ typedef union kmp_tas_lock kmp_tas_lock_t;
 // Static initializer for test and set lock variables. Usage:
 //    kmp_tas_lock_t xlock = KMP_TAS_LOCK_INITIALIZER( xlock );
 //
-#define KMP_TAS_LOCK_INITIALIZER( lock ) { { 0, 0 } }
+#define KMP_TAS_LOCK_INITIALIZER( lock ) { { KMP_LOCK_FREE( tas ), 0 } }
 
 extern void __kmp_acquire_tas_lock( kmp_tas_lock_t *lck, kmp_int32 gtid );
 extern int __kmp_test_tas_lock( kmp_tas_lock_t *lck, kmp_int32 gtid );
@@ -239,7 +356,7 @@ typedef union kmp_futex_lock kmp_futex_lock_t;
 // Static initializer for futex lock variables. Usage:
 //    kmp_futex_lock_t xlock = KMP_FUTEX_LOCK_INITIALIZER( xlock );
 //
-#define KMP_FUTEX_LOCK_INITIALIZER( lock ) { { 0, 0 } }
+#define KMP_FUTEX_LOCK_INITIALIZER( lock ) { { KMP_LOCK_FREE( futex ), 0 } }
 
 extern void __kmp_acquire_futex_lock( kmp_futex_lock_t *lck, kmp_int32 gtid );
 extern int __kmp_test_futex_lock( kmp_futex_lock_t *lck, kmp_int32 gtid );
@@ -355,6 +472,102 @@ extern void __kmp_init_nested_queuing_lock( kmp_queuing_lock_t *lck );
 extern void __kmp_destroy_nested_queuing_lock( kmp_queuing_lock_t *lck );
 
 
+// ----------------------------------------------------------------------------
+// Adaptive locks.
+// ----------------------------------------------------------------------------
+
+//
+// An adaptive lock first tries to execute the critical section as a hardware
+// (RTM) transaction which only reads the queuing lock, so threads touching
+// disjoint data run concurrently. If speculation keeps failing, it falls back
+// to acquiring the underlying queuing lock, and backs off from speculating on
+// that lock for an exponentially growing number of acquisitions.
+//
+// KMP_USE_ADAPTIVE_LOCKS is defined at the top of this file.
+//
+
+#if KMP_USE_ADAPTIVE_LOCKS
+
+//
+// Build with -DKMP_DEBUG_ADAPTIVE_LOCKS=1 to keep per-lock speculation
+// statistics. They are printed when a lock is destroyed, and totals are
+// printed at library shutdown.
+//
+#ifndef KMP_DEBUG_ADAPTIVE_LOCKS
+# define KMP_DEBUG_ADAPTIVE_LOCKS 0
+#endif
+
+struct kmp_adaptive_lock_statistics {
+    kmp_uint32 successful_speculations;
+    kmp_uint32 hard_failed_speculations;   // aborts not worth retrying (capacity, nesting, ...)
+    kmp_uint32 soft_failed_speculations;   // aborts caused by conflicts or a held lock
+    kmp_uint32 non_speculative_acquires;
+    kmp_uint32 lemming_yields;             // waits for the lock to drain before speculating
+};
+
+typedef struct kmp_adaptive_lock_statistics kmp_adaptive_lock_statistics_t;
+
+extern void __kmp_print_speculative_stats( void );
+
+struct kmp_adaptive_lock_info {
+    //
+    // Values used for adaptivity. They are not updated atomically: a lost
+    // update only affects the decision whether to speculate on the lock.
+    //
+    kmp_uint32 volatile badness;
+    kmp_uint32 volatile acquire_attempts;
+
+    // Parameters of the lock.
+    kmp_uint32          max_badness;
+    kmp_uint32          max_soft_retries;
+
+#if KMP_DEBUG_ADAPTIVE_LOCKS
+    kmp_adaptive_lock_statistics_t volatile stats;
+#endif
+};
+
+typedef struct kmp_adaptive_lock_info kmp_adaptive_lock_info_t;
+
+struct kmp_base_adaptive_lock {
+    kmp_base_queuing_lock_t qlk;      // Must be first: the lock is also used as a queuing lock.
+
+    //
+    // Kept on a separate cache line, so updating it does not abort the
+    // transactions which have the queuing lock in their read set.
+    //
+    KMP_ALIGN( CACHE_LINE )
+    kmp_adaptive_lock_info_t adaptive;
+};
+
+typedef struct kmp_base_adaptive_lock kmp_base_adaptive_lock_t;
+
+union KMP_ALIGN_CACHE kmp_adaptive_lock {
+    kmp_base_adaptive_lock_t lk;
+    kmp_lock_pool_t pool;
+    double lk_align;
+    char lk_pad[ KMP_PAD( kmp_base_adaptive_lock_t, CACHE_LINE ) ];
+};
+
+typedef union kmp_adaptive_lock kmp_adaptive_lock_t;
+
+struct kmp_adaptive_backoff_params {
+    kmp_uint32 max_soft_retries;   // Transaction retries after a soft abort.
+    kmp_uint32 max_badness;        // Bounds how rarely a failing lock is retried speculatively.
+};
+
+typedef struct kmp_adaptive_backoff_params kmp_adaptive_backoff_params_t;
+
+extern kmp_adaptive_backoff_params_t __kmp_adaptive_backoff_params;
+
+extern void __kmp_acquire_adaptive_lock( kmp_adaptive_lock_t *lck, kmp_int32 gtid );
+extern int __kmp_test_adaptive_lock( kmp_adaptive_lock_t *lck, kmp_int32 gtid );
+extern void __kmp_release_adaptive_lock( kmp_adaptive_lock_t *lck, kmp_int32 gtid );
+extern void __kmp_init_adaptive_lock( kmp_adaptive_lock_t *lck );
+extern void __kmp_destroy_adaptive_lock( kmp_adaptive_lock_t *lck );
+
+#endif // KMP_USE_ADAPTIVE_LOCKS
+
+
 // ----------------------------------------------------------------------------
 // DRDPA ticket locks.
 // ----------------------------------------------------------------------------
@@ -550,7 +763,10 @@ enum kmp_lock_kind {
 #endif
     lk_ticket,
     lk_queuing,
-    lk_drdpa
+    lk_drdpa,
+#if KMP_USE_ADAPTIVE_LOCKS
+    lk_adaptive
+#endif
 };
 
 typedef enum kmp_lock_kind kmp_lock_kind_t;
@@ -565,6 +781,9 @@ union kmp_user_lock {
     kmp_ticket_lock_t  ticket;
     kmp_queuing_lock_t queuing;
     kmp_drdpa_lock_t   drdpa;
+#if KMP_USE_ADAPTIVE_LOCKS
+    kmp_adaptive_lock_t adaptive;
+#endif
     kmp_lock_pool_t    pool;
 };
 
@@ -597,11 +816,12 @@ extern void ( *__kmp_acquire_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_
                 && lck->tas.lk.depth_locked != -1 ) {                                           \
                 KMP_FATAL( LockNestableUsedAsSimple, func );                                    \
             }                                                                                   \
-            if ( ( gtid >= 0 ) && ( lck->tas.lk.poll - 1 == gtid ) ) {                          \
+            if ( ( gtid >= 0 ) && ( KMP_LOCK_STRIP( lck->tas.lk.poll ) - 1 == gtid ) ) {        \
                 KMP_FATAL( LockIsAlreadyOwned, func );                                          \
             }                                                                                   \
         }                                                                                       \
-        if ( __sync_val_compare_and_swap( &(lck->tas.lk.poll), 0, gtid + 1 ) ) {                \
+        if ( __sync_val_compare_and_swap( &(lck->tas.lk.poll), KMP_LOCK_FREE( tas ),            \
+          KMP_LOCK_BUSY( gtid + 1, tas ) ) != KMP_LOCK_FREE( tas ) ) {                          \
             kmp_uint32 spins;                                                                   \
             KMP_FSYNC_PREPARE( lck );                                                           \
             KMP_INIT_YIELD( spins );                                                            \
@@ -610,7 +830,8 @@ extern void ( *__kmp_acquire_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_
             } else {                                                                            \
                 KMP_YIELD_SPIN( spins );                                                        \
             }                                                                                   \
-            while ( __sync_val_compare_and_swap( &(lck->tas.lk.poll), 0, gtid + 1 ) ) {         \
+            while ( __sync_val_compare_and_swap( &(lck->tas.lk.poll), KMP_LOCK_FREE( tas ),     \
+              KMP_LOCK_BUSY( gtid + 1, tas ) ) != KMP_LOCK_FREE( tas ) ) {                      \
                 if ( TCR_4(__kmp_nth) > (__kmp_avail_proc ? __kmp_avail_proc : __kmp_xproc) ) { \
                     KMP_YIELD( TRUE );                                                          \
                 } else {                                                                        \
@@ -650,7 +871,8 @@ __kmp_test_user_lock_with_checks( kmp_user_lock_p lck, kmp_int32 gtid )
                 KMP_FATAL( LockNestableUsedAsSimple, func );
             }
         }
-        return !__sync_val_compare_and_swap( &(lck->tas.lk.poll), 0, gtid + 1 );
+        return __sync_val_compare_and_swap( &(lck->tas.lk.poll), KMP_LOCK_FREE( tas ),
+          KMP_LOCK_BUSY( gtid + 1, tas ) ) == KMP_LOCK_FREE( tas );
     } else {
         KMP_DEBUG_ASSERT( __kmp_test_user_lock_with_checks_ != NULL );
         return ( *__kmp_test_user_lock_with_checks_ )( lck, gtid );
@@ -665,6 +887,17 @@ __kmp_test_user_lock_with_checks( kmp_user_lock_p lck, kmp_int32 gtid )
 }
 #endif
 
+// A test that reports no errors but keeps the owner the checks rely on,
+// for the lock profiler's try.
+extern int ( *__kmp_try_user_lock_ )( kmp_user_lock_p lck, kmp_int32 gtid );
+
+inline int
+__kmp_try_user_lock( kmp_user_lock_p lck, kmp_int32 gtid )
+{
+    KMP_DEBUG_ASSERT( __kmp_try_user_lock_ != NULL );
+    return ( *__kmp_try_user_lock_ )( lck, gtid );
+}
+
 extern void ( *__kmp_release_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_int32 gtid );
 
 inline void
@@ -718,10 +951,11 @@ extern void ( *__kmp_acquire_nested_user_lock_with_checks_ )( kmp_user_lock_p lc
                 KMP_FATAL( LockSimpleUsedAsNestable, func );                                        \
             }                                                                                       \
         }                                                                                           \
-        if ( lck->tas.lk.poll - 1 == gtid ) {                                                       \
+        if ( KMP_LOCK_STRIP( lck->tas.lk.poll ) - 1 == gtid ) {                                     \
             lck->tas.lk.depth_locked += 1;                                                          \
         } else {                                                                                    \
-            if ( __sync_val_compare_and_swap( &(lck->tas.lk.poll), 0, gtid + 1 ) ) {                \
+            if ( __sync_val_compare_and_swap( &(lck->tas.lk.poll), KMP_LOCK_FREE( tas ),            \
+              KMP_LOCK_BUSY( gtid + 1, tas ) ) != KMP_LOCK_FREE( tas ) ) {                          \
                 kmp_uint32 spins;                                                                   \
                 KMP_FSYNC_PREPARE( lck );                                                           \
                 KMP_INIT_YIELD( spins );                                                            \
@@ -730,7 +964,8 @@ extern void ( *__kmp_acquire_nested_user_lock_with_checks_ )( kmp_user_lock_p lc
                 } else {                                                                            \
                     KMP_YIELD_SPIN( spins );                                                        \
                 }                                                                                   \
-                while ( __sync_val_compare_and_swap( &(lck->tas.lk.poll), 0, gtid + 1 ) ) {         \
+                while ( __sync_val_compare_and_swap( &(lck->tas.lk.poll), KMP_LOCK_FREE( tas ),     \
+                  KMP_LOCK_BUSY( gtid + 1, tas ) ) != KMP_LOCK_FREE( tas ) ) {                      \
                     if ( TCR_4(__kmp_nth) > (__kmp_avail_proc ? __kmp_avail_proc : __kmp_xproc) ) { \
                         KMP_YIELD( TRUE );                                                          \
                     } else {                                                                        \
@@ -771,10 +1006,11 @@ __kmp_test_nested_user_lock_with_checks( kmp_user_lock_p lck, kmp_int32 gtid )
             }
         }
         KMP_DEBUG_ASSERT( gtid >= 0 );
-        if ( lck->tas.lk.poll - 1 == gtid ) {   /* __kmp_get_tas_lock_owner( lck ) == gtid */
+        if ( KMP_LOCK_STRIP( lck->tas.lk.poll ) - 1 == gtid ) {   /* __kmp_get_tas_lock_owner( lck ) == gtid */
             return ++lck->tas.lk.depth_locked;  /* same owner, depth increased */
         }
-        retval = !__sync_val_compare_and_swap( &(lck->tas.lk.poll), 0, gtid + 1 );
+        retval = __sync_val_compare_and_swap( &(lck->tas.lk.poll), KMP_LOCK_FREE( tas ),
+          KMP_LOCK_BUSY( gtid + 1, tas ) ) == KMP_LOCK_FREE( tas );
         if ( retval ) {
             KMP_MB();
             lck->tas.lk.depth_locked = 1;
@@ -794,6 +1030,15 @@ __kmp_test_nested_user_lock_with_checks( kmp_user_lock_p lck, kmp_int32 gtid )
 }
 #endif
 
+extern int ( *__kmp_try_nested_user_lock_ )( kmp_user_lock_p lck, kmp_int32 gtid );
+
+inline int
+__kmp_try_nested_user_lock( kmp_user_lock_p lck, kmp_int32 gtid )
+{
+    KMP_DEBUG_ASSERT( __kmp_try_nested_user_lock_ != NULL );
+    return ( *__kmp_try_nested_user_lock_ )( lck, gtid );
+}
+
 extern void ( *__kmp_release_nested_user_lock_with_checks_ )( kmp_user_lock_p lck, kmp_int32 gtid );
 
 inline void
@@ -880,6 +1125,176 @@ __kmp_set_user_lock_flags( kmp_user_lock_p lck, kmp_lock_flags_t flags )
 extern void __kmp_set_user_lock_vptrs( kmp_lock_kind_t user_lock_kind );
 
 
+// ----------------------------------------------------------------------------
+// Dynamic locks.
+//
+// Every user lock and critical section carries its own lock kind, encoded in
+// the lock word -- the first 32 bits of the omp_lock_t / omp_nest_lock_t /
+// kmp_critical_name storage:
+//
+//   - Direct locks (test and set, futex) live in the lock word itself.  The
+//     low byte of the word holds the lock tag, which is always odd; the upper
+//     bits hold the lock state (see KMP_LOCK_BUSY).
+//   - Indirect locks (all other kinds, and all nested locks) are allocated by
+//     the RTL and kept in the indirect lock table.  The lock word holds the
+//     index of the lock in the table shifted left by one, so it is even.  The
+//     pointer-sized area of a critical section holds a pointer to the table
+//     entry instead.
+//
+// A zero lock word is an uninitialized (or destroyed) lock.
+//
+// All lock operations dispatch through small tables indexed by the kind
+// found in the lock word, so locks of different kinds can be mixed freely in
+// one program.  Locks which are initialized without a hint use the kind
+// selected by KMP_LOCK_KIND.
+// ----------------------------------------------------------------------------
+
+#if KMP_USE_DYNAMIC_LOCK
+
+//
+// Index into the direct lock operation tables: the lock sequence of a direct
+// lock, 0 (lockseq_indirect) for an indirect one.
+//
+#define KMP_EXTRACT_D_TAG(l) \
+    ( ( *(kmp_dyna_lock_t *)( l ) & ( ( 1 << KMP_LOCK_SHIFT ) - 1 ) & -( *(kmp_dyna_lock_t *)( l ) & 1 ) ) >> 1 )
+
+// Index of an indirect lock in the indirect lock table.
+#define KMP_EXTRACT_I_INDEX(l)  ( *(kmp_lock_index_t *)( l ) >> 1 )
+
+struct kmp_indirect_lock {
+    kmp_user_lock_p        lock;    // Allocated with the size of its kind.
+    kmp_indirect_locktag_t type;
+};
+
+typedef struct kmp_indirect_lock kmp_indirect_lock_t;
+
+//
+// The indirect lock table is organized in rows of KMP_I_LOCK_CHUNK locks, so
+// table entries never move.  As in the user lock table, the first element of
+// the row array is not a row: it points to the previous (smaller) row array,
+// which cannot be freed while other threads may still use it.
+//
+#define KMP_I_LOCK_CHUNK        1024
+
+struct kmp_indirect_lock_table {
+    kmp_indirect_lock_t ** table;   // Row array.
+    kmp_lock_index_t       size;    // Number of rows allocated.
+    kmp_lock_index_t       next;    // Index of the next lock to allocate; 0 is never used.
+};
+
+typedef struct kmp_indirect_lock_table kmp_indirect_lock_table_t;
+
+extern kmp_indirect_lock_table_t __kmp_i_lock_table;
+
+#define KMP_GET_I_LOCK(index) \
+    ( __kmp_i_lock_table.table[ 1 + ( index ) / KMP_I_LOCK_CHUNK ] + ( index ) % KMP_I_LOCK_CHUNK )
+
+#define KMP_LOOKUP_I_LOCK(l)    KMP_GET_I_LOCK( KMP_EXTRACT_I_INDEX( l ) )
+
+//
+// Operation tables.  The direct ones are indexed by KMP_EXTRACT_D_TAG(), so
+// their element 0 handles indirect locks; the indirect ones are indexed by
+// the indirect lock tag.  __kmp_init_dynamic_user_locks() points them to
+// the checking versions when KMP_CONSISTENCY_CHECK is on.
+//
+extern void ( *__kmp_direct_init_ops[] )( kmp_dyna_lock_t *, kmp_dyna_lockseq_t );
+extern void ( **__kmp_direct_destroy_ops )( kmp_dyna_lock_t * );
+extern void ( **__kmp_direct_set_ops )( kmp_dyna_lock_t *, kmp_int32 );
+extern void ( **__kmp_direct_unset_ops )( kmp_dyna_lock_t *, kmp_int32 );
+extern int  ( **__kmp_direct_test_ops )( kmp_dyna_lock_t *, kmp_int32 );
+
+extern void ( **__kmp_indirect_init_ops )( kmp_user_lock_p );
+extern void ( **__kmp_indirect_destroy_ops )( kmp_user_lock_p );
+extern void ( **__kmp_indirect_set_ops )( kmp_user_lock_p, kmp_int32 );
+extern void ( **__kmp_indirect_unset_ops )( kmp_user_lock_p, kmp_int32 );
+extern int  ( **__kmp_indirect_test_ops )( kmp_user_lock_p, kmp_int32 );
+
+// The try operations of __kmp_try_user_lock(), for the lock profiler.
+extern int  ( **__kmp_direct_try_ops )( kmp_dyna_lock_t *, kmp_int32 );
+extern int  ( **__kmp_indirect_try_ops )( kmp_user_lock_p, kmp_int32 );
+
+// May be NULL for lock kinds which do not keep the information.
+extern void ( *__kmp_indirect_set_location[] )( kmp_user_lock_p, const ident_t * );
+extern void ( *__kmp_indirect_set_flags[] )( kmp_user_lock_p, kmp_lock_flags_t );
+extern const ident_t * ( *__kmp_indirect_get_location[] )( kmp_user_lock_p );
+extern kmp_lock_flags_t ( *__kmp_indirect_get_flags[] )( kmp_user_lock_p );
+extern int ( *__kmp_indirect_is_initialized[] )( kmp_user_lock_p );
+
+#define KMP_D_LOCK_FUNC(l, op)  __kmp_direct_##op##_ops[ KMP_EXTRACT_D_TAG( l ) ]
+#define KMP_I_LOCK_FUNC(l, op)  __kmp_indirect_##op##_ops[ ( l )->type ]
+
+#define KMP_INIT_D_LOCK(l, seq) __kmp_direct_init_ops[ seq ]( (kmp_dyna_lock_t *)( l ), seq )
+#define KMP_INIT_I_LOCK(l, seq) __kmp_direct_init_ops[ 0 ]( (kmp_dyna_lock_t *)( l ), seq )
+
+#define KMP_SET_I_LOCK_LOCATION(lck, loc)                                       \
+    {                                                                           \
+        if ( __kmp_indirect_set_location[ ( lck )->type ] != NULL )             \
+            __kmp_indirect_set_location[ ( lck )->type ]( ( lck )->lock, loc ); \
+    }
+
+#define KMP_SET_I_LOCK_FLAGS(lck, flag)                                         \
+    {                                                                           \
+        if ( __kmp_indirect_set_flags[ ( lck )->type ] != NULL )                \
+            __kmp_indirect_set_flags[ ( lck )->type ]( ( lck )->lock, flag );   \
+    }
+
+//
+// Inline the uncontended acquire and release of the direct locks into the
+// critical section and simple lock entry points, so they take no call
+// through the operation tables.
+//
+#ifndef KMP_USE_INLINED_DIRECT_LOCKS
+# define KMP_USE_INLINED_DIRECT_LOCKS   1
+#endif
+
+// Lock kind of locks initialized without a hint, set from KMP_LOCK_KIND.
+extern kmp_dyna_lockseq_t __kmp_user_lock_seq;
+
+extern void __kmp_init_dynamic_user_locks( void );
+extern kmp_indirect_lock_t * __kmp_allocate_indirect_lock( void **user_lock, kmp_int32 gtid, kmp_indirect_locktag_t tag );
+extern void __kmp_free_indirect_lock( kmp_indirect_lock_t *lck, kmp_lock_index_t index, kmp_int32 gtid );
+extern kmp_indirect_lock_t * __kmp_lookup_indirect_lock( void **user_lock, const char *func );
+extern void __kmp_cleanup_indirect_user_locks( void );
+
+// Owner of the lock, -1 if it is free or the owner is not known.
+extern kmp_int32 __kmp_get_dyna_lock_owner( kmp_user_lock_p lck, kmp_dyna_lockseq_t seq );
+
+#endif // KMP_USE_DYNAMIC_LOCK
+
+
+// ----------------------------------------------------------------------------
+// Lock contention profile.
+//
+// With KMP_LOCK_PROFILE=true the critical section and user lock entry points
+// keep one record per source location (ident_t) a lock is acquired at: how
+// often it was acquired, how often it was found taken and for how long, and
+// how long it was held, in timestamp ticks.  The sites with the longest total
+// wait are listed at library shutdown.  Acquisitions without a location
+// (e.g. from Fortran) are recorded per lock.
+// ----------------------------------------------------------------------------
+
+struct kmp_lock_profile {
+    const ident_t           * loc;          // acquire site, NULL if unknown
+    void                    * lock;         // first lock acquired at the site
+    char const              * func;         // "critical", "omp_set_lock", ...
+    kmp_uint64                acquires;
+    kmp_uint64                contended;    // acquisitions that had to wait
+    kmp_uint64                wait_ticks;
+    kmp_uint64                max_wait_ticks;
+    kmp_uint64                holds;        // acquisitions whose hold was timed
+    kmp_uint64                hold_ticks;
+    struct kmp_lock_profile * next;         // next record in the hash bucket
+};
+
+typedef struct kmp_lock_profile kmp_lock_profile_t;
+
+extern int __kmp_lock_profile;
+
+extern void __kmp_lock_profile_acquired( kmp_int32 gtid, const ident_t *loc, void *lock, char const *func,
+  kmp_uint64 start, int contended );
+extern void __kmp_lock_profile_released( kmp_int32 gtid, void *lock );
+extern void __kmp_lock_profile_output( void );
+
 
 // ----------------------------------------------------------------------------
 // User lock table & lock allocation
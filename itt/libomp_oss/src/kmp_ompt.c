@@ -0,0 +1,262 @@
+/*
+ * kmp_ompt.c -- Tool interface: tool lookup, callback registration, entry points.
+ */
+
+/* <copyright>
+    Copyright (c) 2013 Intel Corporation.  All Rights Reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+      * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the name of Intel Corporation nor the names of its
+        contributors may be used to endorse or promote products derived
+        from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+------------------------------------------------------------------------
+
+    Portions of this software are protected under the following patents:
+        U.S. Patent 5,812,852
+        U.S. Patent 6,792,599
+        U.S. Patent 7,069,556
+        U.S. Patent 7,328,433
+        U.S. Patent 7,500,242
+
+</copyright> */
+
+#include "kmp.h"
+#include "kmp_version.h"
+#include "kmp_ompt.h"
+
+#if OMPT_SUPPORT
+
+#if KMP_OS_UNIX
+# include <dlfcn.h>
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* ------------------------------------------------------------------------ */
+
+kmp_ompt_callbacks_t __kmp_ompt_callbacks;          // zero-initialized: nothing registered
+int                  __kmp_ompt_enabled = FALSE;    // a tool's ompt_initialize() returned non-zero
+volatile kmp_int64   __kmp_ompt_id_counter = 0;     // source of parallel region and task ids
+
+typedef int (*kmp_ompt_initialize_t)( ompt_function_lookup_t, const char *, unsigned int );
+
+// -------------------------------------------------------------------------------------------------
+// Entry points handed out to the tool
+// -------------------------------------------------------------------------------------------------
+
+static int
+__kmp_ompt_set_callback( ompt_event_t event, ompt_callback_t callback )
+{
+    switch ( event ) {
+#define ompt_event_macro( event_name, callback_type, id )                      \
+        case event_name:                                                       \
+            __kmp_ompt_callbacks.event_name = (callback_type) callback;        \
+            return 1;
+        FOREACH_OMPT_EVENT( ompt_event_macro )
+#undef ompt_event_macro
+        default:
+            return 0;
+    }
+}
+
+static int
+__kmp_ompt_get_callback( ompt_event_t event, ompt_callback_t *callback )
+{
+    switch ( event ) {
+#define ompt_event_macro( event_name, callback_type, id )                      \
+        case event_name:                                                       \
+            if ( __kmp_ompt_callbacks.event_name == NULL )                     \
+                return 0;                                                      \
+            *callback = (ompt_callback_t) __kmp_ompt_callbacks.event_name;     \
+            return 1;
+        FOREACH_OMPT_EVENT( ompt_event_macro )
+#undef ompt_event_macro
+        default:
+            return 0;
+    }
+}
+
+static ompt_thread_id_t
+__kmp_ompt_get_thread_id( void )
+{
+    int gtid = __kmp_gtid_get_specific();
+    return ( gtid >= 0 ) ? KMP_OMPT_THREAD_ID( gtid ) : 0;
+}
+
+//
+// The inquiry functions below may be called from a signal handler interrupting
+// an arbitrary thread, so they only read: no locks, no allocation, and no
+// registration of foreign threads.
+//
+static kmp_info_t *
+__kmp_ompt_get_thread( void )
+{
+    int gtid = __kmp_gtid_get_specific();
+    if ( gtid < 0 || __kmp_threads == NULL ) {
+        return NULL;
+    }
+    return __kmp_threads[ gtid ];
+}
+
+static ompt_state_t
+__kmp_ompt_get_state( ompt_wait_id_t *wait_id )
+{
+    kmp_info_t *thr = __kmp_ompt_get_thread();
+    if ( thr == NULL ) {
+        return ompt_state_undefined;
+    }
+    if ( wait_id != NULL ) {
+        *wait_id = thr->th.th_ompt_wait_id;
+    }
+    return thr->th.th_ompt_state;
+}
+
+#if OMP_30_ENABLED
+static kmp_taskdata_t *
+__kmp_ompt_get_task( int depth )
+{
+    kmp_info_t     *thr = __kmp_ompt_get_thread();
+    kmp_taskdata_t *task;
+
+    if ( thr == NULL || depth < 0 ) {
+        return NULL;
+    }
+    task = thr->th.th_current_task;
+    while ( task != NULL && depth-- > 0 ) {
+        task = task->td_parent;
+    }
+    return task;
+}
+#endif /* OMP_30_ENABLED */
+
+static ompt_task_id_t
+__kmp_ompt_get_task_id( int depth )
+{
+#if OMP_30_ENABLED
+    kmp_taskdata_t *task = __kmp_ompt_get_task( depth );
+    return ( task != NULL ) ? task->td_ompt_task_id : 0;
+#else
+    return 0;
+#endif /* OMP_30_ENABLED */
+}
+
+static ompt_frame_t *
+__kmp_ompt_get_task_frame( int depth )
+{
+#if OMP_30_ENABLED
+    kmp_taskdata_t *task = __kmp_ompt_get_task( depth );
+    return ( task != NULL ) ? & task->td_ompt_frame : NULL;
+#else
+    return NULL;
+#endif /* OMP_30_ENABLED */
+}
+
+static ompt_parallel_id_t
+__kmp_ompt_get_parallel_id( void )
+{
+    kmp_info_t *thr = __kmp_ompt_get_thread();
+    kmp_team_t *team;
+
+    if ( thr == NULL ) {
+        return 0;
+    }
+    team = thr->th.th_team;
+    if ( team == NULL || team->t.t_serialized ) {
+        return 0;
+    }
+    return team->t.t_ompt_parallel_id;
+}
+
+static ompt_interface_fn_t
+__kmp_ompt_lookup( const char *entry_point )
+{
+    if ( entry_point == NULL )
+        return NULL;
+    if ( strcmp( entry_point, "ompt_set_callback" ) == 0 )
+        return (ompt_interface_fn_t) __kmp_ompt_set_callback;
+    if ( strcmp( entry_point, "ompt_get_callback" ) == 0 )
+        return (ompt_interface_fn_t) __kmp_ompt_get_callback;
+    if ( strcmp( entry_point, "ompt_get_thread_id" ) == 0 )
+        return (ompt_interface_fn_t) __kmp_ompt_get_thread_id;
+    if ( strcmp( entry_point, "ompt_get_state" ) == 0 )
+        return (ompt_interface_fn_t) __kmp_ompt_get_state;
+    if ( strcmp( entry_point, "ompt_get_task_id" ) == 0 )
+        return (ompt_interface_fn_t) __kmp_ompt_get_task_id;
+    if ( strcmp( entry_point, "ompt_get_task_frame" ) == 0 )
+        return (ompt_interface_fn_t) __kmp_ompt_get_task_frame;
+    if ( strcmp( entry_point, "ompt_get_parallel_id" ) == 0 )
+        return (ompt_interface_fn_t) __kmp_ompt_get_parallel_id;
+    return NULL;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Attaching and detaching the tool
+// -------------------------------------------------------------------------------------------------
+
+//
+// Called from __kmp_do_serial_initialize() before the initial thread is
+// registered, so the tool sees a thread_begin event for it.
+//
+void
+__kmp_ompt_initialize( void )
+{
+    kmp_ompt_initialize_t tool_init = NULL;
+
+#if KMP_OS_UNIX
+    tool_init = (kmp_ompt_initialize_t) dlsym( RTLD_DEFAULT, "ompt_initialize" );
+#elif KMP_OS_WINDOWS
+    tool_init = (kmp_ompt_initialize_t) GetProcAddress( GetModuleHandle( NULL ), "ompt_initialize" );
+#endif
+
+    if ( tool_init == NULL ) {
+        KA_TRACE( 10, ( "__kmp_ompt_initialize: no tool found\n" ) );
+        return;
+    }
+
+    if ( (*tool_init)( __kmp_ompt_lookup, & __kmp_version_lib_ver[ KMP_VERSION_MAGIC_LEN ], OMPT_VERSION ) ) {
+        __kmp_ompt_enabled = TRUE;
+    } else {
+        memset( & __kmp_ompt_callbacks, 0, sizeof( __kmp_ompt_callbacks ) );
+    }
+    KA_TRACE( 10, ( "__kmp_ompt_initialize: tool %s\n", __kmp_ompt_enabled ? "attached" : "declined" ) );
+}
+
+//
+// Called from __kmp_internal_end() once the worker threads have been reaped
+// (and have reported thread_end).  No event is reported after this one.
+//
+void
+__kmp_ompt_shutdown( void )
+{
+    if ( ! __kmp_ompt_enabled ) {
+        return;
+    }
+    KMP_OMPT_CALLBACK( ompt_event_runtime_shutdown, () );
+    memset( & __kmp_ompt_callbacks, 0, sizeof( __kmp_ompt_callbacks ) );
+    __kmp_ompt_enabled = FALSE;
+}
+
+#endif // OMPT_SUPPORT
+
+// end of file //
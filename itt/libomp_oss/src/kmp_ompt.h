@@ -0,0 +1,127 @@
+/*
+ * kmp_ompt.h -- Runtime side of the tool interface (ompt.h).
+ */
+
+/* <copyright>
+    Copyright (c) 2013 Intel Corporation.  All Rights Reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+      * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the name of Intel Corporation nor the names of its
+        contributors may be used to endorse or promote products derived
+        from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+------------------------------------------------------------------------
+
+    Portions of this software are protected under the following patents:
+        U.S. Patent 5,812,852
+        U.S. Patent 6,792,599
+        U.S. Patent 7,069,556
+        U.S. Patent 7,328,433
+        U.S. Patent 7,500,242
+
+</copyright> */
+
+#ifndef KMP_OMPT_H
+#define KMP_OMPT_H
+
+#include "ompt.h"
+
+/*
+ * The callback table is filled in by the tool from ompt_initialize() and is
+ * read-only afterwards.  Every event site tests its own table entry, so an
+ * event nobody registered for costs one load and one well-predicted branch,
+ * and the callback arguments are not evaluated at all.
+ *
+ * Parallel region and task ids are only generated while a tool is attached
+ * (__kmp_ompt_enabled); otherwise they stay 0.
+ *
+ * The thread state word (th_ompt_state) and the task frames (td_ompt_frame)
+ * are plain stores kept up to date whether or not a tool is attached, so a
+ * sampling tool attached at any time reads correct values.
+ */
+
+#if OMPT_SUPPORT
+
+typedef struct kmp_ompt_callbacks {
+#define ompt_event_macro( event, callback, id ) callback event;
+    FOREACH_OMPT_EVENT( ompt_event_macro )
+#undef ompt_event_macro
+} kmp_ompt_callbacks_t;
+
+extern kmp_ompt_callbacks_t __kmp_ompt_callbacks;
+extern int                  __kmp_ompt_enabled;
+extern volatile kmp_int64   __kmp_ompt_id_counter;
+
+extern void __kmp_ompt_initialize( void );
+extern void __kmp_ompt_shutdown( void );
+
+# define KMP_OMPT_CALLBACK( event, args )                                      \
+    do {                                                                       \
+        if ( __kmp_ompt_callbacks.event != NULL )                              \
+            (*__kmp_ompt_callbacks.event) args;                                \
+    } while ( 0 )
+
+# define KMP_OMPT_NEW_ID()                                                     \
+    ( __kmp_ompt_enabled ? (kmp_uint64) KMP_TEST_THEN_INC64( & __kmp_ompt_id_counter ) + 1 : 0 )
+
+# define KMP_OMPT_THREAD_ID( gtid )     ( (ompt_thread_id_t)( (gtid) + 1 ) )
+
+// Id of the task the thread is executing (only used inside callback arguments).
+# if OMP_30_ENABLED
+#  define KMP_OMPT_TASK_ID( thr )       ( (thr)->th.th_current_task->td_ompt_task_id )
+# else
+#  define KMP_OMPT_TASK_ID( thr )       ( (kmp_uint64) 0 )
+# endif
+
+//
+// KMP_OMPT_STATE_ENTER declares var holding the thread's previous state and
+// switches to the new one; KMP_OMPT_STATE_EXIT switches back.
+//
+# define KMP_OMPT_STATE_ENTER( thr, var, state, wait_id )                      \
+    ompt_state_t var = (thr)->th.th_ompt_state;                                \
+    (thr)->th.th_ompt_wait_id = (kmp_uint64)(kmp_uintptr_t)(wait_id);          \
+    (thr)->th.th_ompt_state = (state)
+
+# define KMP_OMPT_STATE_EXIT( thr, var )    ( (thr)->th.th_ompt_state = (var) )
+# define KMP_OMPT_SET_STATE( thr, state )   ( (thr)->th.th_ompt_state = (state) )
+
+// Frame of the calling function, recorded in td_ompt_frame.
+# if KMP_OS_WINDOWS
+#  include <intrin.h>
+#  define KMP_OMPT_FRAME_ADDRESS()          ( (void *) _AddressOfReturnAddress() )
+# else
+#  define KMP_OMPT_FRAME_ADDRESS()          __builtin_frame_address( 0 )
+# endif
+
+#else // OMPT_SUPPORT
+
+# define KMP_OMPT_CALLBACK( event, args )   ((void)0)
+# define KMP_OMPT_NEW_ID()                  0
+# define KMP_OMPT_STATE_ENTER( thr, var, state, wait_id )
+# define KMP_OMPT_STATE_EXIT( thr, var )    ((void)0)
+# define KMP_OMPT_SET_STATE( thr, state )   ((void)0)
+
+#endif // OMPT_SUPPORT
+
+#endif // KMP_OMPT_H
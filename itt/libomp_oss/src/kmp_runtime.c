@@ -53,6 +53,8 @@
 #include "kmp_i18n.h"
 #include "kmp_io.h"
 #include "kmp_error.h"
+#include "kmp_stats.h"
+#include "kmp_ompt.h"
 
 /* these are temporary issues to be dealt with */
 #define KMP_USE_PRCTL 0
@@ -136,6 +138,7 @@ static int __kmp_expand_threads(int nWish, int nNeed);
 static int __kmp_unregister_root_other_thread( int gtid );
 static void __kmp_unregister_library( void ); // called by __kmp_internal_end()
 static void __kmp_reap_thread( kmp_info_t * thread, int is_root );
+static void __kmp_free_hot_teams( kmp_root_t *root, kmp_info_t *this_th );
 static kmp_info_t *__kmp_thread_pool_insert_pt = NULL;
 
 /* ------------------------------------------------------------------------ */
@@ -379,6 +382,41 @@ __kmp_static_yield( int arg )
     __kmp_yield( arg );
 }
 
+/*
+ * Adaptive waiting (KMP_ADAPTIVE_WAIT).  The history is private to the thread,
+ * so no synchronization is needed; a site that hashes to a slot owned by
+ * another site simply takes the slot over.
+ */
+
+/* Number of ticks to spin at site before parking; 0 to park at once. */
+kmp_uint64
+__kmp_adaptive_spin_ticks( kmp_info_t *th, volatile void *site )
+{
+    kmp_wait_hist_t *hist = & th->th.th_wait_hist[ KMP_WAIT_HIST_HASH( site ) ];
+
+    if ( hist->wh_site != site ) {
+        return KMP_ADAPTIVE_SPIN_MAX;       /* nothing known yet, spin as long as we ever do */
+    }
+    if ( hist->wh_avg > KMP_ADAPTIVE_SPIN_MAX ) {
+        return 0;
+    }
+    return 2 * hist->wh_avg + KMP_ADAPTIVE_SPIN_MIN;
+}
+
+/* Record a wait of ticks at site: the average moves a quarter of the way. */
+void
+__kmp_adaptive_wait_update( kmp_info_t *th, volatile void *site, kmp_uint64 ticks )
+{
+    kmp_wait_hist_t *hist = & th->th.th_wait_hist[ KMP_WAIT_HIST_HASH( site ) ];
+
+    if ( hist->wh_site != site ) {
+        hist->wh_site = site;
+        hist->wh_avg  = ticks;
+    } else {
+        hist->wh_avg  = ( 3 * hist->wh_avg + ticks ) >> 2;
+    }
+}
+
 /*
  * Spin wait loop that first does pause, then yield, then sleep.
  * Wait until spinner is equal to checker to exit.
@@ -398,11 +436,15 @@ __kmp_wait_sleep( kmp_info_t *this_thr,
     register volatile kmp_uint    *spin      = spinner;
     register          kmp_uint     check     = checker;
     register          kmp_uint32   spins;
-    register          int          hibernate;
+    register          int          hibernate = 0;
+                      kmp_uint64   hibernate_goal = 0;
                       int          th_gtid, th_tid;
 #if OMP_30_ENABLED
                       int          flag = FALSE;
 #endif /* OMP_30_ENABLED */
+                      int          adaptive = FALSE;
+                      kmp_uint64   adaptive_start = 0, adaptive_deadline = 0;
+                      int          parked = FALSE;
 
 
     th_gtid = this_thr->th.th_info.ds.ds_gtid;
@@ -414,6 +456,12 @@ __kmp_wait_sleep( kmp_info_t *this_thr,
     KA_TRACE( 20, ("__kmp_wait_sleep: T#%d waiting for spin(%p) == %d\n",
                   th_gtid,
                   spin, check ) );
+    KMP_STATS_TIMER_START( this_thr, wait_start );
+#if OMPT_SUPPORT
+    // The thread has done its share of the barrier and only waits to be released.
+    if ( __kmp_ompt_callbacks.ompt_event_idle_begin != NULL && final_spin )
+        (*__kmp_ompt_callbacks.ompt_event_idle_begin)( KMP_OMPT_THREAD_ID( th_gtid ) );
+#endif
 
     /* setup for waiting */
     KMP_INIT_YIELD( spins );
@@ -433,14 +481,39 @@ __kmp_wait_sleep( kmp_info_t *this_thr,
         #else
             hibernate = this_thr->th.th_team_bt_intervals;
         #endif /* KMP_ADJUST_BLOCKTIME */
-        if ( hibernate == 0 ) {
-            hibernate--;
+        if ( ! __kmp_use_monitor ) {
+            //
+            // No monitor: the intervals are milliseconds, so the deadline
+            // is a timestamp.
+            //
+            hibernate_goal = __kmp_hardware_timestamp() + (kmp_uint64) hibernate * __kmp_ticks_per_msec;
+
+            KF_TRACE( 20, ("__kmp_wait_sleep: T#%d hibernate in %d ms\n",
+                          th_gtid, hibernate ));
+        } else {
+            if ( hibernate == 0 ) {
+                hibernate--;
+            }
+            hibernate += TCR_4( __kmp_global.g.g_time.dt.t_value );
+
+            KF_TRACE( 20, ("__kmp_wait_sleep: T#%d now=%d, hibernate=%d, intervals=%d\n",
+                          th_gtid, __kmp_global.g.g_time.dt.t_value, hibernate,
+                          hibernate - __kmp_global.g.g_time.dt.t_value ));
         }
-        hibernate += TCR_4( __kmp_global.g.g_time.dt.t_value );
 
-        KF_TRACE( 20, ("__kmp_wait_sleep: T#%d now=%d, hibernate=%d, intervals=%d\n",
-                      th_gtid, __kmp_global.g.g_time.dt.t_value, hibernate,
-                      hibernate - __kmp_global.g.g_time.dt.t_value ));
+        if ( __kmp_adaptive_wait ) {
+            //
+            // The history of this site replaces the blocktime: spin for about
+            // as long as recent waits here took, or park at once if they were long.
+            //
+            kmp_uint64 spin_ticks = __kmp_adaptive_spin_ticks( this_thr, spin );
+            adaptive = TRUE;
+            adaptive_start = __kmp_hardware_timestamp();
+            adaptive_deadline = adaptive_start + spin_ticks;
+            KMP_STATS_COUNT( this_thr, spin_ticks ? KMP_STAT_WAIT_SPIN : KMP_STAT_WAIT_PARK );
+            KF_TRACE( 20, ("__kmp_wait_sleep: T#%d adaptive spin for %llu ticks\n",
+                          th_gtid, (unsigned long long) spin_ticks ));
+        }
     }
 
     KMP_MB();
@@ -543,8 +616,22 @@ __kmp_wait_sleep( kmp_info_t *this_thr,
             continue;
         }
 
+        if ( adaptive ) {
+            if ( __kmp_hardware_timestamp() < adaptive_deadline ) {
+                continue;
+            }
+            if ( ! parked && adaptive_deadline != adaptive_start ) {
+                KMP_STATS_COUNT( this_thr, KMP_STAT_WAIT_TIMEOUT );
+            }
+            parked = TRUE;
+        }
         /* if we have waited a bit more, fall asleep */
-        if( TCR_4( __kmp_global.g.g_time.dt.t_value ) <= hibernate ) {
+        else if ( ! __kmp_use_monitor ) {
+            if ( __kmp_hardware_timestamp() < hibernate_goal ) {
+                continue;
+            }
+        }
+        else if( TCR_4( __kmp_global.g.g_time.dt.t_value ) <= (kmp_uint32) hibernate ) {
             continue;
         }
 
@@ -560,6 +647,14 @@ __kmp_wait_sleep( kmp_info_t *this_thr,
         /* if thread is done with work and timesout, disband/free */
     }
 
+    if ( adaptive ) {
+        __kmp_adaptive_wait_update( this_thr, spin, __kmp_hardware_timestamp() - adaptive_start );
+    }
+    KMP_STATS_TIMER_STOP( this_thr, KMP_TIMER_WAIT_SLEEP, wait_start );
+#if OMPT_SUPPORT
+    if ( __kmp_ompt_callbacks.ompt_event_idle_end != NULL && final_spin )
+        (*__kmp_ompt_callbacks.ompt_event_idle_end)( KMP_OMPT_THREAD_ID( th_gtid ) );
+#endif
 }
 
 
@@ -794,7 +889,7 @@ __kmp_print_thread_storage_map( kmp_info_t *thr, int gtid )
 static void
 __kmp_print_team_storage_map( const char *header, kmp_team_t *team, int team_id, int num_thr )
 {
-    int num_disp_buff = team->t.t_max_nproc > 1 ? KMP_MAX_DISP_BUF : 2;
+    int num_disp_buff = team->t.t_disp_num_buffers;
     __kmp_print_storage_map_gtid( -1, team, team + 1, sizeof(kmp_team_t), "%s_%d",
                              header, team_id );
 
@@ -1458,6 +1553,36 @@ __kmp_hyper_barrier_gather( enum barrier_type bt,
 
 }
 
+/*
+ * Wake-up tree for the linear release.  The master bumps every go flag but
+ * leaves sleeping threads asleep, then wakes only its own children in a tree
+ * over the tids; each released worker wakes its children in turn.  The master
+ * thus makes at most KMP_WAKE_TREE_BRANCH wake-up calls however large the
+ * team is.
+ */
+#define KMP_WAKE_TREE_BRANCH    4
+
+static void
+__kmp_linear_wake_children( enum barrier_type bt, kmp_team_t *team, int tid )
+{
+    register kmp_info_t **other_threads = team -> t.t_threads;
+    register kmp_uint32   nproc         = team -> t.t_nproc;
+    register kmp_uint32   child_tid     = tid * KMP_WAKE_TREE_BRANCH + 1;
+    register kmp_uint32   last_tid      = child_tid + KMP_WAKE_TREE_BRANCH;
+
+    for ( ; child_tid < last_tid && child_tid < nproc; ++ child_tid ) {
+        register kmp_info_t        *child_thr = other_threads[ child_tid ];
+        register volatile kmp_uint *child_go  = & child_thr -> th.th_bar[ bt ].bb.b_go;
+
+        if ( TCR_4( *child_go ) & KMP_BARRIER_SLEEP_STATE ) {
+            KA_TRACE( 20, ( "__kmp_linear_wake_children: T#%d(%d:%d) waking T#%d(%d:%d) go(%p)\n",
+                            __kmp_gtid_from_tid( tid, team ), team->t.t_id, tid,
+                            child_thr->th.th_info.ds.ds_gtid, team->t.t_id, child_tid, child_go ) );
+            __kmp_resume( child_thr->th.th_info.ds.ds_gtid, child_go );
+        }
+    }
+}
+
 static void
 __kmp_linear_barrier_release( enum barrier_type bt, 
                               kmp_info_t *this_thr, 
@@ -1508,8 +1633,16 @@ __kmp_linear_barrier_release( enum barrier_type bt,
                                 other_threads[i]->th.th_bar[bt].bb.b_go + KMP_BARRIER_STATE_BUMP
                                 ) );
 
-                __kmp_release( other_threads[ i ],
-                               &other_threads[ i ]-> th.th_bar[ bt ].bb.b_go, kmp_acquire_fence );
+                if ( __kmp_dflt_blocktime != KMP_MAX_BLOCKTIME ) {
+                    /* a sleeping thread is woken below, through the wake-up tree */
+                    KMP_TEST_THEN_ADD4_ACQ32( (volatile kmp_int32 *) &other_threads[ i ]-> th.th_bar[ bt ].bb.b_go );
+                } else {
+                    __kmp_release( other_threads[ i ],
+                                   &other_threads[ i ]-> th.th_bar[ bt ].bb.b_go, kmp_acquire_fence );
+                }
+            }
+            if ( __kmp_dflt_blocktime != KMP_MAX_BLOCKTIME ) {
+                __kmp_linear_wake_children( bt, team, tid );
             }
         }
     } else {
@@ -1530,12 +1663,14 @@ __kmp_linear_barrier_release( enum barrier_type bt,
         //
         // The worker thread may now assume that the team is valid.
         //
-        #ifdef KMP_DEBUG
-            tid = __kmp_tid_from_gtid( gtid );
-            team = __kmp_threads[ gtid ]-> th.th_team;
-        #endif
+        tid = __kmp_tid_from_gtid( gtid );
+        team = __kmp_threads[ gtid ]-> th.th_team;
         KMP_DEBUG_ASSERT( team != NULL );
 
+        if ( __kmp_dflt_blocktime != KMP_MAX_BLOCKTIME ) {
+            __kmp_linear_wake_children( bt, team, tid );
+        }
+
         TCW_4(thr_bar->b_go, KMP_INIT_BARRIER_STATE);
         KA_TRACE( 20, ("__kmp_linear_barrier_release: T#%d(%d:%d) set go(%p) = %u\n",
           gtid, team->t.t_id, tid, &thr_bar->b_go, KMP_INIT_BARRIER_STATE ) );
@@ -1629,7 +1764,7 @@ __kmp_tree_barrier_release( enum barrier_type bt,
                 __kmp_init_implicit_task( team->t.t_ident,
                   team->t.t_threads[child_tid], team, child_tid, FALSE );
                 copy_icvs( &team->t.t_implicit_task_taskdata[child_tid].td_icvs,
-                  &team->t.t_implicit_task_taskdata[0].td_icvs );
+                  &team->t.t_implicit_task_taskdata[tid].td_icvs );
             }
 #endif // KMP_BARRIER_ICV_PUSH
 
@@ -1761,7 +1896,7 @@ __kmp_hyper_barrier_release( enum barrier_type bt,
                     __kmp_init_implicit_task( team->t.t_ident,
                       team->t.t_threads[child_tid], team, child_tid, FALSE );
                     copy_icvs( &team->t.t_implicit_task_taskdata[child_tid].td_icvs,
-                      &team->t.t_implicit_task_taskdata[0].td_icvs );
+                      &team->t.t_implicit_task_taskdata[tid].td_icvs );
                 }
 #endif // KMP_BARRIER_ICV_PUSH
 
@@ -1886,7 +2021,7 @@ __kmp_hyper_barrier_release( enum barrier_type bt, kmp_info_t *this_thr, int gti
                 __kmp_init_implicit_task( team->t.t_ident,
                   team->t.t_threads[child_tid], team, child_tid, FALSE );
                 copy_icvs( &team->t.t_implicit_task_taskdata[child_tid].td_icvs,
-                  &team->t.t_implicit_task_taskdata[0].td_icvs );
+                  &team->t.t_implicit_task_taskdata[tid].td_icvs );
             }
 #endif // KMP_BARRIER_ICV_PUSH
 
@@ -1908,6 +2043,383 @@ __kmp_hyper_barrier_release( enum barrier_type bt, kmp_info_t *this_thr, int gti
 #endif /* KMP_REVERSE_HYPER_BAR */
 
 
+/*
+ * The hierarchical barrier embeds its tree in the machine topology
+ * (__kmp_bar_hier_fanout[], built by __kmp_affinity_initialize()), assuming
+ * consecutive tids are bound close together as with compact affinity or
+ * proc_bind(close).  A thread first synchronizes with the threads on its own
+ * core, then with the other core leaders in its package, then across
+ * packages, so most of the flag traffic stays inside a core or a package.
+ * If the topology is unknown the tree degenerates to a linear barrier.
+ */
+
+/* Number of consecutive tids in the subtree rooted at a level-'level' parent */
+#define KMP_BAR_HIER_SPAN( level, nproc )                                     \
+    ( ( (level) < __kmp_bar_hier_depth ) ? __kmp_bar_hier_skip[ (level) + 1 ] : (nproc) )
+
+/*
+ * The threads of one core gather through the byte flags of their parent's
+ * b_leaf_arrived word.  A byte store cannot tell the parent whether it went
+ * to sleep, so this is only done when the threads never sleep, i.e. when
+ * KMP_BLOCKTIME is infinite.
+ */
+#define KMP_BAR_HIER_ONCORE()                                                  \
+    ( __kmp_dflt_blocktime == KMP_MAX_BLOCKTIME && __kmp_bar_hier_depth > 0 )
+
+KMP_BUILD_ASSERT( KMP_BAR_HIER_MAX_FANOUT == sizeof( kmp_uint64 ) );
+
+/*
+ * Spin until all the leaf bytes in mask are set in *spinner, executing tasks
+ * meanwhile.  Only used with infinite blocktime, so there is no sleep state.
+ */
+static void
+__kmp_wait_oncore( kmp_info_t *this_thr,
+                   volatile kmp_uint64 *spinner,
+                   kmp_uint64 mask )
+{
+    register volatile kmp_uint64 *spin = spinner;
+    register          kmp_uint32  spins;
+#if OMP_30_ENABLED
+                      int         flag = FALSE;
+#endif /* OMP_30_ENABLED */
+
+    KMP_DEBUG_ASSERT( __kmp_dflt_blocktime == KMP_MAX_BLOCKTIME );
+
+    if ( ( TCR_8(*spin) & mask ) == mask ) {
+        return;
+    }
+
+    KA_TRACE( 20, ("__kmp_wait_oncore: T#%d waiting for spin(%p) & 0x%llx\n",
+                  this_thr->th.th_info.ds.ds_gtid, spin, (unsigned long long) mask ) );
+
+    KMP_INIT_YIELD( spins );
+
+    while ( ( TCR_8(*spin) & mask ) != mask ) {
+        #if OMP_30_ENABLED
+            //
+            // Same as in __kmp_wait_sleep(), except that we execute one task
+            // at a time and recheck the flags ourselves, since
+            // __kmp_execute_tasks() only knows how to check a kmp_uint spin.
+            //
+            if ( __kmp_tasking_mode != tskm_immediate_exec ) {
+                kmp_task_team_t * task_team = this_thr->th.th_task_team;
+                if ( task_team != NULL ) {
+                    if ( ! TCR_SYNC_4( task_team->tt.tt_active ) ) {
+                        KMP_DEBUG_ASSERT( ! KMP_MASTER_TID( this_thr->th.th_info.ds.ds_tid ) );
+                        __kmp_unref_task_team( task_team, this_thr );
+                    } else if ( KMP_TASKING_ENABLED( task_team, this_thr->th.th_task_state ) ) {
+                        __kmp_execute_tasks( this_thr, this_thr->th.th_info.ds.ds_gtid,
+                                             NULL, 0, FALSE, &flag );
+                    }
+                }; // if
+            }; // if
+        #endif /* OMP_30_ENABLED */
+
+        if( TCR_4(__kmp_global.g.g_done) ) {
+            if( __kmp_global.g.g_abort )
+                __kmp_abort_thread( );
+            break;
+        }
+
+        KMP_YIELD( TCR_4(__kmp_nth) > __kmp_avail_proc );
+        KMP_YIELD_SPIN( spins );
+    }
+}
+
+static void
+__kmp_hierarchical_barrier_gather( enum barrier_type bt,
+                                   kmp_info_t *this_thr,
+                                   int gtid,
+                                   int tid,
+                                   void (*reduce) (void *, void *)
+                                   )
+{
+    register kmp_team_t    *team          = this_thr -> th.th_team;
+    register kmp_bstate_t  *thr_bar       = & this_thr -> th.th_bar[ bt ].bb;
+    register kmp_info_t   **other_threads = team -> t.t_threads;
+    register kmp_uint       new_state     = KMP_BARRIER_UNUSED_STATE;
+    register kmp_uint32     num_threads   = this_thr -> th.th_team_nproc;
+    register int            oncore        = KMP_BAR_HIER_ONCORE();
+    register kmp_uint32     level;
+
+    KA_TRACE( 20, ( "__kmp_hierarchical_barrier_gather: T#%d(%d:%d) enter for barrier type %d\n",
+                    gtid, team->t.t_id, tid, bt ) );
+
+    KMP_DEBUG_ASSERT( this_thr == other_threads[this_thr->th.th_info.ds.ds_tid] );
+
+    /*
+     * Go up the hierarchy, collecting the children on each level in turn,
+     * until we reach the level at which we are a child ourselves.
+     */
+    for ( level = 0;
+          level <= __kmp_bar_hier_depth && __kmp_bar_hier_skip[ level ] < num_threads;
+          level++ )
+    {
+        register kmp_uint32 skip = __kmp_bar_hier_skip[ level ];
+        register kmp_uint32 span = KMP_BAR_HIER_SPAN( level, num_threads );
+        register kmp_uint32 child_tid;
+
+        if ( (kmp_uint32)tid % span != 0 ) {
+            register kmp_int32 parent_tid = tid - (kmp_uint32)tid % span;
+
+            if ( level == 0 && oncore ) {
+                register kmp_bstate_t *parent_bar = & other_threads[ parent_tid ] -> th.th_bar[ bt ].bb;
+
+                KA_TRACE( 20, ( "__kmp_hierarchical_barrier_gather: T#%d(%d:%d) releasing T#%d(%d:%d) "
+                                "leaf byte %u of arrived(%p)\n",
+                                gtid, team->t.t_id, tid,
+                                __kmp_gtid_from_tid( parent_tid, team ), team->t.t_id, parent_tid,
+                                (kmp_uint32)tid % span, &parent_bar -> b_leaf_arrived ) );
+
+                /* keep our own arrived count in step with the team's */
+                TCW_4( thr_bar -> b_arrived, thr_bar -> b_arrived + KMP_BARRIER_STATE_BUMP );
+
+                /* mark arrival to parent thread; the team may be gone after this store */
+                KMP_MB();
+                parent_bar -> b_leaf_byte[ (kmp_uint32)tid % span ] = 1;
+                break;
+            }
+
+            KA_TRACE( 20, ( "__kmp_hierarchical_barrier_gather: T#%d(%d:%d) releasing T#%d(%d:%d) "
+                            "arrived(%p): %u => %u\n",
+                            gtid, team->t.t_id, tid,
+                            __kmp_gtid_from_tid( parent_tid, team ), team->t.t_id, parent_tid,
+                            &thr_bar -> b_arrived, thr_bar -> b_arrived,
+                            thr_bar -> b_arrived + KMP_BARRIER_STATE_BUMP
+                          ) );
+
+            /* mark arrival to parent thread */
+            //
+            // After performing this write, a worker thread may not assume that
+            // the team is valid any more - it could be deallocated by the master
+            // thread at any time.
+            //
+            __kmp_release( other_threads[parent_tid], &thr_bar -> b_arrived, kmp_release_fence );
+            break;
+        }
+
+        /* parent threads wait for the children on this level to arrive */
+
+        if ( level == 0 && oncore ) {
+            /* all the children on our core report in one word: wait for it once */
+            union {
+                kmp_uint64 word;
+                kmp_uint8  byte[ KMP_BAR_HIER_MAX_FANOUT ];
+            } leaf_mask;
+
+            KMP_DEBUG_ASSERT( span <= KMP_BAR_HIER_MAX_FANOUT );
+            leaf_mask.word = 0;
+            for ( child_tid = tid + 1;
+                  child_tid < tid + span && child_tid < num_threads;
+                  child_tid++ )
+            {
+                leaf_mask.byte[ child_tid - tid ] = 1;
+            }
+
+            if (new_state == KMP_BARRIER_UNUSED_STATE)
+                new_state = team -> t.t_bar[ bt ].b_arrived + KMP_BARRIER_STATE_BUMP;
+
+            KA_TRACE( 20, ( "__kmp_hierarchical_barrier_gather: T#%d(%d:%d) wait leaf arrived(%p) "
+                            "& 0x%llx\n",
+                            gtid, team->t.t_id, tid, &thr_bar -> b_leaf_arrived,
+                            (unsigned long long) leaf_mask.word ) );
+
+            __kmp_wait_oncore( this_thr, &thr_bar -> b_leaf_arrived, leaf_mask.word );
+
+            //
+            // No child writes the word again before we release it, so the
+            // flags can be cleared with a plain store.
+            //
+            TCW_8( thr_bar -> b_leaf_arrived, 0 );
+
+            if (reduce) {
+                for ( child_tid = tid + 1;
+                      child_tid < tid + span && child_tid < num_threads;
+                      child_tid++ )
+                {
+                    KA_TRACE( 100, ( "__kmp_hierarchical_barrier_gather: T#%d(%d:%d) += T#%d(%d:%d)\n",
+                                     gtid, team->t.t_id, tid,
+                                     __kmp_gtid_from_tid( child_tid, team ), team->t.t_id,
+                                     child_tid ) );
+
+                    (*reduce)( this_thr -> th.th_local.reduce_data,
+                               other_threads[ child_tid ] -> th.th_local.reduce_data );
+                }
+            }
+            continue;
+        }
+
+        for ( child_tid = tid + skip;
+              child_tid < tid + span && child_tid < num_threads;
+              child_tid += skip )
+        {
+            register kmp_info_t   *child_thr = other_threads[ child_tid ];
+            register kmp_bstate_t *child_bar = & child_thr -> th.th_bar[ bt ].bb;
+#if KMP_CACHE_MANAGE
+            /* prefetch next thread's arrived count */
+            if ( child_tid + skip < tid + span && child_tid + skip < num_threads )
+                KMP_CACHE_PREFETCH( &other_threads[ child_tid + skip ] -> th.th_bar[ bt ].bb.b_arrived );
+#endif /* KMP_CACHE_MANAGE */
+            /* Only read this arrived flag once per thread that needs it */
+            if (new_state == KMP_BARRIER_UNUSED_STATE)
+                new_state = team -> t.t_bar[ bt ].b_arrived + KMP_BARRIER_STATE_BUMP;
+
+            KA_TRACE( 20, ( "__kmp_hierarchical_barrier_gather: T#%d(%d:%d) wait T#%d(%d:%d) "
+                            "arrived(%p) == %u\n",
+                            gtid, team->t.t_id, tid,
+                            __kmp_gtid_from_tid( child_tid, team ), team->t.t_id, child_tid,
+                            &child_bar -> b_arrived, new_state ) );
+
+            /* wait for child to arrive */
+            __kmp_wait_sleep( this_thr, &child_bar -> b_arrived, new_state, FALSE
+                              );
+
+            if (reduce) {
+
+                KA_TRACE( 100, ( "__kmp_hierarchical_barrier_gather: T#%d(%d:%d) += T#%d(%d:%d)\n",
+                                 gtid, team->t.t_id, tid,
+                                 __kmp_gtid_from_tid( child_tid, team ), team->t.t_id,
+                                 child_tid ) );
+
+                (*reduce)( this_thr -> th.th_local.reduce_data,
+                           child_thr -> th.th_local.reduce_data );
+
+            }
+        }
+    }
+
+    if ( KMP_MASTER_TID(tid) ) {
+        /* Need to update the team arrived pointer if we are the master thread */
+
+        if (new_state == KMP_BARRIER_UNUSED_STATE)
+            team -> t.t_bar[ bt ].b_arrived += KMP_BARRIER_STATE_BUMP;
+        else
+            team -> t.t_bar[ bt ].b_arrived = new_state;
+
+        KA_TRACE( 20, ( "__kmp_hierarchical_barrier_gather: T#%d(%d:%d) set team %d arrived(%p) = %u\n",
+                        gtid, team->t.t_id, tid, team->t.t_id,
+                        &team->t.t_bar[bt].b_arrived, team->t.t_bar[bt].b_arrived ) );
+    }
+
+    KA_TRACE( 20, ( "__kmp_hierarchical_barrier_gather: T#%d(%d:%d) exit for barrier type %d\n",
+                    gtid, team->t.t_id, tid, bt ) );
+}
+
+static void
+__kmp_hierarchical_barrier_release( enum barrier_type bt,
+                                    kmp_info_t *this_thr,
+                                    int gtid,
+                                    int tid,
+                                    int propagate_icvs
+                                    )
+{
+    /* handle fork barrier workers who aren't part of a team yet */
+    register kmp_team_t    *team;
+    register kmp_bstate_t  *thr_bar       = & this_thr -> th.th_bar[ bt ].bb;
+    register kmp_info_t   **other_threads;
+    register kmp_uint32     num_threads;
+    register kmp_uint32     level;
+
+    /*
+     * We now perform a hierarchical release in the reverse order of the
+     * gather: the subtrees farthest away (other packages) are woken first so
+     * that they can start releasing their own children as early as possible.
+     */
+
+    if ( ! KMP_MASTER_TID( tid )) {
+        /* worker threads */
+
+        KA_TRACE( 20, ( "__kmp_hierarchical_barrier_release: T#%d wait go(%p) == %u\n",
+          gtid, &thr_bar -> b_go, KMP_BARRIER_STATE_BUMP ) );
+
+        /* wait for parent thread to release us */
+        __kmp_wait_sleep( this_thr, &thr_bar -> b_go, KMP_BARRIER_STATE_BUMP, TRUE
+                          );
+
+        //
+        // early exit for reaping threads releasing forkjoin barrier
+        //
+        if ( bt == bs_forkjoin_barrier && TCR_4(__kmp_global.g.g_done) )
+            return;
+
+        //
+        // The worker thread may now assume that the team is valid.
+        //
+        team = __kmp_threads[ gtid ]-> th.th_team;
+        KMP_DEBUG_ASSERT( team != NULL );
+        tid = __kmp_tid_from_gtid( gtid );
+
+        TCW_4(thr_bar->b_go, KMP_INIT_BARRIER_STATE);
+        KA_TRACE( 20, ( "__kmp_hierarchical_barrier_release: T#%d(%d:%d) set go(%p) = %u\n",
+          gtid, team->t.t_id, tid, &thr_bar->b_go, KMP_INIT_BARRIER_STATE ) );
+
+        KMP_MB();       /* Flush all pending memory write invalidates.  */
+
+    } else {  /* KMP_MASTER_TID(tid) */
+        team = __kmp_threads[ gtid ]-> th.th_team;
+        KMP_DEBUG_ASSERT( team != NULL );
+
+        KA_TRACE( 20, ( "__kmp_hierarchical_barrier_release: T#%d(%d:%d) master enter for barrier type %d\n",
+          gtid, team->t.t_id, tid, bt ) );
+    }
+
+    num_threads = this_thr -> th.th_team_nproc;
+    other_threads = team -> t.t_threads;
+
+    /* count up to the level at which we are a child */
+    for ( level = 0;
+          level <= __kmp_bar_hier_depth && __kmp_bar_hier_skip[ level ] < num_threads
+            && (kmp_uint32)tid % KMP_BAR_HIER_SPAN( level, num_threads ) == 0;
+          level++ );
+
+    /* now go down from there, releasing the highest children first */
+    while ( level-- > 0 ) {
+        register kmp_uint32 skip = __kmp_bar_hier_skip[ level ];
+        register kmp_uint32 last = tid + KMP_BAR_HIER_SPAN( level, num_threads );
+        register kmp_uint32 child_tid;
+
+        if ( last > num_threads )
+            last = num_threads;
+        child_tid = tid + ( ( last - 1 - tid ) / skip ) * skip;
+
+        for ( ; child_tid > (kmp_uint32)tid; child_tid -= skip ) {
+            register kmp_info_t   *child_thr = other_threads[ child_tid ];
+            register kmp_bstate_t *child_bar = & child_thr -> th.th_bar[ bt ].bb;
+#if KMP_CACHE_MANAGE
+            /* prefetch next thread's go count */
+            if ( child_tid - skip > (kmp_uint32)tid )
+                KMP_CACHE_PREFETCH( &other_threads[ child_tid - skip ]->th.th_bar[ bt ].bb.b_go );
+#endif /* KMP_CACHE_MANAGE */
+
+#if KMP_BARRIER_ICV_PUSH
+            if ( propagate_icvs ) {
+                __kmp_init_implicit_task( team->t.t_ident,
+                  team->t.t_threads[child_tid], team, child_tid, FALSE );
+                copy_icvs( &team->t.t_implicit_task_taskdata[child_tid].td_icvs,
+                  &team->t.t_implicit_task_taskdata[tid].td_icvs );
+            }
+#endif // KMP_BARRIER_ICV_PUSH
+
+            KA_TRACE( 20, ( "__kmp_hierarchical_barrier_release: T#%d(%d:%d) releasing T#%d(%d:%d)"
+                            "go(%p): %u => %u\n",
+                            gtid, team->t.t_id, tid,
+                            __kmp_gtid_from_tid( child_tid, team ), team->t.t_id,
+                            child_tid, &child_bar -> b_go, child_bar -> b_go,
+                            child_bar -> b_go + KMP_BARRIER_STATE_BUMP ) );
+
+            /* release child from barrier */
+            __kmp_release( child_thr, &child_bar -> b_go, kmp_acquire_fence );
+        }
+    }
+
+    KA_TRACE( 20, ( "__kmp_hierarchical_barrier_release: T#%d(%d:%d) exit for barrier type %d\n",
+      gtid, team->t.t_id, tid, bt ) );
+}
+
+#undef KMP_BAR_HIER_SPAN
+#undef KMP_BAR_HIER_ONCORE
+
+
 /*
  * Internal function to do a barrier.
  * If is_split is true, do a split barrier, otherwise, do a plain barrier
@@ -1927,6 +2439,8 @@ __kmp_barrier( enum barrier_type bt, int gtid, int is_split,
                     gtid, __kmp_team_from_gtid(gtid)->t.t_id, __kmp_tid_from_gtid(gtid) ) );
 
     if ( ! team->t.t_serialized ) {
+        KMP_OMPT_STATE_ENTER( this_thr, ompt_prev_state, ompt_state_wait_barrier, 0 );
+        KMP_OMPT_CALLBACK( ompt_event_barrier_begin, ( team->t.t_ompt_parallel_id, KMP_OMPT_TASK_ID( this_thr ) ) );
         #if OMP_30_ENABLED
             if ( __kmp_tasking_mode == tskm_extra_barrier ) {
                 __kmp_tasking_barrier( team, this_thr, gtid );
@@ -1957,16 +2471,22 @@ __kmp_barrier( enum barrier_type bt, int gtid, int is_split,
             //KMP_DEBUG_ASSERT( is_split == TRUE );  // #C69956
             this_thr -> th.th_local.reduce_data = reduce_data;
         }
+        KMP_STATS_COUNT( this_thr, KMP_STAT_BARRIER );
+        KMP_STATS_TIMER_START( this_thr, gather_start );
         if ( __kmp_barrier_gather_pattern[ bt ] == bp_linear_bar || __kmp_barrier_gather_branch_bits[ bt ] == 0 ) {
             __kmp_linear_barrier_gather( bt, this_thr, gtid, tid, reduce
                                          );
         } else if ( __kmp_barrier_gather_pattern[ bt ] == bp_tree_bar ) {
             __kmp_tree_barrier_gather( bt, this_thr, gtid, tid, reduce
                                        );
+        } else if ( __kmp_barrier_gather_pattern[ bt ] == bp_hierarchical_bar ) {
+            __kmp_hierarchical_barrier_gather( bt, this_thr, gtid, tid, reduce
+                                               );
         } else {
             __kmp_hyper_barrier_gather( bt, this_thr, gtid, tid, reduce
                                         );
         }; // if
+        KMP_STATS_TIMER_STOP( this_thr, KMP_TIMER_BARRIER_GATHER, gather_start );
 
 
         KMP_MB();
@@ -1986,22 +2506,29 @@ __kmp_barrier( enum barrier_type bt, int gtid, int is_split,
             status = 1;
         }
         if ( status == 1 || ! is_split ) {
+            KMP_STATS_TIMER_START( this_thr, release_start );
             if ( __kmp_barrier_release_pattern[ bt ] == bp_linear_bar || __kmp_barrier_release_branch_bits[ bt ] == 0 ) {
                 __kmp_linear_barrier_release( bt, this_thr, gtid, tid, FALSE
                                               );
             } else if ( __kmp_barrier_release_pattern[ bt ] == bp_tree_bar ) {
                 __kmp_tree_barrier_release( bt, this_thr, gtid, tid, FALSE
                                             );
+            } else if ( __kmp_barrier_release_pattern[ bt ] == bp_hierarchical_bar ) {
+                __kmp_hierarchical_barrier_release( bt, this_thr, gtid, tid, FALSE
+                                                    );
             } else {
                 __kmp_hyper_barrier_release( bt, this_thr, gtid, tid, FALSE
                                              );
             }
+            KMP_STATS_TIMER_STOP( this_thr, KMP_TIMER_BARRIER_RELEASE, release_start );
             #if OMP_30_ENABLED
                 if ( __kmp_tasking_mode != tskm_immediate_exec ) {
                     __kmp_task_team_sync( this_thr, team );
                 }
             #endif /* OMP_30_ENABLED */
         }
+        KMP_OMPT_CALLBACK( ompt_event_barrier_end, ( team->t.t_ompt_parallel_id, KMP_OMPT_TASK_ID( this_thr ) ) );
+        KMP_OMPT_STATE_EXIT( this_thr, ompt_prev_state );
 
 
     } else {    // Team is serialized.
@@ -2036,16 +2563,21 @@ __kmp_end_split_barrier( enum barrier_type bt, int gtid )
 
     if( ! team -> t.t_serialized ) {
         if( KMP_MASTER_GTID( gtid ) ) {
+            KMP_STATS_TIMER_START( this_thr, release_start );
             if ( __kmp_barrier_release_pattern[ bt ] == bp_linear_bar || __kmp_barrier_release_branch_bits[ bt ] == 0 ) {
                 __kmp_linear_barrier_release( bt, this_thr, gtid, tid, FALSE
                                               );
             } else if ( __kmp_barrier_release_pattern[ bt ] == bp_tree_bar ) {
                 __kmp_tree_barrier_release( bt, this_thr, gtid, tid, FALSE
                                             );
+            } else if ( __kmp_barrier_release_pattern[ bt ] == bp_hierarchical_bar ) {
+                __kmp_hierarchical_barrier_release( bt, this_thr, gtid, tid, FALSE
+                                                    );
             } else {
                 __kmp_hyper_barrier_release( bt, this_thr, gtid, tid, FALSE
                                              );
             }; // if
+            KMP_STATS_TIMER_STOP( this_thr, KMP_TIMER_BARRIER_RELEASE, release_start );
             #if OMP_30_ENABLED
                 if ( __kmp_tasking_mode != tskm_immediate_exec ) {
                     __kmp_task_team_sync( this_thr, team );
@@ -2058,6 +2590,20 @@ __kmp_end_split_barrier( enum barrier_type bt, int gtid )
 /* ------------------------------------------------------------------------ */
 /* ------------------------------------------------------------------------ */
 
+/*
+ * Return the slot in which master_th keeps its hot team for the given active
+ * nesting level, or NULL if teams at that level are not kept hot.  Level 1 is
+ * the root's hot team (root->r.r_hot_team) and has no slot here.
+ */
+static kmp_hot_team_t *
+__kmp_nested_hot_team( kmp_info_t *master_th, int level )
+{
+    if ( ( master_th == NULL ) || ( level < 2 ) || ( level > __kmp_hot_teams_max_level ) ) {
+        return NULL;
+    }
+    return & master_th->th.th_hot_teams[ level - 2 ];
+}
+
 /*
  * determine if we can go parallel or must use a serialized parallel region and
  * how many threads we can use
@@ -2074,6 +2620,7 @@ __kmp_reserve_threads( kmp_root_t *root, kmp_team_t *parent_team,
     int capacity;
     int new_nthreads;
     int use_rml_to_adjust_nth;
+    int hot_nth;
     KMP_DEBUG_ASSERT( __kmp_init_serial );
     KMP_DEBUG_ASSERT( root && parent_team );
 
@@ -2092,6 +2639,24 @@ __kmp_reserve_threads( kmp_root_t *root, kmp_team_t *parent_team,
         return 1;
     }
 
+    //
+    // Threads of the hot team this fork will reuse are already counted in
+    // __kmp_nth; at an inner level that is only the master, unless it keeps
+    // a hot team for that level.
+    //
+    if ( ! root->r.r_active ) {
+        hot_nth = root->r.r_hot_team->t.t_nproc;
+    }
+    else {
+        kmp_hot_team_t *hot_team = NULL;
+#if OMP_30_ENABLED
+        hot_team = __kmp_nested_hot_team( parent_team->t.t_threads[ master_tid ],
+          parent_team->t.t_active_level + 1 );
+#endif // OMP_30_ENABLED
+        hot_nth = ( ( hot_team != NULL ) && ( hot_team->ht_team != NULL ) )
+          ? hot_team->ht_team->t.t_nproc : 1;
+    }
+
     //
     // If dyn-var is set, dynamically adjust the number of desired threads,
     // according to the method specified by dynamic_mode.
@@ -2116,8 +2681,7 @@ __kmp_reserve_threads( kmp_root_t *root, kmp_team_t *parent_team,
     }
 #endif /* USE_LOAD_BALANCE */
     else if ( __kmp_global.g.g_dynamic_mode == dynamic_thread_limit ) {
-        new_nthreads = __kmp_avail_proc - __kmp_nth + (root->r.r_active ? 1
-          : root->r.r_hot_team->t.t_nproc);
+        new_nthreads = __kmp_avail_proc - __kmp_nth + hot_nth;
         if ( new_nthreads <= 1 ) {
             KC_TRACE( 10, ( "__kmp_reserve_threads: T#%d thread limit reduced reservation to 1 thread\n",
               master_tid ));
@@ -2153,10 +2717,8 @@ __kmp_reserve_threads( kmp_root_t *root, kmp_team_t *parent_team,
     //
     // Respect KMP_ALL_THREADS, KMP_MAX_THREADS, OMP_THREAD_LIMIT.
     //
-    if ( __kmp_nth + new_nthreads - ( root->r.r_active ? 1 :
-      root->r.r_hot_team->t.t_nproc ) > __kmp_max_nth ) {
-        int tl_nthreads = __kmp_max_nth - __kmp_nth + ( root->r.r_active ? 1 :
-          root->r.r_hot_team->t.t_nproc );
+    if ( __kmp_nth + new_nthreads - hot_nth > __kmp_max_nth ) {
+        int tl_nthreads = __kmp_max_nth - __kmp_nth + hot_nth;
         if ( tl_nthreads <= 0 ) {
             tl_nthreads = 1;
         }
@@ -2195,13 +2757,11 @@ __kmp_reserve_threads( kmp_root_t *root, kmp_team_t *parent_team,
     if ( TCR_PTR(__kmp_threads[0]) == NULL ) {
         --capacity;
     }
-    if ( __kmp_nth + new_nthreads - ( root->r.r_active ? 1 :
-      root->r.r_hot_team->t.t_nproc ) > capacity ) {
+    if ( __kmp_nth + new_nthreads - hot_nth > capacity ) {
         //
         // Expand the threads array.
         //
-        int slotsRequired = __kmp_nth + new_nthreads - ( root->r.r_active ? 1 :
-          root->r.r_hot_team->t.t_nproc ) - capacity;
+        int slotsRequired = __kmp_nth + new_nthreads - hot_nth - capacity;
         int slotsAdded = __kmp_expand_threads(slotsRequired, slotsRequired);
         if ( slotsAdded < slotsRequired ) {
             //
@@ -2259,7 +2819,8 @@ static void
 __kmp_fork_team_threads( kmp_root_t *root, kmp_team_t *team,
                          kmp_info_t *master_th, int master_gtid )
 {
-    int         i;
+    int             i;
+    kmp_hot_team_t *hot_team = NULL;
 
     KA_TRACE( 10, ("__kmp_fork_team_threads: new_nprocs = %d\n", team->t.t_nproc ) );
     KMP_DEBUG_ASSERT( master_gtid == __kmp_get_gtid() );
@@ -2273,8 +2834,12 @@ __kmp_fork_team_threads( kmp_root_t *root, kmp_team_t *team,
     master_th -> th.th_team_serialized = FALSE;
     master_th -> th.th_dispatch        = & team -> t.t_dispatch[ 0 ];
 
-    /* make sure we are not the optimized hot team */
-    if ( team != root->r.r_hot_team ) {
+#if OMP_30_ENABLED
+    hot_team = __kmp_nested_hot_team( master_th, team->t.t_active_level );
+#endif // OMP_30_ENABLED
+
+    /* make sure we are not the optimized hot team, nor a nested one that kept its threads */
+    if ( team != root->r.r_hot_team && ( hot_team == NULL || team != hot_team->ht_team ) ) {
 
         /* install the master thread */
         team -> t.t_threads[ 0 ]    = master_th;
@@ -2346,6 +2911,9 @@ __kmp_fork_call(
     int             master_active;
     int             master_set_numthreads;
     int             level;
+#if OMPT_SUPPORT
+    kmp_uint64      ompt_parent_task_id;
+#endif
 
     KA_TRACE( 20, ("__kmp_fork_call: enter T#%d\n", gtid ));
 
@@ -2363,6 +2931,10 @@ __kmp_fork_call(
     root          = master_th -> th.th_root;
     master_active = root -> r.r_active;
     master_set_numthreads = master_th -> th.th_set_nproc;
+    KMP_STATS_COUNT( master_th, KMP_STAT_FORK );
+#if OMPT_SUPPORT
+    ompt_parent_task_id = KMP_OMPT_TASK_ID( master_th );
+#endif
 #if OMP_30_ENABLED
     // Nested level will be an index in the nested nthreads array
     level         = parent_team->t.t_level;
@@ -2441,6 +3013,11 @@ __kmp_fork_call(
         return FALSE;
     }
 
+    KMP_OMPT_STATE_ENTER( master_th, ompt_master_state, ompt_state_overhead, 0 );
+#if OMPT_SUPPORT && OMP_30_ENABLED
+    master_th->th.th_current_task->td_ompt_frame.reenter_runtime_frame = KMP_OMPT_FRAME_ADDRESS();
+#endif
+
 #if OMP_30_ENABLED
     // GEH: only modify the executing flag in the case when not serialized
     //      serialized case is handled in kmpc_serialized_parallel
@@ -2540,7 +3117,7 @@ __kmp_fork_call(
 #if OMP_40_ENABLED
           proc_bind,
 #endif
-          &new_icvs, argc );
+          &new_icvs, argc, master_th );
     } else
 #endif /* OMP_30_ENABLED */
     {
@@ -2560,7 +3137,7 @@ __kmp_fork_call(
                 parent_team->t.t_set_bt_intervals[master_tid],
                 parent_team->t.t_set_bt_set[master_tid],
 #endif // OMP_30_ENABLED
-                argc );
+                argc, master_th );
     }
 
     KF_TRACE( 10, ( "__kmp_fork_call: after __kmp_allocate_team - team = %p\n",
@@ -2603,7 +3180,9 @@ __kmp_fork_call(
                         __kmp_gtid_from_thread( master_th ), master_th->th.th_task_team,
                         parent_team, team->t.t_task_team, team ) );
         master_th->th.th_task_team = team->t.t_task_team;
-        KMP_DEBUG_ASSERT( ( master_th->th.th_task_team == NULL ) || ( team == root->r.r_hot_team ) ) ;
+        KMP_DEBUG_ASSERT( ( master_th->th.th_task_team == NULL ) || ( team == root->r.r_hot_team )
+          || ( __kmp_nested_hot_team( master_th, team->t.t_active_level ) != NULL
+            && team == __kmp_nested_hot_team( master_th, team->t.t_active_level )->ht_team ) ) ;
     }
 #endif // OMP_30_ENABLED
 
@@ -2635,7 +3214,12 @@ __kmp_fork_call(
 
     __kmp_release_bootstrap_lock( &__kmp_forkjoin_lock );
 
-
+#if OMPT_SUPPORT
+    team->t.t_ompt_master_state = ompt_master_state;
+    team->t.t_ompt_parallel_id = KMP_OMPT_NEW_ID();
+    KMP_OMPT_CALLBACK( ompt_event_parallel_begin, ( ompt_parent_task_id, team->t.t_ompt_parallel_id,
+                                                    team->t.t_nproc, (void *) microtask ) );
+#endif
 
     /* now go on and do the work */
     KMP_DEBUG_ASSERT( team == __kmp_threads[gtid]->th.th_team );
@@ -2648,6 +3232,8 @@ __kmp_fork_call(
     KF_TRACE( 10, ( "__kmp_internal_fork : after : root=%p, team=%p, master_th=%p, gtid=%d\n", root, team, master_th, gtid ) );
 
     if (! exec_master) {
+        // the master runs its part of the region in the caller (GNU codegen)
+        KMP_OMPT_SET_STATE( master_th, ompt_state_work_parallel );
         KA_TRACE( 20, ("__kmp_fork_call: parallel exit T#%d\n", gtid ));
         return TRUE;
     }
@@ -2676,8 +3262,13 @@ __kmp_join_call(ident_t *loc, int gtid)
     kmp_team_t     *parent_team;
     kmp_info_t     *master_th;
     kmp_root_t     *root;
+    kmp_hot_team_t *hot_team;
     int             master_active;
     int             i;
+#if OMPT_SUPPORT
+    kmp_uint64      ompt_parallel_id;
+    ompt_state_t    ompt_master_state;
+#endif
 
     KA_TRACE( 20, ("__kmp_join_call: enter T#%d\n", gtid ));
 
@@ -2686,6 +3277,7 @@ __kmp_join_call(ident_t *loc, int gtid)
     root          = master_th -> th.th_root;
     team          = master_th -> th.th_team;
     parent_team   = team->t.t_parent;
+    KMP_STATS_COUNT( master_th, KMP_STAT_JOIN );
 
     master_th->th.th_ident = loc;
 
@@ -2705,8 +3297,13 @@ __kmp_join_call(ident_t *loc, int gtid)
 
     master_active = team->t.t_master_active;
 
+    KMP_OMPT_SET_STATE( master_th, ompt_state_overhead );
     __kmp_internal_join( loc, gtid, team );
     KMP_MB();
+#if OMPT_SUPPORT
+    ompt_parallel_id = team->t.t_ompt_parallel_id;
+    ompt_master_state = team->t.t_ompt_master_state;
+#endif
 
 
     /* do cleanup and restore the parent team */
@@ -2752,6 +3349,23 @@ __kmp_join_call(ident_t *loc, int gtid)
     if ( root -> r.r_active != master_active )
         root -> r.r_active = master_active;
 
+#if OMP_30_ENABLED
+    //
+    // Keep an inner team, with its threads, task team and dispatch buffers,
+    // for the master's next fork at this level (KMP_HOT_TEAMS_MAX_LEVEL).
+    //
+    hot_team = __kmp_nested_hot_team( master_th, team->t.t_active_level );
+    if ( hot_team != NULL ) {
+        if ( hot_team->ht_team == NULL ) {
+            KA_TRACE( 20, ("__kmp_join_call: T#%d keeping team %d as nested hot team at level %d\n",
+                           gtid, team->t.t_id, team->t.t_active_level ));
+            hot_team->ht_team = team;
+        }
+        KMP_DEBUG_ASSERT( hot_team->ht_team == team );
+        hot_team->ht_task_state = master_th->th.th_task_state;
+    }
+#endif // OMP_30_ENABLED
+
     __kmp_free_team( root, team ); /* this will free worker threads */
 
     /* this race was fun to find.  make sure the following is in the critical
@@ -2796,6 +3410,14 @@ __kmp_join_call(ident_t *loc, int gtid)
 
     __kmp_release_bootstrap_lock( &__kmp_forkjoin_lock );
 
+    KMP_OMPT_CALLBACK( ompt_event_parallel_end, ( ompt_parallel_id, KMP_OMPT_TASK_ID( master_th ) ) );
+#if OMPT_SUPPORT
+  #if OMP_30_ENABLED
+    master_th->th.th_current_task->td_ompt_frame.reenter_runtime_frame = NULL;
+  #endif
+    KMP_OMPT_STATE_EXIT( master_th, ompt_master_state );
+#endif
+
     KMP_MB();
     KA_TRACE( 20, ("__kmp_join_call: exit T#%d\n", gtid ));
 }
@@ -3080,11 +3702,9 @@ __kmp_get_schedule( int gtid, kmp_sched_t * kind, int * chunk )
     case kmp_sch_trapezoidal:
         *kind = kmp_sched_trapezoidal;
         break;
-/*
     case kmp_sch_static_steal:
         *kind = kmp_sched_static_steal;
         break;
-*/
     default:
         KMP_FATAL( UnknownSchedulingType, th_type );
     }
@@ -3263,22 +3883,29 @@ static void
 __kmp_allocate_team_arrays(kmp_team_t *team, int max_nth)
 {
     int i;
-    int num_disp_buff = max_nth > 1 ? KMP_MAX_DISP_BUF : 2;
+    int num_disp_buff = 2;
+
+    if ( max_nth > 1 ) {
+        // keep the ring size a reallocated team has grown to
+        num_disp_buff = team->t.t_disp_num_buffers > __kmp_dispatch_num_buffers ?
+            team->t.t_disp_num_buffers : __kmp_dispatch_num_buffers;
+    }
 #if KMP_USE_POOLED_ALLOC
     char *ptr = __kmp_allocate(max_nth *
-                            ( sizeof(kmp_info_t*) + sizeof(dispatch_shared_info_t)*2
-                               + sizeof(kmp_disp_t) + sizeof(int)*6
+                            ( sizeof(kmp_info_t*)
+                               + sizeof(kmp_disp_t) + sizeof(int)*7
 #  if OMP_30_ENABLED
                                //+ sizeof(int)
                                + sizeof(kmp_r_sched_t)
                                + sizeof(kmp_taskdata_t)
 #  endif // OMP_30_ENABLED
-                        )     );
+                        ) + sizeof(dispatch_shared_info_t) * num_disp_buff );
 
     team -> t.t_threads          = (kmp_info_t**) ptr; ptr += sizeof(kmp_info_t*) * max_nth;
     team -> t.t_disp_buffer      = (dispatch_shared_info_t*) ptr;
                                    ptr += sizeof(dispatch_shared_info_t) * num_disp_buff;
     team -> t.t_dispatch         = (kmp_disp_t*) ptr; ptr += sizeof(kmp_disp_t) * max_nth;
+    team -> t.t_static_rank      = (int*) ptr; ptr += sizeof(int) * max_nth;
     team -> t.t_set_nproc        = (int*) ptr; ptr += sizeof(int) * max_nth;
     team -> t.t_set_dynamic      = (int*) ptr; ptr += sizeof(int) * max_nth;
     team -> t.t_set_nested       = (int*) ptr; ptr += sizeof(int) * max_nth;
@@ -3299,6 +3926,7 @@ __kmp_allocate_team_arrays(kmp_team_t *team, int max_nth)
     team -> t.t_disp_buffer = (dispatch_shared_info_t*)
         __kmp_allocate( sizeof(dispatch_shared_info_t) * num_disp_buff );
     team -> t.t_dispatch = (kmp_disp_t*) __kmp_allocate( sizeof(kmp_disp_t) * max_nth );
+    team -> t.t_static_rank = (int*) __kmp_allocate( sizeof(int) * max_nth );
     #if OMP_30_ENABLED
     //team -> t.t_set_max_active_levels = (int*) __kmp_allocate( sizeof(int) * max_nth );
     //team -> t.t_set_sched = (kmp_r_sched_t*) __kmp_allocate( sizeof(kmp_r_sched_t) * max_nth );
@@ -3317,8 +3945,91 @@ __kmp_allocate_team_arrays(kmp_team_t *team, int max_nth)
     /* setup dispatch buffers */
     for(i = 0 ; i < num_disp_buff; ++i)
         team -> t.t_disp_buffer[i].buffer_index = i;
+    for(i = 0 ; i < max_nth; ++i)
+        team -> t.t_static_rank[i] = i;
+    team->t.t_disp_num_buffers = num_disp_buff;
+    team->t.t_disp_buffer_waited = FALSE;
 }
 
+#if !KMP_USE_POOLED_ALLOC
+/*
+ * Double the team's ring of dispatch buffers after a thread had to wait for a
+ * free one, i.e. ran more than t_disp_num_buffers nowait loops ahead of the
+ * slowest thread.  The master calls this from __kmp_internal_fork, while no
+ * thread of the team is in the dispatcher.
+ */
+static void
+__kmp_grow_disp_buffers( kmp_team_t *team )
+{
+    int i;
+    int num_disp_buff = team->t.t_disp_num_buffers * 2;
+
+    team->t.t_disp_buffer_waited = FALSE;
+    if ( team->t.t_disp_num_buffers >= KMP_MAX_DISP_NUM_BUFF ) {
+        return;
+    }
+    if ( num_disp_buff > KMP_MAX_DISP_NUM_BUFF ) {
+        num_disp_buff = KMP_MAX_DISP_NUM_BUFF;
+    }
+    KA_TRACE( 20, ( "__kmp_grow_disp_buffers: team %d: %d -> %d dispatch buffers\n",
+                    team->t.t_id, team->t.t_disp_num_buffers, num_disp_buff ) );
+
+    __kmp_free( team->t.t_disp_buffer );
+    team->t.t_disp_buffer = (dispatch_shared_info_t*)
+        __kmp_allocate( sizeof(dispatch_shared_info_t) * num_disp_buff );
+    for ( i = 0; i < team->t.t_max_nproc; ++ i ) {
+        kmp_disp_t *dispatch = & team->t.t_dispatch[ i ];
+
+        if ( dispatch->th_disp_buffer != NULL ) {
+            __kmp_free( dispatch->th_disp_buffer );
+            dispatch->th_disp_buffer = (dispatch_private_info_t *)
+                __kmp_allocate( sizeof( dispatch_private_info_t ) * num_disp_buff );
+        }; // if
+        dispatch->th_dispatch_pr_current = 0;
+        dispatch->th_dispatch_sh_current = 0;
+    }; // for
+    team->t.t_disp_num_buffers = num_disp_buff;
+}
+#endif /* !KMP_USE_POOLED_ALLOC */
+
+#if KMP_OS_LINUX || KMP_OS_WINDOWS
+/*
+ * Rank the team's threads by (node, tid) for KMP_STATIC_NUMA.  The static
+ * schedule gives block r to the thread of rank r, so neighbouring blocks go
+ * to threads of the same node, and a thread gets the same block loop after
+ * loop as long as its place does not change.  If any thread is not bound to
+ * a single place, the ranks stay the tids.
+ */
+static void
+__kmp_set_static_ranks( kmp_team_t *team )
+{
+    int  nproc = team->t.t_nproc;
+    int *rank  = team->t.t_static_rank;
+    int  f, node, r;
+
+    /* first pass: rank[f] = -1 - (node of thread f) */
+    for ( f = 0; f < nproc; ++ f ) {
+        node = __kmp_affinity_thread_node( team->t.t_threads[ f ] );
+        if ( node < 0 ) {
+            for ( f = 0; f < nproc; ++ f )
+                rank[ f ] = f;
+            return;
+        }
+        rank[ f ] = -1 - node;
+    }
+    /* second pass: number the threads node by node, in tid order */
+    r = 0;
+    for ( node = 0; node < __kmp_affinity_num_nodes; ++ node ) {
+        for ( f = 0; f < nproc; ++ f ) {
+            if ( rank[ f ] == -1 - node ) {
+                rank[ f ] = r ++;
+            }
+        }
+    }
+    KMP_DEBUG_ASSERT( r == nproc );
+}
+#endif /* KMP_OS_LINUX || KMP_OS_WINDOWS */
+
 static void
 __kmp_free_team_arrays(kmp_team_t *team) {
     /* Note: this does not free the threads in t_threads (__kmp_free_threads) */
@@ -3333,6 +4044,7 @@ __kmp_free_team_arrays(kmp_team_t *team) {
     #if !KMP_USE_POOLED_ALLOC
         __kmp_free(team->t.t_disp_buffer);
         __kmp_free(team->t.t_dispatch);
+        __kmp_free(team->t.t_static_rank);
         #if OMP_30_ENABLED
         //__kmp_free(team->t.t_set_max_active_levels);
         //__kmp_free(team->t.t_set_sched);
@@ -3370,6 +4082,7 @@ __kmp_reallocate_team_arrays(kmp_team_t *team, int max_nth) {
     #if !KMP_USE_POOLED_ALLOC
         __kmp_free(team->t.t_disp_buffer);
         __kmp_free(team->t.t_dispatch);
+        __kmp_free(team->t.t_static_rank);
         #if OMP_30_ENABLED
         //__kmp_free(team->t.t_set_max_active_levels);
         //__kmp_free(team->t.t_set_sched);
@@ -3493,7 +4206,8 @@ __kmp_initialize_root( kmp_root_t *root )
             __kmp_bt_intervals,                                        // bt_intervals
             __kmp_env_blocktime,                                       // bt_set
 #endif // OMP_30_ENABLED
-            0                                                          // argc
+            0,                                                         // argc
+            NULL                                                       // master
         );
 
     KF_TRACE( 10, ( "__kmp_initialize_root: after root_team = %p\n", root_team ) );
@@ -3534,7 +4248,8 @@ __kmp_initialize_root( kmp_root_t *root )
             __kmp_bt_intervals,                                        // bt_intervals
             __kmp_env_blocktime,                                       // bt_set
 #endif // OMP_30_ENABLED
-            0                                                          // argc
+            0,                                                         // argc
+            NULL                                                       // master
         );
     KF_TRACE( 10, ( "__kmp_initialize_root: after hot_team = %p\n", hot_team ) );
 
@@ -4098,6 +4813,9 @@ __kmp_register_root( int initial_thread )
         #if USE_FAST_MEMORY
             __kmp_initialize_fast_memory( root_thread );
         #endif /* USE_FAST_MEMORY */
+        #if KMP_STATS_ENABLED
+            __kmp_stats_thread_init( root_thread, gtid );
+        #endif
 
         #if KMP_USE_BGET
             KMP_DEBUG_ASSERT( root_thread -> th.th_local.bget_data == NULL );
@@ -4126,7 +4844,7 @@ __kmp_register_root( int initial_thread )
           __kmp_bt_intervals,
           __kmp_env_blocktime,
 #endif // OMP_30_ENABLED
-          0 );
+          0, NULL );
     }
     KMP_ASSERT( root_thread -> th.th_serial_team );
     KF_TRACE( 10, ( "__kmp_register_root: after serial_team = %p\n",
@@ -4176,6 +4894,9 @@ __kmp_register_root( int initial_thread )
     KMP_MB();
     __kmp_release_bootstrap_lock( &__kmp_forkjoin_lock );
 
+    KMP_OMPT_SET_STATE( root_thread, ompt_state_work_serial );
+    KMP_OMPT_CALLBACK( ompt_event_thread_begin, ( KMP_OMPT_THREAD_ID( gtid ) ) );
+
     return gtid;
 }
 
@@ -4192,12 +4913,15 @@ __kmp_reset_root(int gtid, kmp_root_t *root)
 
     KMP_DEBUG_ASSERT( ! root->r.r_active );
 
+    KMP_OMPT_CALLBACK( ompt_event_thread_end, ( KMP_OMPT_THREAD_ID( gtid ) ) );
+
     root->r.r_root_team = NULL;
     root->r.r_hot_team  = NULL;
         // __kmp_free_team() does not free hot teams, so we have to clear r_hot_team before call
         // to __kmp_free_team().
     __kmp_free_team( root, root_team );
     __kmp_free_team( root, hot_team );
+    __kmp_free_hot_teams( root, root->r.r_uber_thread );
 
 #if OMP_30_ENABLED
     //
@@ -4379,7 +5103,7 @@ __kmp_initialize_info( kmp_info_t *this_thr, kmp_team_t *team, int tid, int gtid
          * Use team max_nproc since this will never change for the team.
          */
         size_t disp_size = sizeof( dispatch_private_info_t ) *
-            ( team->t.t_max_nproc == 1 ? 1 : KMP_MAX_DISP_BUF );
+            ( team->t.t_max_nproc == 1 ? 1 : team->t.t_disp_num_buffers );
         KD_TRACE( 10, ("__kmp_initialize_info: T#%d max_nproc: %d\n", gtid, team->t.t_max_nproc ) );
         KMP_ASSERT( dispatch );
         KMP_DEBUG_ASSERT( team -> t.t_dispatch );
@@ -4392,7 +5116,7 @@ __kmp_initialize_info( kmp_info_t *this_thr, kmp_team_t *team, int tid, int gtid
 
             if ( __kmp_storage_map ) {
                 __kmp_print_storage_map_gtid( gtid, &dispatch->th_disp_buffer[ 0 ],
-                                         &dispatch->th_disp_buffer[ team->t.t_max_nproc == 1 ? 1 : KMP_MAX_DISP_BUF ],
+                                         &dispatch->th_disp_buffer[ team->t.t_max_nproc == 1 ? 1 : team->t.t_disp_num_buffers ],
                                          disp_size, "th_%d.th_dispatch.th_disp_buffer "
                                          "(team_%d.t_dispatch[%d].th_disp_buffer)",
                                          gtid, team->t.t_id, gtid );
@@ -4489,7 +5213,7 @@ __kmp_allocate_thread( kmp_root_t *root, kmp_team_t *team, int new_tid )
     // If this is the first worker thread the RTL is creating, then also
     // launch the monitor thread.  We try to do this as early as possible.
     //
-    if ( ! TCR_4( __kmp_init_monitor ) ) {
+    if ( __kmp_use_monitor && ! TCR_4( __kmp_init_monitor ) ) {
         __kmp_acquire_bootstrap_lock( & __kmp_monitor_lock );
         if ( ! TCR_4( __kmp_init_monitor ) ) {
             KF_TRACE( 10, ( "before __kmp_create_monitor\n" ) );
@@ -4535,7 +5259,7 @@ __kmp_allocate_thread( kmp_root_t *root, kmp_team_t *team, int new_tid )
                                            team->t.t_set_bt_intervals[0],
                                            team->t.t_set_bt_set[0],
 #endif // OMP_30_ENABLED
-                                           0 );
+                                           0, NULL );
     }
     KMP_ASSERT ( serial_team );
     serial_team -> t.t_threads[0] = new_thr;
@@ -4548,6 +5272,9 @@ __kmp_allocate_thread( kmp_root_t *root, kmp_team_t *team, int new_tid )
     #if USE_FAST_MEMORY
         __kmp_initialize_fast_memory( new_thr );
     #endif /* USE_FAST_MEMORY */
+    #if KMP_STATS_ENABLED
+        __kmp_stats_thread_init( new_thr, new_gtid );
+    #endif
 
     #if KMP_USE_BGET
         KMP_DEBUG_ASSERT( new_thr -> th.th_local.bget_data == NULL );
@@ -4644,7 +5371,9 @@ __kmp_reinitialize_team(
         int new_set_blocktime, int new_bt_intervals, int new_bt_set
     #endif // OMP_30_ENABLED
 ) {
+#if ! ( KMP_BARRIER_ICV_PULL || KMP_BARRIER_ICV_PUSH )
     int f;
+#endif
     #if OMP_30_ENABLED
         KMP_DEBUG_ASSERT( team && new_nproc && new_icvs );
         KMP_DEBUG_ASSERT( ( ! TCR_4(__kmp_init_parallel) ) || new_icvs->nproc );
@@ -5107,10 +5836,11 @@ __kmp_allocate_team( kmp_root_t *root, int new_nproc, int max_nproc,
     int new_set_nproc, int new_set_dynamic, int new_set_nested,
     int new_set_blocktime, int new_bt_intervals, int new_bt_set,
 #endif
-    int argc )
+    int argc, kmp_info_t *master )
 {
     int f;
-    kmp_team_t *team;
+    kmp_team_t *team = NULL;
+    kmp_hot_team_t *hot_team = NULL;
     char *ptr;
     size_t size;
 
@@ -5124,10 +5854,34 @@ __kmp_allocate_team( kmp_root_t *root, int new_nproc, int max_nproc,
     // as it is usually the same
     //
     if ( ! root->r.r_active  &&  new_nproc > 1 ) {
+        team =  root -> r.r_hot_team;
+    }
+#if OMP_30_ENABLED
+    //
+    // an inner level reuses the team its master kept at the last join
+    // at this level, if any (KMP_HOT_TEAMS_MAX_LEVEL)
+    //
+    else if ( new_nproc > 1 && master != NULL ) {
+        hot_team = __kmp_nested_hot_team( master, master->th.th_team->t.t_active_level + 1 );
+        if ( hot_team != NULL && hot_team->ht_team != NULL ) {
+            team = hot_team->ht_team;
+            KA_TRACE( 20, ("__kmp_allocate_team: T#%d reusing nested hot team %d at level %d\n",
+                           __kmp_gtid_from_thread( master ), team->t.t_id,
+                           master->th.th_team->t.t_active_level + 1 ));
+            //
+            // The workers kept toggling their task state along with the
+            // master's state saved at the join; pick that up again.
+            //
+            master->th.th_task_state = hot_team->ht_task_state;
+            // threads allocated below for a growing team expect a master tid
+            master->th.th_info.ds.ds_tid = 0;
+        }
+    }
+#endif // OMP_30_ENABLED
 
-        KMP_DEBUG_ASSERT( new_nproc == max_nproc );
+    if ( team != NULL ) {
 
-        team =  root -> r.r_hot_team;
+        KMP_DEBUG_ASSERT( new_nproc == max_nproc );
 
 #if OMP_30_ENABLED && KMP_DEBUG
         if ( __kmp_tasking_mode != tskm_immediate_exec ) {
@@ -5283,7 +6037,7 @@ __kmp_allocate_team( kmp_root_t *root, int new_nproc, int max_nproc,
                 { // Initialize barrier data for new threads.
                     int b;
                     kmp_balign_t * balign = new_worker->th.th_bar;
-                    for ( b = 0; b < bp_last_bar; ++ b ) {
+                    for ( b = 0; b < bs_last_barrier; ++ b ) {
                         balign[ b ].bb.b_arrived        = team->t.t_bar[ b ].b_arrived;
                     }
                 }
@@ -5523,7 +6277,6 @@ __kmp_allocate_team( kmp_root_t *root, int new_nproc, int max_nproc,
     return team;
 }
 
-/* TODO implement hot-teams at all levels */
 /* TODO implement lazy thread release on demand (disband request) */
 
 /* free the team.  return it to the team pool.  release all the threads
@@ -5532,6 +6285,7 @@ void
 __kmp_free_team( kmp_root_t *root, kmp_team_t *team )
 {
     int f;
+    kmp_hot_team_t *hot_team = NULL;
     KA_TRACE( 20, ("__kmp_free_team: T#%d freeing team %d\n", __kmp_get_gtid(), team->t.t_id ));
 
     /* verify state */
@@ -5545,8 +6299,18 @@ __kmp_free_team( kmp_root_t *root, kmp_team_t *team )
     team -> t.t_copyin_counter = 0; // init counter for possible reuse
     // Do not reset pointer to parent team to NULL for hot teams.
 
+#if OMP_30_ENABLED
+    /* inner teams kept by their master (see __kmp_join_call) keep their threads too */
+    if ( team->t.t_nproc > 1 ) {
+        hot_team = __kmp_nested_hot_team( team->t.t_threads[ 0 ], team->t.t_active_level );
+        if ( hot_team != NULL && hot_team->ht_team != team ) {
+            hot_team = NULL;
+        }
+    }
+#endif // OMP_30_ENABLED
+
     /* if we are a nested team, release our threads */
-    if( team != root->r.r_hot_team ) {
+    if( team != root->r.r_hot_team && hot_team == NULL ) {
 
 #if OMP_30_ENABLED
         if ( __kmp_tasking_mode != tskm_immediate_exec ) {
@@ -5590,6 +6354,29 @@ __kmp_free_team( kmp_root_t *root, kmp_team_t *team )
 }
 
 
+/*
+ * Release the nested hot teams kept by this_th: their workers go back to the
+ * thread pool and the teams to the team pool.  Called with the forkjoin lock
+ * held when this_th leaves its root, as the teams' threads belong to that root.
+ */
+static void
+__kmp_free_hot_teams( kmp_root_t *root, kmp_info_t *this_th )
+{
+    int level;
+
+    for ( level = 0; level < KMP_MAX_HOT_TEAMS_LEVEL - 1; ++ level ) {
+        kmp_team_t *team = this_th->th.th_hot_teams[ level ].ht_team;
+        if ( team != NULL ) {
+            KA_TRACE( 20, ("__kmp_free_hot_teams: T#%d releasing nested hot team %d\n",
+                           __kmp_gtid_from_thread( this_th ), team->t.t_id ));
+            // __kmp_free_team() keeps registered hot teams, so unregister first
+            this_th->th.th_hot_teams[ level ].ht_team = NULL;
+            __kmp_free_team( root, team );
+        }
+    }
+}
+
+
 /* reap the team.  destroy it, reclaim all its resources and free its memory */
 kmp_team_t *
 __kmp_reap_team( kmp_team_t *team )
@@ -5661,6 +6448,8 @@ __kmp_free_thread( kmp_info_t *this_th )
 
     KMP_DEBUG_ASSERT( this_th );
 
+    /* the thread may join another root from the pool, so give up its nested hot teams */
+    __kmp_free_hot_teams( this_th->th.th_root, this_th );
 
     /* put thread back on the free pool */
     TCW_PTR(this_th->th.th_team, NULL);
@@ -5735,6 +6524,10 @@ __kmp_join_barrier( int gtid )
     #ifdef KMP_DEBUG
         int                    team_id;
     #endif /* KMP_DEBUG */
+    #if OMPT_SUPPORT
+        kmp_uint64             ompt_parallel_id;
+        kmp_uint64             ompt_task_id;
+    #endif /* OMPT_SUPPORT */
 
     KMP_MB();
 
@@ -5766,6 +6559,14 @@ __kmp_join_barrier( int gtid )
     KA_TRACE( 10, ("__kmp_join_barrier: T#%d(%d:%d) arrived at join barrier\n",
                    gtid, team_id, tid ));
 
+    #if OMPT_SUPPORT
+        // Workers may not touch the team once they have arrived, so keep the ids.
+        ompt_parallel_id = team->t.t_ompt_parallel_id;
+        ompt_task_id     = KMP_OMPT_TASK_ID( this_thr );
+        KMP_OMPT_CALLBACK( ompt_event_barrier_begin, ( ompt_parallel_id, ompt_task_id ) );
+    #endif /* OMPT_SUPPORT */
+    KMP_OMPT_STATE_ENTER( this_thr, ompt_prev_state, ompt_state_wait_barrier, 0 );
+
     #if OMP_30_ENABLED
         if ( __kmp_tasking_mode == tskm_extra_barrier ) {
             __kmp_tasking_barrier( team, this_thr, gtid );
@@ -5813,23 +6614,30 @@ __kmp_join_barrier( int gtid )
         //     The moment before barrier_gather sounds appropriate, because master needs to
         //     wait for all workers anyway, and we want this to happen as late as possible,
         //     but before the shutdown which may happen after the barrier.
-        if( KMP_MASTER_TID( tid ) && TCR_4(__kmp_init_monitor) < 2 ) {
+        if( KMP_MASTER_TID( tid ) && __kmp_use_monitor && TCR_4(__kmp_init_monitor) < 2 ) {
             __kmp_wait_sleep( this_thr, (volatile kmp_uint32*)&__kmp_init_monitor, 2, 0
                               );
         }
     #endif
 
 
+    KMP_STATS_TIMER_START( this_thr, gather_start );
     if ( __kmp_barrier_gather_pattern[ bs_forkjoin_barrier ] == bp_linear_bar || __kmp_barrier_gather_branch_bits[ bs_forkjoin_barrier ] == 0 ) {
         __kmp_linear_barrier_gather( bs_forkjoin_barrier, this_thr, gtid, tid, NULL
                                      );
     } else if ( __kmp_barrier_gather_pattern[ bs_forkjoin_barrier ] == bp_tree_bar ) {
         __kmp_tree_barrier_gather( bs_forkjoin_barrier, this_thr, gtid, tid, NULL
                                    );
+    } else if ( __kmp_barrier_gather_pattern[ bs_forkjoin_barrier ] == bp_hierarchical_bar ) {
+        __kmp_hierarchical_barrier_gather( bs_forkjoin_barrier, this_thr, gtid, tid, NULL
+                                           );
     } else {
         __kmp_hyper_barrier_gather( bs_forkjoin_barrier, this_thr, gtid, tid, NULL
                                     );
     }; // if
+    KMP_STATS_TIMER_STOP( this_thr, KMP_TIMER_BARRIER_GATHER, gather_start );
+    KMP_OMPT_CALLBACK( ompt_event_barrier_end, ( ompt_parallel_id, ompt_task_id ) );
+    KMP_OMPT_STATE_EXIT( this_thr, ompt_prev_state );
 
 
     //
@@ -5932,16 +6740,21 @@ __kmp_fork_barrier( int gtid, int tid )
         }
     } // master
 
+    KMP_STATS_TIMER_START( this_thr, release_start );
     if ( __kmp_barrier_release_pattern[ bs_forkjoin_barrier ] == bp_linear_bar || __kmp_barrier_release_branch_bits[ bs_forkjoin_barrier ] == 0 ) {
         __kmp_linear_barrier_release( bs_forkjoin_barrier, this_thr, gtid, tid, TRUE
                                       );
     } else if ( __kmp_barrier_release_pattern[ bs_forkjoin_barrier ] == bp_tree_bar ) {
         __kmp_tree_barrier_release( bs_forkjoin_barrier, this_thr, gtid, tid, TRUE
                                     );
+    } else if ( __kmp_barrier_release_pattern[ bs_forkjoin_barrier ] == bp_hierarchical_bar ) {
+        __kmp_hierarchical_barrier_release( bs_forkjoin_barrier, this_thr, gtid, tid, TRUE
+                                            );
     } else {
         __kmp_hyper_barrier_release( bs_forkjoin_barrier, this_thr, gtid, tid, TRUE
                                      );
     }; // if
+    KMP_STATS_TIMER_STOP( this_thr, KMP_TIMER_BARRIER_RELEASE, release_start );
 
     //
     // early exit for reaping threads releasing forkjoin barrier
@@ -6043,6 +6856,7 @@ __kmp_launch_thread( kmp_info_t *this_thr )
 
     KMP_MB();
     KA_TRACE( 10, ("__kmp_launch_thread: T#%d start\n", gtid ) );
+    KMP_OMPT_CALLBACK( ompt_event_thread_begin, ( KMP_OMPT_THREAD_ID( gtid ) ) );
 
     if( __kmp_env_consistency_check ) {
         this_thr -> th.th_cons = __kmp_allocate_cons_stack( gtid );  // ATT: Memory leak?
@@ -6057,6 +6871,7 @@ __kmp_launch_thread( kmp_info_t *this_thr )
         KA_TRACE( 20, ("__kmp_launch_thread: T#%d waiting for work\n", gtid ));
 
         /* No tid yet since not part of a team */
+        KMP_OMPT_SET_STATE( this_thr, ompt_state_idle );
         __kmp_fork_barrier( gtid, KMP_GTID_DNE );
 
         pteam = (kmp_team_t *(*))(& this_thr->th.th_team);
@@ -6100,6 +6915,8 @@ __kmp_launch_thread( kmp_info_t *this_thr )
     /* run the destructors for the threadprivate data for this thread */
     __kmp_common_destroy_gtid( gtid ); 
 
+    KMP_OMPT_CALLBACK( ompt_event_thread_end, ( KMP_OMPT_THREAD_ID( gtid ) ) );
+
     KA_TRACE( 10, ("__kmp_launch_thread: T#%d done\n", gtid ) );
     KMP_MB();
     return this_thr;
@@ -6259,6 +7076,10 @@ __kmp_reap_thread(
         __kmp_free_fast_memory( thread );
     #endif /* USE_FAST_MEMORY */
 
+#if OMP_40_ENABLED
+    __kmp_free_dep_pool( thread );
+#endif
+
     __kmp_suspend_uninitialize_thread( thread );
 
     KMP_DEBUG_ASSERT( __kmp_threads[ gtid ] == thread );
@@ -6317,6 +7138,10 @@ __kmp_internal_end(void)
 {
     int i;
 
+    if ( __kmp_lock_profile ) {
+        __kmp_lock_profile_output();
+    }
+
     /* First, unregister the library */
     __kmp_unregister_library();
 
@@ -6361,6 +7186,12 @@ __kmp_internal_end(void)
         }
         __kmp_release_bootstrap_lock( & __kmp_monitor_lock );
         KA_TRACE( 10, ("__kmp_internal_end: monitor reaped\n" ) );
+
+        #if KMP_STATS_ENABLED
+            // Workers of the other roots may still update their records, so
+            // they are printed but not freed.
+            __kmp_stats_output();
+        #endif
     } else {
         /* TODO move this to cleanup code */
         #ifdef KMP_DEBUG
@@ -6414,6 +7245,11 @@ __kmp_internal_end(void)
         KA_TRACE( 10, ("__kmp_internal_end: all workers reaped\n" ) );
         KMP_MB();
 
+        #if KMP_STATS_ENABLED
+            __kmp_stats_output();
+            __kmp_stats_cleanup();
+        #endif
+
         //
         // See note above: One of the possible fixes for CQ138434 / CQ140126
         //
@@ -6432,6 +7268,9 @@ __kmp_internal_end(void)
     TCW_4(__kmp_init_gtid, FALSE);
     KMP_MB();       /* Flush all pending memory write invalidates.  */
 
+    #if OMPT_SUPPORT
+        __kmp_ompt_shutdown();
+    #endif
 
     __kmp_cleanup();
 }
@@ -6865,11 +7704,9 @@ __kmp_do_serial_initialize( void )
     __kmp_init_atomic_lock( & __kmp_atomic_lock_8i  );
     __kmp_init_atomic_lock( & __kmp_atomic_lock_8r  );
     __kmp_init_atomic_lock( & __kmp_atomic_lock_8c  );
-    __kmp_init_atomic_lock( & __kmp_atomic_lock_10r );
-    __kmp_init_atomic_lock( & __kmp_atomic_lock_16r );
-    __kmp_init_atomic_lock( & __kmp_atomic_lock_16c );
-    __kmp_init_atomic_lock( & __kmp_atomic_lock_20c );
-    __kmp_init_atomic_lock( & __kmp_atomic_lock_32c );
+    for ( i = 0; i < KMP_ATOMIC_LOCK_TABLE_SIZE; ++ i ) {
+        __kmp_init_atomic_lock( & __kmp_atomic_lock_table[ i ].als_lock );
+    }
     __kmp_init_bootstrap_lock( & __kmp_forkjoin_lock  );
     __kmp_init_bootstrap_lock( & __kmp_exit_lock      );
     __kmp_init_bootstrap_lock( & __kmp_monitor_lock   );
@@ -6971,6 +7808,22 @@ __kmp_do_serial_initialize( void )
         __kmp_env_free( & val );
     #endif
 
+    //
+    // Without the monitor, each waiter compares timestamps against its own
+    // deadline, and blocktime intervals become milliseconds.  That needs the
+    // timestamp frequency found by __kmp_runtime_initialize().
+    //
+    if ( ! __kmp_use_monitor ) {
+        if ( __kmp_cpu_frequency == 0 || __kmp_cpu_frequency == ~ (kmp_uint64) 0 ) {
+            KA_TRACE( 10, ( "__kmp_do_serial_initialize: timestamp frequency unknown, using the monitor\n" ) );
+            __kmp_use_monitor = TRUE;
+        } else {
+            __kmp_ticks_per_msec  = __kmp_cpu_frequency / KMP_BLOCKTIME_MULTIPLIER;
+            __kmp_monitor_wakeups = KMP_MAX_MONITOR_WAKEUPS;
+            __kmp_bt_intervals    = KMP_INTERVALS_FROM_BLOCKTIME( __kmp_dflt_blocktime, __kmp_monitor_wakeups );
+        }
+    }
+
     // Moved here from __kmp_env_initialize() "KMP_ALL_THREADPRIVATE" part
     __kmp_tp_capacity = __kmp_default_tp_capacity(__kmp_dflt_team_nth_ub, __kmp_max_nth, __kmp_allThreadsSpecified);
 
@@ -6999,6 +7852,10 @@ __kmp_do_serial_initialize( void )
     __kmp_all_nth = 0;
     __kmp_nth     = 0;
 
+    #if OMPT_SUPPORT
+        __kmp_ompt_initialize();
+    #endif
+
     /* setup the uber master thread and hierarchy */
     gtid = __kmp_register_root( TRUE );
     KA_TRACE( 10, ("__kmp_do_serial_initialize  T#%d\n", gtid ));
@@ -7307,6 +8164,10 @@ __kmp_run_after_invoked_task( int gtid, int tid, kmp_info_t *this_thr,
 {
     if( __kmp_env_consistency_check )
         __kmp_pop_parallel( gtid, team->t.t_ident );
+#if OMP_40_ENABLED
+    // The implicit task creates no more children; forget their dependences
+    __kmp_dephash_free( this_thr, &team->t.t_implicit_task_taskdata[ tid ] );
+#endif
 }
 
 int
@@ -7318,9 +8179,19 @@ __kmp_invoke_task_func( int gtid )
     kmp_team_t  *team     = this_thr -> th.th_team;
 
     __kmp_run_before_invoked_task( gtid, tid, this_thr, team );
+    KMP_OMPT_CALLBACK( ompt_event_implicit_task_begin, ( team->t.t_ompt_parallel_id, KMP_OMPT_TASK_ID( this_thr ) ) );
+    KMP_OMPT_STATE_ENTER( this_thr, ompt_prev_state, ompt_state_work_parallel, 0 );
+#if OMPT_SUPPORT && OMP_30_ENABLED
+    this_thr->th.th_current_task->td_ompt_frame.exit_runtime_frame = KMP_OMPT_FRAME_ADDRESS();
+#endif
     rc = __kmp_invoke_microtask( (microtask_t) TCR_SYNC_PTR(team->t.t_pkfn),
       gtid, tid, (int) team->t.t_argc, (void **) team->t.t_argv );
 
+#if OMPT_SUPPORT && OMP_30_ENABLED
+    this_thr->th.th_current_task->td_ompt_frame.exit_runtime_frame = NULL;
+#endif
+    KMP_OMPT_STATE_EXIT( this_thr, ompt_prev_state );
+    KMP_OMPT_CALLBACK( ompt_event_implicit_task_end, ( team->t.t_ompt_parallel_id, KMP_OMPT_TASK_ID( this_thr ) ) );
     __kmp_run_after_invoked_task( gtid, tid, this_thr, team );
 
     return rc;
@@ -7377,11 +8248,21 @@ __kmp_internal_fork( ident_t *id, int gtid, kmp_team_t *team )
     KMP_DEBUG_ASSERT( team -> t.t_disp_buffer );
     if ( team->t.t_max_nproc > 1 ) {
         int i;
-        for (i = 0; i <  KMP_MAX_DISP_BUF; ++i)
+#if !KMP_USE_POOLED_ALLOC
+        if ( TCR_4( team->t.t_disp_buffer_waited ) ) {
+            __kmp_grow_disp_buffers( team );
+        }
+#endif /* !KMP_USE_POOLED_ALLOC */
+        for (i = 0; i <  team->t.t_disp_num_buffers; ++i)
             team -> t.t_disp_buffer[ i ].buffer_index = i;
     } else {
         team -> t.t_disp_buffer[ 0 ].buffer_index = 0;
     }
+#if KMP_OS_LINUX || KMP_OS_WINDOWS
+    if ( __kmp_static_numa && team->t.t_nproc > 1 ) {
+        __kmp_set_static_ranks( team );
+    }
+#endif /* KMP_OS_LINUX || KMP_OS_WINDOWS */
 
     KMP_MB();       /* Flush all pending memory write invalidates.  */
     KMP_ASSERT( this_thr -> th.th_team  ==  team );
@@ -7609,6 +8490,10 @@ __kmp_cleanup( void )
 
     __kmp_cleanup_user_locks();
 
+    #if USE_FAST_MEMORY
+        __kmp_cleanup_fast_memory();
+    #endif /* USE_FAST_MEMORY */
+
     #if KMP_OS_LINUX || KMP_OS_WINDOWS
         KMP_INTERNAL_FREE( (void *) __kmp_cpuinfo_file );
         __kmp_cpuinfo_file = NULL;
@@ -57,6 +57,7 @@
 #include "kmp_i18n.h"
 #include "kmp_str.h"
 #include "kmp_error.h"
+#include "kmp_stats.h"
 
 // template for type limits
 template< typename T >
@@ -118,6 +119,7 @@ __kmp_for_static_init(
     register kmp_team_t *team = __kmp_threads[ gtid ]->th.th_team;
 
     KE_TRACE( 10, ("__kmpc_for_static_init called (%d)\n", global_tid));
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_STATIC_LOOP );
     #ifdef KMP_DEBUG
     {
         const char * buff;
@@ -201,6 +203,10 @@ __kmp_for_static_init(
         KE_TRACE( 10, ("__kmpc_for_static_init: T#%d return\n", global_tid ) );
         return;
     }
+    if ( __kmp_static_numa ) {
+        /* take the block of this thread's rank in (node, tid) order */
+        tid = team->t.t_static_rank[ tid ];
+    }
 
     /* compute trip count */
     if ( incr == 1 ) {
@@ -307,6 +313,77 @@ __kmp_for_static_init(
     return;
 }
 
+/*
+ * Fast path for the common loop: unchunked kmp_sch_static with unit stride.
+ * The team size comes from the thread's own copy (th_team_nproc), and the
+ * bounds are computed in unsigned offsets from the lower bound, so there are
+ * no stride, sign or overflow cases to branch on.  With consistency checking
+ * on, defer to __kmp_for_static_init, which maintains the workshare stack
+ * that __kmpc_for_static_fini pops.
+ */
+template< typename T >
+static __forceinline void
+__kmp_for_static_init_simple(
+    ident_t                          *loc,
+    kmp_int32                         gtid,
+    kmp_int32                        *plastiter,
+    T                                *plower,
+    T                                *pupper
+) {
+    typedef typename traits_t< T >::unsigned_t  UT;
+    typedef typename traits_t< T >::signed_t    ST;
+    kmp_info_t *th    = __kmp_threads[ gtid ];
+    UT          nth   = th->th.th_team_nproc;
+    UT          tid   = th->th.th_info.ds.ds_tid;
+    T           lower = *plower;
+    UT          trip_count, begin, size;
+
+    if ( __kmp_env_consistency_check ) {
+        ST stride;
+        __kmp_for_static_init< T >( loc, gtid, kmp_sch_static, plastiter, plower, pupper, &stride, 1, 0 );
+        return;
+    }
+    KE_TRACE( 10, ("__kmpc_for_static_init_simple called (%d)\n", gtid));
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_STATIC_LOOP );
+
+    if ( *pupper < lower ) {
+        /* zero-trip loop: leave the bounds alone */
+        *plastiter = FALSE;
+        return;
+    }
+    if ( nth == 1 ) {
+        /* serialized parallel or one-thread team: the whole iteration space */
+        *plastiter = TRUE;
+        return;
+    }
+    if ( __kmp_static_numa ) {
+        tid = th->th.th_team->t.t_static_rank[ tid ];
+    }
+
+    trip_count = (UT)( *pupper - lower ) + 1;
+    if ( __kmp_static == kmp_sch_static_balanced ) {
+        UT small_chunk = trip_count / nth;
+        UT extras      = trip_count % nth;
+        begin = tid * small_chunk + ( tid < extras ? tid : extras );
+        size  = small_chunk + ( tid < extras ? 1 : 0 );
+    } else {
+        UT big_chunk = trip_count / nth + ( ( trip_count % nth ) ? 1 : 0 );
+        KMP_DEBUG_ASSERT( __kmp_static == kmp_sch_static_greedy );
+        begin = tid * big_chunk;
+        if ( begin > trip_count ) {
+            begin = trip_count;
+        }
+        size = trip_count - begin;
+        if ( size > big_chunk ) {
+            size = big_chunk;
+        }
+    }
+    /* a thread with no iterations gets lower = upper + 1 */
+    *plastiter = ( size != 0 && begin + size == trip_count );
+    *plower    = lower + begin;
+    *pupper    = lower + ( begin + size - 1 );
+}
+
 //--------------------------------------------------------------------------------------
 extern "C" {
 
@@ -374,6 +451,59 @@ __kmpc_for_static_init_8u( ident_t *loc, kmp_int32 gtid, kmp_int32 schedtype, km
     __kmp_for_static_init< kmp_uint64 >(
                       loc, gtid, schedtype, plastiter, plower, pupper, pstride, incr, chunk );
 }
+/*!
+@ingroup WORK_SHARING
+@param    loc       Source code location
+@param    gtid      Global thread id of this thread
+@param    plastiter Pointer to the "last iteration" flag
+@param    plower    Pointer to the lower bound
+@param    pupper    Pointer to the upper bound
+
+Each of the four functions here are identical apart from the argument types.
+
+These are @ref __kmpc_for_static_init_4 and friends specialized for an unchunked
+<tt>schedule(static)</tt> loop with an increment of 1: there is no schedule, stride,
+increment or chunk argument. As with the general entry points, the loop must be
+finished with @ref __kmpc_for_static_fini.
+
+@{
+*/
+void
+__kmpc_for_static_init_simple_4( ident_t *loc, kmp_int32 gtid, kmp_int32 *plastiter,
+                      kmp_int32 *plower, kmp_int32 *pupper )
+{
+    __kmp_for_static_init_simple< kmp_int32 >( loc, gtid, plastiter, plower, pupper );
+}
+
+/*!
+ See @ref __kmpc_for_static_init_simple_4
+ */
+void
+__kmpc_for_static_init_simple_4u( ident_t *loc, kmp_int32 gtid, kmp_int32 *plastiter,
+                      kmp_uint32 *plower, kmp_uint32 *pupper )
+{
+    __kmp_for_static_init_simple< kmp_uint32 >( loc, gtid, plastiter, plower, pupper );
+}
+
+/*!
+ See @ref __kmpc_for_static_init_simple_4
+ */
+void
+__kmpc_for_static_init_simple_8( ident_t *loc, kmp_int32 gtid, kmp_int32 *plastiter,
+                      kmp_int64 *plower, kmp_int64 *pupper )
+{
+    __kmp_for_static_init_simple< kmp_int64 >( loc, gtid, plastiter, plower, pupper );
+}
+
+/*!
+ See @ref __kmpc_for_static_init_simple_4
+ */
+void
+__kmpc_for_static_init_simple_8u( ident_t *loc, kmp_int32 gtid, kmp_int32 *plastiter,
+                      kmp_uint64 *plower, kmp_uint64 *pupper )
+{
+    __kmp_for_static_init_simple< kmp_uint64 >( loc, gtid, plastiter, plower, pupper );
+}
 /*! 
 @}
 */
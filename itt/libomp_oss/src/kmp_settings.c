@@ -786,6 +786,50 @@ __kmp_stg_print_blocktime( kmp_str_buf_t * buffer, char const * name, void * dat
     __kmp_stg_print_int( buffer, name, __kmp_dflt_blocktime );
 } // __kmp_stg_print_blocktime
 
+// -------------------------------------------------------------------------------------------------
+// KMP_ADAPTIVE_WAIT
+// -------------------------------------------------------------------------------------------------
+
+static void
+__kmp_stg_parse_adaptive_wait( char const * name, char const * value, void * data ) {
+    __kmp_stg_parse_bool( name, value, & __kmp_adaptive_wait );
+} // __kmp_stg_parse_adaptive_wait
+
+static void
+__kmp_stg_print_adaptive_wait( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_stg_print_bool( buffer, name, __kmp_adaptive_wait );
+} // __kmp_stg_print_adaptive_wait
+
+// -------------------------------------------------------------------------------------------------
+// KMP_USE_MONITOR
+// -------------------------------------------------------------------------------------------------
+
+static void
+__kmp_stg_parse_use_monitor( char const * name, char const * value, void * data ) {
+    __kmp_stg_parse_bool( name, value, & __kmp_use_monitor );
+} // __kmp_stg_parse_use_monitor
+
+static void
+__kmp_stg_print_use_monitor( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_stg_print_bool( buffer, name, __kmp_use_monitor );
+} // __kmp_stg_print_use_monitor
+
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+// -------------------------------------------------------------------------------------------------
+// KMP_FUTEX_PARKING
+// -------------------------------------------------------------------------------------------------
+
+static void
+__kmp_stg_parse_futex_parking( char const * name, char const * value, void * data ) {
+    __kmp_stg_parse_bool( name, value, & __kmp_futex_parking );
+} // __kmp_stg_parse_futex_parking
+
+static void
+__kmp_stg_print_futex_parking( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_stg_print_bool( buffer, name, __kmp_futex_parking );
+} // __kmp_stg_print_futex_parking
+#endif // KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+
 // -------------------------------------------------------------------------------------------------
 // KMP_DUPLICATE_LIB_OK
 // -------------------------------------------------------------------------------------------------
@@ -1017,6 +1061,22 @@ __kmp_stg_print_version( kmp_str_buf_t * buffer, char const * name, void * data
     __kmp_stg_print_bool( buffer, name, __kmp_version );
 } // __kmp_stg_print_version
 
+#if KMP_STATS_ENABLED
+// -------------------------------------------------------------------------------------------------
+// KMP_STATS
+// -------------------------------------------------------------------------------------------------
+
+static void
+__kmp_stg_parse_stats( char const * name, char const * value, void * data ) {
+    __kmp_stg_parse_bool( name, value, & __kmp_stats_enabled );
+} // __kmp_stg_parse_stats
+
+static void
+__kmp_stg_print_stats( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_stg_print_bool( buffer, name, __kmp_stats_enabled );
+} // __kmp_stg_print_stats
+#endif // KMP_STATS_ENABLED
+
 // -------------------------------------------------------------------------------------------------
 // KMP_WARNINGS
 // -------------------------------------------------------------------------------------------------
@@ -3571,6 +3631,72 @@ __kmp_stg_print_omp_schedule( kmp_str_buf_t * buffer, char const * name, void *
     }
 } // __kmp_stg_print_omp_schedule
 
+// -------------------------------------------------------------------------------------------------
+// KMP_DISPATCH_BATCH
+// -------------------------------------------------------------------------------------------------
+
+static void
+__kmp_stg_parse_dispatch_batch( char const * name, char const * value, void * data ) {
+    __kmp_stg_parse_int( name, value, 1, KMP_MAX_DISPATCH_BATCH, & __kmp_dispatch_batch );
+} // __kmp_stg_parse_dispatch_batch
+
+static void
+__kmp_stg_print_dispatch_batch( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_stg_print_int( buffer, name, __kmp_dispatch_batch );
+} // __kmp_stg_print_dispatch_batch
+
+// -------------------------------------------------------------------------------------------------
+// KMP_DISP_NUM_BUFFERS
+// -------------------------------------------------------------------------------------------------
+
+static void
+__kmp_stg_parse_disp_buffers( char const * name, char const * value, void * data ) {
+    if ( TCR_4( __kmp_init_parallel ) ) {
+        KMP_WARNING( EnvParallelWarn, name );
+        __kmp_env_toPrint( name, 0 );
+        return;
+    }
+    __kmp_stg_parse_int( name, value, 1, KMP_MAX_DISP_NUM_BUFF, & __kmp_dispatch_num_buffers );
+} // __kmp_stg_parse_disp_buffers
+
+static void
+__kmp_stg_print_disp_buffers( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_stg_print_int( buffer, name, __kmp_dispatch_num_buffers );
+} // __kmp_stg_print_disp_buffers
+
+// -------------------------------------------------------------------------------------------------
+// KMP_HOT_TEAMS_MAX_LEVEL
+// -------------------------------------------------------------------------------------------------
+
+static void
+__kmp_stg_parse_hot_teams_level( char const * name, char const * value, void * data ) {
+    if ( TCR_4( __kmp_init_parallel ) ) {
+        KMP_WARNING( EnvParallelWarn, name );
+        __kmp_env_toPrint( name, 0 );
+        return;
+    }
+    __kmp_stg_parse_int( name, value, 1, KMP_MAX_HOT_TEAMS_LEVEL, & __kmp_hot_teams_max_level );
+} // __kmp_stg_parse_hot_teams_level
+
+static void
+__kmp_stg_print_hot_teams_level( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_stg_print_int( buffer, name, __kmp_hot_teams_max_level );
+} // __kmp_stg_print_hot_teams_level
+
+// -------------------------------------------------------------------------------------------------
+// KMP_STATIC_NUMA
+// -------------------------------------------------------------------------------------------------
+
+static void
+__kmp_stg_parse_static_numa( char const * name, char const * value, void * data ) {
+    __kmp_stg_parse_bool( name, value, & __kmp_static_numa );
+} // __kmp_stg_parse_static_numa
+
+static void
+__kmp_stg_print_static_numa( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_stg_print_bool( buffer, name, __kmp_static_numa );
+} // __kmp_stg_print_static_numa
+
 // -------------------------------------------------------------------------------------------------
 // KMP_ATOMIC_MODE
 // -------------------------------------------------------------------------------------------------
@@ -3863,6 +3989,21 @@ __kmp_stg_parse_lock_kind( char const * name, char const * value, void * data )
       || __kmp_str_match( "drdpa", 1, value ) ) {
         __kmp_user_lock_kind = lk_drdpa;
     }
+#if KMP_USE_ADAPTIVE_LOCKS
+    else if ( __kmp_str_match( "adaptive", 1, value )
+      || __kmp_str_match( "rtm", 1, value ) ) {
+        if ( ! __kmp_cpuinfo.initialized ) {
+            __kmp_query_cpuid( & __kmp_cpuinfo );
+        }
+        if ( __kmp_cpuinfo.rtm ) {
+            __kmp_user_lock_kind = lk_adaptive;
+        }
+        else {
+            KMP_WARNING( AdaptiveNotSupported, name, value );
+            __kmp_user_lock_kind = lk_queuing;
+        }
+    }
+#endif // KMP_USE_ADAPTIVE_LOCKS
     else {
         KMP_WARNING( StgInvalidValue, name, value );
     }
@@ -3898,6 +4039,12 @@ __kmp_stg_print_lock_kind( kmp_str_buf_t * buffer, char const * name, void * dat
         case lk_drdpa:
         value = "drdpa";
         break;
+
+#if KMP_USE_ADAPTIVE_LOCKS
+        case lk_adaptive:
+        value = "adaptive";
+        break;
+#endif
     }
 
     if ( value != NULL ) {
@@ -3905,6 +4052,58 @@ __kmp_stg_print_lock_kind( kmp_str_buf_t * buffer, char const * name, void * dat
     }
 }
 
+#if KMP_USE_ADAPTIVE_LOCKS
+// -------------------------------------------------------------------------------------------------
+// KMP_ADAPTIVE_LOCK_PROPS
+// -------------------------------------------------------------------------------------------------
+
+// Parse out values for the adaptive lock properties: "max_soft_retries[,max_badness]".
+static void
+__kmp_stg_parse_adaptive_lock_props( char const * name, char const * value, void * data ) {
+    int   max_retries;
+    int   max_badness;
+    char *comma;
+
+    if ( __kmp_init_user_locks ) {
+        KMP_WARNING( EnvLockWarn, name );
+        return;
+    }
+
+    comma = (char *) strchr( value, ',' );
+    max_retries = __kmp_str_to_int( value, ',' );
+    max_badness = ( comma == NULL ) ? (int) __kmp_adaptive_backoff_params.max_badness
+                                    : __kmp_str_to_int( comma + 1, 0 );
+    if ( max_retries < 0 || max_badness < 0 ) {
+        KMP_WARNING( StgInvalidValue, name, value );
+        return;
+    }
+
+    __kmp_adaptive_backoff_params.max_soft_retries = max_retries;
+    __kmp_adaptive_backoff_params.max_badness = max_badness;
+} // __kmp_stg_parse_adaptive_lock_props
+
+static void
+__kmp_stg_print_adaptive_lock_props( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_str_buf_print( buffer, "   %s=\"%d,%d\"\n", name,
+      __kmp_adaptive_backoff_params.max_soft_retries, __kmp_adaptive_backoff_params.max_badness );
+} // __kmp_stg_print_adaptive_lock_props
+
+#endif // KMP_USE_ADAPTIVE_LOCKS
+
+// -------------------------------------------------------------------------------------------------
+// KMP_LOCK_PROFILE
+// -------------------------------------------------------------------------------------------------
+
+static void
+__kmp_stg_parse_lock_profile( char const * name, char const * value, void * data ) {
+    __kmp_stg_parse_bool( name, value, & __kmp_lock_profile );
+} // __kmp_stg_parse_lock_profile
+
+static void
+__kmp_stg_print_lock_profile( kmp_str_buf_t * buffer, char const * name, void * data ) {
+    __kmp_stg_print_bool( buffer, name, __kmp_lock_profile );
+} // __kmp_stg_print_lock_profile
+
 #if KMP_MIC
 // -------------------------------------------------------------------------------------------------
 // KMP_PLACE_THREADS
@@ -4061,15 +4260,27 @@ __kmp_stg_print_forkjoin_frames( kmp_str_buf_t * buffer, char const * name, void
 
 static kmp_setting_t __kmp_stg_table[] = {
 
+    { "KMP_ADAPTIVE_WAIT",                 __kmp_stg_parse_adaptive_wait,      __kmp_stg_print_adaptive_wait,      NULL, 0, 0 },
     { "KMP_ALL_THREADS",                   __kmp_stg_parse_all_threads,        __kmp_stg_print_all_threads,        NULL, 0, 0 },
     { "KMP_BLOCKTIME",                     __kmp_stg_parse_blocktime,          __kmp_stg_print_blocktime,          NULL, 0, 0 },
+    { "KMP_DISPATCH_BATCH",                __kmp_stg_parse_dispatch_batch,     __kmp_stg_print_dispatch_batch,     NULL, 0, 0 },
+    { "KMP_DISP_NUM_BUFFERS",              __kmp_stg_parse_disp_buffers,       __kmp_stg_print_disp_buffers,       NULL, 0, 0 },
     { "KMP_DUPLICATE_LIB_OK",              __kmp_stg_parse_duplicate_lib_ok,   __kmp_stg_print_duplicate_lib_ok,   NULL, 0, 0 },
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+    { "KMP_FUTEX_PARKING",                 __kmp_stg_parse_futex_parking,      __kmp_stg_print_futex_parking,      NULL, 0, 0 },
+#endif
+    { "KMP_HOT_TEAMS_MAX_LEVEL",           __kmp_stg_parse_hot_teams_level,    __kmp_stg_print_hot_teams_level,    NULL, 0, 0 },
     { "KMP_LIBRARY",                       __kmp_stg_parse_wait_policy,        __kmp_stg_print_wait_policy,        NULL, 0, 0 },
     { "KMP_MAX_THREADS",                   __kmp_stg_parse_all_threads,        NULL,                               NULL, 0, 0 }, // For backward compatibility
     { "KMP_MONITOR_STACKSIZE",             __kmp_stg_parse_monitor_stacksize,  __kmp_stg_print_monitor_stacksize,  NULL, 0, 0 },
     { "KMP_SETTINGS",                      __kmp_stg_parse_settings,           __kmp_stg_print_settings,           NULL, 0, 0 },
     { "KMP_STACKOFFSET",                   __kmp_stg_parse_stackoffset,        __kmp_stg_print_stackoffset,        NULL, 0, 0 },
     { "KMP_STACKSIZE",                     __kmp_stg_parse_stacksize,          __kmp_stg_print_stacksize,          NULL, 0, 0 },
+    { "KMP_STATIC_NUMA",                   __kmp_stg_parse_static_numa,        __kmp_stg_print_static_numa,        NULL, 0, 0 },
+#if KMP_STATS_ENABLED
+    { "KMP_STATS",                         __kmp_stg_parse_stats,              __kmp_stg_print_stats,              NULL, 0, 0 },
+#endif
+    { "KMP_USE_MONITOR",                   __kmp_stg_parse_use_monitor,        __kmp_stg_print_use_monitor,        NULL, 0, 0 },
     { "KMP_VERSION",                       __kmp_stg_parse_version,            __kmp_stg_print_version,            NULL, 0, 0 },
     { "KMP_WARNINGS",                      __kmp_stg_parse_warnings,           __kmp_stg_print_warnings,           NULL, 0, 0 },
 
@@ -4187,6 +4398,10 @@ static kmp_setting_t __kmp_stg_table[] = {
 
     { "KMP_NUM_LOCKS_IN_BLOCK",            __kmp_stg_parse_lock_block,         __kmp_stg_print_lock_block,         NULL, 0, 0 },
     { "KMP_LOCK_KIND",                     __kmp_stg_parse_lock_kind,          __kmp_stg_print_lock_kind,          NULL, 0, 0 },
+#if KMP_USE_ADAPTIVE_LOCKS
+    { "KMP_ADAPTIVE_LOCK_PROPS",           __kmp_stg_parse_adaptive_lock_props, __kmp_stg_print_adaptive_lock_props, NULL, 0, 0 },
+#endif
+    { "KMP_LOCK_PROFILE",                  __kmp_stg_parse_lock_profile,       __kmp_stg_print_lock_profile,       NULL, 0, 0 },
 #if KMP_MIC
     { "KMP_PLACE_THREADS",                 __kmp_stg_parse_place_threads,      __kmp_stg_print_place_threads,      NULL, 0, 0 },
 #endif
@@ -4662,6 +4877,9 @@ __kmp_env_initialize( char const * string ) {
             __kmp_user_lock_kind = lk_queuing;
         }
         __kmp_set_user_lock_vptrs( __kmp_user_lock_kind );
+#if KMP_USE_DYNAMIC_LOCK
+        __kmp_init_dynamic_user_locks();
+#endif
     }
     else {
         KMP_DEBUG_ASSERT( string != NULL); // kmp_set_defaults() was called
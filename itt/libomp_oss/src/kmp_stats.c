@@ -0,0 +1,204 @@
+/*
+ * kmp_stats.c -- Runtime statistics: event counters and wait timers.
+ */
+
+/* <copyright>
+    Copyright (c) 2013 Intel Corporation.  All Rights Reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+      * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the name of Intel Corporation nor the names of its
+        contributors may be used to endorse or promote products derived
+        from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+------------------------------------------------------------------------
+
+    Portions of this software are protected under the following patents:
+        U.S. Patent 5,812,852
+        U.S. Patent 6,792,599
+        U.S. Patent 7,069,556
+        U.S. Patent 7,328,433
+        U.S. Patent 7,500,242
+
+</copyright> */
+
+#include "kmp.h"
+#include "kmp_io.h"
+#include "kmp_stats.h"
+
+#if KMP_STATS_ENABLED
+
+/* ------------------------------------------------------------------------ */
+/* ------------------------------------------------------------------------ */
+
+static kmp_stats_t     * __kmp_stats_list = NULL;      // records of all threads, newest first
+static kmp_bootstrap_lock_t __kmp_stats_lock = KMP_BOOTSTRAP_LOCK_INITIALIZER( __kmp_stats_lock );
+static kmp_uint64        __kmp_stats_start_ticks;      // calibration of the timestamp counter
+static double            __kmp_stats_start_time;
+
+static char const * const __kmp_stats_counter_names[ KMP_STAT_COUNTER_LAST ] = {
+    "fork",
+    "join",
+    "barrier",
+    "task_create",
+    "task_execute",
+    "task_steal",
+    "static_loop",
+    "chunk_static",
+    "chunk_dynamic",
+    "chunk_guided",
+    "chunk_other",
+    "lock_acquire",
+    "lock_contended",
+    "suspend",
+    "wait_spin",
+    "wait_park",
+    "wait_timeout",
+};
+
+static char const * const __kmp_stats_timer_names[ KMP_TIMER_LAST ] = {
+    "barrier_gather",
+    "barrier_release",
+    "wait_sleep",
+    "suspend",
+};
+
+//
+// Attach a zeroed record to a newly created thread.  Records are never freed
+// before the final dump, so the counts of threads that go away are kept.
+//
+void
+__kmp_stats_thread_init( kmp_info_t *th, int gtid )
+{
+    kmp_stats_t *stats;
+
+    if ( ! __kmp_stats_enabled ) {
+        th->th.th_stats = NULL;
+        return;
+    }
+    stats = (kmp_stats_t *) __kmp_allocate( sizeof( kmp_stats_t ) );
+    stats->ks_gtid = gtid;
+
+    __kmp_acquire_bootstrap_lock( & __kmp_stats_lock );
+    if ( __kmp_stats_list == NULL ) {
+        __kmp_stats_start_ticks = __kmp_hardware_timestamp();
+        __kmp_elapsed( & __kmp_stats_start_time );
+    }
+    stats->ks_next = __kmp_stats_list;
+    __kmp_stats_list = stats;
+    __kmp_release_bootstrap_lock( & __kmp_stats_lock );
+
+    th->th.th_stats = stats;
+}
+
+//
+// Print one row per thread and a total row for the counters, then the same
+// for the timers (in seconds).
+//
+void
+__kmp_stats_output( void )
+{
+    kmp_stats_t  total;
+    kmp_stats_t *stats;
+    double       now, seconds_per_tick;
+    int          i;
+
+    if ( __kmp_stats_list == NULL ) {
+        return;
+    }
+
+    __kmp_elapsed( & now );
+    seconds_per_tick = ( now - __kmp_stats_start_time ) /
+                       (double)( __kmp_hardware_timestamp() - __kmp_stats_start_ticks + 1 );
+
+    memset( & total, 0, sizeof( total ) );
+    for ( stats = __kmp_stats_list; stats != NULL; stats = stats->ks_next ) {
+        for ( i = 0; i < KMP_STAT_COUNTER_LAST; ++ i ) {
+            total.ks_count[ i ] += stats->ks_count[ i ];
+        }
+        for ( i = 0; i < KMP_TIMER_LAST; ++ i ) {
+            total.ks_ticks[ i ] += stats->ks_ticks[ i ];
+        }
+    }
+
+    __kmp_printf( "\nOMP: Statistics: event counts\n%6s", "thread" );
+    for ( i = 0; i < KMP_STAT_COUNTER_LAST; ++ i ) {
+        __kmp_printf( " %14s", __kmp_stats_counter_names[ i ] );
+    }
+    __kmp_printf( "\n" );
+    for ( stats = __kmp_stats_list; stats != NULL; stats = stats->ks_next ) {
+        __kmp_printf( "%6d", stats->ks_gtid );
+        for ( i = 0; i < KMP_STAT_COUNTER_LAST; ++ i ) {
+            __kmp_printf( " %14llu", (unsigned long long) stats->ks_count[ i ] );
+        }
+        __kmp_printf( "\n" );
+    }
+    __kmp_printf( "%6s", "total" );
+    for ( i = 0; i < KMP_STAT_COUNTER_LAST; ++ i ) {
+        __kmp_printf( " %14llu", (unsigned long long) total.ks_count[ i ] );
+    }
+
+    __kmp_printf( "\n\nOMP: Statistics: time in seconds\n%6s", "thread" );
+    for ( i = 0; i < KMP_TIMER_LAST; ++ i ) {
+        __kmp_printf( " %15s", __kmp_stats_timer_names[ i ] );
+    }
+    __kmp_printf( "\n" );
+    for ( stats = __kmp_stats_list; stats != NULL; stats = stats->ks_next ) {
+        __kmp_printf( "%6d", stats->ks_gtid );
+        for ( i = 0; i < KMP_TIMER_LAST; ++ i ) {
+            __kmp_printf( " %15.6f", stats->ks_ticks[ i ] * seconds_per_tick );
+        }
+        __kmp_printf( "\n" );
+    }
+    __kmp_printf( "%6s", "total" );
+    for ( i = 0; i < KMP_TIMER_LAST; ++ i ) {
+        __kmp_printf( " %15.6f", total.ks_ticks[ i ] * seconds_per_tick );
+    }
+    __kmp_printf( "\n\n" );
+}
+
+//
+// Free the records.  Only called once the workers are reaped: a worker may
+// have loaded its th_stats before it is cleared here.
+//
+void
+__kmp_stats_cleanup( void )
+{
+    kmp_stats_t *stats;
+    int          i;
+
+    for ( i = 0; i < __kmp_threads_capacity; ++ i ) {
+        if ( __kmp_threads[ i ] != NULL ) {
+            __kmp_threads[ i ]->th.th_stats = NULL;
+        }
+    }
+    while ( __kmp_stats_list != NULL ) {
+        stats = __kmp_stats_list;
+        __kmp_stats_list = stats->ks_next;
+        __kmp_free( stats );
+    }
+}
+
+#endif // KMP_STATS_ENABLED
+
+// end of file //
@@ -0,0 +1,161 @@
+/*
+ * kmp_stats.h -- Runtime statistics: event counters and wait timers.
+ */
+
+/* <copyright>
+    Copyright (c) 2013 Intel Corporation.  All Rights Reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+      * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the name of Intel Corporation nor the names of its
+        contributors may be used to endorse or promote products derived
+        from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+------------------------------------------------------------------------
+
+    Portions of this software are protected under the following patents:
+        U.S. Patent 5,812,852
+        U.S. Patent 6,792,599
+        U.S. Patent 7,069,556
+        U.S. Patent 7,328,433
+        U.S. Patent 7,500,242
+
+</copyright> */
+
+#ifndef KMP_STATS_H
+#define KMP_STATS_H
+
+/*
+ * Statistics are compiled in only when KMP_STATS_ENABLED is set (STATS=on in
+ * the makefile), and then collected only when KMP_STATS=true.  Every thread
+ * owns a kmp_stats_t record (th_stats, NULL while collection is off), so
+ * updates need no synchronization.  The records of all threads that ever
+ * existed are dumped as tables from __kmp_internal_end().
+ *
+ * Times are taken with __kmp_hardware_timestamp() and converted to seconds
+ * at output time.
+ */
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#if KMP_STATS_ENABLED
+
+typedef enum kmp_stats_counter {
+    KMP_STAT_FORK,              // parallel regions forked by this thread
+    KMP_STAT_JOIN,              // parallel regions joined
+    KMP_STAT_BARRIER,           // explicit and implicit barriers (not fork/join)
+    KMP_STAT_TASK_CREATE,       // explicit tasks allocated
+    KMP_STAT_TASK_EXECUTE,      // explicit tasks run
+    KMP_STAT_TASK_STEAL,        // tasks taken from another thread's deque
+    KMP_STAT_STATIC_LOOP,       // static loops started (__kmpc_for_static_init)
+    KMP_STAT_CHUNK_STATIC,      // chunks handed out by __kmp_dispatch_next, per schedule kind
+    KMP_STAT_CHUNK_DYNAMIC,
+    KMP_STAT_CHUNK_GUIDED,
+    KMP_STAT_CHUNK_OTHER,       // trapezoidal, static steal
+    KMP_STAT_LOCK_ACQUIRE,      // lock acquisitions
+    KMP_STAT_LOCK_CONTENDED,    // acquisitions that found the lock taken
+    KMP_STAT_SUSPEND,           // times the thread went to sleep
+    KMP_STAT_WAIT_SPIN,         // KMP_ADAPTIVE_WAIT: waits predicted short, spun first
+    KMP_STAT_WAIT_PARK,         // KMP_ADAPTIVE_WAIT: waits predicted long, parked at once
+    KMP_STAT_WAIT_TIMEOUT,      // KMP_ADAPTIVE_WAIT: predicted short but spun out and parked
+    KMP_STAT_COUNTER_LAST
+} kmp_stats_counter_t;
+
+typedef enum kmp_stats_timer {
+    KMP_TIMER_BARRIER_GATHER,   // time in the gather phase of barriers
+    KMP_TIMER_BARRIER_RELEASE,  // time in the release phase, including waiting at the fork barrier
+    KMP_TIMER_WAIT_SLEEP,       // time in __kmp_wait_sleep
+    KMP_TIMER_SUSPEND,          // time asleep in __kmp_suspend
+    KMP_TIMER_LAST
+} kmp_stats_timer_t;
+
+typedef struct kmp_stats {
+    kmp_uint64          ks_count[ KMP_STAT_COUNTER_LAST ];
+    kmp_uint64          ks_ticks[ KMP_TIMER_LAST ];
+    int                 ks_gtid;
+    struct kmp_stats  * ks_next;    // list of all records, for the final dump
+} kmp_stats_t;
+
+extern void __kmp_stats_thread_init( kmp_info_t *th, int gtid );
+extern void __kmp_stats_output( void );
+extern void __kmp_stats_cleanup( void );
+
+static inline kmp_stats_counter_t
+__kmp_stats_chunk_counter( enum sched_type schedule )
+{
+    switch ( schedule ) {
+        case kmp_sch_static_chunked:
+        case kmp_sch_static_balanced:
+        case kmp_sch_static_greedy:
+            return KMP_STAT_CHUNK_STATIC;
+        case kmp_sch_dynamic_chunked:
+            return KMP_STAT_CHUNK_DYNAMIC;
+        case kmp_sch_guided_iterative_chunked:
+        case kmp_sch_guided_analytical_chunked:
+            return KMP_STAT_CHUNK_GUIDED;
+        default:
+            return KMP_STAT_CHUNK_OTHER;
+    }
+}
+
+# define KMP_STATS_COUNT( thr, counter )                                       \
+    do {                                                                       \
+        kmp_info_t * __st_th = (thr);                                          \
+        if ( __st_th != NULL && __st_th->th.th_stats != NULL )                 \
+            __st_th->th.th_stats->ks_count[ counter ] ++;                      \
+    } while ( 0 )
+
+// For code that only has a gtid, which may not be registered (e.g. bootstrap locks)
+# define KMP_STATS_GTID_COUNT( gtid, counter )                                 \
+    do {                                                                       \
+        if ( __kmp_stats_enabled && (gtid) >= 0 )                              \
+            KMP_STATS_COUNT( __kmp_threads[ gtid ], counter );                 \
+    } while ( 0 )
+
+// Timers are local variables, so they nest (a nested parallel region inside a
+// task executed at a barrier is timed correctly).
+# define KMP_STATS_TIMER_START( thr, var )                                     \
+    kmp_uint64 var = ( (thr)->th.th_stats != NULL ) ? __kmp_hardware_timestamp() : 0
+
+# define KMP_STATS_TIMER_STOP( thr, timer, var )                               \
+    do {                                                                       \
+        if ( (thr)->th.th_stats != NULL )                                      \
+            (thr)->th.th_stats->ks_ticks[ timer ] += __kmp_hardware_timestamp() - (var); \
+    } while ( 0 )
+
+#else // KMP_STATS_ENABLED
+
+# define KMP_STATS_COUNT( thr, counter )           ((void)0)
+# define KMP_STATS_GTID_COUNT( gtid, counter )     ((void)0)
+# define KMP_STATS_TIMER_START( thr, var )
+# define KMP_STATS_TIMER_STOP( thr, timer, var )   ((void)0)
+
+#endif // KMP_STATS_ENABLED
+
+#ifdef __cplusplus
+    } // extern "C"
+#endif
+
+#endif // KMP_STATS_H
@@ -46,6 +46,8 @@
 
 #include "kmp.h"
 #include "kmp_i18n.h"
+#include "kmp_stats.h"
+#include "kmp_ompt.h"
 
 
 #if OMP_30_ENABLED
@@ -58,6 +60,9 @@
 static void __kmp_enable_tasking( kmp_task_team_t *task_team, kmp_info_t *this_thr );
 static void __kmp_alloc_task_deque( kmp_info_t *thread, kmp_thread_data_t *thread_data );
 static int  __kmp_realloc_task_threads_data( kmp_info_t *thread, kmp_task_team_t *task_team );
+#if OMP_40_ENABLED
+static void __kmp_release_deps( kmp_int32 gtid, kmp_depnode_t *node );
+#endif
 
 #ifndef KMP_DEBUG
 # define __kmp_static_delay( arg )     /* nothing to do */
@@ -305,6 +310,62 @@ __kmp_pop_task_stack( kmp_int32 gtid, kmp_info_t *thread, kmp_taskdata_t *ending
 }
 #endif /* BUILD_TIED_TASK_STACK */
 
+//---------------------------------------------------
+//  __kmp_grow_task_deque: Double the size of the thread's deque.
+//  Only the owner calls this.  The live tasks are copied to the same
+//  counter positions in the new array, so head and tail stay valid; the old
+//  array is kept on the ta_prev list because thieves may still read it.
+
+static void
+__kmp_grow_task_deque( kmp_info_t *thread, kmp_thread_data_t *thread_data )
+{
+    kmp_task_array_t * old_deque = thread_data -> td.td_deque;
+    kmp_task_array_t * new_deque;
+    kmp_uint32         new_size = 2 * ( old_deque -> ta_mask + 1 );
+    kmp_uint32         head = TCR_4( thread_data -> td.td_deque_head );
+    kmp_uint32         tail = thread_data -> td.td_deque_tail;
+    kmp_uint32         i;
+
+    KE_TRACE( 10, ( "__kmp_grow_task_deque: T#%d growing deque of thread_data %p from %u to %u\n",
+                   __kmp_gtid_from_thread( thread ), thread_data, old_deque -> ta_mask + 1, new_size ) );
+
+    new_deque = (kmp_task_array_t *)
+            __kmp_allocate( sizeof(kmp_task_array_t) + ( new_size - 1 ) * sizeof(kmp_taskdata_t *) );
+    new_deque -> ta_prev = old_deque;
+    new_deque -> ta_mask = new_size - 1;
+
+    // Thieves may advance head while we copy; copying a stolen entry is harmless.
+    for ( i = head; i != tail; i++ ) {
+        new_deque -> ta_tasks[ i & new_deque -> ta_mask ] = old_deque -> ta_tasks[ i & old_deque -> ta_mask ];
+    }
+
+    KMP_MB();
+    TCW_PTR( thread_data -> td.td_deque, new_deque );
+}
+
+
+//---------------------------------------------------
+//  __kmp_deque_push: Owner pushes a task at the tail of its deque,
+//  growing the deque if it is full.
+
+static void
+__kmp_deque_push( kmp_info_t *thread, kmp_thread_data_t *thread_data, kmp_taskdata_t *taskdata )
+{
+    kmp_uint32         tail = thread_data -> td.td_deque_tail;
+    kmp_task_array_t * deque = thread_data -> td.td_deque;
+
+    if ( (kmp_int32)( tail - TCR_4( thread_data -> td.td_deque_head ) ) > (kmp_int32) deque -> ta_mask ) {
+        __kmp_grow_task_deque( thread, thread_data );
+        deque = thread_data -> td.td_deque;
+    }
+
+    deque -> ta_tasks[ tail & deque -> ta_mask ] = taskdata;  // Push taskdata
+    // The task must be visible before the new tail.
+    KMP_MB();
+    TCW_4( thread_data -> td.td_deque_tail, tail + 1 );
+}
+
+
 //---------------------------------------------------
 //  __kmp_push_task: Add a task to the thread's deque
 
@@ -342,30 +403,11 @@ __kmp_push_task(kmp_int32 gtid, kmp_task_t * task )
         __kmp_alloc_task_deque( thread, thread_data );
     }
 
-    // Check if deque is full
-    if ( TCR_4(thread_data -> td.td_deque_ntasks) >= TASK_DEQUE_SIZE )
-    {
-        KA_TRACE(20, ( "__kmp_push_task: T#%d deque is full; returning TASK_NOT_PUSHED for task %p\n",
-                       gtid, taskdata ) );
-        return TASK_NOT_PUSHED;
-    }
-
-    // Lock the deque for the task push operation
-    __kmp_acquire_bootstrap_lock( & thread_data -> td.td_deque_lock );
-
-    // Must have room since no thread can add tasks but calling thread
-    KMP_DEBUG_ASSERT( TCR_4(thread_data -> td.td_deque_ntasks) < TASK_DEQUE_SIZE );
-
-    thread_data -> td.td_deque[ thread_data -> td.td_deque_tail ] = taskdata;  // Push taskdata
-    // Wrap index.
-    thread_data -> td.td_deque_tail = ( thread_data -> td.td_deque_tail + 1 ) & TASK_DEQUE_MASK;
-    TCW_4(thread_data -> td.td_deque_ntasks, TCR_4(thread_data -> td.td_deque_ntasks) + 1);             // Adjust task count
-
-    __kmp_release_bootstrap_lock( & thread_data -> td.td_deque_lock );
+    __kmp_deque_push( thread, thread_data, taskdata );
 
     KA_TRACE(20, ("__kmp_push_task: T#%d returning TASK_SUCCESSFULLY_PUSHED: "
                   "task=%p ntasks=%d head=%u tail=%u\n",
-                  gtid, taskdata, thread_data->td.td_deque_ntasks,
+                  gtid, taskdata, KMP_TASK_DEQUE_NTASKS( thread_data ),
                   thread_data->td.td_deque_tail, thread_data->td.td_deque_head) );
 
     return TASK_SUCCESSFULLY_PUSHED;
@@ -467,6 +509,10 @@ __kmp_task_start( kmp_int32 gtid, kmp_task_t * task, kmp_taskdata_t * current_ta
     KMP_DEBUG_ASSERT( taskdata -> td_flags.complete == 0 );
     KMP_DEBUG_ASSERT( taskdata -> td_flags.freed == 0 );
 
+    KMP_OMPT_CALLBACK( ompt_event_task_switch, ( current_task->td_ompt_task_id, taskdata->td_ompt_task_id ) );
+    KMP_OMPT_CALLBACK( ompt_event_task_begin, ( taskdata->td_parent->td_ompt_task_id, taskdata->td_ompt_task_id,
+                                                (void *) task->routine ) );
+
     // GEH TODO: shouldn't we pass some sort of location identifier here?
     // APT: yes, we will pass location here.
     // need to store current thread state (in a thread or taskdata structure)
@@ -549,7 +595,7 @@ __kmp_free_task( kmp_int32 gtid, kmp_taskdata_t * taskdata, kmp_info_t * thread
     taskdata->td_flags.freed = 1;
     // deallocate the taskdata and shared variable blocks associated with this task
     #if USE_FAST_MEMORY
-        __kmp_fast_free( thread, taskdata );
+        __kmp_task_slab_free( thread, taskdata );
     #else /* ! USE_FAST_MEMORY */
         __kmp_thread_free( thread, taskdata );
     #endif
@@ -619,6 +665,9 @@ __kmp_task_finish( kmp_int32 gtid, kmp_task_t *task, kmp_taskdata_t *resumed_tas
     kmp_taskdata_t * taskdata = KMP_TASK_TO_TASKDATA(task);
     kmp_info_t * thread = __kmp_threads[ gtid ];
     kmp_int32 children = 0;
+#if OMP_40_ENABLED
+    kmp_depnode_t * depnode = taskdata -> td_depnode;
+#endif
 
     KA_TRACE(10, ("__kmp_task_finish(enter): T#%d finishing task %p and resuming task %p\n",
                   gtid, taskdata, resumed_task) );
@@ -640,6 +689,19 @@ __kmp_task_finish( kmp_int32 gtid, kmp_task_t *task, kmp_taskdata_t *resumed_tas
     KMP_DEBUG_ASSERT( taskdata -> td_flags.started == 1 );
     KMP_DEBUG_ASSERT( taskdata -> td_flags.freed == 0 );
 
+    // Report before the dependences are released: the task may be freed after that.
+    KMP_OMPT_CALLBACK( ompt_event_task_end, ( taskdata->td_ompt_task_id ) );
+    KMP_OMPT_CALLBACK( ompt_event_task_switch, ( taskdata->td_ompt_task_id,
+        ( resumed_task != NULL ? resumed_task : taskdata->td_parent )->td_ompt_task_id ) );
+
+#if OMP_40_ENABLED
+    // No more children can be created, so forget their dependences.  The
+    // successors are scheduled once this task is gone (see below).
+    if ( taskdata -> td_dephash != NULL )
+        __kmp_dephash_free( thread, taskdata );
+    taskdata -> td_depnode = NULL;
+#endif
+
     // Only need to keep track of count if team parallel and tasking not serialized
     if ( !( taskdata -> td_flags.team_serial || taskdata -> td_flags.tasking_ser ) ) {
         // Predecrement simulated by "- 1" calculation
@@ -681,6 +743,13 @@ __kmp_task_finish( kmp_int32 gtid, kmp_task_t *task, kmp_taskdata_t *resumed_tas
     // KMP_DEBUG_ASSERT( resumed_task->td_flags.executing == 0 );
     resumed_task->td_flags.executing = 1;  // resume previous task
 
+#if OMP_40_ENABLED
+    // Schedule the tasks that were waiting for this one.  This comes after the
+    // resumed task is restored, since a successor may have to run right here.
+    if ( depnode != NULL )
+        __kmp_release_deps( gtid, depnode );
+#endif
+
     KA_TRACE(10, ("__kmp_task_finish(exit): T#%d finished task %p, resuming task %p\n",
                   gtid, taskdata, resumed_task) );
 
@@ -747,6 +816,11 @@ __kmp_init_implicit_task( ident_t *loc_ref, kmp_info_t *this_thr, kmp_team_t *te
                   tid, team, task, set_curr_task ? "TRUE" : "FALSE" ) );
 
     task->td_task_id  = KMP_GEN_TASK_ID();
+#if OMPT_SUPPORT
+    task->td_ompt_task_id = KMP_OMPT_NEW_ID();
+    task->td_ompt_frame.exit_runtime_frame    = NULL;
+    task->td_ompt_frame.reenter_runtime_frame = NULL;
+#endif
     task->td_team     = team;
 //    task->td_parent   = NULL;  // fix for CQ230101 (broken parent task info in debugger)
     task->td_ident    = loc_ref;
@@ -771,6 +845,8 @@ __kmp_init_implicit_task( ident_t *loc_ref, kmp_info_t *this_thr, kmp_team_t *te
         task->td_allocated_child_tasks  = 0; // Not used because do not need to deallocate implicit task
 #if OMP_40_ENABLED
         task->td_taskgroup = NULL;           // An implicit task does not have taskgroup
+        task->td_dephash = NULL;
+        task->td_depnode = NULL;
 #endif
         __kmp_push_current_task_to_thread( this_thr, team, tid );
     } else {
@@ -844,7 +920,7 @@ __kmp_task_alloc( ident_t *loc_ref, kmp_int32 gtid, kmp_tasking_flags_t *flags,
 
     // Avoid double allocation here by combining shareds with taskdata
     #if USE_FAST_MEMORY
-    taskdata = (kmp_taskdata_t *) __kmp_fast_allocate( thread, shareds_offset + sizeof_shareds );
+    taskdata = (kmp_taskdata_t *) __kmp_task_slab_allocate( thread, shareds_offset + sizeof_shareds );
     #else /* ! USE_FAST_MEMORY */
     taskdata = (kmp_taskdata_t *) __kmp_thread_malloc( thread, shareds_offset + sizeof_shareds );
     #endif /* USE_FAST_MEMORY */
@@ -885,6 +961,7 @@ __kmp_task_alloc( ident_t *loc_ref, kmp_int32 gtid, kmp_tasking_flags_t *flags,
     taskdata->td_flags.tiedness    = flags->tiedness;
     taskdata->td_flags.final       = flags->final;
     taskdata->td_flags.merged_if0  = flags->merged_if0;
+    taskdata->td_flags.unsigned_bounds = flags->unsigned_bounds;
     taskdata->td_flags.tasktype    = TASK_EXPLICIT;
 
     // GEH - TODO: fix this to copy parent task's value of tasking_ser flag
@@ -910,6 +987,14 @@ __kmp_task_alloc( ident_t *loc_ref, kmp_int32 gtid, kmp_tasking_flags_t *flags,
     taskdata->td_allocated_child_tasks  = 1; // start at one because counts current task and children
 #if OMP_40_ENABLED
     taskdata->td_taskgroup = parent_task->td_taskgroup; // task inherits the taskgroup from the parent task
+    taskdata->td_dephash = NULL;
+    taskdata->td_depnode = NULL;
+    taskdata->td_size_alloc = shareds_offset + sizeof_shareds;
+#endif
+#if OMPT_SUPPORT
+    taskdata->td_ompt_task_id = KMP_OMPT_NEW_ID();
+    taskdata->td_ompt_frame.exit_runtime_frame    = NULL;
+    taskdata->td_ompt_frame.reenter_runtime_frame = NULL;
 #endif
     // Only need to keep track of child task counts if team parallel and tasking not serialized
     if ( !( taskdata -> td_flags.team_serial || taskdata -> td_flags.tasking_ser ) ) {
@@ -924,6 +1009,8 @@ __kmp_task_alloc( ident_t *loc_ref, kmp_int32 gtid, kmp_tasking_flags_t *flags,
         }
     }
 
+    KMP_STATS_COUNT( thread, KMP_STAT_TASK_CREATE );
+
     KA_TRACE(20, ("__kmp_task_alloc(exit): T#%d created task %p parent=%p\n",
                   gtid, taskdata, taskdata->td_parent) );
 
@@ -970,6 +1057,11 @@ __kmp_invoke_task( kmp_int32 gtid, kmp_task_t *task, kmp_taskdata_t * current_ta
                   gtid, taskdata, current_task) );
 
     __kmp_task_start( gtid, task, current_task );
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_TASK_EXECUTE );
+    KMP_OMPT_STATE_ENTER( __kmp_threads[ gtid ], ompt_prev_state, ompt_state_work_parallel, 0 );
+#if OMPT_SUPPORT
+    taskdata->td_ompt_frame.exit_runtime_frame = KMP_OMPT_FRAME_ADDRESS();
+#endif
 
     //
     // Invoke the task routine and pass in relevant data.
@@ -985,6 +1077,10 @@ __kmp_invoke_task( kmp_int32 gtid, kmp_task_t *task, kmp_taskdata_t * current_ta
         (*(task->routine))(gtid, task);
     }
 
+#if OMPT_SUPPORT
+    taskdata->td_ompt_frame.exit_runtime_frame = NULL;
+#endif
+    KMP_OMPT_STATE_EXIT( __kmp_threads[ gtid ], ompt_prev_state );
     __kmp_task_finish( gtid, task, current_task );
 
     KA_TRACE(30, ("__kmp_inovke_task(exit): T#%d completed task %p, resuming task %p\n",
@@ -1089,11 +1185,13 @@ __kmpc_omp_taskwait( ident_t *loc_ref, kmp_int32 gtid )
 
         if ( ! taskdata->td_flags.team_serial ) {
             // GEH: if team serialized, avoid reading the volatile variable below.
+            KMP_OMPT_STATE_ENTER( thread, ompt_prev_state, ompt_state_wait_taskwait, taskdata );
             while ( TCR_4(taskdata -> td_incomplete_child_tasks) != 0 ) {
                 __kmp_execute_tasks( thread, gtid, &(taskdata->td_incomplete_child_tasks),
                                      0, FALSE, &thread_finished, 
                                      __kmp_task_stealing_constraint );
             }
+            KMP_OMPT_STATE_EXIT( thread, ompt_prev_state );
         }
 
         // GEH TODO: shouldn't we have some sort of OMPRAP API calls here to mark end of wait?
@@ -1183,11 +1281,13 @@ __kmpc_end_taskgroup( ident* loc, int gtid )
     if ( __kmp_tasking_mode != tskm_immediate_exec ) {
 
         if ( ! taskdata->td_flags.team_serial ) {
+            KMP_OMPT_STATE_ENTER( thread, ompt_prev_state, ompt_state_wait_taskgroup, taskgroup );
             while ( TCR_4(taskgroup->count) != 0 ) {
                 __kmp_execute_tasks( thread, gtid, &(taskgroup->count),
                                      0, FALSE, &thread_finished, 
                                      __kmp_task_stealing_constraint );
             }
+            KMP_OMPT_STATE_EXIT( thread, ompt_prev_state );
         }
 
     }
@@ -1202,8 +1302,748 @@ __kmpc_end_taskgroup( ident* loc, int gtid )
 #endif
 
 
+#if OMP_40_ENABLED
+//-------------------------------------------------------------------------------------
+// Task dependences
+//
+// A task created with dependences gets a kmp_depnode_t.  Its parent keeps a hash
+// (td_dephash) mapping each address to the last child that wrote it and the
+// children that read it since.  The new task becomes a successor of every node
+// it conflicts with; dn_npredecessors counts the predecessors that have not
+// finished yet, and the last one to finish schedules the task from
+// __kmp_task_finish.  Successor lists are pushed with a CAS and closed with
+// KMP_DEPNODE_FINISHED, so no lock is needed on the node.
+//
+// Nodes, list cells and hash entries are all recycled through a free list owned
+// by the thread that releases them (th_dep_free_list), so after warm up no
+// dependence costs a call to the allocator.  The list is capped: when one
+// thread creates the tasks and others finish them, the chunks pile up on the
+// finishing threads, and only TASK_DEP_FREE_LIST_MAX of them stay there.
+
+typedef union kmp_dep_chunk {
+    union kmp_dep_chunk *   dc_next;
+    kmp_depnode_t           dc_node;
+    kmp_depnode_list_t      dc_list;
+    kmp_dephash_entry_t     dc_entry;
+} kmp_dep_chunk_t;
+
+static void *
+__kmp_dep_alloc( kmp_info_t *thread )
+{
+    kmp_dep_chunk_t *chunk = (kmp_dep_chunk_t *) thread->th.th_dep_free_list;
+
+    if ( chunk != NULL ) {
+        thread->th.th_dep_free_list = chunk->dc_next;
+        thread->th.th_dep_free_count--;
+        return chunk;
+    }
+    // Chunks move to the free list of whichever thread releases them,
+    // so they are not carved from the thread's fast memory
+    return __kmp_allocate( sizeof( kmp_dep_chunk_t ) );
+}
+
+static void
+__kmp_dep_free( kmp_info_t *thread, void *ptr )
+{
+    kmp_dep_chunk_t *chunk = (kmp_dep_chunk_t *) ptr;
+
+    if ( thread->th.th_dep_free_count >= TASK_DEP_FREE_LIST_MAX ) {
+        __kmp_free( chunk );
+        return;
+    }
+    chunk->dc_next = (kmp_dep_chunk_t *) thread->th.th_dep_free_list;
+    thread->th.th_dep_free_list = chunk;
+    thread->th.th_dep_free_count++;
+}
+
+//-------------------------------------------------------------------------------------
+// __kmp_free_dep_pool: return the thread's free dependence chunks to the system
+// Called when the thread is reaped.
+
+void
+__kmp_free_dep_pool( kmp_info_t *thread )
+{
+    kmp_dep_chunk_t *chunk = (kmp_dep_chunk_t *) thread->th.th_dep_free_list;
+
+    thread->th.th_dep_free_list = NULL;
+    thread->th.th_dep_free_count = 0;
+    while ( chunk != NULL ) {
+        kmp_dep_chunk_t *next = chunk->dc_next;
+        __kmp_free( chunk );
+        chunk = next;
+    }
+}
+
+static kmp_depnode_t *
+__kmp_depnode_alloc( kmp_info_t *thread, kmp_task_t *task )
+{
+    kmp_depnode_t *node = (kmp_depnode_t *) __kmp_dep_alloc( thread );
+
+    node->dn_task = task;
+    node->dn_successors = NULL;
+    node->dn_npredecessors = 1;     // guard, dropped once all dependences are processed
+    node->dn_nrefs = 1;             // reference held by the task (or waiter)
+    return node;
+}
+
+static void
+__kmp_depnode_deref( kmp_info_t *thread, kmp_depnode_t *node )
+{
+    if ( KMP_TEST_THEN_DEC32( &node->dn_nrefs ) - 1 == 0 ) {
+        KMP_DEBUG_ASSERT( node->dn_successors == NULL || node->dn_successors == KMP_DEPNODE_FINISHED );
+        __kmp_dep_free( thread, node );
+    }
+}
+
+static void
+__kmp_depnode_list_free( kmp_info_t *thread, kmp_depnode_list_t *list )
+{
+    while ( list != NULL ) {
+        kmp_depnode_list_t *next = list->dl_next;
+        __kmp_depnode_deref( thread, list->dl_node );
+        __kmp_dep_free( thread, list );
+        list = next;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// __kmp_depnode_link_successor: make node wait for pred unless pred has already
+// finished.  Returns 1 if a predecessor was added, 0 otherwise.
+
+static kmp_int32
+__kmp_depnode_link_successor( kmp_info_t *thread, kmp_depnode_t *pred, kmp_depnode_t *node )
+{
+    kmp_depnode_list_t *cell, *head;
+
+    if ( pred == node || TCR_PTR( pred->dn_successors ) == KMP_DEPNODE_FINISHED )
+        return 0;
+
+    cell = (kmp_depnode_list_t *) __kmp_dep_alloc( thread );
+    cell->dl_node = node;
+    KMP_TEST_THEN_INC32( &node->dn_nrefs );             // reference held by the cell
+    KMP_TEST_THEN_INC32( &node->dn_npredecessors );
+
+    for (;;) {
+        head = (kmp_depnode_list_t *) TCR_PTR( pred->dn_successors );
+        if ( head == KMP_DEPNODE_FINISHED ) {
+            // pred finished meanwhile; our own references keep both counts above zero
+            KMP_TEST_THEN_DEC32( &node->dn_npredecessors );
+            KMP_TEST_THEN_DEC32( &node->dn_nrefs );
+            __kmp_dep_free( thread, cell );
+            return 0;
+        }
+        cell->dl_next = head;
+        if ( KMP_COMPARE_AND_STORE_PTR( &pred->dn_successors, head, cell ) )
+            return 1;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Dependence hash of a task, keyed on the base address of the dependence
+
+static kmp_dephash_t *
+__kmp_dephash_create( kmp_info_t *thread, kmp_taskdata_t *current_task )
+{
+    kmp_dephash_t *h;
+    kmp_uint32 size = ( current_task->td_flags.tasktype == TASK_IMPLICIT ) ?
+                      KMP_DEPHASH_MASTER_SIZE : KMP_DEPHASH_OTHER_SIZE;
+    size_t bytes = sizeof( kmp_dephash_t ) + ( size - 1 ) * sizeof( kmp_dephash_entry_t * );
+
+    #if USE_FAST_MEMORY
+        h = (kmp_dephash_t *) __kmp_fast_allocate( thread, bytes );
+    #else /* ! USE_FAST_MEMORY */
+        h = (kmp_dephash_t *) __kmp_thread_malloc( thread, bytes );
+    #endif
+    h->dh_size = size;
+    memset( h->dh_buckets, 0, size * sizeof( kmp_dephash_entry_t * ) );
+    return h;
+}
+
+//-------------------------------------------------------------------------------------
+// __kmp_dephash_free: drop the dependence hash of a task whose children are
+// all created.  The nodes live on as long as tasks or successor lists use them.
+
+void
+__kmp_dephash_free( kmp_info_t *thread, kmp_taskdata_t *task )
+{
+    kmp_dephash_t *h = task->td_dephash;
+    kmp_uint32 i;
+
+    if ( h == NULL )
+        return;
+    task->td_dephash = NULL;
+
+    for ( i = 0; i < h->dh_size; i++ ) {
+        kmp_dephash_entry_t *entry = h->dh_buckets[ i ];
+        while ( entry != NULL ) {
+            kmp_dephash_entry_t *next = entry->de_next;
+            if ( entry->de_last_out != NULL )
+                __kmp_depnode_deref( thread, entry->de_last_out );
+            __kmp_depnode_list_free( thread, entry->de_last_ins );
+            __kmp_dep_free( thread, entry );
+            entry = next;
+        }
+    }
+    #if USE_FAST_MEMORY
+        __kmp_fast_free( thread, h );
+    #else /* ! USE_FAST_MEMORY */
+        __kmp_thread_free( thread, h );
+    #endif
+}
+
+static kmp_dephash_entry_t *
+__kmp_dephash_find( kmp_info_t *thread, kmp_dephash_t *h, kmp_intptr_t addr )
+{
+    kmp_uint32 bucket = (kmp_uint32)( ( (kmp_uintptr_t) addr >> 6 ) ^ ( (kmp_uintptr_t) addr >> 2 ) ) % h->dh_size;
+    kmp_dephash_entry_t *entry;
+
+    for ( entry = h->dh_buckets[ bucket ]; entry != NULL; entry = entry->de_next )
+        if ( entry->de_addr == addr )
+            return entry;
+
+    entry = (kmp_dephash_entry_t *) __kmp_dep_alloc( thread );
+    entry->de_addr = addr;
+    entry->de_last_out = NULL;
+    entry->de_last_ins = NULL;
+    entry->de_next = h->dh_buckets[ bucket ];
+    h->dh_buckets[ bucket ] = entry;
+    return entry;
+}
+
+//-------------------------------------------------------------------------------------
+// __kmp_merge_deps: fold repeated addresses into their first occurrence, so a
+// task never depends on itself.  Merged entries get a zero base address.
+
+static void
+__kmp_merge_deps( kmp_int32 ndeps, kmp_depend_info_t *dep_list,
+                  kmp_int32 ndeps_noalias, kmp_depend_info_t *noalias_dep_list )
+{
+    kmp_int32 i, j;
+    kmp_int32 n = ndeps + ndeps_noalias;
+
+    for ( i = 0; i < n; i++ ) {
+        kmp_depend_info_t *di = ( i < ndeps ) ? &dep_list[ i ] : &noalias_dep_list[ i - ndeps ];
+        if ( di->base_addr == 0 )
+            continue;
+        for ( j = i + 1; j < n; j++ ) {
+            kmp_depend_info_t *dj = ( j < ndeps ) ? &dep_list[ j ] : &noalias_dep_list[ j - ndeps ];
+            if ( dj->base_addr == di->base_addr ) {
+                di->flags.in  |= dj->flags.in;
+                di->flags.out |= dj->flags.out;
+                dj->base_addr = 0;
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// __kmp_process_deps: link node after the siblings it conflicts with.
+// If record is set, node is also entered in the hash as the last writer or a
+// reader of each address (a taskwait with depend clauses does not record).
+// Returns the number of predecessors added.
+
+static kmp_int32
+__kmp_process_deps( kmp_info_t *thread, kmp_dephash_t *h, kmp_depnode_t *node, int record,
+                    kmp_int32 ndeps, kmp_depend_info_t *dep_list )
+{
+    kmp_int32 npredecessors = 0;
+    kmp_int32 i;
+
+    for ( i = 0; i < ndeps; i++ ) {
+        kmp_depend_info_t *dep = &dep_list[ i ];
+        kmp_dephash_entry_t *entry;
+        kmp_depnode_list_t *cell;
+
+        if ( dep->base_addr == 0 )
+            continue;
+        entry = __kmp_dephash_find( thread, h, dep->base_addr );
+
+        if ( dep->flags.out ) {
+            // a writer waits for the readers since the last writer, or for that writer
+            if ( entry->de_last_ins != NULL ) {
+                for ( cell = entry->de_last_ins; cell != NULL; cell = cell->dl_next )
+                    npredecessors += __kmp_depnode_link_successor( thread, cell->dl_node, node );
+            } else if ( entry->de_last_out != NULL ) {
+                npredecessors += __kmp_depnode_link_successor( thread, entry->de_last_out, node );
+            }
+            if ( record ) {
+                __kmp_depnode_list_free( thread, entry->de_last_ins );
+                entry->de_last_ins = NULL;
+                if ( entry->de_last_out != NULL )
+                    __kmp_depnode_deref( thread, entry->de_last_out );
+                KMP_TEST_THEN_INC32( &node->dn_nrefs );
+                entry->de_last_out = node;
+            }
+        } else if ( dep->flags.in ) {
+            // a reader only waits for the last writer
+            if ( entry->de_last_out != NULL )
+                npredecessors += __kmp_depnode_link_successor( thread, entry->de_last_out, node );
+            if ( record ) {
+                cell = (kmp_depnode_list_t *) __kmp_dep_alloc( thread );
+                KMP_TEST_THEN_INC32( &node->dn_nrefs );
+                cell->dl_node = node;
+                cell->dl_next = entry->de_last_ins;
+                entry->de_last_ins = cell;
+            }
+        }
+    }
+    return npredecessors;
+}
+
+//-------------------------------------------------------------------------------------
+// __kmp_release_deps: close the successor list of a finished task's node and
+// schedule the successors that have no other unfinished predecessor.
+
+static void
+__kmp_release_deps( kmp_int32 gtid, kmp_depnode_t *node )
+{
+    kmp_info_t *thread = __kmp_threads[ gtid ];
+    kmp_depnode_list_t *list;
+
+    do {
+        list = (kmp_depnode_list_t *) TCR_PTR( node->dn_successors );
+    } while ( ! KMP_COMPARE_AND_STORE_PTR( &node->dn_successors, list, KMP_DEPNODE_FINISHED ) );
+
+    KA_TRACE(20, ("__kmp_release_deps: T#%d releasing successors of node %p\n",
+                  gtid, node) );
+
+    while ( list != NULL ) {
+        kmp_depnode_list_t *next = list->dl_next;
+        kmp_depnode_t *successor = list->dl_node;
+
+        if ( KMP_TEST_THEN_DEC32( &successor->dn_npredecessors ) - 1 == 0 && successor->dn_task != NULL ) {
+            KA_TRACE(20, ("__kmp_release_deps: T#%d scheduling task %p\n",
+                          gtid, KMP_TASK_TO_TASKDATA( successor->dn_task ) ) );
+            if ( __kmp_push_task( gtid, successor->dn_task ) == TASK_NOT_PUSHED ) {
+                // Cannot defer: execute it now, as a stolen task would be
+                __kmp_invoke_task( gtid, successor->dn_task, thread->th.th_current_task );
+            }
+        }
+        __kmp_depnode_deref( thread, successor );
+        __kmp_dep_free( thread, list );
+        list = next;
+    }
+    __kmp_depnode_deref( thread, node );
+}
+
+//-------------------------------------------------------------------------------------
+// __kmpc_omp_task_with_deps: Schedule a task once its dependences are satisfied
+// loc_ref: location of original task pragma (ignored)
+// gtid: Global Thread ID of encountering thread
+// new_task: task thunk allocated by __kmp_omp_task_alloc() for the ''new task''
+// ndeps: number of depend items with possible aliasing
+// dep_list: list of depend items with possible aliasing
+// ndeps_noalias: number of depend items with no aliasing
+// noalias_dep_list: list of depend items with no aliasing
+// returns:
+//
+//    TASK_CURRENT_NOT_QUEUED (0) if did not suspend and queue current task to be resumed later.
+//    TASK_CURRENT_QUEUED (1) if suspended and queued the current task to be resumed later.
+
+kmp_int32
+__kmpc_omp_task_with_deps( ident_t *loc_ref, kmp_int32 gtid, kmp_task_t * new_task,
+                           kmp_int32 ndeps, kmp_depend_info_t *dep_list,
+                           kmp_int32 ndeps_noalias, kmp_depend_info_t *noalias_dep_list )
+{
+    kmp_info_t     * thread = __kmp_threads[ gtid ];
+    kmp_taskdata_t * current_task = thread->th.th_current_task;
+    kmp_taskdata_t * new_taskdata = KMP_TASK_TO_TASKDATA(new_task);
+
+    KA_TRACE(10, ("__kmpc_omp_task_with_deps(enter): T#%d loc=%p task=%p ndeps=%d ndeps_noalias=%d\n",
+                  gtid, loc_ref, new_taskdata, ndeps, ndeps_noalias ) );
+
+    // Serialized tasks run in creation order, which already satisfies any dependence
+    if ( ndeps + ndeps_noalias > 0 &&
+         ! ( current_task->td_flags.team_serial || current_task->td_flags.tasking_ser ||
+             current_task->td_flags.final ) ) {
+        kmp_depnode_t *node = __kmp_depnode_alloc( thread, new_task );
+        kmp_uint32 task_serial = new_taskdata->td_flags.task_serial;
+
+        if ( current_task->td_dephash == NULL )
+            current_task->td_dephash = __kmp_dephash_create( thread, current_task );
+        new_taskdata->td_depnode = node;
+
+        // A task that has to wait is pushed by its last predecessor, so it must be deferrable
+        new_taskdata->td_flags.task_serial = 0;
+
+        __kmp_merge_deps( ndeps, dep_list, ndeps_noalias, noalias_dep_list );
+        __kmp_process_deps( thread, current_task->td_dephash, node, TRUE, ndeps, dep_list );
+        __kmp_process_deps( thread, current_task->td_dephash, node, TRUE, ndeps_noalias, noalias_dep_list );
+
+        // Drop the guard; if predecessors remain, the last of them schedules the task
+        if ( KMP_TEST_THEN_DEC32( &node->dn_npredecessors ) - 1 > 0 ) {
+            KA_TRACE(10, ("__kmpc_omp_task_with_deps(exit): T#%d task %p waits for predecessors, "
+                          "returning TASK_CURRENT_NOT_QUEUED\n", gtid, new_taskdata ) );
+            return TASK_CURRENT_NOT_QUEUED;
+        }
+        new_taskdata->td_flags.task_serial = task_serial;
+    }
+
+    return __kmpc_omp_task( loc_ref, gtid, new_task );
+}
+
+//-------------------------------------------------------------------------------------
+// __kmpc_omp_wait_deps: Wait until the siblings an undeferred task depends on are complete
+// loc_ref: location of original task pragma (ignored)
+// gtid: Global Thread ID of encountering thread
+// ndeps, dep_list, ndeps_noalias, noalias_dep_list: depend items, as for __kmpc_omp_task_with_deps
+
+void
+__kmpc_omp_wait_deps( ident_t *loc_ref, kmp_int32 gtid, kmp_int32 ndeps, kmp_depend_info_t *dep_list,
+                      kmp_int32 ndeps_noalias, kmp_depend_info_t *noalias_dep_list )
+{
+    kmp_info_t     * thread = __kmp_threads[ gtid ];
+    kmp_taskdata_t * current_task = thread->th.th_current_task;
+    kmp_depnode_t  * node;
+    int thread_finished = FALSE;
+
+    KA_TRACE(10, ("__kmpc_omp_wait_deps(enter): T#%d loc=%p ndeps=%d ndeps_noalias=%d\n",
+                  gtid, loc_ref, ndeps, ndeps_noalias ) );
+
+    // Without a hash no sibling with dependences was ever created
+    if ( ndeps + ndeps_noalias == 0 || current_task->td_dephash == NULL ||
+         current_task->td_flags.team_serial || current_task->td_flags.tasking_ser ||
+         current_task->td_flags.final ) {
+        KA_TRACE(10, ("__kmpc_omp_wait_deps(exit): T#%d has nothing to wait for\n", gtid ) );
+        return;
+    }
+
+    node = __kmp_depnode_alloc( thread, NULL );
+    __kmp_merge_deps( ndeps, dep_list, ndeps_noalias, noalias_dep_list );
+    __kmp_process_deps( thread, current_task->td_dephash, node, FALSE, ndeps, dep_list );
+    __kmp_process_deps( thread, current_task->td_dephash, node, FALSE, ndeps_noalias, noalias_dep_list );
+
+    if ( KMP_TEST_THEN_DEC32( &node->dn_npredecessors ) - 1 > 0 ) {
+        KMP_OMPT_STATE_ENTER( thread, ompt_prev_state, ompt_state_wait_taskwait, current_task );
+        while ( TCR_4(node->dn_npredecessors) != 0 ) {
+            __kmp_execute_tasks( thread, gtid, (volatile kmp_uint *) &node->dn_npredecessors,
+                                 0, FALSE, &thread_finished,
+                                 __kmp_task_stealing_constraint );
+        }
+        KMP_OMPT_STATE_EXIT( thread, ompt_prev_state );
+    }
+    __kmp_depnode_deref( thread, node );
+
+    KA_TRACE(10, ("__kmpc_omp_wait_deps(exit): T#%d finished waiting\n", gtid ) );
+}
+
+//-------------------------------------------------------------------------------------
+// Taskloop
+//
+// The compiler allocates one pattern task whose privates hold the loop bounds.
+// The iteration space is cut into num_tasks pieces; a range of pieces is split
+// in two by pushing a splitter task for the upper half (which thieves pick up
+// and split further in parallel) and keeping the lower half, until at most
+// TASKLOOP_LEAF_TASKS pieces remain.  Those are then created as copies of the
+// pattern with their own bounds.  Each splitter owns a copy of the pattern, so
+// the encountering task does not have to outlive the loop.
+
+typedef struct kmp_taskloop_bounds {
+    kmp_task_t *         tb_pattern;     // task duplicated for each piece
+    kmp_task_dup_t       tb_task_dup;    // compiler routine copying firstprivates, may be NULL
+    size_t               tb_lb_offset;   // offsets of the bounds within the task
+    size_t               tb_ub_offset;
+    kmp_uint64           tb_lower;       // first iteration of the whole loop
+    kmp_int64            tb_st;
+    kmp_uint64           tb_tc;          // trip count of the whole loop
+    kmp_uint64           tb_num_tasks;
+    kmp_uint64           tb_first;       // pieces [tb_first, tb_first + tb_count) are ours
+    kmp_uint64           tb_count;
+} kmp_taskloop_bounds_t;
+
+typedef struct kmp_taskloop_split {
+    kmp_task_t              ts_task;
+    kmp_taskloop_bounds_t   ts_bounds;
+} kmp_taskloop_split_t;
+
+static kmp_int32 __kmp_taskloop_task( kmp_int32 gtid, void *ptask );
+
+//-------------------------------------------------------------------------------------
+// __kmp_task_dup_alloc: allocate a copy of task_src as a child of the current task
+
+static kmp_task_t *
+__kmp_task_dup_alloc( kmp_info_t *thread, kmp_task_t *task_src )
+{
+    kmp_taskdata_t *taskdata_src = KMP_TASK_TO_TASKDATA( task_src );
+    kmp_taskdata_t *parent_task = thread->th.th_current_task;
+    size_t size = taskdata_src->td_size_alloc;
+    kmp_taskdata_t *taskdata;
+    kmp_task_t *task;
+
+    #if USE_FAST_MEMORY
+    taskdata = (kmp_taskdata_t *) __kmp_task_slab_allocate( thread, size );
+    #else /* ! USE_FAST_MEMORY */
+    taskdata = (kmp_taskdata_t *) __kmp_thread_malloc( thread, size );
+    #endif /* USE_FAST_MEMORY */
+    memcpy( taskdata, taskdata_src, size );
+
+    task = KMP_TASKDATA_TO_TASK( taskdata );
+    if ( task_src->shareds != NULL )
+        task->shareds = & ((char *) taskdata)[ (char *) task_src->shareds - (char *) taskdata_src ];
+
+    taskdata->td_task_id      = KMP_GEN_TASK_ID();
+#if OMPT_SUPPORT
+    taskdata->td_ompt_task_id = KMP_OMPT_NEW_ID();
+    taskdata->td_ompt_frame.exit_runtime_frame    = NULL;
+    taskdata->td_ompt_frame.reenter_runtime_frame = NULL;
+#endif
+    taskdata->td_alloc_thread = thread;
+    taskdata->td_parent       = parent_task;
+    taskdata->td_level        = parent_task->td_level + 1;
+    taskdata->td_taskgroup    = parent_task->td_taskgroup;
+    taskdata->td_dephash      = NULL;
+    taskdata->td_depnode      = NULL;
+
+    taskdata->td_flags.started     = 0;
+    taskdata->td_flags.executing   = 0;
+    taskdata->td_flags.complete    = 0;
+    taskdata->td_flags.freed       = 0;
+
+    taskdata->td_incomplete_child_tasks = 0;
+    taskdata->td_allocated_child_tasks  = 1;
+
+    // Same bookkeeping as in __kmp_task_alloc
+    if ( !( taskdata -> td_flags.team_serial || taskdata -> td_flags.tasking_ser ) ) {
+        KMP_TEST_THEN_INC32( (kmp_int32 *)(& parent_task->td_incomplete_child_tasks) );
+        if ( parent_task->td_taskgroup )
+            KMP_TEST_THEN_INC32( (kmp_int32 *)(& parent_task->td_taskgroup->count) );
+        if ( parent_task->td_flags.tasktype == TASK_EXPLICIT ) {
+            KMP_TEST_THEN_INC32( (kmp_int32 *)(& parent_task->td_allocated_child_tasks) );
+        }
+    }
+
+    KMP_STATS_COUNT( thread, KMP_STAT_TASK_CREATE );
+
+    KA_TRACE(20, ("__kmp_task_dup_alloc: T#%d created task %p from %p parent=%p\n",
+                  __kmp_gtid_from_thread( thread ), taskdata, taskdata_src, parent_task) );
+    return task;
+}
+
+//-------------------------------------------------------------------------------------
+// __kmp_taskloop_leaves: create one task per piece of b's range
+
+static void
+__kmp_taskloop_leaves( ident_t *loc, kmp_int32 gtid, kmp_taskloop_bounds_t *b )
+{
+    kmp_info_t *thread = __kmp_threads[ gtid ];
+    kmp_uint64 q = b->tb_tc / b->tb_num_tasks;   // iterations per piece
+    kmp_uint64 r = b->tb_tc % b->tb_num_tasks;   // the first r pieces get one more
+    kmp_uint64 i;
+
+    for ( i = b->tb_first; i < b->tb_first + b->tb_count; i++ ) {
+        kmp_uint64 start = i * q + ( i < r ? i : r );
+        kmp_uint64 len = q + ( i < r ? 1 : 0 );
+        kmp_task_t *task = __kmp_task_dup_alloc( thread, b->tb_pattern );
+        kmp_uint64 lower = b->tb_lower + start * b->tb_st;
+
+        *(kmp_uint64 *)( (char *) task + b->tb_lb_offset ) = lower;
+        *(kmp_uint64 *)( (char *) task + b->tb_ub_offset ) = lower + ( len - 1 ) * b->tb_st;
+        if ( b->tb_task_dup != NULL )
+            b->tb_task_dup( task, b->tb_pattern, i == b->tb_num_tasks - 1 );
+        __kmpc_omp_task( loc, gtid, task );
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// __kmp_taskloop_free_pattern: free a pattern task, which is never executed.
+// It was counted as a child of its parent (and taskgroup) when allocated, so
+// undo that like __kmp_task_finish() does, but without starting and finishing
+// it: it must not show up as an executed task in the statistics or to OMPT.
+
+static void
+__kmp_taskloop_free_pattern( kmp_int32 gtid, kmp_task_t *pattern )
+{
+    kmp_info_t *thread = __kmp_threads[ gtid ];
+    kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA( pattern );
+
+    KMP_DEBUG_ASSERT( taskdata->td_flags.started == 0 );
+    taskdata->td_flags.complete = 1;
+
+    if ( !( taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser ) ) {
+        KMP_TEST_THEN_DEC32( (kmp_int32 *)(& taskdata->td_parent->td_incomplete_child_tasks) );
+        if ( taskdata->td_taskgroup )
+            KMP_TEST_THEN_DEC32( (kmp_int32 *)(& taskdata->td_taskgroup->count) );
+    }
+    __kmp_free_task_and_ancestors( gtid, taskdata, thread );
+}
+
+//-------------------------------------------------------------------------------------
+// __kmp_taskloop_recur: split b's range until it is small enough, then create its tasks
+
+static void
+__kmp_taskloop_recur( ident_t *loc, kmp_int32 gtid, kmp_taskloop_bounds_t *b )
+{
+    kmp_info_t *thread = __kmp_threads[ gtid ];
+
+    while ( b->tb_count > TASKLOOP_LEAF_TASKS ) {
+        kmp_uint64 half = b->tb_count / 2;
+        kmp_tasking_flags_t flags = { 0 };
+        kmp_taskloop_split_t *split;
+
+        flags.tiedness = TASK_TIED;
+        split = (kmp_taskloop_split_t *) __kmp_task_alloc( loc, gtid, &flags,
+                    sizeof( kmp_taskloop_split_t ), 0, __kmp_taskloop_task );
+        split->ts_bounds = *b;
+        split->ts_bounds.tb_pattern = __kmp_task_dup_alloc( thread, b->tb_pattern );
+        split->ts_bounds.tb_first = b->tb_first + half;
+        split->ts_bounds.tb_count = b->tb_count - half;
+        b->tb_count = half;
+
+        KA_TRACE(20, ("__kmp_taskloop_recur: T#%d splitting off pieces %llu..%llu\n", gtid,
+                      split->ts_bounds.tb_first, split->ts_bounds.tb_first + split->ts_bounds.tb_count - 1) );
+        __kmpc_omp_task( loc, gtid, &split->ts_task );
+    }
+    __kmp_taskloop_leaves( loc, gtid, b );
+}
+
+static kmp_int32
+__kmp_taskloop_task( kmp_int32 gtid, void *ptask )
+{
+    kmp_taskloop_split_t *split = (kmp_taskloop_split_t *) ptask;
+    kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA( &split->ts_task );
+
+    __kmp_taskloop_recur( taskdata->td_ident, gtid, &split->ts_bounds );
+    __kmp_taskloop_free_pattern( gtid, split->ts_bounds.tb_pattern );
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------
+// __kmpc_taskloop: Execute a loop as a set of tasks
+// loc: location of the taskloop pragma
+// gtid: Global Thread ID of encountering thread
+// task: pattern task allocated by __kmpc_omp_task_alloc(), never executed itself
+// if_val: value of the if clause (0 makes every piece undeferred)
+// lb, ub: pointers to the loop bounds inside the pattern task's privates;
+//         the pattern's unsigned_bounds flag tells how to compare them
+// st: loop stride
+// nogroup: if set, do not wrap the loop in an implicit taskgroup
+// sched: 0 - no clause, 1 - grainsize given, 2 - num_tasks given
+// grainsize: value of the grainsize or num_tasks clause
+// task_dup: compiler routine copying firstprivates and setting lastprivate, or NULL
+
+void
+__kmpc_taskloop( ident_t *loc, kmp_int32 gtid, kmp_task_t *task, kmp_int32 if_val,
+                 kmp_uint64 *lb, kmp_uint64 *ub, kmp_int64 st,
+                 kmp_int32 nogroup, kmp_int32 sched, kmp_uint64 grainsize, void *task_dup )
+{
+    kmp_info_t *thread = __kmp_threads[ gtid ];
+    kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA( task );
+    kmp_uint64 lower = *lb, upper = *ub;
+    kmp_taskloop_bounds_t b;
+    kmp_uint64 tc;
+    int empty;
+
+    KA_TRACE(10, ("__kmpc_taskloop(enter): T#%d pattern %p lb %lld ub %lld st %lld sched %d grainsize %llu\n",
+                  gtid, taskdata, lower, upper, st, sched, grainsize) );
+    KMP_DEBUG_ASSERT( st != 0 );
+
+    if ( ! nogroup )
+        __kmpc_taskgroup( loc, gtid );
+
+    // Check for an empty range first; the count below is modulo 2^64 and
+    // would turn lb > ub into a huge trip count.
+    if ( taskdata->td_flags.unsigned_bounds )
+        empty = ( st > 0 ) ? ( lower > upper ) : ( lower < upper );
+    else
+        empty = ( st > 0 ) ? ( (kmp_int64) lower > (kmp_int64) upper )
+                           : ( (kmp_int64) lower < (kmp_int64) upper );
+    if ( empty )
+        tc = 0;
+    else if ( st > 0 )
+        tc = ( upper - lower ) / (kmp_uint64) st + 1;
+    else
+        tc = ( lower - upper ) / ( (kmp_uint64) 0 - (kmp_uint64) st ) + 1;
+
+    if ( tc > 0 ) {
+        b.tb_pattern = task;
+        b.tb_task_dup = (kmp_task_dup_t) task_dup;
+        b.tb_lb_offset = (char *) lb - (char *) task;
+        b.tb_ub_offset = (char *) ub - (char *) task;
+        b.tb_lower = lower;
+        b.tb_st = st;
+        b.tb_tc = tc;
+
+        switch ( sched ) {
+            case 1:  // grainsize
+                b.tb_num_tasks = ( grainsize > 0 ) ? tc / grainsize : tc;
+                break;
+            case 2:  // num_tasks
+                b.tb_num_tasks = grainsize;
+                break;
+            default:
+                b.tb_num_tasks = (kmp_uint64) thread->th.th_team_nproc * TASKLOOP_TASKS_PER_THREAD;
+                break;
+        }
+        if ( b.tb_num_tasks > tc )
+            b.tb_num_tasks = tc;
+        if ( b.tb_num_tasks == 0 )
+            b.tb_num_tasks = 1;
+
+        if ( ! if_val ) {
+            // Undeferred: the pieces inherit task_serial and run here, in order
+            taskdata->td_flags.task_serial = 1;
+        }
+        b.tb_first = 0;
+        b.tb_count = b.tb_num_tasks;
+
+        if ( taskdata->td_flags.task_serial ) {
+            // Tasks will execute immediately, so splitting buys nothing
+            __kmp_taskloop_leaves( loc, gtid, &b );
+        } else {
+            __kmp_taskloop_recur( loc, gtid, &b );
+        }
+    }
+    __kmp_taskloop_free_pattern( gtid, task );
+
+    if ( ! nogroup )
+        __kmpc_end_taskgroup( loc, gtid );
+
+    KA_TRACE(10, ("__kmpc_taskloop(exit): T#%d\n", gtid) );
+}
+#endif // OMP_40_ENABLED
+
+
+//------------------------------------------------------------------------------
+// __kmp_task_is_descendant: check the task scheduling constraint, i.e. that
+// taskdata is a descendant of the thread's current task.
+// If head is not NULL, taskdata is still queued at position head_value of
+// another thread's deque and can be taken and freed under us at any time.
+// Every pointer is then revalidated against the head before it is followed
+// (the head only moves forward, so an unchanged head means the task, and
+// hence all its ancestors, are still alive), and FALSE is returned if the
+// task went away.
+
+static int
+__kmp_task_is_descendant( kmp_info_t *thread, kmp_taskdata_t *taskdata,
+                          volatile kmp_uint32 *head, kmp_uint32 head_value )
+{
+    kmp_taskdata_t * current = thread->th.th_current_task;
+    kmp_int32        level = current->td_level;
+    kmp_taskdata_t * parent;
+
+    if ( head != NULL && TCR_4(*head) != head_value )
+        return FALSE;
+    parent = taskdata->td_parent;
+    for ( ;; ) {
+        // Validates the pointer just loaded before it is followed
+        if ( head != NULL && TCR_4(*head) != head_value )
+            return FALSE;
+        KMP_DEBUG_ASSERT(parent != NULL);
+        if ( parent == current || parent->td_level <= level )
+            break;
+        parent = parent->td_parent;  // check generation up to the level of the current task
+    }
+    return parent == current;
+}
+
+
 //------------------------------------------------------
 // __kmp_remove_my_task: remove a task from my own deque
+//
+// The owner reserves the tail entry by publishing the decremented tail before
+// it reads the head.  If other tasks remain, no thief can reach that entry;
+// if it is the last one, the owner races the thieves for it with a CAS on the
+// head, like a thief would.
 
 static kmp_task_t *
 __kmp_remove_my_task( kmp_info_t * thread, kmp_int32 gtid, kmp_task_team_t *task_team,
@@ -1212,7 +2052,9 @@ __kmp_remove_my_task( kmp_info_t * thread, kmp_int32 gtid, kmp_task_team_t *task
     kmp_task_t * task;
     kmp_taskdata_t * taskdata;
     kmp_thread_data_t *thread_data;
-    kmp_uint32 tail;
+    kmp_task_array_t * deque;
+    kmp_uint32 head, tail;
+    kmp_int32 remaining;
 
     KMP_DEBUG_ASSERT( __kmp_tasking_mode != tskm_immediate_exec );
     KMP_DEBUG_ASSERT( task_team -> tt.tt_threads_data != NULL ); // Caller should check this condition
@@ -1220,56 +2062,64 @@ __kmp_remove_my_task( kmp_info_t * thread, kmp_int32 gtid, kmp_task_team_t *task
         thread_data = & task_team -> tt.tt_threads_data[ __kmp_tid_from_gtid( gtid ) ];
 
     KA_TRACE(10, ("__kmp_remove_my_task(enter): T#%d ntasks=%d head=%u tail=%u\n",
-                  gtid, thread_data->td.td_deque_ntasks, thread_data->td.td_deque_head,
+                  gtid, KMP_TASK_DEQUE_NTASKS( thread_data ), thread_data->td.td_deque_head,
                   thread_data->td.td_deque_tail) );
 
-    if (TCR_4(thread_data -> td.td_deque_ntasks) == 0) {
+    if (KMP_TASK_DEQUE_NTASKS( thread_data ) <= 0) {
         KA_TRACE(10, ("__kmp_remove_my_task(exit #1): T#%d No tasks to remove: ntasks=%d head=%u tail=%u\n",
-                      gtid, thread_data->td.td_deque_ntasks, thread_data->td.td_deque_head,
+                      gtid, KMP_TASK_DEQUE_NTASKS( thread_data ), thread_data->td.td_deque_head,
                       thread_data->td.td_deque_tail) );
         return NULL;
     }
 
-    __kmp_acquire_bootstrap_lock( & thread_data -> td.td_deque_lock );
+    deque = thread_data -> td.td_deque;
+    tail = thread_data -> td.td_deque_tail - 1;
+
+    // The exchange is a full fence: the new tail must be visible before we read the head.
+    __kmp_xchg_fixed32( (volatile kmp_int32 *) & thread_data -> td.td_deque_tail, tail );
+    head = TCR_4( thread_data -> td.td_deque_head );
+    remaining = (kmp_int32)( tail - head );
 
-    if (TCR_4(thread_data -> td.td_deque_ntasks) == 0) {
-        __kmp_release_bootstrap_lock( & thread_data -> td.td_deque_lock );
+    if ( remaining < 0 ) {
+        // Thieves emptied the deque in the meantime.
+        TCW_4( thread_data -> td.td_deque_tail, head );
         KA_TRACE(10, ("__kmp_remove_my_task(exit #2): T#%d No tasks to remove: ntasks=%d head=%u tail=%u\n",
-                      gtid, thread_data->td.td_deque_ntasks, thread_data->td.td_deque_head,
+                      gtid, KMP_TASK_DEQUE_NTASKS( thread_data ), thread_data->td.td_deque_head,
                       thread_data->td.td_deque_tail) );
         return NULL;
     }
 
-    tail = ( thread_data -> td.td_deque_tail - 1 ) & TASK_DEQUE_MASK;  // Wrap index.
-    taskdata = thread_data -> td.td_deque[ tail ];
+    taskdata = deque -> ta_tasks[ tail & deque -> ta_mask ];
 
-    if (is_constrained) {
-        // we need to check if the candidate obeys task scheduling constraint:
-        // only child of current task can be scheduled
-        kmp_taskdata_t * current = thread->th.th_current_task;
-        kmp_int32        level = current->td_level;
-        kmp_taskdata_t * parent = taskdata->td_parent;
-        while ( parent != current && parent->td_level > level ) {
-            parent = parent->td_parent;  // check generation up to the level of the current task
-            KMP_DEBUG_ASSERT(parent != NULL);
-        }
-        if ( parent != current ) {
-            // If the tail task is not a child, then no other childs can appear in the deque.
-            __kmp_release_bootstrap_lock( & thread_data -> td.td_deque_lock );
-            KA_TRACE(10, ("__kmp_remove_my_task(exit #2): T#%d No tasks to remove: ntasks=%d head=%u tail=%u\n",
-                          gtid, thread_data->td.td_deque_ntasks, thread_data->td.td_deque_head,
+    if ( remaining == 0 ) {
+        // Last task: take it away from the thieves by moving the head past it.
+        int won = KMP_COMPARE_AND_STORE_ACQ32( (volatile kmp_int32 *) & thread_data -> td.td_deque_head, head, head + 1 );
+        TCW_4( thread_data -> td.td_deque_tail, head + 1 );   // The deque is empty either way
+        if ( ! won ) {
+            KA_TRACE(10, ("__kmp_remove_my_task(exit #2): T#%d last task stolen: ntasks=%d head=%u tail=%u\n",
+                          gtid, KMP_TASK_DEQUE_NTASKS( thread_data ), thread_data->td.td_deque_head,
                           thread_data->td.td_deque_tail) );
             return NULL;
         }
     }
 
-    thread_data -> td.td_deque_tail = tail;
-    TCW_4(thread_data -> td.td_deque_ntasks, thread_data -> td.td_deque_ntasks - 1);
-
-    __kmp_release_bootstrap_lock( & thread_data->td.td_deque_lock );
+    // The task is ours now, so the constraint can be checked without revalidation.
+    if ( is_constrained && ! __kmp_task_is_descendant( thread, taskdata, NULL, 0 ) ) {
+        // If the tail task is not a child, then no other childs can appear in the deque.
+        // Put it back where it was.
+        if ( remaining == 0 ) {
+            __kmp_deque_push( thread, thread_data, taskdata );
+        } else {
+            TCW_4( thread_data -> td.td_deque_tail, tail + 1 );
+        }
+        KA_TRACE(10, ("__kmp_remove_my_task(exit #2): T#%d No tasks to remove: ntasks=%d head=%u tail=%u\n",
+                      gtid, KMP_TASK_DEQUE_NTASKS( thread_data ), thread_data->td.td_deque_head,
+                      thread_data->td.td_deque_tail) );
+        return NULL;
+    }
 
     KA_TRACE(10, ("__kmp_remove_my_task(exit #2): T#%d task %p removed: ntasks=%d head=%u tail=%u\n",
-                  gtid, taskdata, thread_data->td.td_deque_ntasks, thread_data->td.td_deque_head,
+                  gtid, taskdata, KMP_TASK_DEQUE_NTASKS( thread_data ), thread_data->td.td_deque_head,
                   thread_data->td.td_deque_tail) );
 
     task = KMP_TASKDATA_TO_TASK( taskdata );
@@ -1281,6 +2131,10 @@ __kmp_remove_my_task( kmp_info_t * thread, kmp_int32 gtid, kmp_task_team_t *task
 // __kmp_steal_task: remove a task from another thread's deque
 // Assume that calling thread has already checked existence of
 // task_team thread_data before calling this routine.
+//
+// Thieves always take the task at the head with a CAS.  When the task
+// scheduling constraint applies, the head task is only taken if it is a
+// descendant of our current task.
 
 static kmp_task_t *
 __kmp_steal_task( kmp_info_t *victim, kmp_int32 gtid, kmp_task_team_t *task_team,
@@ -1290,7 +2144,10 @@ __kmp_steal_task( kmp_info_t *victim, kmp_int32 gtid, kmp_task_team_t *task_team
     kmp_task_t * task;
     kmp_taskdata_t * taskdata;
     kmp_thread_data_t *victim_td, *threads_data;
+    kmp_task_array_t * deque;
     kmp_int32 victim_tid, thread_tid;
+    kmp_uint32 head, tail;
+    int was_finished;
 
     KMP_DEBUG_ASSERT( __kmp_tasking_mode != tskm_immediate_exec );
 
@@ -1302,83 +2159,74 @@ __kmp_steal_task( kmp_info_t *victim, kmp_int32 gtid, kmp_task_team_t *task_team
 
     KA_TRACE(10, ("__kmp_steal_task(enter): T#%d try to steal from T#%d: task_team=%p ntasks=%d "
                   "head=%u tail=%u\n",
-                  gtid, __kmp_gtid_from_thread( victim ), task_team, victim_td->td.td_deque_ntasks,
+                  gtid, __kmp_gtid_from_thread( victim ), task_team, KMP_TASK_DEQUE_NTASKS( victim_td ),
                   victim_td->td.td_deque_head, victim_td->td.td_deque_tail) );
 
-    if ( (TCR_4(victim_td -> td.td_deque_ntasks) == 0) || // Caller should not check this condition
+    // The head must be read before the tail, and the tail before the array.
+    head = TCR_4( victim_td -> td.td_deque_head );
+    tail = TCR_4( victim_td -> td.td_deque_tail );
+
+    if ( ((kmp_int32)( tail - head ) <= 0) || // Caller should not check this condition
          (TCR_PTR(victim->th.th_task_team) != task_team)) // GEH: why would this happen?
     {
         KA_TRACE(10, ("__kmp_steal_task(exit #1): T#%d could not steal from T#%d: task_team=%p "
                       "ntasks=%d head=%u tail=%u\n",
-                      gtid, __kmp_gtid_from_thread( victim ), task_team, victim_td->td.td_deque_ntasks,
+                      gtid, __kmp_gtid_from_thread( victim ), task_team, KMP_TASK_DEQUE_NTASKS( victim_td ),
                       victim_td->td.td_deque_head, victim_td->td.td_deque_tail) );
         return NULL;
     }
 
-    __kmp_acquire_bootstrap_lock( & victim_td -> td.td_deque_lock );
+    deque = (kmp_task_array_t *) TCR_PTR( victim_td -> td.td_deque );
+    KMP_DEBUG_ASSERT( deque != NULL );
+    taskdata = deque -> ta_tasks[ head & deque -> ta_mask ];
 
-    // Check again after we acquire the lock
-    if ( (TCR_4(victim_td -> td.td_deque_ntasks) == 0) ||
-         (TCR_PTR(victim->th.th_task_team) != task_team)) // GEH: why would this happen?
+    if ( is_constrained &&
+         ! __kmp_task_is_descendant( __kmp_threads[ gtid ], taskdata, & victim_td -> td.td_deque_head, head ) )
     {
-        __kmp_release_bootstrap_lock( & victim_td -> td.td_deque_lock );
         KA_TRACE(10, ("__kmp_steal_task(exit #2): T#%d could not steal from T#%d: task_team=%p "
                       "ntasks=%d head=%u tail=%u\n",
-                      gtid, __kmp_gtid_from_thread( victim ), task_team, victim_td->td.td_deque_ntasks,
+                      gtid, __kmp_gtid_from_thread( threads_data[victim_tid].td.td_thr ),
+                      task_team, KMP_TASK_DEQUE_NTASKS( victim_td ),
                       victim_td->td.td_deque_head, victim_td->td.td_deque_tail) );
         return NULL;
     }
 
-    KMP_DEBUG_ASSERT( victim_td -> td.td_deque != NULL );
-
-    if ( !is_constrained ) {
-        taskdata = victim_td -> td.td_deque[ victim_td -> td.td_deque_head ];
-        // Bump head pointer and Wrap.
-        victim_td -> td.td_deque_head = ( victim_td -> td.td_deque_head + 1 ) & TASK_DEQUE_MASK;
-    } else {
-        // While we have postponed tasks let's steal from tail of the deque (smaller tasks)
-        kmp_int32 tail = ( victim_td -> td.td_deque_tail - 1 ) & TASK_DEQUE_MASK;  // Wrap index.
-        taskdata = victim_td -> td.td_deque[ tail ];
-        // we need to check if the candidate obeys task scheduling constraint:
-        // only child of current task can be scheduled
-        kmp_taskdata_t * current = __kmp_threads[ gtid ]->th.th_current_task;
-        kmp_int32        level = current->td_level;
-        kmp_taskdata_t * parent = taskdata->td_parent;
-        while ( parent != current && parent->td_level > level ) {
-            parent = parent->td_parent;  // check generation up to the level of the current task
-            KMP_DEBUG_ASSERT(parent != NULL);
-        }
-        if ( parent != current ) {
-            // If the tail task is not a child, then no other childs can appear in the deque (?).
-            __kmp_release_bootstrap_lock( & victim_td -> td.td_deque_lock );
-            KA_TRACE(10, ("__kmp_steal_task(exit #2): T#%d could not steal from T#%d: task_team=%p "
-                          "ntasks=%d head=%u tail=%u\n",
-                          gtid, __kmp_gtid_from_thread( threads_data[victim_tid].td.td_thr ),
-                          task_team, victim_td->td.td_deque_ntasks,
-                          victim_td->td.td_deque_head, victim_td->td.td_deque_tail) );
-            return NULL;
-        }
-        victim_td -> td.td_deque_tail = tail;
-    }
-    if (*thread_finished) {
+    was_finished = *thread_finished;
+    if (was_finished) {
         // We need to un-mark this victim as a finished victim.  This must be done before
-        // releasing the lock, or else other threads (starting with the master victim)
+        // the task leaves the deque, or else other threads (starting with the master victim)
         // might be prematurely released from the barrier!!!
-        kmp_uint32 count = KMP_TEST_THEN_INC32( (kmp_int32 *)unfinished_threads );
+        KMP_TEST_THEN_INC32( (kmp_int32 *)unfinished_threads );
 
-        KA_TRACE(20, ("__kmp_steal_task: T#%d inc unfinished_threads to %d: task_team=%p\n",
-                      gtid, count + 1, task_team) );
+        KA_TRACE(20, ("__kmp_steal_task: T#%d inc unfinished_threads: task_team=%p\n",
+                      gtid, task_team) );
 
         *thread_finished = FALSE;
     }
-    TCW_4(victim_td -> td.td_deque_ntasks, TCR_4(victim_td -> td.td_deque_ntasks) - 1);
 
-    __kmp_release_bootstrap_lock( & victim_td -> td.td_deque_lock );
+    if ( ! KMP_COMPARE_AND_STORE_ACQ32( (volatile kmp_int32 *) & victim_td -> td.td_deque_head, head, head + 1 ) ) {
+        // Someone else took the task first.
+        if (was_finished) {
+            KMP_TEST_THEN_DEC32( (kmp_int32 *)unfinished_threads );
+
+            KA_TRACE(20, ("__kmp_steal_task: T#%d dec unfinished_threads: task_team=%p\n",
+                          gtid, task_team) );
+
+            *thread_finished = TRUE;
+        }
+        KA_TRACE(10, ("__kmp_steal_task(exit #2): T#%d lost the race to steal from T#%d: task_team=%p "
+                      "ntasks=%d head=%u tail=%u\n",
+                      gtid, __kmp_gtid_from_thread( victim ), task_team, KMP_TASK_DEQUE_NTASKS( victim_td ),
+                      victim_td->td.td_deque_head, victim_td->td.td_deque_tail) );
+        return NULL;
+    }
+
+    KMP_STATS_GTID_COUNT( gtid, KMP_STAT_TASK_STEAL );
 
     KA_TRACE(10, ("__kmp_steal_task(exit #3): T#%d stole task %p from T#d: task_team=%p "
                   "ntasks=%d head=%u tail=%u\n",
                   gtid, taskdata, __kmp_gtid_from_thread( victim ), task_team,
-                  victim_td->td.td_deque_ntasks, victim_td->td.td_deque_head,
+                  KMP_TASK_DEQUE_NTASKS( victim_td ), victim_td->td.td_deque_head,
                   victim_td->td.td_deque_tail) );
 
     task = KMP_TASKDATA_TO_TASK( taskdata );
@@ -1493,7 +2341,7 @@ __kmp_execute_tasks( kmp_info_t *thread,
             KMP_YIELD( __kmp_library == library_throughput );   // Yield before executing next task
             // If the execution of the stolen task resulted in more tasks being
             // placed on our run queue, then restart the whole process.
-            if (TCR_4(threads_data[ tid ].td.td_deque_ntasks) != 0) {
+            if (KMP_TASK_DEQUE_NTASKS( & threads_data[ tid ] ) > 0) {
                 KA_TRACE(20, ("__kmp_execute_tasks: T#%d stolen task spawned other tasks, restart\n",
                               gtid) );
                 goto start;
@@ -1588,7 +2436,7 @@ __kmp_execute_tasks( kmp_info_t *thread,
 
             // If the execution of the stolen task resulted in more tasks being
             // placed on our run queue, then restart the whole process.
-            if (TCR_4(threads_data[ tid ].td.td_deque_ntasks) != 0) {
+            if (KMP_TASK_DEQUE_NTASKS( & threads_data[ tid ] ) > 0) {
                 KA_TRACE(20, ("__kmp_execute_tasks: T#%d stolen task spawned other tasks, restart\n",
                               gtid) );
                 goto start;
@@ -1757,42 +2605,45 @@ static kmp_bootstrap_lock_t __kmp_task_team_lock = KMP_BOOTSTRAP_LOCK_INITIALIZE
 static void
 __kmp_alloc_task_deque( kmp_info_t *thread, kmp_thread_data_t *thread_data )
 {
-    __kmp_init_bootstrap_lock( & thread_data -> td.td_deque_lock );
+    kmp_task_array_t * deque;
+
     KMP_DEBUG_ASSERT( thread_data -> td.td_deque == NULL );
 
     // Initialize last stolen task field to "none"
     thread_data -> td.td_deque_last_stolen = -1;
 
-    KMP_DEBUG_ASSERT( TCR_4(thread_data -> td.td_deque_ntasks) == 0 );
-    KMP_DEBUG_ASSERT( thread_data -> td.td_deque_head == 0 );
-    KMP_DEBUG_ASSERT( thread_data -> td.td_deque_tail == 0 );
+    KMP_DEBUG_ASSERT( KMP_TASK_DEQUE_NTASKS( thread_data ) == 0 );
 
     KE_TRACE( 10, ( "__kmp_alloc_task_deque: T#%d allocating deque[%d] for thread_data %p\n",
                    __kmp_gtid_from_thread( thread ), TASK_DEQUE_SIZE, thread_data ) );
     // Allocate space for task deque, and zero the deque
     // Cannot use __kmp_thread_calloc() because threads not around for
     // kmp_reap_task_team( ).
-    thread_data -> td.td_deque = (kmp_taskdata_t **)
-            __kmp_allocate( TASK_DEQUE_SIZE * sizeof(kmp_taskdata_t *));
+    deque = (kmp_task_array_t *)
+            __kmp_allocate( sizeof(kmp_task_array_t) + ( TASK_DEQUE_SIZE - 1 ) * sizeof(kmp_taskdata_t *) );
+    deque -> ta_mask = TASK_DEQUE_SIZE - 1;
+    thread_data -> td.td_deque = deque;
 }
 
 
 //------------------------------------------------------------------------------
 // __kmp_free_task_deque:
-// Deallocates a task deque for a particular thread.
+// Deallocates a task deque for a particular thread, together with the arrays
+// it has outgrown.
 // Happens at library deallocation so don't need to reset all thread data fields.
 
 static void
 __kmp_free_task_deque( kmp_thread_data_t *thread_data )
 {
-    __kmp_acquire_bootstrap_lock( & thread_data -> td.td_deque_lock );
-
-    if ( thread_data -> td.td_deque != NULL ) {
-        TCW_4(thread_data -> td.td_deque_ntasks, 0);
-         __kmp_free( thread_data -> td.td_deque );
-        thread_data -> td.td_deque = NULL;
+    kmp_task_array_t * deque = thread_data -> td.td_deque;
+
+    thread_data -> td.td_deque = NULL;
+    thread_data -> td.td_deque_head = thread_data -> td.td_deque_tail = 0;
+    while ( deque != NULL ) {
+        kmp_task_array_t * prev = deque -> ta_prev;
+        __kmp_free( deque );
+        deque = prev;
     }
-    __kmp_release_bootstrap_lock( & thread_data -> td.td_deque_lock );
 
 #ifdef BUILD_TIED_TASK_STACK
     // GEH: Figure out what to do here for td_susp_tied_tasks
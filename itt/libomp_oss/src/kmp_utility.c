@@ -172,6 +172,8 @@ __kmp_query_cpuid( kmp_cpuinfo_t *p )
     p->initialized = 1;
 
     p->sse2 = 1; // Assume SSE2 by default.
+    p->rtm  = 0;
+    p->cx16 = 0;
 
     __kmp_x86_cpuid( 0, 0, &buf );
 
@@ -208,6 +210,7 @@ __kmp_query_cpuid( kmp_cpuinfo_t *p )
         }; // for
         
         p->sse2 = ( buf.edx >> 26 ) & 1;
+        p->cx16 = ( buf.ecx >> 13 ) & 1;
         
 #ifdef KMP_DEBUG
         
@@ -302,6 +305,13 @@ __kmp_query_cpuid( kmp_cpuinfo_t *p )
                         i, buf.eax, buf.ebx, buf.ecx, buf.edx ) );
         }
 #endif
+
+        if ( max_arg >= 7 ) {
+            __kmp_x86_cpuid( 7, 0, &buf );
+            /* RTM - Restricted Transactional Memory: CPUID(EAX=7,ECX=0).EBX[11] */
+            p->rtm = ( buf.ebx >> 11 ) & 1;
+            KA_TRACE( trace_level, ( "INFO: RTM %s\n", p->rtm ? "supported" : "not supported" ) );
+        }
     }; // if
     
     { // Parse CPU brand string for frequency.
@@ -98,6 +98,8 @@ LINK_TYPE    := $(call check_variable,LINK_TYPE,dyna stat)
 OMP_VERSION  := $(call check_variable,OMP_VERSION,40 30 25)
 # Generate optimized code.
 OPTIMIZATION := $(call check_variable,OPTIMIZATION,off on)
+# Collect runtime statistics (enabled at run time with KMP_STATS).
+STATS        := $(call check_variable,STATS,off on)
 # Target compiler.
 TARGET_COMPILER := $(call check_variable,TARGET_COMPILER,12 11)
 # Library version: 4 -- legacy, 5 -- compat.
@@ -118,6 +120,7 @@ define curr_config
     LINK_TYPE=$(LINK_TYPE)
     OMP_VERSION=$(OMP_VERSION)
     OPTIMIZATION=$(OPTIMIZATION)
+    STATS=$(STATS)
     TARGET_COMPILER=$(TARGET_COMPILER)
     VERSION=$(VERSION)
     CPPFLAGS=$(subst $(space),_,$(CPPFLAGS))
@@ -436,6 +439,9 @@ endif
 ifeq "$(COVERAGE)" "on"
     cpp-flags += -D COVER
 endif
+ifeq "$(STATS)" "on"
+    cpp-flags += -D KMP_STATS_ENABLED=1
+endif
 # Assertions in OMP RTL code are controlled by two macros: KMP_DEBUG enables or disables assertions
 # iff KMP_USE_ASSERT is defined. If KMP_USE_ASSERT is not defined, assertions disabled regardless of
 # KMP_DEBUG. It was implemented for code coverage -- to have debug build with no assertion, but it
@@ -625,6 +631,8 @@ else # norm or prof
         kmp_dispatch                 \
         kmp_lock                     \
         kmp_sched                    \
+        kmp_stats                    \
+        kmp_ompt                     \
         $(empty)
     # OS-specific files.
     ifeq "$(os)" "win"
@@ -737,7 +745,7 @@ out_inc_files  = \
     $(addprefix $(out_ptf_dir)include/,omp_lib.mod omp_lib_kinds.mod) \
     $(addprefix $(out_ptf_dir)include_compat/,iomp_lib.h)
 out_cmn_files  = \
-    $(addprefix $(out_cmn_dir)include/,omp.h omp_lib.h omp_lib.f omp_lib.f90) \
+    $(addprefix $(out_cmn_dir)include/,omp.h ompt.h omp_lib.h omp_lib.f omp_lib.f90) \
     $(addprefix $(out_cmn_dir)include_compat/,iomp.h)
 ifneq "$(out_lib_fat_dir)" ""
     out_lib_fat_files  = $(addprefix $(out_lib_fat_dir),$(lib_file) $(imp_file))
@@ -1356,6 +1364,41 @@ ifneq "$(filter %-dyna win-%,$(os)-$(LINK_TYPE))" ""
 
 endif
 
+# --------------------------------------------------------------------------------------------------
+# Benchmarks.
+# --------------------------------------------------------------------------------------------------
+
+# --- bench ---
+
+# bench is not a part of tests: its results are meaningful on a quiet machine only, so it is run
+# only when requested explicitly. It does actual work on Linux* OS and OS X* (GNU compiler).
+ifneq "$(filter lin mac,$(os))" ""
+
+    # The benchmark calls __kmpc_* entry points directly, so it is built by GNU compiler without
+    # OpenMP support, like test-touch. run-bench.pl sweeps thread counts and runtime settings and
+    # collects results into bench/bench.csv. Options may be passed to it via BENCH_FLAGS, e. g.
+    # BENCH_FLAGS="--threads=8,16 --affinity=compact".
+    bench-exe-file = bench/bench-overhead$(exe)
+    bench-c-flags += -O2
+    bench-c-flags += $(if $(filter 64,$(arch)),,$(if $(filter 32,$(arch)),-m32,-m64))
+    ifeq "$(os)" "lin"
+        bench-c-flags += -pthread
+        bench-env     += LD_LIBRARY_PATH=".:$(LD_LIBRARY_PATH)"
+    else # mac
+        bench-env     += DYLD_LIBRARY_PATH=".:$(DYLD_LIBRARY_PATH)"
+    endif
+    bench-ld-flags += -lm
+
+    bench : $(bench-exe-file) $(tools_dir)run-bench.pl
+	    $(target)
+	    $(bench-env) $(perl) $(tools_dir)run-bench.pl $(BENCH_FLAGS) --output=bench/bench.csv $<
+
+    $(bench-exe-file) : bench-overhead.c $(lib_file) bench/.dir .rebuild
+	    $(target)
+	    gcc $(bench-c-flags) -o $@ $< $(lib_file) $(bench-ld-flags)
+
+endif
+
 
 # --------------------------------------------------------------------------------------------------
 # Fortran files.
@@ -0,0 +1,187 @@
+/*
+ * ompt.h -- Tool interface: callbacks for parallel, task and synchronization events.
+ */
+
+/* <copyright>
+    Copyright (c) 2013 Intel Corporation.  All Rights Reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+      * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the name of Intel Corporation nor the names of its
+        contributors may be used to endorse or promote products derived
+        from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+------------------------------------------------------------------------
+
+    Portions of this software are protected under the following patents:
+        U.S. Patent 5,812,852
+        U.S. Patent 6,792,599
+        U.S. Patent 7,069,556
+        U.S. Patent 7,328,433
+        U.S. Patent 7,500,242
+
+</copyright> */
+
+#ifndef OMPT_H
+#define OMPT_H
+
+/*
+ * A performance tool is attached by defining
+ *
+ *     int ompt_initialize( ompt_function_lookup_t lookup,
+ *                          const char *runtime_version, unsigned int ompt_version );
+ *
+ * in the executable or in any shared object loaded with it.  The runtime looks
+ * the symbol up once, during serial initialization, and calls it before any
+ * thread other than the initial one exists.  The tool uses lookup() to get
+ * the entry points below (by name, e.g. "ompt_set_callback"), registers the
+ * callbacks it wants and returns non-zero; returning zero disables the
+ * interface for the rest of the run.
+ *
+ * Callbacks are invoked on the thread the event happens on.  They must not
+ * call back into the OpenMP runtime.
+ */
+
+#define OMPT_VERSION 1
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+typedef unsigned long long ompt_thread_id_t;    /* global thread number + 1 */
+typedef unsigned long long ompt_parallel_id_t;  /* unique per active parallel region, 0 = none */
+typedef unsigned long long ompt_task_id_t;      /* unique per task, 0 = none */
+typedef unsigned long long ompt_wait_id_t;      /* address of the lock or critical name */
+
+/*
+ * What a thread is doing.  The runtime keeps a state word per thread current
+ * at every wait, barrier, lock and task switch site, so a sampling tool can
+ * read it with ompt_get_state() from a signal handler on the sampled thread.
+ */
+typedef enum ompt_state_e {
+    ompt_state_undefined      = 0x00,  /* not an OpenMP thread, or not yet registered */
+
+    ompt_state_work_serial    = 0x01,  /* outside any parallel region */
+    ompt_state_work_parallel  = 0x02,  /* executing code of a parallel region or task */
+
+    ompt_state_idle           = 0x10,  /* worker waiting for a parallel region */
+    ompt_state_overhead       = 0x20,  /* forking or joining a team */
+
+    ompt_state_wait_barrier   = 0x40,  /* in a barrier, incl. tasks executed there */
+    ompt_state_wait_taskwait  = 0x41,  /* in a taskwait or waiting for dependences */
+    ompt_state_wait_taskgroup = 0x42,  /* at the end of a taskgroup */
+    ompt_state_wait_lock      = 0x43,  /* acquiring a user lock (wait id: the lock) */
+    ompt_state_wait_critical  = 0x44,  /* entering a critical section (wait id: its name) */
+    ompt_state_wait_ordered   = 0x45   /* waiting for its turn in an ordered section */
+} ompt_state_t;
+
+/*
+ * Stack frames of a task.  exit_runtime_frame is the runtime frame that called
+ * the task's code (NULL while the task is not executing user code);
+ * reenter_runtime_frame is the runtime frame the task's code has called into
+ * to start a nested parallel region (NULL otherwise).  Frames between the two
+ * belong to the user.
+ */
+typedef struct ompt_frame_s {
+    void *exit_runtime_frame;
+    void *reenter_runtime_frame;
+} ompt_frame_t;
+
+/*
+ * Events.  The second column is the callback type the tool must register for
+ * the event.
+ */
+#define FOREACH_OMPT_EVENT( macro )                                                                 \
+    macro( ompt_event_parallel_begin,       ompt_new_parallel_callback_t,   1 )  /* team forked */  \
+    macro( ompt_event_parallel_end,         ompt_parallel_callback_t,       2 )  /* team joined */  \
+    macro( ompt_event_implicit_task_begin,  ompt_parallel_callback_t,       3 )                     \
+    macro( ompt_event_implicit_task_end,    ompt_parallel_callback_t,       4 )                     \
+    macro( ompt_event_task_begin,           ompt_new_task_callback_t,       5 )  /* explicit */     \
+    macro( ompt_event_task_end,             ompt_task_callback_t,           6 )                     \
+    macro( ompt_event_task_switch,          ompt_task_switch_callback_t,    7 )                     \
+    macro( ompt_event_barrier_begin,        ompt_parallel_callback_t,       8 )                     \
+    macro( ompt_event_barrier_end,          ompt_parallel_callback_t,       9 )                     \
+    macro( ompt_event_idle_begin,           ompt_thread_callback_t,        10 )  /* waiting */      \
+    macro( ompt_event_idle_end,             ompt_thread_callback_t,        11 )                     \
+    macro( ompt_event_wait_lock,            ompt_wait_callback_t,          12 )                     \
+    macro( ompt_event_acquired_lock,        ompt_wait_callback_t,          13 )                     \
+    macro( ompt_event_release_lock,         ompt_wait_callback_t,          14 )                     \
+    macro( ompt_event_wait_critical,        ompt_wait_callback_t,          15 )                     \
+    macro( ompt_event_acquired_critical,    ompt_wait_callback_t,          16 )                     \
+    macro( ompt_event_release_critical,     ompt_wait_callback_t,          17 )                     \
+    macro( ompt_event_thread_begin,         ompt_thread_callback_t,        18 )                     \
+    macro( ompt_event_thread_end,           ompt_thread_callback_t,        19 )                     \
+    macro( ompt_event_runtime_shutdown,     ompt_callback_t,               20 )
+
+typedef enum ompt_event_e {
+#define ompt_event_macro( event, callback, id ) event = id,
+    FOREACH_OMPT_EVENT( ompt_event_macro )
+#undef ompt_event_macro
+    ompt_event_last
+} ompt_event_t;
+
+/* Callback types. */
+typedef void (*ompt_callback_t)( void );
+typedef void (*ompt_thread_callback_t)( ompt_thread_id_t thread_id );
+typedef void (*ompt_new_parallel_callback_t)( ompt_task_id_t parent_task_id, ompt_parallel_id_t parallel_id,
+                                              unsigned int team_size, void *parallel_function );
+typedef void (*ompt_parallel_callback_t)( ompt_parallel_id_t parallel_id, ompt_task_id_t task_id );
+typedef void (*ompt_new_task_callback_t)( ompt_task_id_t parent_task_id, ompt_task_id_t new_task_id,
+                                          void *task_function );
+typedef void (*ompt_task_callback_t)( ompt_task_id_t task_id );
+typedef void (*ompt_task_switch_callback_t)( ompt_task_id_t suspended_task_id, ompt_task_id_t resumed_task_id );
+typedef void (*ompt_wait_callback_t)( ompt_wait_id_t wait_id );
+
+/* Entry points returned by the lookup function. */
+typedef void (*ompt_interface_fn_t)( void );
+typedef ompt_interface_fn_t (*ompt_function_lookup_t)( const char *entry_point );
+
+/* "ompt_set_callback": returns 1 if the callback was set, 0 for an unknown event. */
+typedef int (*ompt_set_callback_t)( ompt_event_t event, ompt_callback_t callback );
+/* "ompt_get_callback": returns 1 and stores the callback if one is registered. */
+typedef int (*ompt_get_callback_t)( ompt_event_t event, ompt_callback_t *callback );
+/* "ompt_get_thread_id": id of the calling thread, 0 if it is not an OpenMP thread. */
+typedef ompt_thread_id_t (*ompt_get_thread_id_t)( void );
+
+/*
+ * Inquiry functions for sampling tools.  They only read the calling thread's
+ * runtime data, take no locks and may be called from a signal handler.
+ */
+/* "ompt_get_state": state of the calling thread; stores the wait id if wait_id is not NULL. */
+typedef ompt_state_t (*ompt_get_state_t)( ompt_wait_id_t *wait_id );
+/* "ompt_get_task_id": id of the current task (depth 0) or of its depth'th ancestor, 0 if none. */
+typedef ompt_task_id_t (*ompt_get_task_id_t)( int depth );
+/* "ompt_get_task_frame": frames of the current task or of an ancestor, NULL if none. */
+typedef ompt_frame_t * (*ompt_get_task_frame_t)( int depth );
+/* "ompt_get_parallel_id": id of the innermost active parallel region, 0 if none. */
+typedef ompt_parallel_id_t (*ompt_get_parallel_id_t)( void );
+
+/* Defined by the tool. */
+extern int ompt_initialize( ompt_function_lookup_t lookup, const char *runtime_version,
+                            unsigned int ompt_version );
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif /* OMPT_H */
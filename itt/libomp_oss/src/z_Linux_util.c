@@ -49,6 +49,7 @@
 #include "kmp_str.h"
 #include "kmp_i18n.h"
 #include "kmp_io.h"
+#include "kmp_stats.h"
 
 #include <alloca.h>
 #include <unistd.h>
@@ -1599,6 +1600,13 @@ __kmp_suspend_initialize( void )
     KMP_CHECK_SYSFAIL( "pthread_mutexattr_init", status );
     status = pthread_condattr_init( &__kmp_suspend_cond_attr );
     KMP_CHECK_SYSFAIL( "pthread_condattr_init", status );
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+    if ( __kmp_futex_parking && ! __kmp_futex_determine_capable() ) {
+        __kmp_futex_parking = FALSE;
+    }
+    KA_TRACE( 10, ( "__kmp_suspend_initialize: futex parking %s\n",
+                    __kmp_futex_parking ? "on" : "off" ) );
+#endif
 }
 
 static void
@@ -1637,6 +1645,93 @@ __kmp_suspend_uninitialize_thread( kmp_info_t *th )
     }
 }
 
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+
+/*
+ * Futex parking (KMP_FUTEX_PARKING).  The sleep state lives in the spin
+ * variable itself, so the thread waits on that word directly: no mutex or
+ * condition variable is taken on either side.  Any change to the word (the
+ * release bump or the clearing of the sleep bit) makes a pending FUTEX_WAIT
+ * fail, and __kmp_resume_futex always wakes after clearing the bit, so a
+ * wake-up cannot be lost.
+ *
+ * Only the sleeper clears th_sleep_loc.  A resumer that reads a stale
+ * location finds the sleep bit already clear there and does nothing.
+ */
+
+static void
+__kmp_suspend_futex( kmp_info_t *th, int th_gtid, volatile kmp_uint *spinner, kmp_uint checker )
+{
+    kmp_uint old_spin, spin_val;
+    int deactivated = FALSE;
+
+    old_spin = __kmp_test_then_or32( (volatile kmp_int32 *) spinner,
+                                     KMP_BARRIER_SLEEP_STATE );
+    if ( old_spin == checker ) {
+        __kmp_test_then_and32( (volatile kmp_int32 *) spinner, ~(KMP_BARRIER_SLEEP_STATE) );
+        KF_TRACE( 5, ( "__kmp_suspend_futex: T#%d false alarm, reset sleep bit for spin(%p)\n",
+                       th_gtid, spinner) );
+        return;
+    }
+
+    KMP_STATS_COUNT( th, KMP_STAT_SUSPEND );
+    KMP_STATS_TIMER_START( th, suspend_start );
+    TCW_PTR(th->th.th_sleep_loc, spinner);
+    while ( ( spin_val = TCR_4( *spinner ) ) & KMP_BARRIER_SLEEP_STATE ) {
+        if ( ! deactivated ) {
+            th->th.th_active = FALSE;
+            if ( th->th.th_active_in_pool ) {
+                th->th.th_active_in_pool = FALSE;
+                KMP_TEST_THEN_DEC32(
+                  (kmp_int32 *) &__kmp_thread_pool_active_nth );
+                KMP_DEBUG_ASSERT( TCR_4(__kmp_thread_pool_active_nth) >= 0 );
+            }
+            deactivated = TRUE;
+        }
+        KF_TRACE( 15, ( "__kmp_suspend_futex: T#%d futex_wait(%p, 0x%x)\n",
+                        th_gtid, spinner, spin_val ) );
+        // EAGAIN (the word changed) and EINTR just send us around the loop again.
+        syscall( __NR_futex, spinner, FUTEX_WAIT, spin_val, NULL, NULL, 0 );
+    }
+    TCW_PTR(th->th.th_sleep_loc, NULL);
+    KMP_STATS_TIMER_STOP( th, KMP_TIMER_SUSPEND, suspend_start );
+
+    if ( deactivated ) {
+        th->th.th_active = TRUE;
+        if ( TCR_4(th->th.th_in_pool) ) {
+            KMP_TEST_THEN_INC32(
+              (kmp_int32 *) &__kmp_thread_pool_active_nth );
+            th->th.th_active_in_pool = TRUE;
+        }
+    }
+    KF_TRACE( 30, ("__kmp_suspend_futex: T#%d exit\n", th_gtid ) );
+}
+
+static void
+__kmp_resume_futex( kmp_info_t *th, int target_gtid, volatile kmp_uint *spin )
+{
+    kmp_uint old_spin;
+
+    if ( spin == NULL ) {
+        spin = (volatile kmp_uint *)TCR_PTR(th->th.th_sleep_loc);
+        if ( spin == NULL ) {
+            return;
+        }
+    }
+    old_spin = __kmp_test_then_and32( (kmp_int32 volatile *) spin,
+      ~( KMP_BARRIER_SLEEP_STATE ) );
+    if ( ( old_spin & KMP_BARRIER_SLEEP_STATE ) == 0 ) {
+        KF_TRACE( 5, ( "__kmp_resume_futex: T#%d already awake - spin(%p): %u\n",
+                       target_gtid, spin, old_spin ) );
+        return;
+    }
+    KF_TRACE( 5, ( "__kmp_resume_futex: waking T#%d, reset sleep bit for spin(%p): %u => %u\n",
+                   target_gtid, spin, old_spin, *spin ) );
+    syscall( __NR_futex, spin, FUTEX_WAKE, 1, NULL, NULL, 0 );
+}
+
+#endif // KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+
 /*
  * This routine puts the calling thread to sleep after setting the
  * sleep bit for the indicated spin variable to true.
@@ -1651,6 +1746,13 @@ __kmp_suspend( int th_gtid, volatile kmp_uint *spinner, kmp_uint checker )
 
     KF_TRACE( 30, ("__kmp_suspend: T#%d enter for spin = %p\n", th_gtid, spinner ) );
 
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+    if ( __kmp_futex_parking ) {
+        __kmp_suspend_futex( th, th_gtid, spinner, checker );
+        return;
+    }
+#endif
+
     __kmp_suspend_initialize_thread( th );
 
     status = pthread_mutex_lock( &th->th.th_suspend_mx.m_mutex );
@@ -1680,6 +1782,8 @@ __kmp_suspend( int th_gtid, volatile kmp_uint *spinner, kmp_uint checker )
          * not been signaled or broadcast
          */
         int deactivated = FALSE;
+        KMP_STATS_COUNT( th, KMP_STAT_SUSPEND );
+        KMP_STATS_TIMER_START( th, suspend_start );
         TCW_PTR(th->th.th_sleep_loc, spinner);
         while ( TCR_4( *spinner ) & KMP_BARRIER_SLEEP_STATE ) {
 #ifdef DEBUG_SUSPEND
@@ -1746,6 +1850,7 @@ __kmp_suspend( int th_gtid, volatile kmp_uint *spinner, kmp_uint checker )
 #endif
 
         } // while
+        KMP_STATS_TIMER_STOP( th, KMP_TIMER_SUSPEND, suspend_start );
 
         //
         // Mark the thread as active again
@@ -1798,6 +1903,13 @@ __kmp_resume( int target_gtid, volatile kmp_uint *spin )
 
     KMP_DEBUG_ASSERT( gtid != target_gtid );
 
+#if KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64)
+    if ( __kmp_futex_parking ) {
+        __kmp_resume_futex( th, target_gtid, spin );
+        return;
+    }
+#endif
+
     __kmp_suspend_initialize_thread( th );
 
     status = pthread_mutex_lock( &th->th.th_suspend_mx.m_mutex );
@@ -593,6 +593,13 @@ Makefile goal to build (or clean).
 
 Build C<lib>, C<tests>, C<inc>.
 
+=item B<bench>
+
+Linux* OS and OS X* only: build F<bench-overhead> micro-benchmarks and run them with
+F<run-bench.pl> over thread counts, barrier patterns, lock kinds, and reduction methods. Results
+are saved to F<bench/bench.csv> in build directory. Options for F<run-bench.pl> may be passed via
+C<BENCH_FLAGS> environment variable. The goal is not a part of C<tests>.
+
 =item B<common>
 
 Build common (architecture-independent) files. Common files are not configuration-dependent, so
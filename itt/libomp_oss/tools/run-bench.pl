@@ -0,0 +1,261 @@
+#!/usr/bin/perl
+
+# <copyright>
+#    Copyright (c) 2013 Intel Corporation.  All Rights Reserved.
+#
+#    Redistribution and use in source and binary forms, with or without
+#    modification, are permitted provided that the following conditions
+#    are met:
+#
+#      * Redistributions of source code must retain the above copyright
+#        notice, this list of conditions and the following disclaimer.
+#      * Redistributions in binary form must reproduce the above copyright
+#        notice, this list of conditions and the following disclaimer in the
+#        documentation and/or other materials provided with the distribution.
+#      * Neither the name of Intel Corporation nor the names of its
+#        contributors may be used to endorse or promote products derived
+#        from this software without specific prior written permission.
+#
+#    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+#    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+#    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+#    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+#    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+#    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+#    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+#    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+#    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+#    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+#    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+#
+#------------------------------------------------------------------------
+#
+#    Portions of this software are protected under the following patents:
+#        U.S. Patent 5,812,852
+#        U.S. Patent 6,792,599
+#        U.S. Patent 7,069,556
+#        U.S. Patent 7,328,433
+#        U.S. Patent 7,500,242
+#
+# </copyright>
+
+use strict;
+use warnings;
+
+use FindBin;
+use lib "$FindBin::Bin/lib";
+
+use tools;
+
+our $VERSION = "0.001";
+
+my @barrier_patterns = qw{ linear tree hyper hierarchical };
+my @lock_kinds       = ( qw{ tas ticket queuing drdpa adaptive }, ( $^O eq "linux" ? "futex" : () ) );
+my @reductions       = qw{ critical atomic tree };
+
+my $threads;
+my @affinity;
+my $samples;
+my $target;
+my $output;
+
+get_options(
+    "threads=s"  => \$threads,
+    "affinity=s" => \@affinity,
+    "samples=i"  => \$samples,
+    "target=f"   => \$target,
+    "output=s"   => \$output,
+);
+
+@ARGV == 1 or cmdline_error( "Exactly one benchmark executable expected" );
+my $bench = shift( @ARGV );
+-x $bench or runtime_error( "\"$bench\" is not an executable file" );
+
+my @threads;
+if ( defined( $threads ) ) {
+    @threads = split( ",", $threads );
+    foreach my $n ( @threads ) {
+        $n =~ m{\A[1-9]\d*\z} or cmdline_error( "Illegal thread count: \"$n\"" );
+    }; # foreach $n
+} else {
+    # Powers of two up to the number of processors, and the number of processors itself.
+    my $procs = backticks( [ $bench, "-P" ], -chomp => 1 );
+    for ( my $n = 1; $n < $procs; $n *= 2 ) {
+        push( @threads, $n );
+    }; # for
+    push( @threads, $procs );
+}; # if
+if ( not @affinity ) {
+    @affinity = ( undef );    # Run with whatever KMP_AFFINITY the caller has.
+}; # if
+
+#
+# Each sweep lists the tests to run and the settings to run them under. Tests not affected by a
+# setting are run once, in the "base" sweep.
+#
+my @sweeps = (
+    {
+        tests => [ qw{ parallel for single atomic task } ],
+        envs  => [ {} ],
+    },
+    {
+        tests => [ qw{ parallel barrier reduction } ],
+        envs  => [
+            map(
+                {
+                    KMP_FORKJOIN_BARRIER_PATTERN  => "$_,$_",
+                    KMP_PLAIN_BARRIER_PATTERN     => "$_,$_",
+                    KMP_REDUCTION_BARRIER_PATTERN => "$_,$_",
+                },
+                @barrier_patterns
+            )
+        ],
+    },
+    {
+        tests => [ qw{ critical lock } ],
+        envs  => [ map( { KMP_LOCK_KIND => $_ }, @lock_kinds ) ],
+    },
+    {
+        tests => [ qw{ reduction } ],
+        envs  => [ map( { KMP_FORCE_REDUCTION => $_ }, @reductions ) ],
+    },
+);
+
+my @results;
+my @opts = (
+    ( defined( $samples ) ? ( "-r", $samples ) : () ),
+    ( defined( $target  ) ? ( "-T", $target  ) : () ),
+);
+
+foreach my $affinity ( @affinity ) {
+    local $ENV{ KMP_AFFINITY } = $affinity if defined( $affinity );
+    foreach my $n ( @threads ) {
+        foreach my $sweep ( @sweeps ) {
+            foreach my $env ( @{ $sweep->{ envs } } ) {
+                local @ENV{ keys( %$env ) } = values( %$env );
+                my @output;
+                info(
+                    "Running with $n thread(s): @{ $sweep->{ tests } }" .
+                    join( "", map( " $_=$env->{ $_ }", sort( keys( %$env ) ) ) )
+                );
+                execute(
+                    [ $bench, ( @results ? () : "-H" ), "-t", $n, @opts, @{ $sweep->{ tests } } ],
+                    -stdout => \@output
+                );
+                push( @results, @output );
+            }; # foreach $env
+        }; # foreach $sweep
+    }; # foreach $n
+}; # foreach $affinity
+
+if ( defined( $output ) ) {
+    write_file( $output, \@results );
+} else {
+    print( @results );
+}; # if
+
+exit( 0 );
+
+__END__
+
+=pod
+
+=head1 NAME
+
+B<run-bench.pl> -- Run the overhead micro-benchmarks over a range of runtime settings.
+
+=head1 SYNOPSIS
+
+B<run-bench.pl> I<option>... I<bench-overhead>
+
+=head1 DESCRIPTION
+
+The script runs F<bench-overhead> (built from F<src/bench-overhead.c> by the C<bench> goal) for
+each thread count and affinity setting, once with the default runtime settings and once per
+barrier pattern, lock kind and forced reduction method for the tests affected by them. Results
+of all runs are collected into a single CSV table with one header line; each record carries the
+values of the environment variables it was measured with.
+
+The library must be found by the dynamic loader, e. g. through C<LD_LIBRARY_PATH>.
+
+=head1 OPTIONS
+
+=over
+
+=item B<--threads=>I<n>[,I<n>...]
+
+Thread counts to run with. By default, powers of two up to the number of processors and the
+number of processors itself.
+
+=item B<--affinity=>I<str>
+
+C<KMP_AFFINITY> setting to run with. The option may be specified several times. By default the
+benchmarks run with the current environment.
+
+=item B<--samples=>I<n>
+
+Number of samples per test (C<bench-overhead -r>).
+
+=item B<--target=>I<us>
+
+Minimal duration of one sample in microseconds (C<bench-overhead -T>).
+
+=item B<--output=>I<file>
+
+Write results to the file. By default results are printed to stdout.
+
+=item Standard Options
+
+=over
+
+=item B<--doc>
+
+=item B<--manual>
+
+Print full help message and exit.
+
+=item B<--help>
+
+Print short help message and exit.
+
+=item B<--usage>
+
+Print very short usage message and exit.
+
+=item B<--verbose>
+
+Do print informational messages.
+
+=item B<--version>
+
+Print program version and exit.
+
+=item B<--quiet>
+
+Work quiet, do not print informational messages.
+
+=back
+
+=back
+
+=head1 ARGUMENTS
+
+=over
+
+=item I<bench-overhead>
+
+The benchmark executable.
+
+=back
+
+=head1 EXAMPLES
+
+Run on 8 and 16 threads with compact and scatter affinity:
+
+    $ run-bench.pl --threads=8,16 --affinity=compact --affinity=scatter \
+        --output=bench.csv bench/bench-overhead
+
+=cut
+
+# end of file #
@@ -243,6 +243,9 @@ all :
 
 .PHONY : common clean clean-common fat inc l10n lib
 
+# Benchmarks are not a part of tests, they run only if requested explicitly.
+.PHONY : bench
+
 .PHONY : force-tests          tests
 .PHONY : force-test-touch     test-touch
 .PHONY : force-test-relo      test-relo